@@ -0,0 +1,1958 @@
+// *********************************************************************************** //
+// Parity harness: checks the GL kernels against a double precision host reference
+//
+// Every trial builds a dense network of random shape and activations, runs one
+// forward pass and one TrainNetwork() step on random inputs, targets and learning
+// rate, and compares outputs, errors and updated weights of every layer with the
+// same step computed on the host from the network's own starting weights. Trials
+// cycle through every kernel variant the autotuner can pick, and every third trial
+// runs on the CPU device instead. StaticNetwork, the CPU engine, is checked against
+// the same reference on a few fixed shapes. Quantized networks are checked against
+// calibration and int8 arithmetic done on the host. Layers the analytic reference
+// doesn't model, like convolution, pooling and self-attention, are checked with a
+// host forward pass, and their train step against central difference gradients of
+// its loss. Sparse (CSR) layers are checked against the dense reference with their
+// dropped weights set to 0, and inputs sent by SendSparseInputs() against it on the
+// same inputs zero filled. TrainNetworkBatch() of one sample is checked against
+// TrainNetwork() from the same weights.
+// Recurrent cells are trained on a random sequence and the gradient they descend is
+// compared with central differences of the loss of GL forward passes over it.
+// Networks paged out and back in by SetMemoryBudget() around every call, sparse
+// and int8 ones too, must match a clone that stays resident bit for bit.
+// PruneNetwork() of networks with units forced dead or constant must keep their
+// outputs, and its compacted weights are checked against the same cut on host.
+// A replay buffer filled from host and from dense and sparse network inputs must
+// hold the rows appended last, and TrainFromReplay() must train like
+// TrainNetworkBatch() on the rows it drew.
+// Async forward and train steps queued together must match the same steps run
+// synchronously, and deleting a network must finish its passes still in flight.
+// A session recorded with StartRecording() on a built and a loaded network must
+// replay with the same count of every kind of call and leave the same networks.
+// *********************************************************************************** //
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Parity
+{
+    //Float kernels against double reference: |gl - ref| <= AbsTolerance + RelTolerance * |ref|
+    const double AbsTolerance = 2e-5;
+    const double RelTolerance = 2e-4;
+
+    //Activations a dense layer can use, softmax only on output
+    const ActivationType Hidden[] = { Sigmoid, TanH, ReLu, Linear };
+    const ActivationType Output[] = { Sigmoid, TanH, ReLu, Linear, Softmax };
+
+    struct HostLayer
+    {
+        int size;
+        ActivationType fun;
+        std::vector<double> weights;    // (prev+1) per neuron, bias last
+        std::vector<double> out, err;
+    };
+
+    double activate(ActivationType Fun, double X)
+    {
+        switch(Fun)
+        {
+            case Sigmoid:   return 1.0 / (1.0 + std::exp(-X));
+            case TanH:      return std::tanh(X);
+            case ReLu:      return X > 0 ? X : 0;
+            default:        return X;
+        }
+    }
+
+    //Derivative in terms of the activated value, as the kernels compute it
+    double derivate(ActivationType Fun, double Y)
+    {
+        switch(Fun)
+        {
+            case Sigmoid:   return Y * (1.0 - Y);
+            case TanH:      return 1.0 - Y * Y;
+            case ReLu:      return Y > 0 ? 1.0 : 0.0;
+            default:        return 1.0;
+        }
+    }
+
+    const char* name(ActivationType Fun)
+    {
+        const char* names[] = { "sigmoid", "tanh", "relu", "leaky_relu", "linear", "softmax" };
+        return names[Fun];
+    }
+
+    std::vector<float> readNeurons(HermesNetwork::Layer Lyr)
+    {
+        std::vector<float> rgba(4 * Lyr->no_neuron);
+        if(Lyr->onHost)
+        {
+            for(int n = 0; n < Lyr->no_neuron; n++)
+            {
+                rgba[4 * n] = Lyr->hostNeurons[n];
+                rgba[4 * n + 2] = Lyr->hostErrors[n];
+            }
+            return rgba;
+        }
+        glBindTexture(GL_TEXTURE_2D, Lyr->NeuronsTex);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, rgba.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return rgba;
+    }
+
+    std::vector<double> readWeights(HermesNetwork::Layer Lyr)
+    {
+        HermesNetwork::fetchLayerWeights_Bias(Lyr);
+        return std::vector<double>(Lyr->weights, Lyr->weights + Lyr->no_weight);
+    }
+
+    //Overwrite weights of Lyr with Weights laid out as in its WeightsTex
+    void writeWeights(HermesNetwork::Layer Lyr, const std::vector<double>& Weights)
+    {
+        std::vector<float> w(Weights.begin(), Weights.end());
+        GLint width = 0, height = 0;
+        glBindTexture(GL_TEXTURE_2D, Lyr->WeightsTex);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_FLOAT, w.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        Lyr->weightVersion++;
+    }
+
+    //Softmax of logits in place
+    void softmax(std::vector<double>& Logits)
+    {
+        double top = Logits[0], total = 0;
+        for(double z: Logits)
+            top = std::max(top, z);
+        for(double& z: Logits)
+            total += (z = std::exp(z - top));
+        for(double& z: Logits)
+            z /= total;
+    }
+
+    //Forward pass of the network on host, outputs of every layer go into its out
+    void forward(const std::vector<double>& Inputs, std::vector<HostLayer>& Layers)
+    {
+        const std::vector<double>* in = &Inputs;
+        for(HostLayer& L: Layers)
+        {
+            int prev = in->size();
+            L.out.assign(L.size, 0);
+            for(int j = 0; j < L.size; j++)
+            {
+                double sum = L.weights[j * (prev + 1) + prev];
+                for(int i = 0; i < prev; i++)
+                    sum += L.weights[j * (prev + 1) + i] * (*in)[i];
+                L.out[j] = L.fun == Softmax ? sum : activate(L.fun, sum);
+            }
+            if(L.fun == Softmax)
+                softmax(L.out);
+            in = &L.out;
+        }
+    }
+
+    //One forward pass and training step of the network on host, in same order as TrainNetwork()
+    void reference(const std::vector<double>& Inputs, std::vector<HostLayer>& Layers, const std::vector<double>& Targets, double LearningRate)
+    {
+        forward(Inputs, Layers);
+
+        /* output error, softmax is trained with cross-entropy so its error is target - probability */
+        HostLayer& out = Layers.back();
+        out.err.assign(out.size, 0);
+        for(int j = 0; j < out.size; j++)
+            out.err[j] = (Targets[j] - out.out[j]) * derivate(out.fun, out.out[j]);
+
+        for(int k = (int)Layers.size() - 2; k >= 0; k--)
+        {
+            HostLayer &L = Layers[k], &next = Layers[k + 1];
+            L.err.assign(L.size, 0);
+            for(int i = 0; i < L.size; i++)
+            {
+                double sum = 0;
+                for(int j = 0; j < next.size; j++)
+                    sum += next.err[j] * next.weights[j * (L.size + 1) + i];
+                L.err[i] = sum * derivate(L.fun, L.out[i]);
+            }
+        }
+
+        for(size_t k = 0; k < Layers.size(); k++)
+        {
+            HostLayer& L = Layers[k];
+            const std::vector<double>& x = k ? Layers[k - 1].out : Inputs;
+            int prev = x.size();
+            for(int j = 0; j < L.size; j++)
+                for(int i = 0; i <= prev; i++)
+                    L.weights[j * (prev + 1) + i] += LearningRate * L.err[j] * (i < prev ? x[i] : 1.0);
+        }
+    }
+
+    //Largest violation of tolerance in a compared quantity, reported when above 1
+    struct Check
+    {
+        std::string what;
+        double absTolerance = AbsTolerance, relTolerance = RelTolerance;
+        double worst = 0, gl = 0, ref = 0;
+        int index = -1;
+
+        void compare(double GL, double Ref, int Index)
+        {
+            double ratio = std::abs(GL - Ref) / (absTolerance + relTolerance * std::abs(Ref));
+            if(!(ratio <= worst))
+            {
+                worst = ratio;
+                gl = GL;
+                ref = Ref;
+                index = Index;
+            }
+        }
+
+        bool passed() const
+        {
+            return worst <= 1.0;
+        }
+    };
+
+    //Prints result of a trial of given kind and every check that failed, true if all passed
+    bool report(const std::string& Trial, const std::vector<Check>& Checks)
+    {
+        bool passed = true;
+        for(const Check& c: Checks)
+            passed &= c.passed();
+        std::printf("%s %s\n", Trial.c_str(), passed ? "ok" : "FAILED");
+        for(const Check& c: Checks)
+            if(!c.passed())
+                std::printf("    %-22s [%d] gl %.9g ref %.9g\n", c.what.c_str(), c.index, c.gl, c.ref);
+        return passed;
+    }
+
+    //One forward and train step of a StaticNetwork against reference, true if they agree
+    template <ActivationType HiddenFun, ActivationType OutputFun>
+    bool staticTrial(std::mt19937& Rng)
+    {
+        auto uniform = [&](double Lo, double Hi) { return std::uniform_real_distribution<double>(Lo, Hi)(Rng); };
+        StaticNetwork<5, Layers<12, 7>, 3, HiddenFun, OutputFun> N;
+        int sizes[] = { 5, 12, 7, 3 };
+
+        std::vector<HostLayer> host;
+        const float* w = N.layers.weights.data();
+        host.push_back({ 12, HiddenFun, std::vector<double>(w, w + N.layers.weights.size()), {}, {} });
+        w = N.layers.next.weights.data();
+        host.push_back({ 7, HiddenFun, std::vector<double>(w, w + N.layers.next.weights.size()), {}, {} });
+        w = N.layers.next.next.weights.data();
+        host.push_back({ 3, OutputFun, std::vector<double>(w, w + N.layers.next.next.weights.size()), {}, {} });
+
+        std::vector<float> inputs(5), targets(3, 0.0f);
+        for(float& x: inputs)
+            x = uniform(-1, 1);
+        targets[(int)uniform(0, 3) % 3] = 1;
+        double learningRate = uniform(0.01, 1.0);
+
+        SendInputs(N, inputs.data());
+        TriggerNetwork(N);
+        std::vector<float> forward(N.Out.begin(), N.Out.end());
+        TrainNetwork(N, targets.data(), (float)learningRate);
+        reference(std::vector<double>(inputs.begin(), inputs.end()), host, std::vector<double>(targets.begin(), targets.end()), learningRate);
+
+        Check out { "static output" }, wgt { "static weight" };
+        for(int j = 0; j < 3; j++)
+            out.compare(forward[j], host[2].out[j], j);
+        const float* trained[] = { N.layers.weights.data(), N.layers.next.weights.data(), N.layers.next.next.weights.data() };
+        for(int k = 0, base = 0; k < 3; base += host[k].weights.size(), k++)
+            for(size_t i = 0; i < host[k].weights.size(); i++)
+                wgt.compare(trained[k][i], host[k].weights[i], base + i);
+
+        bool passed = out.passed() && wgt.passed();
+        std::printf("static %d-%d-%d-%d %s/%s %s\n", sizes[0], sizes[1], sizes[2], sizes[3], name(HiddenFun), name(OutputFun), passed ? "ok" : "FAILED");
+        for(const Check& c: { out, wgt })
+            if(!c.passed())
+                std::printf("    %-16s [%d] cpu %.9g ref %.9g\n", c.what.c_str(), c.index, c.gl, c.ref);
+        return passed;
+    }
+
+    //Symmetric int8 code of X at Scale, rounded and clamped like the quantization kernels do
+    int quantize(double X, double Scale)
+    {
+        return (int)std::max(-127.0, std::min(127.0, std::round(X / Scale)));
+    }
+
+    //Forward pass of an int8 network on host: inputs of every layer are quantized with activation scale of layer before
+    //it, weights with the largest magnitude of their row. Integer dot products are rescaled and biased in double
+    void quantizedForward(const std::vector<double>& Inputs, std::vector<HostLayer>& Layers, const std::vector<double>& Scales)
+    {
+        const std::vector<double>* in = &Inputs;
+        for(size_t k = 0; k < Layers.size(); k++)
+        {
+            HostLayer& L = Layers[k];
+            int prev = in->size();
+            L.out.assign(L.size, 0);
+            for(int j = 0; j < L.size; j++)
+            {
+                const double* row = &L.weights[j * (prev + 1)];
+                double absMax = 0;
+                for(int i = 0; i < prev; i++)
+                    absMax = std::max(absMax, std::abs((double)(float)row[i]));
+                double scale = absMax > 0 ? (float)absMax / 127.0f : 1.0;
+                long long acc = 0;
+                for(int i = 0; i < prev; i++)
+                    acc += quantize(row[i], scale) * quantize((*in)[i], Scales[k]);
+                double sum = acc * scale * Scales[k] + row[prev];
+                L.out[j] = L.fun == Softmax ? sum : activate(L.fun, sum);
+            }
+            if(L.fun == Softmax)
+                softmax(L.out);
+            in = &L.out;
+        }
+    }
+
+    //QuantizeNetwork() of a random dense network against calibration and int8 forward pass done on host, true if they agree
+    bool quantizedTrial(std::mt19937& Rng, int Trial)
+    {
+        auto uniform = [&](double Lo, double Hi) { return std::uniform_real_distribution<double>(Lo, Hi)(Rng); };
+        auto pick = [&](int Lo, int Hi) { return std::uniform_int_distribution<int>(Lo, Hi)(Rng); };
+        std::vector<int> sizes = { pick(1, 40) };
+        for(int k = pick(0, 2); k > 0; k--)
+            sizes.push_back(pick(1, 32));
+        sizes.push_back(pick(1, 10));
+        std::vector<int> hidden(sizes.begin() + 1, sizes.end() - 1);
+        ActivationType hiddenFun = Hidden[Trial % 4];
+        ActivationType outputFun = Output[Trial % 5];
+
+        NeuralNetwork N = NetworkBuilder(sizes.front(), hidden, sizes.back());
+        SetActivation(N, hiddenFun, outputFun);
+        SetNetworkDevice(N, GPUDevice);
+        std::vector<HostLayer> host;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next)
+            host.push_back({ L->no_neuron, (ActivationType)L->AFun, readWeights(L), {}, {} });
+
+        /* calibration: largest activation of every layer over the samples, in fp32 */
+        const int samples = 8;
+        std::vector<float> sampleInputs(samples * sizes.front());
+        for(float& x: sampleInputs)
+            x = uniform(-1, 1);
+        std::vector<double> absMax(host.size() + 1, 0);
+        for(int s = 0; s < samples; s++)
+        {
+            std::vector<double> inputs(&sampleInputs[s * sizes.front()], &sampleInputs[(s + 1) * sizes.front()]);
+            forward(inputs, host);
+            for(double x: inputs)
+                absMax[0] = std::max(absMax[0], std::abs(x));
+            for(size_t k = 0; k < host.size(); k++)
+                for(double y: host[k].out)
+                    absMax[k + 1] = std::max(absMax[k + 1], std::abs(y));
+        }
+        QuantizeNetwork(N, sampleInputs.data(), samples);
+
+        Check scale { "act scale" };
+        std::vector<double> scales;
+        HermesNetwork::Layer L = N->inputLayer;
+        for(size_t k = 0; k < absMax.size(); k++, L = L->next)
+        {
+            scales.push_back(absMax[k] > 0 ? (float)absMax[k] / 127.0f : 1.0);
+            scale.compare(L->ActScale, scales.back(), k);
+        }
+
+        /* int8 pass over a calibration sample and a new input */
+        std::vector<Check> checks = { scale };
+        for(int s = 0; s < 2; s++)
+        {
+            std::vector<float> inputs(&sampleInputs[0], &sampleInputs[sizes.front()]);
+            if(s == 1)
+                for(float& x: inputs)
+                    x = uniform(-1, 1);
+            SendInputs(N, inputs.data());
+            TriggerNetwork(N);
+            quantizedForward(std::vector<double>(inputs.begin(), inputs.end()), host, scales);
+            size_t k = 0;
+            for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next, k++)
+            {
+                Check out { "layer " + std::to_string(k + 1) + " int8 output" };
+                std::vector<float> neurons = readNeurons(L);
+                for(int j = 0; j < L->no_neuron; j++)
+                    out.compare(neurons[4 * j], host[k].out[j], j);
+                checks.push_back(out);
+            }
+        }
+        HermesNetwork::deleteNetwork(N);
+
+        std::string shape = std::to_string(sizes.front());
+        for(size_t s = 1; s < sizes.size(); s++)
+            shape += "-" + std::to_string(sizes[s]);
+        return report("int8 " + shape + " " + name(hiddenFun) + "/" + name(outputFun), checks);
+    }
+
+    //Output of Lyr on host for output In of layer before it, from Weights laid out as in its WeightsTex.
+    //Dense, convolution, max pooling and self-attention layers. Logits leaves out softmax of a softmax layer
+    std::vector<double> layerForward(HermesNetwork::Layer Lyr, const std::vector<double>& Weights, const std::vector<double>& In, bool Logits = false)
+    {
+        using namespace HermesNetwork;
+        ActivationType fun = (ActivationType)Lyr->AFun;
+        const LayerHandle& prev = *Lyr->prev;
+        std::vector<double> out(Lyr->no_neuron);
+        if(Lyr->kind == attentionK)
+        {
+            /* rows of Wq, Wk, Wv and Wo with bias in last column, every head attends to all tokens */
+            int T = Lyr->tokens, D = Lyr->no_neuron / T, dh = D / Lyr->heads;
+            auto project = [&](int Row, const double* X)
+            {
+                double sum = Weights[Row * (D + 1) + D];
+                for(int i = 0; i < D; i++)
+                    sum += Weights[Row * (D + 1) + i] * X[i];
+                return sum;
+            };
+            std::vector<double> qkv(T * 3 * D), attn(T * D), scores(T);
+            for(int t = 0; t < T; t++)
+                for(int r = 0; r < 3 * D; r++)
+                    qkv[t * 3 * D + r] = project(r, &In[t * D]);
+            for(int h = 0; h < Lyr->heads; h++)
+                for(int t = 0; t < T; t++)
+                {
+                    for(int u = 0; u < T; u++)
+                    {
+                        scores[u] = 0;
+                        for(int d = 0; d < dh; d++)
+                            scores[u] += qkv[t * 3 * D + h * dh + d] * qkv[u * 3 * D + D + h * dh + d];
+                        scores[u] /= std::sqrt((double)dh);
+                    }
+                    softmax(scores);
+                    for(int d = 0; d < dh; d++)
+                    {
+                        double sum = 0;
+                        for(int u = 0; u < T; u++)
+                            sum += scores[u] * qkv[u * 3 * D + 2 * D + h * dh + d];
+                        attn[t * D + h * dh + d] = sum;
+                    }
+                }
+            for(int t = 0; t < T; t++)
+                for(int j = 0; j < D; j++)
+                    out[t * D + j] = activate(fun, project(3 * D + j, &attn[t * D]));
+            return out;
+        }
+        if(Lyr->kind == convolutionK || Lyr->kind == poolingK)
+        {
+            int K = Lyr->kernel, filter = prev.channels * K * K + 1;
+            for(int c = 0; c < Lyr->channels; c++)
+                for(int y = 0; y < Lyr->height; y++)
+                    for(int x = 0; x < Lyr->width; x++)
+                    {
+                        double sum = Lyr->kind == convolutionK ? Weights[c * filter + filter - 1] : -HUGE_VAL;
+                        for(int ic = 0; ic < prev.channels; ic++)
+                        {
+                            if(Lyr->kind == poolingK && ic != c)
+                                continue;
+                            for(int ky = 0; ky < K; ky++)
+                                for(int kx = 0; kx < K; kx++)
+                                {
+                                    int py = y * Lyr->stride - Lyr->padding + ky, px = x * Lyr->stride - Lyr->padding + kx;
+                                    if(px < 0 || py < 0 || px >= prev.width || py >= prev.height)
+                                        continue;
+                                    double v = In[(ic * prev.height + py) * prev.width + px];
+                                    if(Lyr->kind == poolingK)
+                                        sum = std::max(sum, v);
+                                    else
+                                        sum += Weights[c * filter + (ic * K + ky) * K + kx] * v;
+                                }
+                        }
+                        out[(c * Lyr->height + y) * Lyr->width + x] = Lyr->kind == poolingK ? sum : activate(fun, sum);
+                    }
+            return out;
+        }
+
+        int size = In.size();
+        for(int j = 0; j < Lyr->no_neuron; j++)
+        {
+            double sum = Weights[j * (size + 1) + size];
+            for(int i = 0; i < size; i++)
+                sum += Weights[j * (size + 1) + i] * In[i];
+            out[j] = fun == Softmax ? sum : activate(fun, sum);
+        }
+        if(fun == Softmax && !Logits)
+            softmax(out);
+        return out;
+    }
+
+    //Outputs of every layer of Network on host, with weights of layer k+1 in Weights[k]
+    std::vector<std::vector<double>> networkForward(NeuralNetwork Network, const std::vector<std::vector<double>>& Weights, const std::vector<double>& Inputs)
+    {
+        std::vector<std::vector<double>> out;
+        const std::vector<double>* in = &Inputs;
+        size_t k = 0;
+        for(HermesNetwork::Layer L = Network->inputLayer->next; L; L = L->next, k++)
+        {
+            out.push_back(layerForward(L, Weights[k], *in));
+            in = &out.back();
+        }
+        return out;
+    }
+
+    //Loss TrainNetwork() descends for outputs Out: cross-entropy for softmax output, half squared error otherwise
+    double outputLoss(ActivationType Fun, const std::vector<double>& Out, const std::vector<double>& Targets)
+    {
+        double sum = 0;
+        for(size_t j = 0; j < Out.size(); j++)
+            sum += Fun == Softmax ? -Targets[j] * std::log(Out[j]) : 0.5 * (Targets[j] - Out[j]) * (Targets[j] - Out[j]);
+        return sum;
+    }
+
+    double loss(NeuralNetwork Network, const std::vector<std::vector<double>>& Weights, const std::vector<double>& Inputs, const std::vector<double>& Targets)
+    {
+        std::vector<std::vector<double>> out = networkForward(Network, Weights, Inputs);
+        if(Network->outputLayer->AFun != Softmax)
+            return outputLoss((ActivationType)Network->outputLayer->AFun, out.back(), Targets);
+
+        /* cross-entropy from logits, a saturated softmax rounds to 0 and its log to -inf */
+        std::vector<double> z = layerForward(Network->outputLayer, Weights.back(), out.size() > 1 ? out[out.size() - 2] : Inputs, true);
+        double top = *std::max_element(z.begin(), z.end()), total = 0, sum = 0;
+        for(double v: z)
+            total += std::exp(v - top);
+        for(size_t j = 0; j < z.size(); j++)
+            sum += Targets[j] * (top + std::log(total) - z[j]);
+        return sum;
+    }
+
+    //Weights after one TrainNetwork() step on host: every weight moves against central difference gradient of loss.
+    //Checks backpropagation of layers that the analytic reference doesn't model
+    std::vector<std::vector<double>> numericStep(NeuralNetwork Network, std::vector<std::vector<double>> Weights, const std::vector<double>& Inputs,
+                                                 const std::vector<double>& Targets, double LearningRate)
+    {
+        const double eps = 1e-6;
+        std::vector<std::vector<double>> trained = Weights;
+        for(size_t k = 0; k < Weights.size(); k++)
+            for(size_t w = 0; w < Weights[k].size(); w++)
+            {
+                double w0 = Weights[k][w];
+                Weights[k][w] = w0 + eps;
+                double up = loss(Network, Weights, Inputs, Targets);
+                Weights[k][w] = w0 - eps;
+                double down = loss(Network, Weights, Inputs, Targets);
+                Weights[k][w] = w0;
+                trained[k][w] -= LearningRate * (up - down) / (2 * eps);
+            }
+        return trained;
+    }
+
+    //Forward pass and TrainNetwork() step of Network against host: outputs of every layer against networkForward(),
+    //updated weights against numericStep(). Network is deleted after
+    bool numericTrial(const std::string& Trial, NeuralNetwork Network, std::mt19937& Rng)
+    {
+        auto uniform = [&](double Lo, double Hi) { return std::uniform_real_distribution<double>(Lo, Hi)(Rng); };
+        std::vector<std::vector<double>> weights;
+        for(HermesNetwork::Layer L = Network->inputLayer->next; L; L = L->next)
+            weights.push_back(readWeights(L));
+
+        std::vector<float> inputs(Network->no_of_input), targets(Network->no_of_output);
+        for(float& x: inputs)
+            x = uniform(-1, 1);
+        for(float& y: targets)
+            y = uniform(0, 1);
+        if(Network->outputLayer->AFun == Softmax)
+        {
+            std::fill(targets.begin(), targets.end(), 0.0f);
+            targets[std::uniform_int_distribution<int>(0, targets.size() - 1)(Rng)] = 1;
+        }
+        double learningRate = uniform(0.01, 0.5);
+
+        SendInputs(Network, inputs.data());
+        TriggerNetwork(Network);
+        std::vector<double> in(inputs.begin(), inputs.end()), target(targets.begin(), targets.end());
+        std::vector<std::vector<double>> out = networkForward(Network, weights, in);
+        std::vector<Check> checks;
+        size_t k = 0;
+        for(HermesNetwork::Layer L = Network->inputLayer->next; L; L = L->next, k++)
+        {
+            Check c { "layer " + std::to_string(k + 1) + " output" };
+            std::vector<float> neurons = readNeurons(L);
+            for(int j = 0; j < L->no_neuron; j++)
+                c.compare(neurons[4 * j], out[k][j], j);
+            checks.push_back(c);
+        }
+
+        TrainNetwork(Network, targets.data(), (float)learningRate);
+        std::vector<std::vector<double>> trained = numericStep(Network, weights, in, target, learningRate);
+        k = 0;
+        for(HermesNetwork::Layer L = Network->inputLayer->next; L; L = L->next, k++)
+        {
+            Check c { "layer " + std::to_string(k + 1) + " weight" };
+            std::vector<double> w = readWeights(L);
+            for(size_t i = 0; i < trained[k].size(); i++)
+                c.compare(w[i], trained[k][i], i);
+            checks.push_back(c);
+        }
+        HermesNetwork::deleteNetwork(Network);
+        return report(Trial, checks);
+    }
+
+    //Convolution network of random image and stages, true if its forward pass and train step agree with host
+    bool convolutionTrial(std::mt19937& Rng, int Trial)
+    {
+        auto pick = [&](int Lo, int Hi) { return std::uniform_int_distribution<int>(Lo, Hi)(Rng); };
+        NeuralNetwork N = nullptr;
+        std::string shape;
+        while(!N)
+        {
+            /* images wider than 8 span several work group tiles */
+            int width = pick(4, 12), height = pick(4, 12), channels = pick(1, 3);
+            std::vector<ConvStage> stages;
+            shape = std::to_string(width) + "x" + std::to_string(height) + "x" + std::to_string(channels);
+            for(int s = pick(1, 3); s > 0; s--)
+                if(pick(0, 2) == 0)
+                {
+                    stages.push_back(MaxPooling(2, pick(1, 2)));
+                    shape += " pool2s" + std::to_string(stages.back().Stride);
+                }
+                else
+                {
+                    int kernel = pick(1, 4);
+                    stages.push_back(Convolution(pick(1, 4), kernel, pick(1, 2), pick(0, kernel / 2)));
+                    shape += " conv" + std::to_string(stages.back().Channels) + "k" + std::to_string(kernel) + "s" + std::to_string(stages.back().Stride)
+                             + "p" + std::to_string(stages.back().Padding);
+                }
+            std::vector<int> hidden;
+            if(pick(0, 1))
+            {
+                hidden.push_back(pick(1, 8));
+                shape += " -" + std::to_string(hidden[0]);
+            }
+            N = ConvNetworkBuilder(width, height, channels, stages, hidden, pick(1, 4));
+        }
+
+        /* smooth activations only, ties of relu zeros make max pooling gradient ambiguous */
+        const ActivationType smooth[] = { Sigmoid, TanH, Linear };
+        ActivationType hiddenFun = smooth[Trial % 3], outputFun = Trial % 2 ? Softmax : Sigmoid;
+        SetActivation(N, hiddenFun, outputFun);
+        shape += " -" + std::to_string(N->no_of_output) + " " + name(hiddenFun) + "/" + name(outputFun);
+        return numericTrial("conv " + shape, N, Rng);
+    }
+
+    //Forward pass and train step of a dense network on inputs sent by SendSparseInputs() against reference on the same
+    //inputs zero filled, then a forward pass of them sent dense again. True if they agree
+    bool sparseInputTrial(std::mt19937& Rng, int Trial)
+    {
+        auto uniform = [&](double Lo, double Hi) { return std::uniform_real_distribution<double>(Lo, Hi)(Rng); };
+        auto pick = [&](int Lo, int Hi) { return std::uniform_int_distribution<int>(Lo, Hi)(Rng); };
+        std::vector<int> sizes = { pick(16, 256) };
+        for(int k = pick(0, 2); k > 0; k--)
+            sizes.push_back(pick(1, 32));
+        sizes.push_back(pick(1, 10));
+        std::vector<int> hidden(sizes.begin() + 1, sizes.end() - 1);
+        ActivationType hiddenFun = Hidden[Trial % 4];
+        ActivationType outputFun = Output[Trial % 5];
+
+        NeuralNetwork N = NetworkBuilder(sizes.front(), hidden, sizes.back());
+        SetActivation(N, hiddenFun, outputFun);
+        SetNetworkDevice(N, Trial % 3 == 2 ? CPUDevice : GPUDevice);
+        std::vector<HostLayer> host;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next)
+            host.push_back({ L->no_neuron, (ActivationType)L->AFun, readWeights(L), {}, {} });
+
+        /* first trial sends no non-zero input at all */
+        std::vector<int> indices;
+        std::vector<float> values, inputs(sizes.front(), 0.0f), targets(sizes.back());
+        double density = Trial == 0 ? 0 : uniform(0.02, 0.3);
+        for(int i = 0; i < sizes.front(); i++)
+            if(uniform(0, 1) < density)
+            {
+                indices.push_back(i);
+                values.push_back(uniform(-1, 1));
+                inputs[i] = values.back();
+            }
+        for(float& y: targets)
+            y = outputFun == TanH || outputFun == Linear ? uniform(-1, 1) : uniform(0, 1);
+        if(outputFun == Softmax)
+        {
+            std::fill(targets.begin(), targets.end(), 0.0f);
+            targets[pick(0, sizes.back() - 1)] = 1;
+        }
+        double learningRate = uniform(0.01, 1.0);
+
+        SendSparseInputs(N, indices.data(), values.data(), indices.size());
+        TriggerNetwork(N);
+        std::vector<std::vector<float>> neurons;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next)
+            neurons.push_back(readNeurons(L));
+        TrainNetwork(N, targets.data(), (float)learningRate);
+        std::vector<double> in(inputs.begin(), inputs.end());
+        reference(in, host, std::vector<double>(targets.begin(), targets.end()), learningRate);
+
+        std::vector<Check> checks;
+        size_t k = 0;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next, k++)
+        {
+            std::string layer = "layer " + std::to_string(k + 1);
+            Check out { layer + " output" }, err { layer + " error" }, wgt { layer + " weight" };
+            std::vector<float> trained = readNeurons(L);
+            for(int j = 0; j < L->no_neuron; j++)
+            {
+                out.compare(neurons[k][4 * j], host[k].out[j], j);
+                err.compare(trained[4 * j + 2], host[k].err[j], j);
+            }
+            std::vector<double> weights = readWeights(L);
+            for(int w = 0; w < L->no_weight; w++)
+                wgt.compare(weights[w], host[k].weights[w], w);
+            checks.insert(checks.end(), { out, err, wgt });
+        }
+
+        /* dense inputs after sparse ones, with trained weights */
+        SendInputs(N, inputs.data());
+        TriggerNetwork(N);
+        FetchOutputLayerData(N);
+        forward(in, host);
+        Check dense { "dense output after" };
+        for(int j = 0; j < sizes.back(); j++)
+            dense.compare(N->Out[j], host.back().out[j], j);
+        checks.push_back(dense);
+        HermesNetwork::deleteNetwork(N);
+
+        std::string shape = std::to_string(sizes.front());
+        for(size_t s = 1; s < sizes.size(); s++)
+            shape += "-" + std::to_string(sizes[s]);
+        return report("sparse inputs " + shape + " " + name(hiddenFun) + "/" + name(outputFun) + " nnz " + std::to_string(indices.size())
+                      + (Trial % 3 == 2 ? " cpu" : ""), checks);
+    }
+
+    //Forward pass and TrainNetworkBatch() step of one sample against SendInputs(), TriggerNetwork() and TrainNetwork() from
+    //the same starting weights, true if they agree and batch calls refuse more rows than were sent
+    bool batchTrial(std::mt19937& Rng, int Trial)
+    {
+        auto uniform = [&](double Lo, double Hi) { return std::uniform_real_distribution<double>(Lo, Hi)(Rng); };
+        auto pick = [&](int Lo, int Hi) { return std::uniform_int_distribution<int>(Lo, Hi)(Rng); };
+        std::vector<int> sizes = { pick(1, 48) };
+        for(int k = pick(0, 2); k > 0; k--)
+            sizes.push_back(pick(1, 32));
+        sizes.push_back(pick(1, 10));
+        std::vector<int> hidden(sizes.begin() + 1, sizes.end() - 1);
+        /* batches take no softmax output */
+        ActivationType hiddenFun = Hidden[Trial % 4], outputFun = Output[Trial % 4];
+
+        NeuralNetwork N = NetworkBuilder(sizes.front(), hidden, sizes.back());
+        SetActivation(N, hiddenFun, outputFun);
+        SetNetworkDevice(N, GPUDevice);
+        std::vector<std::vector<double>> weights;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next)
+            weights.push_back(readWeights(L));
+
+        std::vector<float> inputs(sizes.front()), targets(sizes.back()), outputs(sizes.back());
+        for(float& x: inputs)
+            x = uniform(-1, 1);
+        for(float& y: targets)
+            y = outputFun == TanH || outputFun == Linear ? uniform(-1, 1) : uniform(0, 1);
+        float learningRate = uniform(0.01, 1.0);
+
+        SendInputs(N, inputs.data());
+        TriggerNetwork(N);
+        FetchOutputLayerData(N);
+        std::vector<float> single(N->Out, N->Out + sizes.back());
+        TrainNetwork(N, targets.data(), learningRate);
+        std::vector<std::vector<double>> trained;
+        size_t k = 0;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next, k++)
+        {
+            trained.push_back(readWeights(L));
+            writeWeights(L, weights[k]);
+        }
+
+        Check bounds { "batch calls accepted" }, out { "batch output" };
+        bool sent = SendInputsBatch(N, inputs.data(), 1);
+        bounds.compare(TriggerNetworkBatch(N, 2) + FetchOutputBatch(N, outputs.data(), 2) + TrainNetworkBatch(N, targets.data(), 2, learningRate), 0, 0);
+        bounds.compare(sent && TriggerNetworkBatch(N, 1) && FetchOutputBatch(N, outputs.data(), 1), 1, 1);
+        for(int j = 0; j < sizes.back(); j++)
+            out.compare(outputs[j], single[j], j);
+        bounds.compare(TrainNetworkBatch(N, targets.data(), 1, learningRate), 1, 2);
+
+        std::vector<Check> checks = { bounds, out };
+        k = 0;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next, k++)
+        {
+            Check wgt { "layer " + std::to_string(k + 1) + " weight" };
+            std::vector<double> batched = readWeights(L);
+            for(size_t w = 0; w < batched.size(); w++)
+                wgt.compare(batched[w], trained[k][w], w);
+            checks.push_back(wgt);
+        }
+        HermesNetwork::deleteNetwork(N);
+
+        std::string shape = std::to_string(sizes.front());
+        for(size_t s = 1; s < sizes.size(); s++)
+            shape += "-" + std::to_string(sizes[s]);
+        return report("batch " + shape + " " + name(hiddenFun) + "/" + name(outputFun), checks);
+    }
+
+    //TrainNetwork() of a recurrent network after a random sequence against central difference gradients of its loss.
+    //Every loss is taken from GL forward passes over the whole sequence, so steps stay within window and the
+    //backpropagation through time is exact. Gradients are compared, eps of float passes limits their precision
+    bool recurrentTrial(std::mt19937& Rng, RecurrentCell Cell, int Layers)
+    {
+        const double eps = 1e-2;
+        auto uniform = [&](double Lo, double Hi) { return std::uniform_real_distribution<double>(Lo, Hi)(Rng); };
+        auto pick = [&](int Lo, int Hi) { return std::uniform_int_distribution<int>(Lo, Hi)(Rng); };
+        const char* cells[] = { "elman", "gru", "lstm" };
+
+        std::vector<int> recurrent;
+        int inputs = pick(1, 4);
+        std::string shape = std::to_string(inputs);
+        for(int k = 0; k < Layers; k++)
+        {
+            recurrent.push_back(pick(1, 5));
+            shape += "-" + std::to_string(recurrent.back());
+        }
+        int outputs = pick(1, 3), steps = pick(2, 6);
+        NeuralNetwork N = RecurrentNetworkBuilder(inputs, Cell, recurrent, {}, outputs, 8);
+        /* smooth output only, central differences across a relu kink are off */
+        const ActivationType smooth[] = { Sigmoid, TanH, Linear };
+        ActivationType outputFun = outputs > 1 && pick(0, 1) ? Softmax : smooth[pick(0, 2)];
+        SetActivation(N, Sigmoid, outputFun);
+
+        std::vector<float> sequence(steps * inputs), targets(outputs);
+        for(float& x: sequence)
+            x = uniform(-1, 1);
+        for(float& y: targets)
+            y = outputFun == TanH || outputFun == Linear ? uniform(-1, 1) : uniform(0, 1);
+        if(outputFun == Softmax)
+        {
+            std::fill(targets.begin(), targets.end(), 0.0f);
+            targets[pick(0, outputs - 1)] = 1;
+        }
+        std::vector<double> target(targets.begin(), targets.end());
+        double learningRate = uniform(0.05, 0.5);
+
+        auto sequenceLoss = [&]()
+        {
+            ResetState(N);
+            for(int s = 0; s < steps; s++)
+            {
+                SendInputs(N, &sequence[s * inputs]);
+                TriggerNetwork(N);
+            }
+            FetchOutputLayerData(N);
+            return outputLoss(outputFun, std::vector<double>(N->Out, N->Out + outputs), target);
+        };
+
+        std::vector<std::vector<double>> weights;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next)
+            weights.push_back(readWeights(L));
+        sequenceLoss();
+        TrainNetwork(N, targets.data(), (float)learningRate);
+
+        /* gradient TrainNetwork() descended, then every layer back to its starting weights */
+        std::vector<std::vector<double>> gradients;
+        size_t k = 0;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next, k++)
+        {
+            gradients.push_back(readWeights(L));
+            for(size_t w = 0; w < weights[k].size(); w++)
+                gradients[k][w] = (weights[k][w] - gradients[k][w]) / learningRate;
+            writeWeights(L, weights[k]);
+        }
+
+        std::vector<Check> checks;
+        k = 0;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next, k++)
+        {
+            Check c { "layer " + std::to_string(k + 1) + " gradient" };
+            c.absTolerance = 1e-4;
+            c.relTolerance = 1e-2;
+            checks.push_back(c);
+            for(size_t w = 0; w < weights[k].size(); w++)
+            {
+                std::vector<double> moved = weights[k];
+                moved[w] += eps;
+                writeWeights(L, moved);
+                double up = sequenceLoss();
+                moved[w] -= 2 * eps;
+                writeWeights(L, moved);
+                double down = sequenceLoss();
+                checks.back().compare(gradients[k][w], (up - down) / (2 * eps), w);
+            }
+            writeWeights(L, weights[k]);
+        }
+        HermesNetwork::deleteNetwork(N);
+
+        shape += "-" + std::to_string(outputs);
+        return report(std::string("rnn ") + cells[Cell] + " " + shape + " sigmoid/" + name(outputFun) + " steps " + std::to_string(steps), checks);
+    }
+
+    //Self-attention network of random shape, true if its forward pass and train step agree with host
+    bool attentionTrial(std::mt19937& Rng, int Trial)
+    {
+        auto pick = [&](int Lo, int Hi) { return std::uniform_int_distribution<int>(Lo, Hi)(Rng); };
+        /* last trial spans two tiles of 32 keys */
+        int tokens = Trial == 4 ? pick(33, 40) : pick(2, 5), heads = pick(1, 2), model = heads * pick(2, 4), blocks = pick(1, 2);
+        std::vector<int> hidden;
+        if(pick(0, 1))
+            hidden.push_back(pick(1, 8));
+        NeuralNetwork N = AttentionNetworkBuilder(tokens, model, heads, blocks, hidden, pick(1, 4));
+
+        const ActivationType smooth[] = { Sigmoid, TanH, Linear };
+        ActivationType hiddenFun = smooth[Trial % 3], outputFun = Trial % 2 ? Softmax : Sigmoid;
+        SetActivation(N, hiddenFun, outputFun);
+        std::string shape = std::to_string(tokens) + "x" + std::to_string(model) + " " + std::to_string(blocks) + "x" + std::to_string(heads) + "h";
+        for(int h: hidden)
+            shape += " -" + std::to_string(h);
+        shape += " -" + std::to_string(N->no_of_output) + " " + name(hiddenFun) + "/" + name(outputFun);
+        return numericTrial("attention " + shape, N, Rng);
+    }
+
+    //Weights of a sparse layer in dense layout, (prev+1) per neuron with bias last, rebuilt from its CSR textures.
+    //Kept is set to 1 where a weight is stored
+    std::vector<double> readSparseWeights(HermesNetwork::Layer Lyr, std::vector<int>& Kept)
+    {
+        int prev = Lyr->prev->no_neuron;
+        std::vector<double> values = readWeights(Lyr);
+        std::vector<int> rowPtr(Lyr->no_neuron + 1), colIndex(std::max(Lyr->nnz, 1));
+        glBindTexture(GL_TEXTURE_2D, Lyr->RowPtrTex);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_INT, rowPtr.data());
+        glBindTexture(GL_TEXTURE_2D, Lyr->ColIndexTex);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_INT, colIndex.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        std::vector<double> dense(Lyr->no_neuron * (prev + 1), 0);
+        Kept.assign(dense.size(), 0);
+        for(int n = 0; n < Lyr->no_neuron; n++)
+        {
+            for(int k = rowPtr[n]; k < rowPtr[n + 1]; k++)
+            {
+                dense[n * (prev + 1) + colIndex[k]] = values[k];
+                Kept[n * (prev + 1) + colIndex[k]] = 1;
+            }
+            dense[n * (prev + 1) + prev] = values[Lyr->nnz + n];
+            Kept[n * (prev + 1) + prev] = 1;
+        }
+        return dense;
+    }
+
+    //SparsifyLayer() of one layer of a random dense network, true if its stored weights, forward pass and train step
+    //agree with the dense reference with dropped weights set to 0
+    bool sparseTrial(std::mt19937& Rng, int Trial)
+    {
+        auto uniform = [&](double Lo, double Hi) { return std::uniform_real_distribution<double>(Lo, Hi)(Rng); };
+        auto pick = [&](int Lo, int Hi) { return std::uniform_int_distribution<int>(Lo, Hi)(Rng); };
+        std::vector<int> sizes = { pick(1, 48) };
+        for(int k = pick(0, 2); k > 0; k--)
+            sizes.push_back(pick(1, 32));
+        sizes.push_back(pick(1, 10));
+        std::vector<int> hidden(sizes.begin() + 1, sizes.end() - 1);
+        ActivationType hiddenFun = Hidden[Trial % 4];
+        ActivationType outputFun = Output[Trial % 5];
+        int depth = pick(1, sizes.size() - 1);
+        double sparsity = uniform(0.2, 0.95);
+
+        NeuralNetwork N = NetworkBuilder(sizes.front(), hidden, sizes.back());
+        SetActivation(N, hiddenFun, outputFun);
+        SetNetworkDevice(N, GPUDevice);
+        std::vector<HostLayer> host;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next)
+            host.push_back({ L->no_neuron, (ActivationType)L->AFun, readWeights(L), {}, {} });
+
+        /* same threshold as SparsifyLayer(): magnitude of the last weight dropped, biases always stay */
+        std::vector<double>& dense = host[depth - 1].weights;
+        int row = sizes[depth - 1] + 1;
+        std::vector<float> magnitude;
+        for(size_t w = 0; w < dense.size(); w++)
+            if(w % row != (size_t)row - 1)
+                magnitude.push_back(std::abs((float)dense[w]));
+        int drop = sparsity * magnitude.size();
+        float threshold = -1;
+        if(drop > 0)
+        {
+            std::nth_element(magnitude.begin(), magnitude.begin() + drop - 1, magnitude.end());
+            threshold = magnitude[drop - 1];
+        }
+        int nnz = 0;
+        for(size_t w = 0; w < dense.size(); w++)
+            if(w % row != (size_t)row - 1)
+            {
+                if(std::abs((float)dense[w]) > threshold)
+                    nnz++;
+                else
+                    dense[w] = 0;
+            }
+
+        Check stored { "kept weights" }, csr { "csr weight" };
+        stored.compare(SparsifyLayer(N, depth, sparsity), nnz, 0);
+        HermesNetwork::Layer sparse = N->inputLayer;
+        for(int d = 0; d < depth; d++)
+            sparse = sparse->next;
+        std::vector<int> kept;
+        std::vector<double> before = readSparseWeights(sparse, kept);
+        for(size_t w = 0; w < dense.size(); w++)
+            csr.compare(before[w], dense[w], w);
+
+        std::vector<float> inputs(sizes.front()), targets(sizes.back());
+        for(float& x: inputs)
+            x = uniform(-1, 1);
+        for(float& y: targets)
+            y = outputFun == TanH || outputFun == Linear ? uniform(-1, 1) : uniform(0, 1);
+        if(outputFun == Softmax)
+        {
+            std::fill(targets.begin(), targets.end(), 0.0f);
+            targets[pick(0, sizes.back() - 1)] = 1;
+        }
+        double learningRate = uniform(0.01, 1.0);
+
+        SendInputs(N, inputs.data());
+        TriggerNetwork(N);
+        std::vector<std::vector<float>> forward;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next)
+            forward.push_back(readNeurons(L));
+        TrainNetwork(N, targets.data(), (float)learningRate);
+        reference(std::vector<double>(inputs.begin(), inputs.end()), host, std::vector<double>(targets.begin(), targets.end()), learningRate);
+
+        /* weights dropped from sparse layer are left out, the dense reference trains them too */
+        std::vector<Check> checks = { stored, csr };
+        size_t k = 0;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next, k++)
+        {
+            std::string layer = "layer " + std::to_string(k + 1);
+            Check out { layer + " output" }, err { layer + " error" }, wgt { layer + " weight" };
+            std::vector<float> trained = readNeurons(L);
+            for(int j = 0; j < L->no_neuron; j++)
+            {
+                out.compare(forward[k][4 * j], host[k].out[j], j);
+                err.compare(trained[4 * j + 2], host[k].err[j], j);
+            }
+            std::vector<double> weights = L == sparse ? readSparseWeights(L, kept) : readWeights(L);
+            for(size_t w = 0; w < host[k].weights.size(); w++)
+                if(L != sparse || kept[w])
+                    wgt.compare(weights[w], host[k].weights[w], w);
+            checks.insert(checks.end(), { out, err, wgt });
+        }
+        HermesNetwork::deleteNetwork(N);
+
+        std::string shape = std::to_string(sizes.front());
+        for(size_t s = 1; s < sizes.size(); s++)
+            shape += "-" + std::to_string(sizes[s]);
+        char sparseLayer[64];
+        std::snprintf(sparseLayer, sizeof(sparseLayer), " layer %d %.0f%% sparse", depth, 100 * sparsity);
+        return report("csr " + shape + " " + name(hiddenFun) + "/" + name(outputFun) + sparseLayer, checks);
+    }
+
+    //PruneNetwork() of a random dense network whose hidden layers have units forced out: with WeightNorm their outgoing
+    //weights are 0, with ActivationStats their incoming weights are, so they are constant (dead for relu). True if
+    //outputs don't change, the compacted weights match those cut and folded on host from the starting weights, and a
+    //save and load round trip and a batch call after pruning give the same outputs. Batch textures are made before
+    //pruning, so pruned layers have to resize theirs
+    bool pruneTrial(std::mt19937& Rng, int Trial)
+    {
+        auto uniform = [&](double Lo, double Hi) { return std::uniform_real_distribution<double>(Lo, Hi)(Rng); };
+        auto pick = [&](int Lo, int Hi) { return std::uniform_int_distribution<int>(Lo, Hi)(Rng); };
+        std::vector<int> sizes = { pick(1, 24) };
+        for(int k = pick(1, 2); k > 0; k--)
+            sizes.push_back(pick(2, 24));
+        sizes.push_back(pick(1, 8));
+        std::vector<int> hidden(sizes.begin() + 1, sizes.end() - 1);
+        PruneCriterion criterion = Trial % 4 < 2 ? WeightNorm : ActivationStats;
+        ActivationType hiddenFun = Hidden[Trial % 4], outputFun = Output[Trial % 4];
+        const double threshold = criterion == WeightNorm ? 1e-4 : 1e-2;
+
+        NeuralNetwork N = NetworkBuilder(sizes.front(), hidden, sizes.back());
+        SetActivation(N, hiddenFun, outputFun);
+        SetNetworkDevice(N, GPUDevice);
+
+        /* weights well away from 0 and relu units biased on, so only forced units fall under threshold */
+        std::vector<HostLayer> host;
+        for(size_t k = 1; k < sizes.size(); k++)
+        {
+            HostLayer L = { sizes[k], k + 1 < sizes.size() ? hiddenFun : outputFun, std::vector<double>(sizes[k] * (sizes[k - 1] + 1)), {}, {} };
+            for(double& w: L.weights)
+                w = uniform(0.3, 1) * (pick(0, 1) ? 1 : -1);
+            if(L.fun == ReLu)
+                for(int n = 0; n < L.size; n++)
+                    L.weights[n * (sizes[k - 1] + 1) + sizes[k - 1]] = uniform(0.2, 1);
+            host.push_back(L);
+        }
+        for(size_t k = 0; k + 1 < host.size(); k++)
+        {
+            int prev = sizes[k], size = sizes[k + 1];
+            for(int forced = pick(1, size - 1); forced > 0; forced--)
+            {
+                int n = pick(0, size - 1);
+                if(criterion == WeightNorm)
+                    for(int m = 0; m < host[k + 1].size; m++)
+                        host[k + 1].weights[m * (size + 1) + n] = 0;
+                else
+                {
+                    for(int i = 0; i < prev; i++)
+                        host[k].weights[n * (prev + 1) + i] = 0;
+                    host[k].weights[n * (prev + 1) + prev] = hiddenFun == ReLu ? -uniform(0.2, 1) : uniform(-1, 1);
+                }
+            }
+        }
+        size_t k = 0;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next, k++)
+            writeWeights(L, host[k].weights);
+
+        /* outputs are compared on calibration samples, a unit constant over them is constant there */
+        const int samples = 16, rows = 3;
+        std::vector<float> sampleInputs(samples * sizes.front());
+        for(float& x: sampleInputs)
+            x = uniform(-1, 1);
+        std::vector<float> inputs(sampleInputs.begin(), sampleInputs.begin() + rows * sizes.front());
+        SendInputsBatch(N, inputs.data(), rows);
+        std::vector<std::vector<float>> before;
+        for(int r = 0; r < rows; r++)
+        {
+            SendInputs(N, &inputs[r * sizes.front()]);
+            TriggerNetwork(N);
+            FetchOutputLayerData(N);
+            before.emplace_back(N->Out, N->Out + sizes.back());
+        }
+
+        /* same statistics on host, taken before any layer shrinks */
+        std::vector<std::vector<double>> sum, squares;
+        for(size_t k = 0; k + 1 < host.size(); k++)
+        {
+            sum.emplace_back(host[k].size, 0);
+            squares.emplace_back(host[k].size, 0);
+        }
+        for(int s = 0; s < samples; s++)
+        {
+            forward(std::vector<double>(&sampleInputs[s * sizes.front()], &sampleInputs[(s + 1) * sizes.front()]), host);
+            for(size_t k = 0; k + 1 < host.size(); k++)
+                for(int n = 0; n < host[k].size; n++)
+                {
+                    sum[k][n] += host[k].out[n];
+                    squares[k][n] += host[k].out[n] * host[k].out[n];
+                }
+        }
+
+        /* rows of removed units are dropped, their columns too with their mean folded into next bias */
+        int removed = 0;
+        for(size_t k = 0; k + 1 < host.size(); k++)
+        {
+            HostLayer &L = host[k], &next = host[k + 1];
+            int prev = k ? host[k - 1].size : sizes.front();
+            std::vector<double> importance(L.size), mean(L.size, 0);
+            for(int n = 0; n < L.size; n++)
+            {
+                if(criterion == WeightNorm)
+                {
+                    for(int m = 0; m < next.size; m++)
+                        importance[n] += next.weights[m * (L.size + 1) + n] * next.weights[m * (L.size + 1) + n];
+                    importance[n] = std::sqrt(importance[n]);
+                }
+                else
+                {
+                    mean[n] = sum[k][n] / samples;
+                    importance[n] = std::sqrt(std::max(squares[k][n] / samples - mean[n] * mean[n], 0.0));
+                }
+            }
+            std::vector<int> kept(L.size, 0);
+            for(int n = 0; n < L.size; n++)
+                kept[n] = importance[n] >= threshold;
+            if(std::count(kept.begin(), kept.end(), 1) == 0)
+                kept[std::max_element(importance.begin(), importance.end()) - importance.begin()] = 1;
+
+            std::vector<double> weights, nextWeights;
+            for(int n = 0; n < L.size; n++)
+                if(kept[n])
+                    weights.insert(weights.end(), &L.weights[n * (prev + 1)], &L.weights[(n + 1) * (prev + 1)]);
+            for(int m = 0; m < next.size; m++)
+            {
+                double bias = next.weights[m * (L.size + 1) + L.size];
+                for(int n = 0; n < L.size; n++)
+                    if(kept[n])
+                        nextWeights.push_back(next.weights[m * (L.size + 1) + n]);
+                    else
+                        bias += mean[n] * next.weights[m * (L.size + 1) + n];
+                nextWeights.push_back(bias);
+            }
+            removed += L.size - (int)weights.size() / (prev + 1);
+            L.size = weights.size() / (prev + 1);
+            L.weights = weights;
+            next.weights = nextWeights;
+        }
+
+        Check count { "units removed" }, size { "layer size" }, unchanged { "output unchanged" }, out { "output" };
+        count.compare(PruneNetwork(N, criterion, threshold, sampleInputs.data(), samples), removed, 0);
+        std::vector<Check> checks;
+        k = 0;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next, k++)
+        {
+            size.compare(L->no_neuron, host[k].size, k + 1);
+            Check wgt { "layer " + std::to_string(k + 1) + " weight" };
+            std::vector<double> weights = readWeights(L);
+            for(size_t w = 0; w < std::min(weights.size(), host[k].weights.size()); w++)
+                wgt.compare(weights[w], host[k].weights[w], w);
+            checks.push_back(wgt);
+        }
+        for(int r = 0; r < rows; r++)
+        {
+            SendInputs(N, &inputs[r * sizes.front()]);
+            TriggerNetwork(N);
+            FetchOutputLayerData(N);
+            forward(std::vector<double>(&inputs[r * sizes.front()], &inputs[(r + 1) * sizes.front()]), host);
+            for(int j = 0; j < sizes.back(); j++)
+            {
+                unchanged.compare(N->Out[j], before[r][j], r * sizes.back() + j);
+                out.compare(N->Out[j], host.back().out[j], r * sizes.back() + j);
+            }
+        }
+
+        /* batch textures were reserved for the unpruned shape */
+        Check batch { "batch output" }, widths { "batch width" }, loaded { "loaded output" };
+        std::vector<float> outputs(rows * sizes.back());
+        batch.compare(SendInputsBatch(N, inputs.data(), rows) && TriggerNetworkBatch(N, rows) && FetchOutputBatch(N, outputs.data(), rows), 1, -1);
+        for(int r = 0; r < rows; r++)
+            for(int j = 0; j < sizes.back(); j++)
+                batch.compare(outputs[r * sizes.back() + j], before[r][j], r * sizes.back() + j);
+        k = 0;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next, k++)
+        {
+            GLint width = 0;
+            glBindTexture(GL_TEXTURE_2D, L->BatchTex);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            widths.compare(width, L->no_neuron, k + 1);
+        }
+
+        const char* file = "parity_prune.bin";
+        SaveNetwork(N, file);
+        NeuralNetwork M = LoadNetwork(file);
+        std::remove(file);
+        loaded.compare(M != nullptr && M->no_layers == N->no_layers, 1, -1);
+        if(M)
+        {
+            /* files don't store activations */
+            SetActivation(M, hiddenFun, outputFun);
+            SetNetworkDevice(M, GPUDevice);
+            for(int r = 0; r < rows; r++)
+            {
+                SendInputs(M, &inputs[r * sizes.front()]);
+                TriggerNetwork(M);
+                FetchOutputLayerData(M);
+                for(int j = 0; j < sizes.back(); j++)
+                    loaded.compare(M->Out[j], before[r][j], r * sizes.back() + j);
+            }
+            DeleteNetwork(M);
+        }
+        checks.insert(checks.begin(), { count, size, unchanged, out, batch, widths, loaded });
+        DeleteNetwork(N);
+
+        std::string shape = std::to_string(sizes.front());
+        for(size_t s = 1; s < sizes.size(); s++)
+            shape += "-" + std::to_string(sizes[s]);
+        return report(std::string("prune ") + (criterion == WeightNorm ? "weight norm " : "activation stats ") + shape + " "
+                      + name(hiddenFun) + "/" + name(outputFun) + ", " + std::to_string(removed) + " removed", checks);
+    }
+
+    //Replay buffer filled from host and from network inputs, dense and sparse, wrapping around its ring, then trained
+    //from uniformly and with priorities. True if the ring holds the samples appended last, and each TrainFromReplay()
+    //leaves the weights TrainNetworkBatch() leaves on the rows it drew. One sample outweighs the others a million times,
+    //so prioritized draws all take it, and its priority becomes its mean absolute error before the update plus a 1e-3 floor
+    bool replayTrial(std::mt19937& Rng, int Trial)
+    {
+        auto uniform = [&](double Lo, double Hi) { return std::uniform_real_distribution<double>(Lo, Hi)(Rng); };
+        auto pick = [&](int Lo, int Hi) { return std::uniform_int_distribution<int>(Lo, Hi)(Rng); };
+        std::vector<int> sizes = { pick(2, 32) };
+        for(int k = pick(0, 1); k > 0; k--)
+            sizes.push_back(pick(1, 24));
+        sizes.push_back(pick(1, 6));
+        std::vector<int> hidden(sizes.begin() + 1, sizes.end() - 1);
+        /* batches take no softmax output */
+        ActivationType hiddenFun = Hidden[Trial % 4], outputFun = Output[Trial % 4];
+        int in = sizes.front(), out = sizes.back(), capacity = pick(4, 9), batch = pick(2, 8);
+        float learningRate = uniform(0.01, 1.0);
+
+        NeuralNetwork N = NetworkBuilder(in, hidden, out);
+        SetActivation(N, hiddenFun, outputFun);
+        SetNetworkDevice(N, GPUDevice);
+        ReplayBuffer B = CreateReplayBuffer(capacity, in, out);
+
+        /* host copy of ring, the heavy sample is appended from sparse inputs last */
+        std::vector<float> ringIn(capacity * in), ringOut(capacity * out), ringPriority(capacity, 0);
+        int head = 0, heavy = -1;
+        auto sample = [&](std::vector<float>& X, std::vector<float>& Y, int Rows) {
+            X.resize(Rows * in);
+            Y.resize(Rows * out);
+            for(float& x: X)
+                x = uniform(-1, 1);
+            for(float& y: Y)
+                y = outputFun == TanH || outputFun == Linear ? uniform(-1, 1) : uniform(0, 1);
+        };
+        auto store = [&](const float* X, const float* Y, float Priority) {
+            std::copy(X, X + in, &ringIn[head * in]);
+            std::copy(Y, Y + out, &ringOut[head * out]);
+            ringPriority[head] = Priority;
+            head = (head + 1) % capacity;
+        };
+        std::vector<float> x, y;
+        sample(x, y, capacity - 2);
+        AppendReplay(B, x.data(), y.data(), capacity - 2, 1e-6f);
+        for(int r = 0; r < capacity - 2; r++)
+            store(&x[r * in], &y[r * out], 1e-6f);
+        sample(x, y, 3);
+        AppendReplay(B, x.data(), y.data(), 3, 1e-6f);
+        for(int r = 0; r < 3; r++)
+            store(&x[r * in], &y[r * out], 1e-6f);
+        sample(x, y, 1);
+        SendInputs(N, x.data());
+        AppendReplayFromInputs(B, N, y.data(), 1e-6f);
+        store(x.data(), y.data(), 1e-6f);
+
+        /* sparse row differs from dense one sent before it wherever dense one isn't 0 */
+        sample(x, y, 1);
+        std::vector<int> indices;
+        std::vector<float> values;
+        for(int i = 0; i < in; i++)
+            if(pick(0, 2) == 0)
+            {
+                indices.push_back(i);
+                values.push_back(x[i]);
+            }
+            else
+                x[i] = 0;
+        SendSparseInputs(N, indices.data(), values.data(), indices.size());
+        heavy = head;
+        AppendReplayFromInputs(B, N, y.data(), 1);
+        store(x.data(), y.data(), 1);
+
+        Check ring { "ring rows" }, inputs { "ring input" }, targets { "ring target" }, priority { "ring priority" };
+        ring.compare(B->count, capacity, 0);
+        ring.compare(B->head, head, 1);
+        std::vector<float> rgba(4 * capacity * std::max(in, out)), tree(2 * B->leaves);
+        glBindTexture(GL_TEXTURE_2D, B->InputsTex);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, rgba.data());
+        for(int i = 0; i < capacity * in; i++)
+            inputs.compare(rgba[4 * i], ringIn[i], i);
+        glBindTexture(GL_TEXTURE_2D, B->TargetsTex);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, rgba.data());
+        for(int i = 0; i < capacity * out; i++)
+            targets.compare(rgba[4 * i], ringOut[i], i);
+        glBindTexture(GL_TEXTURE_2D, B->PriorityTex);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, tree.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        for(int r = 0; r < capacity; r++)
+            priority.compare(tree[B->leaves + r], ringPriority[r], r);
+        std::vector<Check> checks = { ring, inputs, targets, priority };
+
+        std::vector<std::vector<double>> start;
+        for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next)
+            start.push_back(readWeights(L));
+        for(int prioritized = 0; prioritized < 2; prioritized++)
+        {
+            std::string mode = prioritized ? "prioritized " : "uniform ";
+            Check drawn { mode + "draws" }, error { mode + "priority" };
+
+            /* mean absolute error of every ring row before the update, from a batch pass */
+            std::vector<float> outputs(capacity * out);
+            SendInputsBatch(N, ringIn.data(), capacity);
+            TriggerNetworkBatch(N, capacity);
+            FetchOutputBatch(N, outputs.data(), capacity);
+
+            drawn.compare(TrainFromReplay(N, B, batch, learningRate, prioritized), 1, -1);
+            std::vector<float> rows(batch);
+            glBindTexture(GL_TEXTURE_2D, B->SampledTex);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, rows.data());
+            glBindTexture(GL_TEXTURE_2D, 0);
+            std::vector<std::vector<double>> replayed;
+            size_t k = 0;
+            for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next, k++)
+            {
+                replayed.push_back(readWeights(L));
+                writeWeights(L, start[k]);
+            }
+
+            /* same rows through TrainNetworkBatch() from the same weights */
+            std::vector<float> batchIn(batch * in), batchOut(batch * out);
+            for(int r = 0; r < batch; r++)
+            {
+                int row = std::min(std::max((int)rows[r], 0), capacity - 1);
+                drawn.compare(rows[r], prioritized ? heavy : row, r);
+                std::copy(&ringIn[row * in], &ringIn[(row + 1) * in], &batchIn[r * in]);
+                std::copy(&ringOut[row * out], &ringOut[(row + 1) * out], &batchOut[r * out]);
+            }
+            SendInputsBatch(N, batchIn.data(), batch);
+            TriggerNetworkBatch(N, batch);
+            TrainNetworkBatch(N, batchOut.data(), batch, learningRate);
+            checks.push_back(drawn);
+            k = 0;
+            for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next, k++)
+            {
+                Check wgt { mode + "layer " + std::to_string(k + 1) + " weight" };
+                std::vector<double> batched = readWeights(L);
+                for(size_t w = 0; w < batched.size(); w++)
+                    wgt.compare(replayed[k][w], batched[w], w);
+                checks.push_back(wgt);
+                writeWeights(L, start[k]);
+            }
+
+            if(prioritized)
+            {
+                double sum = 0;
+                for(int j = 0; j < out; j++)
+                    sum += std::abs(ringOut[heavy * out + j] - outputs[heavy * out + j]);
+                glBindTexture(GL_TEXTURE_2D, B->PriorityTex);
+                glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, tree.data());
+                glBindTexture(GL_TEXTURE_2D, 0);
+                error.compare(tree[B->leaves + heavy], sum / out + 1e-3, heavy);
+                checks.push_back(error);
+            }
+        }
+        DeleteReplayBuffer(B);
+        DeleteNetwork(N);
+
+        std::string shape = std::to_string(in);
+        for(size_t s = 1; s < sizes.size(); s++)
+            shape += "-" + std::to_string(sizes[s]);
+        return report("replay " + shape + " " + name(hiddenFun) + "/" + name(outputFun) + ", ring " + std::to_string(capacity)
+                      + " batch " + std::to_string(batch), checks);
+    }
+
+    //TriggerNetworkAsync() and TrainNetworkAsync() steps queued all at once against the same steps run synchronously on
+    //a clone, true if every result, callback and final weight match. Then a third clone gets passes in flight and is
+    //deleted before they are polled, which must finish them with their outputs. Odd trials run on CPU
+    bool asyncTrial(std::mt19937& Rng, int Trial)
+    {
+        auto uniform = [&](double Lo, double Hi) { return std::uniform_real_distribution<double>(Lo, Hi)(Rng); };
+        auto pick = [&](int Lo, int Hi) { return std::uniform_int_distribution<int>(Lo, Hi)(Rng); };
+        std::vector<int> sizes = { pick(1, 32) };
+        for(int k = pick(0, 2); k > 0; k--)
+            sizes.push_back(pick(1, 24));
+        sizes.push_back(pick(1, 8));
+        std::vector<int> hidden(sizes.begin() + 1, sizes.end() - 1);
+        /* bounded activations, unbounded ones can train to inf over the steps and inf never compares equal */
+        ActivationType hiddenFun = Hidden[Trial % 2], outputFun = Trial == 2 ? Softmax : Output[Trial % 2];
+        ComputeDevice device = Trial % 2 ? CPUDevice : GPUDevice;
+        int in = sizes.front(), out = sizes.back();
+        float learningRate = uniform(0.01, 1.0);
+
+        /* [0] async, [1] sync, [2] deleted in flight */
+        NeuralNetwork nets[3];
+        for(NeuralNetwork& N: nets)
+        {
+            N = NetworkBuilder(in, hidden, out);
+            SetActivation(N, hiddenFun, outputFun);
+        }
+        for(int n = 1; n < 3; n++)
+            for(HermesNetwork::Layer L = nets[0]->inputLayer->next, M = nets[n]->inputLayer->next; L; L = L->next, M = M->next)
+                writeWeights(M, readWeights(L));
+        SetNetworkDevice(nets[0], device);
+        SetNetworkDevice(nets[1], device);
+        SetNetworkDevice(nets[2], GPUDevice);
+
+        const int steps = 3;
+        std::vector<float> inputs(steps * in), targets(steps * out);
+        for(float& x: inputs)
+            x = uniform(-1, 1);
+        for(float& y: targets)
+            y = outputFun == TanH || outputFun == Linear ? uniform(-1, 1) : uniform(0, 1);
+        if(outputFun == Softmax)
+            for(int s = 0; s < steps; s++)
+            {
+                std::fill(&targets[s * out], &targets[(s + 1) * out], 0.0f);
+                targets[s * out + pick(0, out - 1)] = 1;
+            }
+
+        std::vector<std::vector<float>> expected;
+        for(int s = 0; s < steps; s++)
+        {
+            SendInputs(nets[1], &inputs[s * in]);
+            TriggerNetwork(nets[1]);
+            FetchOutputLayerData(nets[1]);
+            expected.emplace_back(nets[1]->Out, nets[1]->Out + out);
+            TrainNetwork(nets[1], &targets[s * out], learningRate);
+        }
+
+        /* nothing is waited for until every step is queued */
+        std::vector<NetworkFuture> passes, trains;
+        std::vector<std::vector<float>> called(steps);
+        for(int s = 0; s < steps; s++)
+        {
+            SendInputs(nets[0], &inputs[s * in]);
+            passes.push_back(TriggerNetworkAsync(nets[0]));
+            passes.back().Then([&called, s](const std::vector<float>& Out) { called[s] = Out; });
+            trains.push_back(TrainNetworkAsync(nets[0], &targets[s * out], learningRate));
+        }
+        Check result { "async output" }, callback { "callback output" }, done { "trains done" };
+        for(int s = 0; s < steps; s++)
+        {
+            const std::vector<float>& got = passes[s].Get();
+            result.compare(got.size(), out, -1);
+            for(int j = 0; j < out && j < (int)got.size(); j++)
+                result.compare(got[j], expected[s][j], s * out + j);
+            trains[s].Get();
+            done.compare(trains[s].Ready() && !trains[s].Failed(), 1, s);
+        }
+        for(int s = 0; s < steps; s++)
+        {
+            callback.compare(called[s].size(), out, -1);
+            for(int j = 0; j < out && j < (int)called[s].size(); j++)
+                callback.compare(called[s][j], expected[s][j], s * out + j);
+        }
+        std::vector<Check> checks = { result, callback, done };
+        int depth = 1;
+        for(HermesNetwork::Layer L = nets[0]->inputLayer->next, M = nets[1]->inputLayer->next; L; L = L->next, M = M->next, depth++)
+        {
+            Check wgt { "layer " + std::to_string(depth) + " weight" };
+            std::vector<double> async = readWeights(L), sync = readWeights(M);
+            for(size_t w = 0; w < sync.size(); w++)
+                wgt.compare(async[w], sync[w], w);
+            checks.push_back(wgt);
+        }
+
+        /* passes on starting weights still in flight when their network goes */
+        Check deleted { "deleted in flight" };
+        std::vector<NetworkFuture> inFlight;
+        int callbacks = 0;
+        SendInputs(nets[2], &inputs[0]);
+        for(int p = 0; p < 3; p++)
+        {
+            inFlight.push_back(TriggerNetworkAsync(nets[2]));
+            inFlight.back().Then([&callbacks](const std::vector<float>&) { callbacks++; });
+        }
+        DeleteNetwork(nets[2]);
+        deleted.compare(callbacks, 3, -1);
+        deleted.compare(PollAsync(), 0, -2);
+        for(NetworkFuture& f: inFlight)
+        {
+            deleted.compare(f.Ready() && !f.Failed() && (int)f.Get().size() == out, 1, -3);
+            for(int j = 0; j < out && j < (int)f.Get().size(); j++)
+                deleted.compare(f.Get()[j], expected[0][j], j);
+        }
+        checks.push_back(deleted);
+        DeleteNetwork(nets[0]);
+        DeleteNetwork(nets[1]);
+
+        std::string shape = std::to_string(in);
+        for(size_t s = 1; s < sizes.size(); s++)
+            shape += "-" + std::to_string(sizes[s]);
+        return report("async " + shape + " " + name(hiddenFun) + "/" + name(outputFun) + (device == CPUDevice ? " cpu" : ""), checks);
+    }
+
+    //A session on two networks recorded with StartRecording(), one built while recording (or before it from trial 1 on, so
+    //it goes into log whole) and one loaded, then replayed by ReplayRecording(). True if replay succeeds, runs as many
+    //calls of each kind as were recorded, and leaves networks with the same outputs and weights as the recorded ones
+    bool recordingTrial(std::mt19937& Rng, int Trial)
+    {
+        auto uniform = [&](double Lo, double Hi) { return std::uniform_real_distribution<double>(Lo, Hi)(Rng); };
+        auto pick = [&](int Lo, int Hi) { return std::uniform_int_distribution<int>(Lo, Hi)(Rng); };
+        std::vector<int> sizes = { pick(1, 32) };
+        for(int k = pick(1, 2); k > 0; k--)
+            sizes.push_back(pick(1, 24));
+        sizes.push_back(pick(1, 8));
+        std::vector<int> hidden(sizes.begin() + 1, sizes.end() - 1);
+        /* bounded activations, unbounded ones can train to inf over the steps and inf never compares equal */
+        ActivationType hiddenFun = Hidden[Trial % 2], outputFun = Output[(Trial / 2) % 2];
+        bool snapshot = Trial % 2;
+        int in = sizes.front(), out = sizes.back();
+        float learningRate = uniform(0.01, 1.0);
+        const char* log = "parity_record.log";
+        const char* saved = "parity_record.bin";
+
+        /* network loaded while recording is trained once and saved first */
+        NeuralNetwork source = NetworkBuilder(in, hidden, out);
+        std::vector<float> x(in), y(out);
+        for(float& v: x)
+            v = uniform(-1, 1);
+        for(float& v: y)
+            v = outputFun == TanH ? uniform(-1, 1) : uniform(0, 1);
+        SendInputs(source, x.data());
+        TriggerNetwork(source);
+        TrainNetwork(source, y.data(), learningRate);
+        SaveNetwork(source, saved);
+        DeleteNetwork(source);
+
+        /* [0] built, [1] loaded, in order they appear in log */
+        NeuralNetwork nets[2] = { snapshot ? NetworkBuilder(in, hidden, out) : nullptr, nullptr };
+        std::map<std::string, long long> made;
+        Check ok { "recording" };
+        ok.compare(StartRecording(log), 1, -1);
+        if(!snapshot)
+        {
+            nets[0] = NetworkBuilder(in, hidden, out);
+            made["NetworkBuilder"]++;
+        }
+        SetActivation(nets[0], hiddenFun, outputFun);
+        nets[1] = LoadNetwork(saved);
+        SetActivation(nets[1], hiddenFun, outputFun);
+        made["LoadNetwork"]++;
+        made["SetActivation"] += 2;
+
+        const int steps = 4;
+        std::vector<int> order(in);
+        for(int i = 0; i < in; i++)
+            order[i] = i;
+        for(int s = 0; s < steps; s++)
+            for(int n = 0; n < 2; n++)
+            {
+                for(float& v: x)
+                    v = uniform(-1, 1);
+                for(float& v: y)
+                    v = outputFun == TanH ? uniform(-1, 1) : uniform(0, 1);
+                if((s + n) % 2)
+                {
+                    std::shuffle(order.begin(), order.end(), Rng);
+                    int nonZeros = pick(1, in);
+                    SendSparseInputs(nets[n], order.data(), x.data(), nonZeros);
+                    made["SendSparseInputs"]++;
+                }
+                else
+                {
+                    SendInputs(nets[n], x.data());
+                    made["SendInputs"]++;
+                }
+                TriggerNetwork(nets[n]);
+                TrainNetwork(nets[n], y.data(), learningRate);
+                made["TriggerNetwork"]++;
+                made["TrainNetwork"]++;
+            }
+
+        std::vector<std::vector<float>> outputs;
+        for(float& v: x)
+            v = uniform(-1, 1);
+        for(NeuralNetwork N: nets)
+        {
+            SendInputs(N, x.data());
+            TriggerNetwork(N);
+            FetchOutputLayerData(N);
+            outputs.emplace_back(N->Out, N->Out + out);
+            made["SendInputs"]++;
+            made["TriggerNetwork"]++;
+            made["FetchOutputLayerData"]++;
+        }
+        StopRecording();
+        std::remove(saved);
+
+        ReplayReport replay = ReplayRecording(log);
+        std::remove(log);
+        ok.compare(replay.Ok, 1, -2);
+        ok.compare(replay.Networks.size(), 2, -3);
+
+        Check calls { "call count" };
+        long long total = 0;
+        for(auto& m: made)
+            total += m.second;
+        calls.compare(replay.Calls, total, -1);
+        calls.compare(replay.Timings.size(), made.size(), -2);
+        int kind = 0;
+        for(const ReplayTiming& t: replay.Timings)
+            calls.compare(t.Count, made.count(t.Call) ? made[t.Call] : 0, kind++);
+        std::vector<Check> checks = { ok, calls };
+
+        for(int n = 0; n < 2 && n < (int)replay.Networks.size(); n++)
+        {
+            NeuralNetwork R = replay.Networks[n];
+            std::string net = n ? "loaded" : "built";
+            Check result { net + " output" };
+            result.compare(R != nullptr, 1, -1);
+            if(R == nullptr)
+            {
+                checks.push_back(result);
+                continue;
+            }
+            FetchOutputLayerData(R);
+            for(int j = 0; j < out; j++)
+                result.compare(R->Out[j], outputs[n][j], j);
+            checks.push_back(result);
+            int depth = 1;
+            for(HermesNetwork::Layer L = nets[n]->inputLayer->next, M = R->inputLayer->next; L && M; L = L->next, M = M->next, depth++)
+            {
+                Check wgt { net + " layer " + std::to_string(depth) + " weight" };
+                std::vector<double> original = readWeights(L), replayed = readWeights(M);
+                wgt.compare(replayed.size(), original.size(), -1);
+                for(size_t w = 0; w < original.size() && w < replayed.size(); w++)
+                    wgt.compare(replayed[w], original[w], w);
+                checks.push_back(wgt);
+            }
+        }
+        for(NeuralNetwork N: replay.Networks)
+            DeleteNetwork(N);
+        for(NeuralNetwork N: nets)
+            DeleteNetwork(N);
+
+        std::string shape = std::to_string(in);
+        for(size_t s = 1; s < sizes.size(); s++)
+            shape += "-" + std::to_string(sizes[s]);
+        return report("recording " + shape + " " + name(hiddenFun) + "/" + name(outputFun) + (snapshot ? " snapshot" : ""), checks);
+    }
+
+    //A trained network paged out to host and back in around every call under SetMemoryBudget() against a clone that
+    //never pages, true if outputs, neurons and weights match bit for bit. Trials from 2 on make a layer sparse and
+    //quantize the others first, so integer textures of CSR indices and int8 weights go through paging too
+    bool pagingTrial(std::mt19937& Rng, int Trial)
+    {
+        auto uniform = [&](double Lo, double Hi) { return std::uniform_real_distribution<double>(Lo, Hi)(Rng); };
+        auto pick = [&](int Lo, int Hi) { return std::uniform_int_distribution<int>(Lo, Hi)(Rng); };
+        std::vector<int> sizes = { pick(1, 48) };
+        for(int k = pick(1, 2); k > 0; k--)
+            sizes.push_back(pick(1, 32));
+        sizes.push_back(pick(1, 10));
+        std::vector<int> hidden(sizes.begin() + 1, sizes.end() - 1);
+        /* bounded activations, unbounded ones can train to inf over the steps and inf never compares equal */
+        ActivationType hiddenFun = Hidden[Trial % 2], outputFun = Output[Trial % 2];
+        bool packed = Trial >= 2;
+        int depth = pick(1, sizes.size() - 1);
+        float sparsity = uniform(0.2, 0.9);
+
+        /* [0] is paged, [1] its clone */
+        NeuralNetwork nets[2];
+        for(NeuralNetwork& N: nets)
+        {
+            N = NetworkBuilder(sizes.front(), hidden, sizes.back());
+            SetActivation(N, hiddenFun, outputFun);
+            SetNetworkDevice(N, GPUDevice);
+        }
+        for(HermesNetwork::Layer L = nets[0]->inputLayer->next, M = nets[1]->inputLayer->next; L; L = L->next, M = M->next)
+            writeWeights(M, readWeights(L));
+
+        const int steps = 3, samples = 8;
+        std::vector<float> inputs((steps + 1) * sizes.front()), targets(steps * sizes.back()), sampleInputs(samples * sizes.front());
+        for(float& x: inputs)
+            x = uniform(-1, 1);
+        for(float& y: targets)
+            y = outputFun == TanH || outputFun == Linear ? uniform(-1, 1) : uniform(0, 1);
+        for(float& x: sampleInputs)
+            x = uniform(-1, 1);
+        float learningRate = uniform(0.01, 1.0);
+
+        /* both are trained a step, then made sparse and int8 the same way */
+        for(NeuralNetwork N: nets)
+        {
+            SendInputs(N, &inputs[0]);
+            TriggerNetwork(N);
+            TrainNetwork(N, &targets[0], learningRate);
+            if(packed)
+            {
+                SparsifyLayer(N, depth, sparsity);
+                QuantizeNetwork(N, sampleInputs.data(), samples);
+            }
+        }
+
+        /* clone runs without budget, then paged network with a budget that holds no network, so every call on other
+           pages it out and the next call on it pages it back in. Training a quantized network drops int8, so it trains last */
+        NeuralNetwork other = NetworkBuilder(1, std::vector<int>(), 1);
+        std::vector<std::vector<float>> outputs[2], neurons[2];
+        std::vector<std::vector<double>> weights[2];
+        EngineStats before = GetEngineStats(), after = before;
+        for(int n = 1; n >= 0; n--)
+        {
+            NeuralNetwork N = nets[n];
+            auto touch = [&]() {
+                if(n == 0)
+                    TriggerNetwork(other);
+            };
+            if(n == 0)
+            {
+                before = GetEngineStats();
+                SetMemoryBudget(1);
+            }
+            for(int s = 0; s <= steps; s++)
+            {
+                SendInputs(N, &inputs[s * sizes.front()]);
+                touch();
+                TriggerNetwork(N);
+                touch();
+                FetchOutputLayerData(N);
+                outputs[n].emplace_back(N->Out, N->Out + sizes.back());
+                if(s < steps && (!packed || s == steps - 1))
+                {
+                    touch();
+                    TrainNetwork(N, &targets[s * sizes.back()], learningRate);
+                }
+            }
+            if(n == 0)
+            {
+                after = GetEngineStats();
+                SetMemoryBudget(0);
+                HermesNetwork::useNetwork(N);
+            }
+            for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next)
+            {
+                std::vector<int> kept;
+                neurons[n].push_back(readNeurons(L));
+                weights[n].push_back(L->kind == HermesNetwork::sparseK ? readSparseWeights(L, kept) : readWeights(L));
+            }
+        }
+
+        /* any difference at all fails, paging copies textures as they are */
+        Check paged { "calls paged in" }, out { "output", 1e-300, 0 };
+        paged.compare(after.PageOuts - before.PageOuts >= 2 * steps && after.PageMisses - before.PageMisses >= steps, 1, 0);
+        for(size_t s = 0; s < outputs[0].size(); s++)
+            for(int j = 0; j < sizes.back(); j++)
+                out.compare(outputs[0][s][j], outputs[1][s][j], s * sizes.back() + j);
+        std::vector<Check> checks = { paged, out };
+        for(size_t k = 0; k < weights[0].size(); k++)
+        {
+            std::string layer = "layer " + std::to_string(k + 1);
+            Check neuron { layer + " neuron", 1e-300, 0 }, wgt { layer + " weight", 1e-300, 0 };
+            for(size_t j = 0; j < neurons[0][k].size(); j++)
+                neuron.compare(neurons[0][k][j], neurons[1][k][j], j);
+            for(size_t w = 0; w < weights[0][k].size(); w++)
+                wgt.compare(weights[0][k][w], weights[1][k][w], w);
+            checks.insert(checks.end(), { neuron, wgt });
+        }
+        for(NeuralNetwork N: { nets[0], nets[1], other })
+            HermesNetwork::deleteNetwork(N);
+
+        std::string shape = std::to_string(sizes.front());
+        for(size_t s = 1; s < sizes.size(); s++)
+            shape += "-" + std::to_string(sizes[s]);
+        char sparseLayer[64] = "";
+        if(packed)
+            std::snprintf(sparseLayer, sizeof(sparseLayer), " int8, layer %d %.0f%% sparse", depth, 100 * sparsity);
+        return report("paging " + shape + " " + name(hiddenFun) + "/" + name(outputFun) + sparseLayer, checks);
+    }
+
+    //Runs Trials random networks, prints every mismatch and returns no. of failed trials
+    int run(int Trials, unsigned int Seed)
+    {
+        GLint maxWidth = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxWidth);
+        std::mt19937 rng(Seed);
+        auto uniform = [&](double Lo, double Hi) { return std::uniform_real_distribution<double>(Lo, Hi)(rng); };
+        auto pick = [&](int Lo, int Hi) { return std::uniform_int_distribution<int>(Lo, Hi)(rng); };
+        srand(Seed);
+
+        int failed = 0;
+        for(int t = 0; t < Trials; t++)
+        {
+            /* shape kept inside texture limits of weights, (prev+1) * size */
+            std::vector<int> sizes = { pick(1, 64) };
+            int hiddenLayers = pick(0, 3);
+            for(int k = 0; k <= hiddenLayers; k++)
+            {
+                int size = k == hiddenLayers ? pick(1, 16) : pick(1, 48);
+                sizes.push_back(std::min(size, maxWidth / (sizes.back() + 1)));
+            }
+            std::vector<int> hidden(sizes.begin() + 1, sizes.end() - 1);
+
+            ActivationType hiddenFun = Hidden[pick(0, 3)];
+            ActivationType outputFun = Output[pick(0, 4)];
+            double learningRate = uniform(0.01, 1.0);
+
+            NeuralNetwork N = NetworkBuilder(sizes.front(), hidden, sizes.back());
+            SetActivation(N, hiddenFun, outputFun);
+            SetNetworkDevice(N, t % 3 == 2 ? CPUDevice : GPUDevice);
+            const char* device = t % 3 == 2 ? " cpu" : "";
+
+            /* cycle through autotuner's kernel variants, so every one of them is checked too */
+            for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next)
+                for(int k = HermesNetwork::forwardT; k < HermesNetwork::tunedKernels; k++)
+                    L->tuned[k] = (t + k) % HermesNetwork::denseVariants[k].size();
+
+            std::vector<HostLayer> host;
+            for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next)
+                host.push_back({ L->no_neuron, (ActivationType)L->AFun, readWeights(L), {}, {} });
+
+            std::vector<float> inputs(sizes.front()), targets(sizes.back());
+            for(float& x: inputs)
+                x = uniform(-1, 1);
+            for(float& y: targets)
+                y = outputFun == TanH || outputFun == Linear ? uniform(-1, 1) : uniform(0, 1);
+            if(outputFun == Softmax)
+            {
+                /* one-hot target like a classifier would train with */
+                std::fill(targets.begin(), targets.end(), 0.0f);
+                targets[pick(0, sizes.back() - 1)] = 1;
+            }
+
+            SendInputs(N, inputs.data());
+            TriggerNetwork(N);
+            std::vector<std::vector<float>> forward;
+            for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next)
+                forward.push_back(readNeurons(L));
+            TrainNetwork(N, targets.data(), (float)learningRate);
+
+            reference(std::vector<double>(inputs.begin(), inputs.end()), host, std::vector<double>(targets.begin(), targets.end()), learningRate);
+
+            std::vector<Check> checks;
+            size_t k = 0;
+            for(HermesNetwork::Layer L = N->inputLayer->next; L; L = L->next, k++)
+            {
+                std::string layer = "layer " + std::to_string(k + 1);
+                Check out { layer + " output" }, err { layer + " error" }, wgt { layer + " weight" };
+                std::vector<float> trained = readNeurons(L);
+                for(int j = 0; j < L->no_neuron; j++)
+                {
+                    out.compare(forward[k][4 * j], host[k].out[j], j);
+                    err.compare(trained[4 * j + 2], host[k].err[j], j);
+                }
+                std::vector<double> weights = readWeights(L);
+                for(int w = 0; w < L->no_weight; w++)
+                    wgt.compare(weights[w], host[k].weights[w], w);
+                checks.insert(checks.end(), { out, err, wgt });
+            }
+
+            std::string shape = std::to_string(sizes.front());
+            for(size_t s = 1; s < sizes.size(); s++)
+                shape += "-" + std::to_string(sizes[s]);
+
+            bool passed = true;
+            for(const Check& c: checks)
+                if(!c.passed())
+                {
+                    if(passed)
+                        std::printf("trial %d FAILED: %s %s/%s lr %.4f%s\n", t, shape.c_str(), name(hiddenFun), name(outputFun), learningRate, device);
+                    std::printf("    %-16s [%d] gl %.9g ref %.9g\n", c.what.c_str(), c.index, c.gl, c.ref);
+                    passed = false;
+                }
+            if(passed)
+                std::printf("trial %d ok: %s %s/%s lr %.4f%s\n", t, shape.c_str(), name(hiddenFun), name(outputFun), learningRate, device);
+            else
+                failed++;
+        }
+
+        bool staticPassed[] = { staticTrial<Sigmoid, Sigmoid>(rng), staticTrial<TanH, Linear>(rng), staticTrial<ReLu, Softmax>(rng),
+                                staticTrial<Linear, TanH>(rng) };
+        for(bool passed: staticPassed)
+            failed += !passed;
+        Trials += 4;
+
+        for(int t = 0; t < 5; t++)
+            failed += !quantizedTrial(rng, t);
+        Trials += 5;
+
+        for(int t = 0; t < 6; t++)
+            failed += !convolutionTrial(rng, t);
+        Trials += 6;
+
+        for(int t = 0; t < 5; t++)
+            failed += !attentionTrial(rng, t);
+        Trials += 5;
+
+        for(int t = 0; t < 5; t++)
+            failed += !sparseTrial(rng, t);
+        Trials += 5;
+
+        for(int t = 0; t < 5; t++)
+            failed += !sparseInputTrial(rng, t);
+        Trials += 5;
+
+        for(int t = 0; t < 4; t++)
+            failed += !batchTrial(rng, t);
+        Trials += 4;
+
+        for(RecurrentCell cell: { Elman, GRU, LSTM })
+            for(int layers = 1; layers <= 2; layers++)
+                failed += !recurrentTrial(rng, cell, layers);
+        Trials += 6;
+
+        for(int t = 0; t < 4; t++)
+            failed += !pagingTrial(rng, t);
+        Trials += 4;
+
+        for(int t = 0; t < 4; t++)
+            failed += !pruneTrial(rng, t);
+        Trials += 4;
+
+        for(int t = 0; t < 4; t++)
+            failed += !replayTrial(rng, t);
+        Trials += 4;
+
+        for(int t = 0; t < 4; t++)
+            failed += !asyncTrial(rng, t);
+        Trials += 4;
+
+        for(int t = 0; t < 4; t++)
+            failed += !recordingTrial(rng, t);
+        Trials += 4;
+
+        std::printf("\nparity: %d of %d trials passed (seed %u)\n", Trials - failed, Trials, Seed);
+        return failed;
+    }
+}
@@ -0,0 +1,543 @@
+// *********************************************************************************** //
+// hermes_bench: standard workloads for measuring HermesNetwork throughput and latency
+//
+// Runs every workload through init, forward, forward-async, train-step, replay-train and save/load, and reports
+// samples/sec, p50/p99 latency and mean GPU/CPU time per sample. GPU time is n/a where
+// timer queries measure no compute work, like on llvmpipe. Results can be written as
+// JSON to compare runs across commits.
+//
+// --parity runs the parity harness of Parity.h instead, and exits non-zero when the
+// GL kernels disagree with the host reference.
+//
+// pingpong_selfplay steps --games independent PingPong games of two networks at once
+// through PingPongEnv.h, samples/sec there is game-steps per second.
+//
+// forward_async keeps 8 passes of TriggerNetworkAsync() in flight before waiting on them,
+// samples/sec there counts every pass.
+//
+// model_paging serves 64 small models under a SetMemoryBudget() that holds 16 of them,
+// and prints the page hit rate and paging latency.
+//
+// --generic runs dense layers on kernels that read sizes from uniforms, instead of
+// kernels specialized for each layer shape.
+//
+// --calibrate runs CalibrateDevices() in InitNeuralLink(), so every workload network is
+// measured on the device picked for it (forward and train-step; replay-train is GPU only).
+//
+// --replay <log> re-runs API calls recorded with StartRecording() as fast as possible
+// and reports timing of each kind of call.
+//
+// Linux: runs headless through EGL (Mesa surfaceless, e.g. llvmpipe), falling back
+// to the GLX context of InitNeuralLink() when EGL is not available.
+// *********************************************************************************** //
+
+#ifdef _WIN32
+    #include <GL/glew.h>
+#else
+    #define GL_GLEXT_PROTOTYPES
+    #include <GL/gl.h>
+    #include <GL/glext.h>
+    #include <GL/glx.h>
+    #include <EGL/egl.h>
+    #include <EGL/eglext.h>
+#endif
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+
+#include <HermesNetwork.h>
+#include <HermesNetworkInspector/PingPongEnv.h>
+#include "Parity.h"
+
+namespace Bench
+{
+    struct Workload
+    {
+        const char* name;
+        int input;
+        std::vector<int> hidden;
+        int output;
+    };
+
+    //Network shapes of the standard matrix
+    const std::vector<Workload> Workloads = {
+        { "logic_gate",     2,      { 4 },          1 },
+        { "pingpong",       3,      { 8, 8 },       2 },
+        { "mnist_small",    784,    { 16 },         10 },
+        { "mnist",          784,    { 256 },        10 },
+        { "wide_4k",        4096,   { 4096, 4096 }, 10 },
+    };
+
+    struct Result
+    {
+        std::string workload, phase;
+        bool supported = true;
+        std::string reason;
+        int iterations = 0;
+        double samplesPerSec = 0, p50Ms = 0, p99Ms = 0, gpuMs = 0, cpuMs = 0;
+        bool gpuTimed = false;          // timer queries don't measure compute work on every driver, llvmpipe reports 1 ns for any op
+    };
+
+    int iterations = 200;
+    bool parity = false;
+    bool autotune = false;
+    bool generic = false;
+    bool calibrate = false;
+    int trials = 40;
+    int games = 4096;
+    unsigned int seed = 1;
+    std::string replayPath;
+    std::string jsonPath, filter, label;
+    unsigned int timerQuery = 0;
+
+    double percentile(std::vector<double> v, double p)
+    {
+        std::sort(v.begin(), v.end());
+        return v[(size_t)((v.size() - 1) * p)];
+    }
+
+    //Run Op Iterations times after a short warm up, each run waits for GPU so latency covers the whole op.
+    //After, if given, runs untimed after every run
+    Result measure(const char* Workload, const char* Phase, int Iterations, int Warmup, const std::function<void()>& Op,
+                   const std::function<void()>& After = nullptr)
+    {
+        for(int i = 0; i < Warmup; i++)
+            Op();
+        glFinish();
+
+        std::vector<double> latency;
+        double gpuTotal = 0, cpuTotal = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for(int i = 0; i < Iterations; i++)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            std::clock_t c0 = std::clock();
+            glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+            Op();
+            glEndQuery(GL_TIME_ELAPSED);
+            glFinish();
+            std::clock_t c1 = std::clock();
+            auto t1 = std::chrono::steady_clock::now();
+
+            GLuint64 gpuNs = 0;
+            glGetQueryObjectui64v(timerQuery, GL_QUERY_RESULT, &gpuNs);
+            latency.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+            gpuTotal += gpuNs / 1.0e6;
+            cpuTotal += 1000.0 * (c1 - c0) / CLOCKS_PER_SEC;
+            if(After)
+                After();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        Result r;
+        r.workload = Workload;
+        r.phase = Phase;
+        r.iterations = Iterations;
+        r.samplesPerSec = Iterations / seconds;
+        r.p50Ms = percentile(latency, 0.5);
+        r.p99Ms = percentile(latency, 0.99);
+        r.gpuMs = gpuTotal / Iterations;
+        r.gpuTimed = r.gpuMs >= 1e-3;
+        r.cpuMs = cpuTotal / Iterations;
+        return r;
+    }
+
+    //Layers keep neurons and weights in 1D textures, which can't be wider than GL_MAX_TEXTURE_SIZE
+    bool fits(const Workload& W, std::string& Reason)
+    {
+        GLint maxWidth = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxWidth);
+        std::vector<int> sizes = { W.input };
+        sizes.insert(sizes.end(), W.hidden.begin(), W.hidden.end());
+        sizes.push_back(W.output);
+        for(size_t k = 1; k < sizes.size(); k++)
+        {
+            long long weights = (long long)(sizes[k-1] + 1) * sizes[k];
+            if(weights > maxWidth || sizes[k] > maxWidth)
+            {
+                Reason = "layer " + std::to_string(k) + " needs " + std::to_string(weights) + " weights, GL_MAX_TEXTURE_SIZE is " + std::to_string(maxWidth);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void run(const Workload& W, std::vector<Result>& Results)
+    {
+        std::string reason;
+        if(!fits(W, reason))
+        {
+            for(const char* phase: { "init", "forward", "forward_async", "train_step", "replay_train", "save_load" })
+            {
+                Result r;
+                r.workload = W.name;
+                r.phase = phase;
+                r.supported = false;
+                r.reason = reason;
+                Results.push_back(r);
+            }
+            return;
+        }
+
+        /* init and save/load build a network every run, so they are kept to a few runs */
+        int fewRuns = std::max(2, std::min(iterations, 10));
+        std::vector<float> inputs(W.input), outputs(W.output);
+        for(float& x: inputs)
+            x = (float)rand() / RAND_MAX;
+        for(float& y: outputs)
+            y = (float)(rand() % 2);
+
+        NeuralNetwork N = nullptr;
+        int built = 0;
+        Results.push_back(measure(W.name, "init", fewRuns, 0, [&]() {
+            N = NetworkBuilder(W.input, W.hidden, W.output);
+        }, [&]() {
+            /* last one is benchmarked by the phases below */
+            if(++built < fewRuns)
+                DeleteNetwork(N);
+        }));
+        SetActivation(N, Sigmoid);
+        if(calibrate)
+            std::printf("%s on %s, estimated step %.1f us on GPU, %.1f us on CPU\n", W.name, GetNetworkDevice(N) == CPUDevice ? "CPU" : "GPU",
+                        EstimateStepTime(N, GPUDevice), EstimateStepTime(N, CPUDevice));
+
+        Results.push_back(measure(W.name, "forward", iterations, iterations / 10, [&]() {
+            SendInputs(N, inputs.data());
+            TriggerNetwork(N);
+            FetchOutputLayerData(N);
+        }));
+
+        /* 8 forward passes in flight before waiting on the first, samples/sec counts every pass */
+        const int depth = 8;
+        std::vector<NetworkFuture> futures(depth);
+        Result async = measure(W.name, "forward_async", iterations, iterations / 10, [&]() {
+            for(NetworkFuture& f: futures)
+            {
+                SendInputs(N, inputs.data());
+                f = TriggerNetworkAsync(N);
+            }
+            for(NetworkFuture& f: futures)
+                f.Get();
+        });
+        async.samplesPerSec *= depth;
+        Results.push_back(async);
+
+        Results.push_back(measure(W.name, "train_step", iterations, iterations / 10, [&]() {
+            SendInputs(N, inputs.data());
+            TriggerNetwork(N);
+            TrainNetwork(N, outputs.data(), 0.1f);
+        }));
+
+        /* minibatches of 32 drawn on GPU from a ring of 256 samples, samples/sec counts every sample of a batch */
+        const int batch = 32, capacity = 256;
+        ReplayBuffer buffer = CreateReplayBuffer(capacity, W.input, W.output);
+        for(int k = 0; buffer && k < capacity; k++)
+            AppendReplay(buffer, inputs.data(), outputs.data());
+        if(buffer && TrainFromReplay(N, buffer, batch, 0.1f))
+        {
+            Result r = measure(W.name, "replay_train", iterations, iterations / 10, [&]() {
+                TrainFromReplay(N, buffer, batch, 0.1f);
+            });
+            r.samplesPerSec *= batch;
+            Results.push_back(r);
+        }
+        else
+        {
+            Result r;
+            r.workload = W.name;
+            r.phase = "replay_train";
+            r.supported = false;
+            r.reason = "network can't take batches";
+            Results.push_back(r);
+        }
+        if(buffer)
+            DeleteReplayBuffer(buffer);
+
+        std::string file = std::string("hermes_bench_") + W.name + ".bin";
+        NeuralNetwork loaded = nullptr;
+        Results.push_back(measure(W.name, "save_load", fewRuns, 0, [&]() {
+            SaveNetwork(N, file.c_str());
+            loaded = LoadNetwork(file.c_str());
+        }, [&]() {
+            if(loaded)
+                DeleteNetwork(loaded);
+        }));
+        std::remove(file.c_str());
+        DeleteNetwork(N);
+    }
+
+    //Batched self-play of the Inspector's PingPong networks, every game of the environment steps together
+    void selfplay(std::vector<Result>& Results)
+    {
+        const char* name = "pingpong_selfplay";
+        NeuralNetwork left = NetworkBuilder(3, { 50 }, 2);
+        NeuralNetwork right = NetworkBuilder(3, {}, 2);
+        PingPongEnv::Environment* env = PingPongEnv::create(games, left, right, seed);
+        if(!env)
+        {
+            Result r;
+            r.workload = name;
+            r.phase = "env_step";
+            r.supported = false;
+            r.reason = "networks can't take " + std::to_string(games) + " game batches";
+            Results.push_back(r);
+            return;
+        }
+
+        Result step = measure(name, "env_step", iterations, iterations / 10, [&]() {
+            PingPongEnv::step(env);
+        });
+        step.samplesPerSec *= games;
+        Results.push_back(step);
+
+        Results.push_back(measure(name, "sample", iterations, iterations / 10, [&]() {
+            PingPongEnv::sample(env, 0);
+        }));
+        PingPongEnv::destroy(env);
+    }
+
+    //Many small models behind a GPU memory budget that holds a quarter of them, most calls going to a few hot ones
+    void paging(std::vector<Result>& Results)
+    {
+        const char* name = "model_paging";
+        const int models = 64, hot = 8;
+        std::vector<NeuralNetwork> nets;
+        for(int k = 0; k < models; k++)
+            nets.push_back(NetworkBuilder(3, { 64, 64 }, 2));
+        EngineStats before = GetEngineStats();
+        long long perModel = before.Networks.back().Bytes;
+        SetMemoryBudget(perModel * models / 4);
+
+        /* 80% of calls go to hot models, the rest to any model */
+        float inputs[3] = { 0.2f, 0.5f, 0.8f };
+        unsigned int state = seed;
+        Results.push_back(measure(name, "forward_paged", iterations, iterations / 10, [&]() {
+            state = state * 1664525u + 1013904223u;
+            NeuralNetwork N = nets[(state >> 8) % 100 < 80 ? (state >> 16) % hot : (state >> 16) % models];
+            SendInputs(N, inputs);
+            TriggerNetwork(N);
+            FetchOutputLayerData(N);
+        }));
+
+        EngineStats after = GetEngineStats();
+        long long hits = after.PageHits - before.PageHits, misses = after.PageMisses - before.PageMisses;
+        std::printf("%s: budget %lld KB for %d models of %lld KB, hit rate %.1f%%, page in %.3f ms mean %.3f ms p99, page out %.3f ms mean\n",
+                    name, after.MemoryBudget / 1024, models, perModel / 1024, hits + misses ? 100.0 * hits / (hits + misses) : 0.0,
+                    after.PageIn.MeanMs, after.PageIn.P99Ms, after.PageOut.MeanMs);
+        SetMemoryBudget(0);
+    }
+
+    //Each kind of replayed call is a phase of workload "replay", samples/sec is calls per second spent in it
+    bool replay(std::vector<Result>& Results)
+    {
+        ReplayReport report = ReplayRecording(replayPath.c_str());
+        for(NeuralNetwork N: report.Networks)
+            DeleteNetwork(N);
+        if(!report.Ok)
+            return false;
+        for(const ReplayTiming& t: report.Timings)
+        {
+            Result r;
+            r.workload = "replay";
+            r.phase = t.Call;
+            r.iterations = t.Count;
+            r.samplesPerSec = t.TotalMs > 0 ? 1000.0 * t.Count / t.TotalMs : 0;
+            r.p50Ms = t.P50Ms;
+            r.p99Ms = t.P99Ms;
+            r.cpuMs = t.TotalMs / t.Count;
+            Results.push_back(r);
+        }
+        std::printf("replayed %lld calls in %.3f ms\n", report.Calls, report.WallMs);
+        return true;
+    }
+
+    void print(const std::vector<Result>& Results)
+    {
+        std::printf("\n%-18s %-20s %10s %12s %10s %10s %10s %10s\n", "workload", "phase", "iterations", "samples/sec", "p50 ms", "p99 ms", "gpu ms", "cpu ms");
+        for(const Result& r: Results)
+        {
+            if(!r.supported)
+                std::printf("%-18s %-20s unsupported: %s\n", r.workload.c_str(), r.phase.c_str(), r.reason.c_str());
+            else
+            {
+                char gpu[16] = "n/a";
+                if(r.gpuTimed)
+                    std::snprintf(gpu, sizeof(gpu), "%.4f", r.gpuMs);
+                std::printf("%-18s %-20s %10d %12.1f %10.4f %10.4f %10s %10.4f\n", r.workload.c_str(), r.phase.c_str(), r.iterations,
+                            r.samplesPerSec, r.p50Ms, r.p99Ms, gpu, r.cpuMs);
+            }
+        }
+    }
+
+    bool writeJson(const std::vector<Result>& Results, double EngineInitMs)
+    {
+        std::ofstream file(jsonPath);
+        if(!file.is_open())
+            return false;
+        file << "{\n  \"label\": \"" << label << "\",\n";
+        file << "  \"renderer\": \"" << (const char*)glGetString(GL_RENDERER) << "\",\n";
+        file << "  \"gl_version\": \"" << (const char*)glGetString(GL_VERSION) << "\",\n";
+        file << "  \"engine_init_ms\": " << EngineInitMs << ",\n";
+        file << "  \"results\": [";
+        for(size_t k = 0; k < Results.size(); k++)
+        {
+            const Result& r = Results[k];
+            file << (k ? "," : "") << "\n    { \"workload\": \"" << r.workload << "\", \"phase\": \"" << r.phase
+                 << "\", \"supported\": " << (r.supported ? "true" : "false");
+            if(r.supported)
+            {
+                file << ", \"iterations\": " << r.iterations << ", \"samples_per_sec\": " << r.samplesPerSec
+                     << ", \"p50_ms\": " << r.p50Ms << ", \"p99_ms\": " << r.p99Ms << ", \"gpu_ms\": ";
+                if(r.gpuTimed)
+                    file << r.gpuMs;
+                else
+                    file << "null";
+                file << ", \"cpu_ms\": " << r.cpuMs << " }";
+            }
+            else
+                file << ", \"reason\": \"" << r.reason << "\" }";
+        }
+        file << "\n  ]\n}\n";
+        return file.good();
+    }
+
+    //Headless context: Mesa surfaceless platform first, then default EGL display
+    bool createHeadlessContext()
+    {
+    #ifdef _WIN32
+        return false;
+    #else
+        EGLDisplay display = EGL_NO_DISPLAY;
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if(getPlatformDisplay)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if(display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+        {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+            if(display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+                return false;
+        }
+        if(!eglBindAPI(EGL_OPENGL_API))
+            return false;
+
+        EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLConfig config = nullptr;
+        EGLint configs = 0;
+        eglChooseConfig(display, configAttribs, &config, 1, &configs);
+
+        EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+            EGL_NONE };
+        EGLContext context = eglCreateContext(display, configs ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttribs);
+        if(context == EGL_NO_CONTEXT)
+            return false;
+        return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+    #endif
+    }
+}
+
+int main(int argc, char** argv)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--iterations" && i + 1 < argc)
+            Bench::iterations = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--quick")
+            Bench::iterations = 20;
+        else if(arg == "--json" && i + 1 < argc)
+            Bench::jsonPath = argv[++i];
+        else if(arg == "--filter" && i + 1 < argc)
+            Bench::filter = argv[++i];
+        else if(arg == "--label" && i + 1 < argc)
+            Bench::label = argv[++i];
+        else if(arg == "--autotune")
+            Bench::autotune = true;
+        else if(arg == "--generic")
+            Bench::generic = true;
+        else if(arg == "--calibrate")
+            Bench::calibrate = true;
+        else if(arg == "--parity")
+            Bench::parity = true;
+        else if(arg == "--games" && i + 1 < argc)
+            Bench::games = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--trials" && i + 1 < argc)
+            Bench::trials = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--seed" && i + 1 < argc)
+            Bench::seed = std::strtoul(argv[++i], nullptr, 10);
+        else if(arg == "--replay" && i + 1 < argc)
+            Bench::replayPath = argv[++i];
+        else
+        {
+            std::cout << "usage: hermes_bench [--iterations N] [--quick] [--filter WORKLOAD] [--json FILE] [--label TEXT] [--autotune] [--generic] [--calibrate] [--games N]\n"
+                         "       hermes_bench --parity [--trials N] [--seed S]\n"
+                         "       hermes_bench --replay LOG [--json FILE] [--label TEXT]\n";
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    bool shared = Bench::createHeadlessContext();
+    #ifdef _WIN32
+        glewInit();
+    #endif
+    if(!InitNeuralLink(shared, Bench::calibrate && !Bench::parity))
+    {
+        std::cerr << "hermes_bench: could not initialise HermesNetwork\n";
+        return 1;
+    }
+    double engineInitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "renderer: " << glGetString(GL_RENDERER) << ", engine init " << engineInitMs << " ms\n";
+    DeviceCalibration calibration = GetDeviceCalibration();
+    if(calibration.Calibrated)
+        std::printf("calibration: dispatch %.2f us, upload %.2f us, readback %.2f us, GPU %.2f GFLOP/s, CPU %.2f GFLOP/s\n", calibration.DispatchUs,
+                    calibration.UploadUs, calibration.ReadbackUs, calibration.GpuGflops, calibration.CpuGflops);
+
+    if(Bench::parity)
+        return Parity::run(Bench::trials, Bench::seed) ? 1 : 0;
+
+    /* networks are tuned by NetworkBuilder(), shapes in cache of an earlier run are not timed again */
+    if(Bench::autotune)
+        SetAutotune(true);
+    if(Bench::generic)
+        SetShapeSpecialization(false);
+
+    glGenQueries(1, &Bench::timerQuery);
+    std::vector<Bench::Result> results;
+    if(!Bench::replayPath.empty())
+    {
+        if(!Bench::replay(results))
+        {
+            std::cerr << "hermes_bench: could not replay " << Bench::replayPath << "\n";
+            return 1;
+        }
+    }
+    else
+    {
+        for(const Bench::Workload& w: Bench::Workloads)
+            if(Bench::filter.empty() || Bench::filter == w.name)
+                Bench::run(w, results);
+        if(Bench::filter.empty() || Bench::filter == "pingpong_selfplay")
+            Bench::selfplay(results);
+        if(Bench::filter.empty() || Bench::filter == "model_paging")
+            Bench::paging(results);
+    }
+
+    Bench::print(results);
+    if(!Bench::jsonPath.empty() && !Bench::writeJson(results, engineInitMs))
+    {
+        std::cerr << "hermes_bench: could not write " << Bench::jsonPath << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+// *********************************************************************************** //
+// HermesClient: talks to hermesd, the inference daemon, over a Unix domain socket
+//
+// The socket only carries small fixed size messages. Inputs and outputs go through a ring
+// of slots in memory shared with the daemon: a request names its slot, the daemon reads
+// the inputs from it and writes the outputs back in their place. Needs no GL.
+// *********************************************************************************** //
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <vector>
+
+namespace HermesClient
+{
+    enum Op
+    {
+        HelloOp = 1,    // client: slots and slotFloats of ring wanted. daemon: status, fd of ring as SCM_RIGHTS
+        OpenOp = 2,     // client: path and activations. daemon: status, model, inputSize and outputSize
+        InferOp = 3     // client: model, slot and rows. daemon: status and slot, outputs are in slot
+    };
+
+    //Every message both ways, sent as one SOCK_SEQPACKET packet
+    struct Message
+    {
+        int op = 0;
+        int status = 0;                 // daemon replies 0 on success
+        int model = -1;
+        int slot = 0;
+        int rows = 0;
+        int slots = 0, slotFloats = 0;
+        int inputSize = 0, outputSize = 0;
+        int hiddenActivation = 0;       // ActivationType of HermesNetwork.h, activations aren't stored in model files
+        int outputActivation = -1;      // -1 for same as hidden layers
+        char path[256] = {};
+    };
+
+    struct Connection
+    {
+        int socket = -1;
+        float* ring = nullptr;
+        int slots = 0, slotFloats = 0;
+        std::vector<int> inputSizes, outputSizes;      // of models opened, by model id
+        std::vector<int> slotRows;      // rows of request in each slot, 0 for free
+        std::vector<int> slotOutputs;   // outputs per row of request in each slot
+        std::vector<int> slotStatus;    // 1 while in flight, then status of reply
+    };
+
+    inline bool sendMessage(int Socket, const Message& M)
+    {
+        return send(Socket, &M, sizeof(Message), MSG_NOSIGNAL) == (ssize_t)sizeof(Message);
+    }
+
+    inline bool receiveMessage(int Socket, Message& M, int* Fd = nullptr)
+    {
+        char control[CMSG_SPACE(sizeof(int))] = {};
+        iovec io = { &M, sizeof(Message) };
+        msghdr header = {};
+        header.msg_iov = &io;
+        header.msg_iovlen = 1;
+        header.msg_control = control;
+        header.msg_controllen = sizeof(control);
+        if(recvmsg(Socket, &header, MSG_CMSG_CLOEXEC) != (ssize_t)sizeof(Message))
+            return false;
+        cmsghdr* fd = CMSG_FIRSTHDR(&header);
+        if(Fd && fd && fd->cmsg_level == SOL_SOCKET && fd->cmsg_type == SCM_RIGHTS)
+            std::memcpy(Fd, CMSG_DATA(fd), sizeof(int));
+        return true;
+    }
+
+    //Close connection, requests still in flight are dropped
+    inline void Disconnect(Connection* C)
+    {
+        if(!C)
+            return;
+        if(C->ring)
+            munmap(C->ring, sizeof(float) * C->slots * C->slotFloats);
+        if(C->socket >= 0)
+            close(C->socket);
+        delete C;
+    }
+
+    //Connect to hermesd listening on SocketPath with a ring of Slots slots of SlotFloats floats each.
+    //A slot holds inputs, then outputs, of one request. Returns nullptr on failure
+    inline Connection* Connect(const char* SocketPath, int Slots = 16, int SlotFloats = 4096)
+    {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if(std::strlen(SocketPath) >= sizeof(address.sun_path))
+            return nullptr;
+        std::strcpy(address.sun_path, SocketPath);
+
+        Connection* C = new Connection();
+        C->socket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if(C->socket < 0 || connect(C->socket, (sockaddr*)&address, sizeof(address)) != 0)
+        {
+            Disconnect(C);
+            return nullptr;
+        }
+
+        Message hello;
+        hello.op = HelloOp;
+        hello.slots = Slots;
+        hello.slotFloats = SlotFloats;
+        int fd = -1;
+        if(!sendMessage(C->socket, hello) || !receiveMessage(C->socket, hello, &fd) || hello.status != 0 || fd < 0)
+        {
+            if(fd >= 0)
+                close(fd);
+            Disconnect(C);
+            return nullptr;
+        }
+        void* ring = mmap(nullptr, sizeof(float) * Slots * SlotFloats, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if(ring == MAP_FAILED)
+        {
+            Disconnect(C);
+            return nullptr;
+        }
+        C->ring = (float*)ring;
+        C->slots = Slots;
+        C->slotFloats = SlotFloats;
+        C->slotRows.assign(Slots, 0);
+        C->slotOutputs.assign(Slots, 0);
+        C->slotStatus.assign(Slots, 0);
+        return C;
+    }
+
+    //Model file at Path with given activations, loaded by daemon unless another client did already.
+    //Path is read by daemon, so give it in full. Returns model id, or -1 on failure
+    inline int OpenModel(Connection* C, const char* Path, int* InputSize = nullptr, int* OutputSize = nullptr,
+                         int HiddenActivation = 0, int OutputActivation = -1)
+    {
+        Message open;
+        open.op = OpenOp;
+        open.hiddenActivation = HiddenActivation;
+        open.outputActivation = OutputActivation;
+        if(std::strlen(Path) >= sizeof(open.path))
+            return -1;
+        std::strcpy(open.path, Path);
+        if(!sendMessage(C->socket, open))
+            return -1;
+
+        /* replies to requests in flight may come first */
+        Message reply;
+        while(receiveMessage(C->socket, reply))
+        {
+            if(reply.op == InferOp)
+            {
+                if(reply.slot >= 0 && reply.slot < C->slots)
+                    C->slotStatus[reply.slot] = reply.status;
+                continue;
+            }
+            if(reply.status != 0)
+                return -1;
+            if((int)C->outputSizes.size() <= reply.model)
+            {
+                C->inputSizes.resize(reply.model + 1, 0);
+                C->outputSizes.resize(reply.model + 1, 0);
+            }
+            C->inputSizes[reply.model] = reply.inputSize;
+            C->outputSizes[reply.model] = reply.outputSize;
+            if(InputSize)
+                *InputSize = reply.inputSize;
+            if(OutputSize)
+                *OutputSize = reply.outputSize;
+            return reply.model;
+        }
+        return -1;
+    }
+
+    //Queue inference of Rows samples, inputs row after row, without waiting. Daemon batches it with other
+    //requests for Model. Returns slot to Wait() on, or -1 if no slot is free or inputs or outputs don't fit one
+    inline int Submit(Connection* C, int Model, const float Inputs[], int Rows = 1)
+    {
+        if(Model < 0 || Model >= (int)C->outputSizes.size() || Rows < 1)
+            return -1;
+        int inputs = C->inputSizes[Model], outputs = C->outputSizes[Model];
+        if(outputs == 0 || inputs * Rows > C->slotFloats || outputs * Rows > C->slotFloats)
+            return -1;
+        int slot = 0;
+        while(slot < C->slots && C->slotRows[slot] != 0)
+            slot++;
+        if(slot == C->slots)
+            return -1;
+
+        std::memcpy(C->ring + (size_t)slot * C->slotFloats, Inputs, sizeof(float) * inputs * Rows);
+        Message infer;
+        infer.op = InferOp;
+        infer.model = Model;
+        infer.slot = slot;
+        infer.rows = Rows;
+        if(!sendMessage(C->socket, infer))
+            return -1;
+        C->slotRows[slot] = Rows;
+        C->slotOutputs[slot] = outputs;
+        C->slotStatus[slot] = 1;
+        return slot;
+    }
+
+    //Wait for request in Slot and copy its outputs, row after row, then free Slot. Returns false if it failed
+    inline bool Wait(Connection* C, int Slot, float Outputs[])
+    {
+        if(Slot < 0 || Slot >= C->slots || C->slotRows[Slot] == 0)
+            return false;
+        Message reply;
+        while(C->slotStatus[Slot] == 1)
+        {
+            if(!receiveMessage(C->socket, reply))
+                break;
+            if(reply.op == InferOp && reply.slot >= 0 && reply.slot < C->slots)
+                C->slotStatus[reply.slot] = reply.status;
+        }
+        bool ok = C->slotStatus[Slot] == 0;
+        if(ok)
+            std::memcpy(Outputs, C->ring + (size_t)Slot * C->slotFloats, sizeof(float) * C->slotOutputs[Slot] * C->slotRows[Slot]);
+        C->slotRows[Slot] = 0;
+        return ok;
+    }
+
+    //Submit() and Wait() for one request
+    inline bool Infer(Connection* C, int Model, const float Inputs[], float Outputs[], int Rows = 1)
+    {
+        int slot = Submit(C, Model, Inputs, Rows);
+        return slot >= 0 && Wait(C, slot, Outputs);
+    }
+}
@@ -0,0 +1,592 @@
+// *********************************************************************************** //
+// hermesd: inference daemon holding the GL context and models for several processes
+//
+// Clients connect over a Unix domain socket with HermesClient.h. Each gets a ring of slots
+// in shared memory (memfd) for inputs and outputs, so the socket carries only small
+// messages. Models are loaded once, on the first client asking for a file with given
+// activations, and shared by every client after it.
+//
+// Requests are coalesced: requests for a model that arrived while the last batch ran, or
+// within --window-us of the oldest one, go through the batch kernels as one batch of up to
+// --max-batch rows. Models that can't take batches run request by request.
+//
+// --memory-budget MB caps GPU memory of loaded models with SetMemoryBudget(), least recently
+// used ones are paged out to host memory and back in on their next request.
+//
+// --self-test serves client processes forked from the daemon, which check every output
+// against the same network run in the daemon, and exits non-zero on any mismatch.
+//
+// Linux only: runs headless through EGL (Mesa surfaceless, e.g. llvmpipe), falling back
+// to the GLX context of InitNeuralLink() when EGL is not available.
+// *********************************************************************************** //
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <GL/glx.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+#include <HermesNetwork.h>
+#include "HermesClient.h"
+
+namespace Daemon
+{
+    using HermesClient::Message;
+
+    struct Model
+    {
+        std::string path;
+        int hidden, output;         // activations
+        NeuralNetwork network;
+        bool batched;               // takes batches, see SendInputsBatch()
+    };
+
+    struct Client
+    {
+        float* ring = nullptr;
+        int slots = 0, slotFloats = 0;
+    };
+
+    struct Request
+    {
+        int socket;
+        int model;
+        int slot;
+        int rows;
+    };
+
+    std::string socketPath = "/tmp/hermesd.sock";
+    int maxBatch = 256;
+    int windowUs = 0;
+    size_t maxRingBytes = 64 << 20;     // per client
+    volatile sig_atomic_t quit = 0;
+
+    std::vector<Model> models;
+    std::map<int, Client> clients;      // by socket
+    std::vector<Request> pending;       // in order of arrival
+    std::chrono::steady_clock::time_point oldestPending;
+    long long requests = 0, batches = 0, batchedRows = 0, singleRows = 0;    // rows through batch kernels and one by one
+
+    //Id of model at Path with given activations, loaded now unless loaded before. -1 if it can't be
+    int openModel(std::string Path, int Hidden, int Output)
+    {
+        /* same file under another name shares the loaded copy */
+        char* resolved = realpath(Path.c_str(), nullptr);
+        if(!resolved)
+            return -1;
+        Path = resolved;
+        free(resolved);
+        if(Output < 0)
+            Output = Hidden;
+        if(Hidden < Sigmoid || Hidden > Linear || Output < Sigmoid || Output > Softmax)
+            return -1;
+        for(size_t m = 0; m < models.size(); m++)
+            if(models[m].path == Path && models[m].hidden == Hidden && models[m].output == Output)
+                return m;
+
+        NeuralNetwork N = LoadNetwork(Path.c_str());
+        if(!N)
+            return -1;
+        SetActivation(N, (ActivationType)Hidden, (ActivationType)Output);
+        models.push_back({ Path, Hidden, Output, N, HermesNetwork::batchSupported(N) });
+        std::printf("hermesd: loaded %s as model %d, %d inputs, %d outputs%s\n", Path.c_str(), (int)models.size() - 1,
+                    N->no_of_input, N->no_of_output, models.back().batched ? "" : ", no batches");
+        return models.size() - 1;
+    }
+
+    //Make ring of shared memory asked for in M and send its fd along with reply
+    void hello(int Socket, Message& M)
+    {
+        Client& c = clients[Socket];
+        size_t bytes = sizeof(float) * (size_t)std::max(M.slots, 0) * std::max(M.slotFloats, 0);
+        int fd = -1;
+        void* ring = MAP_FAILED;
+        if(!c.ring && bytes > 0 && bytes <= maxRingBytes)
+            fd = memfd_create("hermesd ring", MFD_CLOEXEC);
+        if(fd >= 0 && ftruncate(fd, bytes) == 0)
+            ring = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        M.status = ring == MAP_FAILED ? 1 : 0;
+        if(ring != MAP_FAILED)
+        {
+            c.ring = (float*)ring;
+            c.slots = M.slots;
+            c.slotFloats = M.slotFloats;
+        }
+
+        char control[CMSG_SPACE(sizeof(int))] = {};
+        iovec io = { &M, sizeof(Message) };
+        msghdr header = {};
+        header.msg_iov = &io;
+        header.msg_iovlen = 1;
+        if(M.status == 0)
+        {
+            header.msg_control = control;
+            header.msg_controllen = sizeof(control);
+            cmsghdr* cm = CMSG_FIRSTHDR(&header);
+            cm->cmsg_level = SOL_SOCKET;
+            cm->cmsg_type = SCM_RIGHTS;
+            cm->cmsg_len = CMSG_LEN(sizeof(int));
+            std::memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+        }
+        sendmsg(Socket, &header, MSG_NOSIGNAL);
+        if(fd >= 0)
+            close(fd);
+    }
+
+    //Queue inference request, or reply with an error right away if it doesn't fit its slot or a batch
+    void request(int Socket, Message& M)
+    {
+        const Client& c = clients[Socket];
+        bool valid = c.ring && M.slot >= 0 && M.slot < c.slots && M.model >= 0 && M.model < (int)models.size()
+                     && M.rows >= 1 && M.rows <= maxBatch;
+        if(valid)
+        {
+            NeuralNetwork N = models[M.model].network;
+            valid = (long long)N->no_of_input * M.rows <= c.slotFloats && (long long)N->no_of_output * M.rows <= c.slotFloats;
+        }
+        if(!valid)
+        {
+            M.status = 1;
+            HermesClient::sendMessage(Socket, M);
+            return;
+        }
+        if(pending.empty())
+            oldestPending = std::chrono::steady_clock::now();
+        pending.push_back({ Socket, M.model, M.slot, M.rows });
+        requests++;
+    }
+
+    //Run Group of requests for M as one batch of Rows rows, outputs go back into their slots
+    void runBatch(Model& M, const std::vector<Request>& Group, int Rows)
+    {
+        NeuralNetwork N = M.network;
+        int in = N->no_of_input, out = N->no_of_output;
+        std::vector<float> inputs(in * Rows), outputs(out * Rows);
+        int row = 0;
+        for(const Request& r: Group)
+        {
+            const Client& c = clients[r.socket];
+            std::memcpy(&inputs[in * row], c.ring + (size_t)r.slot * c.slotFloats, sizeof(float) * in * r.rows);
+            row += r.rows;
+        }
+
+        /* a batch taller than GL_MAX_TEXTURE_SIZE runs row by row */
+        if(M.batched && SendInputsBatch(N, inputs.data(), Rows))
+        {
+            TriggerNetworkBatch(N, Rows);
+            FetchOutputBatch(N, outputs.data(), Rows);
+            batches++;
+            batchedRows += Rows;
+        }
+        else
+            for(int k = 0; k < Rows; k++)
+            {
+                SendInputs(N, &inputs[in * k]);
+                TriggerNetwork(N);
+                FetchOutputLayerData(N);
+                std::copy(N->Out, N->Out + out, &outputs[out * k]);
+                singleRows++;
+            }
+
+        row = 0;
+        for(const Request& r: Group)
+        {
+            const Client& c = clients[r.socket];
+            std::memcpy(c.ring + (size_t)r.slot * c.slotFloats, &outputs[out * row], sizeof(float) * out * r.rows);
+            row += r.rows;
+            Message reply;
+            reply.op = HermesClient::InferOp;
+            reply.model = r.model;
+            reply.slot = r.slot;
+            reply.rows = r.rows;
+            HermesClient::sendMessage(r.socket, reply);
+        }
+    }
+
+    //Run every pending request, those of a model in order of arrival and in as few batches as maxBatch allows
+    void runPending()
+    {
+        std::vector<bool> done(pending.size(), false);
+        for(size_t first = 0; first < pending.size(); first++)
+        {
+            if(done[first])
+                continue;
+            std::vector<Request> group;
+            int rows = 0;
+            for(size_t k = first; k < pending.size(); k++)
+                if(!done[k] && pending[k].model == pending[first].model && rows + pending[k].rows <= maxBatch)
+                {
+                    group.push_back(pending[k]);
+                    rows += pending[k].rows;
+                    done[k] = true;
+                }
+            runBatch(models[pending[first].model], group, rows);
+        }
+        pending.clear();
+    }
+
+    void dropClient(int Socket)
+    {
+        pending.erase(std::remove_if(pending.begin(), pending.end(), [Socket](const Request& r) { return r.socket == Socket; }), pending.end());
+        Client& c = clients[Socket];
+        if(c.ring)
+            munmap(c.ring, sizeof(float) * c.slots * c.slotFloats);
+        clients.erase(Socket);
+        close(Socket);
+    }
+
+    //Read every message waiting on Socket, false once client has gone
+    bool receive(int Socket)
+    {
+        while(true)
+        {
+            Message m;
+            ssize_t n = recv(Socket, &m, sizeof(Message), MSG_DONTWAIT);
+            if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return true;
+            if(n != (ssize_t)sizeof(Message))
+                return false;
+
+            if(m.op == HermesClient::HelloOp)
+                hello(Socket, m);
+            else if(m.op == HermesClient::OpenOp)
+            {
+                m.path[sizeof(m.path) - 1] = 0;
+                m.model = openModel(m.path, m.hiddenActivation, m.outputActivation);
+                m.status = m.model < 0 ? 1 : 0;
+                if(m.model >= 0)
+                {
+                    m.inputSize = models[m.model].network->no_of_input;
+                    m.outputSize = models[m.model].network->no_of_output;
+                }
+                HermesClient::sendMessage(Socket, m);
+            }
+            else if(m.op == HermesClient::InferOp)
+                request(Socket, m);
+            else
+                return false;
+        }
+    }
+
+    //Listening socket at Path, -1 if another daemon serves there or it can't be made
+    int listenOn(const std::string& Path)
+    {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if(Path.size() >= sizeof(address.sun_path))
+            return -1;
+        std::strcpy(address.sun_path, Path.c_str());
+
+        /* a socket file nobody accepts on is left over from a daemon that died */
+        int probe = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        bool taken = connect(probe, (sockaddr*)&address, sizeof(address)) == 0;
+        close(probe);
+        if(taken)
+            return -1;
+        unlink(Path.c_str());
+
+        int listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if(listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0)
+        {
+            if(listener >= 0)
+                close(listener);
+            return -1;
+        }
+        return listener;
+    }
+
+    //Serve clients until a signal asks to quit or Stop returns true
+    void serve(int Listener, const std::function<bool()>& Stop)
+    {
+        using clock = std::chrono::steady_clock;
+        while(!quit && !Stop())
+        {
+            std::vector<pollfd> fds = { { Listener, POLLIN, 0 } };
+            for(const auto& c: clients)
+                fds.push_back({ c.first, POLLIN, 0 });
+
+            /* without pending requests, wake up now and then to check Stop */
+            long long waitUs = 100000;
+            if(!pending.empty())
+                waitUs = std::max<long long>(0, windowUs - std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - oldestPending).count());
+            timespec timeout = { (time_t)(waitUs / 1000000), (long)(waitUs % 1000000) * 1000 };
+            if(ppoll(fds.data(), fds.size(), &timeout, nullptr) < 0 && errno != EINTR)
+                break;
+
+            if(fds[0].revents & POLLIN)
+            {
+                int s;
+                while((s = accept4(Listener, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK)) >= 0)
+                    clients[s] = Client();
+            }
+            for(size_t k = 1; k < fds.size(); k++)
+                if(fds[k].revents && !receive(fds[k].fd))
+                    dropClient(fds[k].fd);
+
+            if(pending.empty())
+                continue;
+            int rows = 0;
+            for(const Request& r: pending)
+                rows += r.rows;
+            if(rows >= maxBatch || clock::now() - oldestPending >= std::chrono::microseconds(windowUs))
+                runPending();
+        }
+    }
+
+    void printStats()
+    {
+        std::printf("hermesd: %lld requests, %lld rows in %lld batches (%.2f rows per batch), %lld rows one by one\n", requests, batchedRows,
+                    batches, batches ? (double)batchedRows / batches : 0.0, singleRows);
+        EngineStats stats = GetEngineStats();
+        if(stats.MemoryBudget > 0)
+            std::printf("hermesd: %lld page hits, %lld misses, %lld page outs, page in %.3f ms mean\n", stats.PageHits, stats.PageMisses,
+                        stats.PageOuts, stats.PageIn.MeanMs);
+    }
+
+    //Clients in child processes check daemon outputs against the networks run here, returns no. of failed clients
+    int selfTest()
+    {
+        struct Case
+        {
+            std::string path;
+            int hidden, output, inputSize, outputSize;
+            std::vector<float> inputs = {}, expected = {};    // rows of reference samples
+        };
+        const int samples = 32, children = 4;
+        std::string base = "/tmp/hermesd_selftest_" + std::to_string(getpid());
+        socketPath = base + ".sock";
+
+        /* one model takes batches, softmax output keeps the other on the single sample path */
+        std::vector<Case> cases = { { base + "_a.bin", TanH, Sigmoid, 5, 3 }, { base + "_b.bin", Sigmoid, Softmax, 4, 3 } };
+        std::vector<std::vector<int>> hidden = { { 16 }, { 8, 6 } };
+        for(size_t m = 0; m < cases.size(); m++)
+        {
+            Case& t = cases[m];
+            NeuralNetwork N = NetworkBuilder(t.inputSize, hidden[m], t.outputSize);
+            SetActivation(N, (ActivationType)t.hidden, (ActivationType)t.output);
+            SaveNetwork(N, t.path.c_str());
+            for(int s = 0; s < samples; s++)
+            {
+                std::vector<float> x(t.inputSize);
+                for(float& v: x)
+                    v = (float)rand() / RAND_MAX * 2 - 1;
+                SendInputs(N, x.data());
+                TriggerNetwork(N);
+                FetchOutputLayerData(N);
+                t.inputs.insert(t.inputs.end(), x.begin(), x.end());
+                t.expected.insert(t.expected.end(), N->Out, N->Out + t.outputSize);
+            }
+        }
+
+        int listener = listenOn(socketPath);
+        if(listener < 0)
+        {
+            std::cerr << "hermesd: could not listen on " << socketPath << "\n";
+            return children;
+        }
+
+        /* each client keeps its ring full with requests of 1 to 4 rows for both models, then waits on all of them */
+        std::vector<pid_t> running;
+        for(int k = 0; k < children; k++)
+        {
+            pid_t pid = fork();
+            if(pid != 0)
+            {
+                running.push_back(pid);
+                continue;
+            }
+            close(listener);
+            HermesClient::Connection* C = HermesClient::Connect(socketPath.c_str(), 8, 64);
+            if(!C)
+                _exit(1);
+            int ids[2], failures = 0;
+            for(int m = 0; m < 2; m++)
+            {
+                int in = 0, out = 0;
+                ids[m] = HermesClient::OpenModel(C, cases[m].path.c_str(), &in, &out, cases[m].hidden, cases[m].output);
+                if(ids[m] < 0 || in != cases[m].inputSize || out != cases[m].outputSize)
+                    _exit(1);
+            }
+            for(int round = 0; round < 20; round++)
+            {
+                struct Sent { int slot, model, first, rows; };
+                std::vector<Sent> sent;
+                for(int q = 0; q < 8; q++)
+                {
+                    int m = (k + q + round) % 2, rows = 1 + (k * 7 + q * 3 + round) % 4, first = (k * 5 + q * 11 + round * 3) % (samples - rows);
+                    int slot = HermesClient::Submit(C, ids[m], &cases[m].inputs[first * cases[m].inputSize], rows);
+                    if(slot < 0)
+                        failures++;
+                    else
+                        sent.push_back({ slot, m, first, rows });
+                }
+                for(const Sent& s: sent)
+                {
+                    const Case& t = cases[s.model];
+                    std::vector<float> out(t.outputSize * s.rows);
+                    if(!HermesClient::Wait(C, s.slot, out.data()))
+                    {
+                        failures++;
+                        continue;
+                    }
+                    for(size_t j = 0; j < out.size(); j++)
+                        if(std::fabs(out[j] - t.expected[s.first * t.outputSize + j]) > 1e-4f)
+                        {
+                            failures++;
+                            break;
+                        }
+                }
+            }
+            HermesClient::Disconnect(C);
+            _exit(failures ? 1 : 0);
+        }
+
+        int failed = 0;
+        serve(listener, [&]() {
+            int status;
+            pid_t pid;
+            while((pid = waitpid(-1, &status, WNOHANG)) > 0)
+            {
+                running.erase(std::remove(running.begin(), running.end(), pid), running.end());
+                if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                    failed++;
+            }
+            return running.empty();
+        });
+        close(listener);
+        unlink(socketPath.c_str());
+        for(const Case& t: cases)
+            std::remove(t.path.c_str());
+
+        printStats();
+        std::printf("hermesd self test: %d of %d clients failed\n", failed, children);
+        return failed;
+    }
+
+    //Headless context: Mesa surfaceless platform first, then default EGL display
+    bool createHeadlessContext()
+    {
+        EGLDisplay display = EGL_NO_DISPLAY;
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if(getPlatformDisplay)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if(display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+        {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+            if(display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+                return false;
+        }
+        if(!eglBindAPI(EGL_OPENGL_API))
+            return false;
+
+        EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLConfig config = nullptr;
+        EGLint configs = 0;
+        eglChooseConfig(display, configAttribs, &config, 1, &configs);
+
+        EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+            EGL_NONE };
+        EGLContext context = eglCreateContext(display, configs ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttribs);
+        if(context == EGL_NO_CONTEXT)
+            return false;
+        return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+    }
+
+    void onSignal(int)
+    {
+        quit = 1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool selfTest = false;
+    int budgetMb = 0;
+    std::vector<std::string> preload;
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--socket" && i + 1 < argc)
+            Daemon::socketPath = argv[++i];
+        else if(arg == "--max-batch" && i + 1 < argc)
+            Daemon::maxBatch = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--window-us" && i + 1 < argc)
+            Daemon::windowUs = std::max(0, std::atoi(argv[++i]));
+        else if(arg == "--memory-budget" && i + 1 < argc)
+            budgetMb = std::max(0, std::atoi(argv[++i]));
+        else if(arg == "--self-test")
+            selfTest = true;
+        else if(!arg.empty() && arg[0] != '-')
+            preload.push_back(arg);
+        else
+        {
+            std::cout << "usage: hermesd [--socket PATH] [--max-batch N] [--window-us N] [--memory-budget MB] [MODEL...]\n"
+                         "       hermesd --self-test\n";
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    bool shared = Daemon::createHeadlessContext();
+    if(!InitNeuralLink(shared))
+    {
+        std::cerr << "hermesd: could not initialise HermesNetwork\n";
+        return 1;
+    }
+    std::cout << "renderer: " << glGetString(GL_RENDERER) << "\n";
+    SetMemoryBudget(budgetMb * 1024LL * 1024);
+
+    struct sigaction action = {};
+    action.sa_handler = Daemon::onSignal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    if(selfTest)
+        return Daemon::selfTest() ? 1 : 0;
+
+    /* preloaded models use sigmoid everywhere, clients asking for other activations get their own copy */
+    for(const std::string& path: preload)
+        if(Daemon::openModel(path, Sigmoid, Sigmoid) < 0)
+        {
+            std::cerr << "hermesd: could not load " << path << "\n";
+            return 1;
+        }
+
+    int listener = Daemon::listenOn(Daemon::socketPath);
+    if(listener < 0)
+    {
+        std::cerr << "hermesd: could not listen on " << Daemon::socketPath << ", is another hermesd serving there?\n";
+        return 1;
+    }
+    std::cout << "hermesd: serving on " << Daemon::socketPath << std::endl;
+    Daemon::serve(listener, []() { return false; });
+
+    close(listener);
+    unlink(Daemon::socketPath.c_str());
+    Daemon::printStats();
+    return 0;
+}
@@ -13,8 +13,24 @@
 #define __HERMES_NETWORK__
 
 #include <vector>
+#include <string>
 #include <fstream>
+#include <cstdio>
 #include <ctime>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <array>
+#include <istream>
+#include <ostream>
+#include <functional>
+#include <memory>
+#ifdef __cpp_impl_coroutine
+    #include <coroutine>
+#endif
 
 #ifdef _WIN32
     #include <windows.h>
@@ -44,7 +60,12 @@ namespace HermesNetwork
 {
     //////////////////////////////////////////// Objects ///////////////////////////////////////
     enum layerType	 {	inputL, outputL, hiddenL };
-    enum networkType {	convolutional };
+    enum networkType {	convolutional, feedForward, recurrent, attention };
+    enum layerKind   {	denseK, convolutionK, poolingK, sparseK, recurrentK, attentionK };
+    enum cellType    {	elmanC, gruC, lstmC };
+
+    //Marks int8 section appended after fp32 weights in a saved network file ("QNT8")
+    const int Int8SectionTag = 0x38544E51;
 
     //Handle a layer in network.
     struct LayerHandle
@@ -59,9 +80,54 @@ namespace HermesNetwork
         float* data = nullptr;
         float* weights = nullptr;
         int AFun = 0;
+        bool int8 = false;              // run this layer through int8 kernels instead of fp32
+        float ActScale = 0;             // int8 scale of this layer's activations (set by calibration)
+        unsigned int QNeuronsTex = 0;   // this layer's activations as int8, 4 packed per texel
+        unsigned int QWeightsTex = 0;   // weights as per row symmetric int8, 4 packed per texel
+        unsigned int QScaleTex = 0;     // per row weight scale in red and fp32 bias in green
+        layerKind kind = denseK;
+        int width = 0, height = 0, channels = 0;    // image shape of neurons, laid out as [channel][row][column]
+        int kernel = 0, stride = 1, padding = 0;     // window of convolution/pooling layer
+        int nnz = 0;                    // stored weights of sparse layer, WeightsTex then holds nnz values followed by biases
+        unsigned int RowPtrTex = 0;     // CSR row offsets (no_neuron+1) into WeightsTex
+        unsigned int ColIndexTex = 0;   // CSR column (previous layer neuron) of every stored weight
+        unsigned int ColPtrTex = 0;     // CSC column offsets (prev->no_neuron+1) into CscEntryTex
+        unsigned int CscEntryTex = 0;   // CSC entries: row in red, position in WeightsTex in green
+        int activeInputs = 0;           // non-zero inputs sent by SendSparseInputs(), 0 once inputs are dense
+        unsigned int ActiveInputTex = 0;    // value in red and input index in green of every non-zero input
+        int cell = elmanC;              // recurrent cell, WeightsTex then has a row per gate & neuron: input | hidden | bias
+        int window = 0;                 // no. of past steps unrolled by truncated BPTT, history rings keep window+1 steps
+        int step = 0;                   // steps run since last reset
+        int unrolled = 0;               // steps unrolled by last backpropagation, used by weight update
+        unsigned int StateHistTex = 0;  // row per step: gates and (h, c) of every neuron
+        unsigned int InputHistTex = 0;  // row per step: input received from previous layer
+        unsigned int GradHistTex = 0;   // row per step: pre-activation error of every gate
+        unsigned int DeltaTex = 0;      // error of h and c carried from one unrolled step to the one before
+        unsigned int ErrHistTex = 0;    // row per step: error of h given by next layer when it is recurrent too
+        int tokens = 0, heads = 0;      // self-attention over tokens x (no_neuron/tokens) neurons, laid out as [token][feature]
+        unsigned int QKVTex = 0;        // row per token: query | key | value of every head
+        unsigned int AttnTex = 0;       // row per token: attention output of all heads, before output projection
+        unsigned int AttnStatTex = 0;   // log of softmax denominator per (head, token), lets backward rebuild probabilities
+        unsigned int AttnGradTex = 0;   // error of AttnTex
+        unsigned int QKVGradTex = 0;    // error of QKVTex
+        int tuned[3] = { 0, 0, 0 };     // autotuned variant of forward, backpropagation (into previous layer) and weight update kernels of this layer's weights
+        unsigned int neuronVersion = 0; // bumped whenever NeuronsTex is written, snapshots read it back only when changed
+        unsigned int weightVersion = 0; // same for WeightsTex
+        unsigned int BatchTex = 0;      // row per sample of a batch: activation in red, error in blue
+        bool onHost = false;            // layer runs on CPU from host copies below, its textures are stale until it moves back
+        std::vector<float> hostNeurons, hostErrors, hostWeights;
     };
     typedef LayerHandle* Layer;
 
+    //Contents of a texture of a network paged out to host memory
+    struct PagedTexture
+    {
+        unsigned int* handle;           // field of layer or network that held texture, 0 while paged out
+        int internalFormat, width, height;
+        int parameters[4];              // wrap s, wrap t, min and mag filter
+        std::vector<unsigned char> pixels;
+    };
+
     //Handle to entire network.    
     struct NeuralNetworkHandle
     {
@@ -79,10 +145,39 @@ namespace HermesNetwork
     // private:
         unsigned int trainingCountByBatch = 0;
         bool errorAccumulation = false;
+        bool quantized = false;
+        unsigned int BatchTargetTex = 0;    // row per sample of a batch: target of each output in red, weight of sample in green
+        int batchRows = 0;                  // samples batch textures of every layer can hold
+        bool paged = false;                 // textures are in pagedTextures on host, see SetMemoryBudget()
+        std::vector<PagedTexture> pagedTextures;
+        long long residentBytes = -1;       // texture memory counted against budget, -1 until network is tracked
+        long long memorySignature = 0;      // batch rows and textures allocated when residentBytes was measured
+        unsigned long long lastUse = 0;     // useNetwork() clock of last call using network
+        bool pagedIn = false;               // paged back in since last call counted by countPageUse()
         
     };
     typedef NeuralNetworkHandle* NeuralNetwork;
 
+    //Fixed capacity ring of training samples kept on GPU, written by AppendReplay() and read by TrainFromReplay()
+    struct ReplayBufferHandle
+    {
+        int capacity = 0;
+        int no_of_input = 0;
+        int no_of_output = 0;
+        int head = 0;                   // row next sample goes to
+        int count = 0;                  // rows holding a sample
+        int leaves = 0;                 // capacity rounded up to a power of 2
+        unsigned int InputsTex = 0;     // row per sample: inputs in red
+        unsigned int TargetsTex = 0;    // row per sample: targets in red
+        unsigned int PriorityTex = 0;   // sum tree of priorities: leaf i at (i, 1), node i at (i, 0) with root at 1
+        unsigned int SampledTex = 0;    // row of ring each minibatch row was drawn from
+        int sampledRows = 0;
+        bool treeDirty = false;         // leaves changed since sums were built
+        unsigned int seed = 0;
+        long long draws = 0;
+    };
+    typedef ReplayBufferHandle* ReplayBuffer;
+
     #ifdef _WIN32
         HWND offscreen_context;
         HGLRC GlRenderingContext;
@@ -107,6 +202,214 @@ namespace HermesNetwork
     int ERROR_unifm_neuronOut_TEX, ERROR_unifm_actualOut_TEX;
     int ERROR_BP_unifm_neuronOut_TEX, ERROR_BP_unifm_next_L_TEX, ERROR_BP_unifm_weight_TEX, ERROR_BP_unifm_Layer_size, ERROR_BP_unifm_next_L_size;
     int ACTVLibs_unifm_SEL;
+    unsigned int QuantizeWeights, QuantizeNeurons, QActivation;
+    int QWGHT_unifm_prev_size, QWGHT_unifm_packed_size, QWGHT_unifm_weight_TEX, QWGHT_unifm_qweight_TEX, QWGHT_unifm_scale_TEX;
+    int QNRN_unifm_Layer_size, QNRN_unifm_act_scale, QNRN_unifm_neuron_TEX, QNRN_unifm_qneuron_TEX;
+    int QACTV_unifm_packed_size, QACTV_unifm_input_scale, QACTV_unifm_prev_L_TEX, QACTV_unifm_qweight_TEX, QACTV_unifm_scale_TEX;
+    unsigned int ConvActivation, ConvBackPropogate, ConvWeightUpdate, PoolActivation, PoolBackPropogate;
+    int IMG_unifm_in_shape, IMG_unifm_out_shape, IMG_unifm_window, IMG_unifm_LearnRT;
+    unsigned int Softmax_CE;
+    int SMAX_unifm_Layer_size, SMAX_unifm_with_target, SMAX_unifm_neuronOut_TEX, SMAX_unifm_actualOut_TEX;
+    unsigned int SparseActivation, SparseBackPropogate, SparseWeightUpdate;
+    int SPRS_unifm_Layer_size, SPRS_unifm_nnz, SPRS_unifm_LearnRT, SPRS_unifm_prev_size, SPRS_unifm_mode;
+    unsigned int SparseInputActivation, SparseInputWeightUpdate, SparseInputScatter;
+    unsigned int NeuronStats, OutgoingNorm;
+    int STAT_unifm_Layer_size, STAT_unifm_neuronOut_TEX, STAT_unifm_stats_TEX;
+    int NORM_unifm_Layer_size, NORM_unifm_next_size, NORM_unifm_next_weight_TEX, NORM_unifm_stats_TEX;
+    unsigned int RecurrentActivation, RecurrentGateGrad, RecurrentHiddenGrad, RecurrentWeightUpdate, RecurrentBackPropogate;
+    int RNN_unifm_shape, RNN_unifm_step, RNN_unifm_steps, RNN_unifm_LearnRT, RNN_unifm_first, RNN_unifm_external, RNN_unifm_history;
+    unsigned int AttentionProjection, AttentionScores, AttentionBackProject, AttentionBackQuery, AttentionBackKeyValue, AttentionWeightUpdate;
+    int ATTN_unifm_shape, ATTN_unifm_mode, ATTN_unifm_LearnRT;
+    int DENSE_unifm_prev_size, DENSE_unifm_Layer_size, DENSE_unifm_LearnRT, DENSE_unifm_next_size;
+    unsigned int BatchActivation, BatchError, BatchBackPropogate, BatchWeightUpdate;
+    int BATCH_unifm_prev_size, BATCH_unifm_Layer_size, BATCH_unifm_rows, BATCH_unifm_LearnRT, BATCH_unifm_next_size;
+    unsigned int ReplaySample, ReplayPriority, ReplayTreeLevel, ReplayStore;
+    int RPLY_unifm_count, RPLY_unifm_leaves, RPLY_unifm_rows, RPLY_unifm_seed, RPLY_unifm_prioritized, RPLY_unifm_input_size,
+        RPLY_unifm_output_size, RPLY_unifm_floor, RPLY_unifm_begin, RPLY_unifm_head, RPLY_unifm_capacity;
+
+    //Kernels of a dense layer that autotuner picks a variant for
+    enum tunedKernel { forwardT, backPropT, updateT, tunedKernels };
+
+    //One build of a dense kernel. Variant 0 of each kernel is the original one-invocation-per-item kernel
+    struct KernelVariant
+    {
+        const char* name;
+        int workGroup;
+        bool cooperative;           // a work group per neuron instead of an invocation per neuron
+        unsigned int program;
+        int groups(int Items) const;
+    };
+    std::vector<KernelVariant> denseVariants[tunedKernels];
+
+    //Dense kernels with sizes of one weight shape compiled in, built on first use and kept for every layer of that shape
+    bool specializeShapes = true;
+    std::map<std::array<int, 4>, unsigned int> shapedKernels;   // (kernel, variant, previous layer size, layer size), 0 if it didn't build
+
+    //Costs measured by CalibrateDevices(), in microseconds and flops per microsecond. Once measured,
+    //NetworkBuilder() and LoadNetwork() place each network on the device estimated faster for it
+    bool devicesCalibrated = false;
+    double dispatchCost = 0, uploadCost = 0, readbackCost = 0, gpuFlopRate = 0, cpuFlopRate = 0;
+
+    //Fastest variant of each kernel for dense weights of one (previous layer size, layer size)
+    struct TunedShape
+    {
+        int variant[tunedKernels];
+    };
+    std::map<std::pair<int, int>, TunedShape> tunedShapes;    // measured or read from cache, for current renderer
+    bool autotune = false;                                  // tune networks as NetworkBuilder() and LoadNetwork() build them
+    std::string tuningCachePath;
+    const char* TuningCacheHeader = "hermes tuning 1";      // change when variants change, old caches are then ignored
+
+    //Phases of network work timed by profiler, same order as ProfilePhase of API
+    enum profilePhase { forwardP, errorP, backPropP, updateP, uploadP, readbackP };
+
+    //GPU timestamps taken around one profiled call, resolved later so CPU never waits for GPU
+    struct ProfileQuery
+    {
+        Layer Lyr;
+        int phase;
+        unsigned int begin, end;
+    };
+
+    //Timings of one (layer, phase) in milliseconds. samples keeps last ProfileSampleLimit of them for percentiles
+    struct ProfileStat
+    {
+        long long count = 0;
+        double total = 0;
+        std::vector<float> samples;
+    };
+
+    const int ProfileRingSize = 256;        // calls that can be in flight before profiler has to wait for GPU
+    const int ProfileSampleLimit = 8192;
+    bool profiling = false;
+    int profileDepth = 0;                   // nesting of ProfileScope, only outermost one is timed and traced
+    Layer profileLayer = nullptr;           // layer of outermost ProfileScope, dispatches are traced under it
+    std::vector<ProfileQuery> profileRing;
+    int profileHead = 0, profilePending = 0;
+    std::map<std::pair<Layer, int>, ProfileStat> profileStats;
+
+    //Times everything issued to GPU during its lifetime when profiling is on, and records it as a span when tracing
+    struct ProfileScope
+    {
+        bool timed = false, outermost = false;
+        profilePhase phase;
+        long long start = 0;
+        ProfileScope(Layer Lyr, profilePhase Phase);
+        ~ProfileScope();
+    };
+
+    //One entry of the trace timeline. tid 0 is GPU, others are host threads
+    struct TraceEvent
+    {
+        const char* name;
+        const char* category;
+        char ph;                    // 'X' span, 'i' instant
+        int tid;
+        int layer;                  // depth of layer, -1 if none
+        long long ts, dur;          // ns since StartTrace()
+        unsigned int grid[3];
+    };
+
+    std::atomic<bool> tracing(false);
+    std::vector<TraceEvent> traceEvents;            // preallocated, writers claim slots with traceNext
+    std::atomic<long long> traceNext(0);
+    std::atomic<int> traceThreads(0);
+    std::chrono::steady_clock::time_point traceOrigin;
+    long long traceGpuOffset = 0;                   // GPU timestamp at trace origin
+
+    //Records host span of a public API call when tracing
+    struct TraceScope
+    {
+        const char* name;
+        long long start = -1;
+        TraceScope(const char* Name);
+        ~TraceScope();
+    };
+
+    //Always on engine counters, relaxed atomic adds so they cost next to nothing
+    std::atomic<long long> statInferences(0), statTrainingSteps(0);
+    std::atomic<long long> statBytesUploaded(0), statBytesReadBack(0);
+    std::atomic<long long> statStalls(0);                   // host waits for GPU: readbacks and profiler waits
+    std::atomic<long long> statDispatches(0), statBarriers(0);
+    std::vector<NeuralNetwork> networks;                    // every network created, for GPU memory of each
+
+    //Log-linear (HDR style) histogram of ns: values below 32 get own bucket, above that
+    //every power of 2 is split in 16 buckets, so any value is kept within 1/16 of it
+    struct LatencyHistogram
+    {
+        static const int Buckets = 16 * 40;                 // up to 2^40 ns, about 18 minutes
+        std::atomic<long long> bucket[Buckets];
+        std::atomic<long long> count, total, max;
+        void record(long long Ns);
+        double percentile(double P) const;                  // in ns
+    };
+    LatencyHistogram triggerLatency, trainLatency;
+
+    //GPU memory budget of all networks' textures, 0 for none. Once over it least recently used networks are paged out to host
+    long long memoryBudget = 0;
+    long long residentBytes = 0, pagedBytes = 0;            // textures of tracked networks on GPU, and host copies of paged ones
+    unsigned long long useClock = 0;
+    long long pageHits = 0, pageMisses = 0, pageOuts = 0;
+    LatencyHistogram pageInLatency, pageOutLatency;
+
+    //Adds host time of a public API call to histogram
+    struct LatencyScope
+    {
+        LatencyHistogram& histogram;
+        std::chrono::steady_clock::time_point start;
+        LatencyScope(LatencyHistogram& Histogram);
+        ~LatencyScope();
+    };
+
+    //Records of an API call log, each is one op byte followed by its fields
+    enum recordOp : unsigned char { snapshotR, loadR, buildR, activationR, inputsR, sparseInputsR, triggerR, trainR, fetchR, recordOps };
+    const int RecordTag = 0x4C504852;       // "RHPL" at start of a log
+    const int RecordVersion = 1;
+
+    std::ofstream recordFile;
+    std::string recordPath;
+    bool recording = false;
+    int recordDepth = 0;                    // nesting of recorded API calls, calls made inside another are not recorded
+    std::map<NeuralNetwork, int> recordIds; // id of every network in log, in order of appearance
+
+    //Marks a recorded API call, active only for outermost one while recording
+    struct RecordScope
+    {
+        bool active;
+        RecordScope();
+        ~RecordScope();
+    };
+
+    //Neurons (Red) or weights of a layer read back through a pixel buffer without waiting for GPU
+    struct LayerSnapshot
+    {
+        std::vector<float> values;
+        bool ready = false;             // values hold a finished readback
+        unsigned int version = 0;       // layer version values were read at
+        unsigned int pbo = 0;
+        int capacity = 0;               // floats pbo can hold
+        GLsync fence = nullptr;         // readback in flight
+        unsigned int pendingVersion = 0;
+        int pendingSize = 0;
+        std::chrono::steady_clock::time_point requested;
+    };
+    std::map<std::pair<Layer, bool>, LayerSnapshot> snapshots;     // keyed by layer and whether weights
+    float snapshotRate = 30;            // max. readbacks started per second for each snapshot, 0 for no limit
+
+    //Result of an async call, finished once GPU has signalled its fence
+    struct AsyncState
+    {
+        NeuralNetwork network = nullptr;
+        GLsync fence = nullptr;
+        unsigned int pbo = 0;           // output layer is read into it, 0 for training
+        int size = 0;                   // floats read back, whole output texture
+        bool done = false;
+        bool failed = false;            // GPU wait failed, done without outputs
+        std::vector<float> outputs;
+        std::function<void()> continuation;     // run once done, callbacks and awaiting coroutines
+    };
+    std::vector<std::shared_ptr<AsyncState>> asyncJobs;    // in flight, in order of issue
+    std::vector<unsigned int> asyncBuffers;                // pixel buffers free for next readback
 
     ////////////////////////////////////////////// Functions /////////////////////////////////////////////////////////
 
@@ -148,6 +451,199 @@ namespace HermesNetwork
 
     //Get errors from next layer neurons and backpropogate with weights to current layer neurons
 	void backPropogateError(Layer Lyr);
+
+    //Create a nearest filtered texture of given size and format, optionally filled with data
+    unsigned int createDataTexture(int width, int height, GLenum internalFormat, GLenum format, GLenum type, const void* data);
+
+    //Compile compute shader code into a program, linking activation/derivative library if required. Returns 0 on failure
+    //defines are inserted after #version line of code
+    unsigned int buildKernel(const char* code, bool withActivationLibs, const std::string& defines = "");
+
+    //Compile every variant of dense kernels
+    bool buildDenseVariants();
+
+    //Program of dense kernel's Variant specialized for weights of shape (PrevSize, Size), compiled the first time a shape is seen.
+    //Untuned layers get the invocation-per-neuron x64 variant. Sets Used to variant it was built from, returns 0 when not specializing
+    unsigned int shapedKernel(tunedKernel Kernel, int Variant, int PrevSize, int Size, const KernelVariant*& Used);
+
+    //Time every variant of dense kernels on weights of given shape and return fastest of each
+    TunedShape tuneShape(int PrevSize, int Size);
+
+    //Set tuned variants of every dense layer of Network, measuring shapes not tuned yet
+    void autotuneNetwork(NeuralNetwork Network);
+
+    //Whether batches can run through Network: dense fp32 layers only, and output without softmax
+    bool batchSupported(NeuralNetwork Network);
+
+    //Make batch textures of every layer and batch targets hold at least Rows samples.
+    //Returns false if Rows is below 1 or above GL_MAX_TEXTURE_SIZE
+    bool reserveBatch(NeuralNetwork Network, int Rows);
+
+    //Forward pass of Rows samples, from rows of input layer's BatchTex to output layer's
+    void triggerBatch(NeuralNetwork Network, int Rows);
+
+    //One weight update with mean gradient of Rows samples after triggerBatch(), against BatchTargetTex
+    void trainBatch(NeuralNetwork Network, int Rows, float LearningRate);
+
+    //Copy red of first Rows rows of Source into ring of Buffer from its head, wrapping around
+    void storeReplayRows(ReplayBuffer Buffer, unsigned int Source, unsigned int Ring, int Width, int Rows);
+
+    //Write Rows leaves of priority tree from Buffer's head, wrapping around
+    void writeReplayPriorities(ReplayBuffer Buffer, int Rows, float Priority);
+
+    //Sum leaves of priority tree up to its root, one dispatch per level
+    void buildReplayTree(ReplayBuffer Buffer);
+
+    //Whether Network can run on CPU: feed forward network of dense fp32 layers
+    bool hostSupported(NeuralNetwork Network);
+
+    //Move neurons and weights of every layer of Network from its textures into host copies, or back
+    void placeNetwork(NeuralNetwork Network, bool OnHost);
+
+    //Move Network back to GPU if it runs on CPU, for calls that work on its textures
+    void requireDevice(NeuralNetwork Network);
+
+    //Estimated microseconds of one SendInputs(), TriggerNetwork(), FetchOutputLayerData() and TrainNetwork() on GPU or CPU
+    double estimateStep(NeuralNetwork Network, bool OnHost);
+
+    //Activation functions of kernels' library on host, derivative in terms of activated value
+    float hostActivate(int Fun, float X);
+    float hostDerivate(int Fun, float Y);
+
+    //Forward pass of a dense layer of a network on CPU
+    void hostTriggerLayer(Layer Lyr);
+
+    //Same step as TrainNetwork() for a network on CPU
+    void hostTrainNetwork(NeuralNetwork Network, const float* ActualOutput, float LearningRate);
+
+    //Free textures, host copies and layers of Network, then Network itself. Waits for its async calls still in flight
+    void deleteNetwork(NeuralNetwork Network);
+
+    //Read entries of current renderer from tuning cache, and write them back keeping entries of other renderers
+    void loadTuningCache();
+    bool saveTuningCache();
+
+    //Quantize Layer's weights to per row symmetric int8 and switch the layer to int8 kernels
+    void quantizeLayer(Layer Lyr);
+
+    //Pack Layer's activations into int8 using its calibrated ActScale
+    void quantizeLayerNeurons(Layer Lyr);
+
+    //Add a convolution layer before the output layer. Input image shape is taken from the layer before it
+    void appendConvolutionLayer(NeuralNetwork Network, int Channels, int KernelSize, int Stride, int Padding);
+
+    //Add a max pooling layer before the output layer. Input image shape is taken from the layer before it
+    void appendPoolingLayer(NeuralNetwork Network, int KernelSize, int Stride);
+
+    //Set image shape and window uniforms of convolution/pooling kernels for given layer
+    void setImageUniforms(Layer Lyr);
+
+    //Normalize logits of a softmax layer. If ActualOutput is given, cross-entropy error is also stored in Blue color
+    void softmaxLayer(Layer Lyr, float* ActualOutput);
+
+    //Replace Layer's weights with given CSR arrays (values hold nnz weights followed by no_neuron biases) and build CSC index for backpropagation
+    void uploadSparseLayer(Layer Lyr, int nnz, const int* rowPtr, const int* colIndex, const float* values);
+
+    //Convert a dense layer to sparse, keeping only weights whose magnitude is above Threshold. Returns no. of weights kept
+    int sparsifyLayer(Layer Lyr, float Threshold);
+
+    //Delete sparse index textures and turn Layer back to dense kind
+    void freeSparseIndex(Layer Lyr);
+
+    //Write non-zero inputs of input Layer into its dense neurons texture, for layers that can't gather them
+    void scatterActiveInputs(Layer Lyr);
+
+    //Add Layer's current activations to per neuron sum (Red), sum of squares (Green) and max magnitude (Blue) in StatsTex
+    void accumulateNeuronStats(Layer Lyr, unsigned int StatsTex);
+
+    //Store L2 norm of each neuron's outgoing weights in Alpha of StatsTex
+    void outgoingWeightNorm(Layer Lyr, unsigned int StatsTex);
+
+    //Add a recurrent layer before the output layer. Window is the no. of past steps trained by truncated BPTT
+    void appendRecurrentLayer(NeuralNetwork Network, int LayerSize, int Cell, int Window);
+
+    //Set shape and step uniforms of recurrent kernels for given layer
+    void setRecurrentUniforms(Layer Lyr, int Step);
+
+    //Truncated BPTT: spread error of recurrent Layer's latest step back over its window into GradHistTex
+    void unrollRecurrentError(Layer Lyr);
+
+    //Add a multi-head self-attention layer before the output layer, it keeps the size of the layer before it
+    void appendAttentionLayer(NeuralNetwork Network, int Tokens, int Heads);
+
+    //Bring error of attention Layer's output back through output projection and softmax into QKVGradTex
+    void attentionBackward(Layer Lyr);
+
+    //Rebuild dense hidden Layer with only the neurons in keep and drop their columns from next layer. Activation of each removed neuron given in foldValue is added to next layer's bias.
+    //Its batch texture is resized to the new width
+    void compactLayer(Layer Lyr, const std::vector<int>& keep, const std::vector<float>& foldValue);
+
+    //Move finished timer queries from ring into profileStats. With Wait, blocks until oldest one is finished
+    void collectProfileQueries(bool Wait);
+
+    //glDispatchCompute() and glMemoryBarrier() recorded on trace timeline
+    void dispatchCompute(unsigned int X, unsigned int Y, unsigned int Z);
+    void memoryBarrier(GLbitfield Barriers);
+
+    //ns since trace started
+    long long traceClock();
+
+    //Count data sent to GPU, and data read back which also makes host wait for GPU
+    void countUpload(long long Bytes);
+    void countReadback(long long Bytes);
+
+    //Bytes of GPU memory held by a texture, and by all textures of a network
+    long long textureBytes(unsigned int Tex);
+    long long networkBytes(NeuralNetwork Network);
+
+    //Every texture handle of Network's layers and of Network itself, 0 for textures not made
+    std::vector<unsigned int*> networkTextures(NeuralNetwork Network);
+
+    //Count Network's textures against memoryBudget, measuring them again if textures were made or freed since
+    void measureNetwork(NeuralNetwork Network);
+
+    //Mark Network most recently used, paging it back in if it was paged out. While over memoryBudget, pages out least
+    //recently used networks other than Network and Keep. Call before any GPU work of Network
+    void useNetwork(NeuralNetwork Network, NeuralNetwork Keep = nullptr);
+
+    //Count a page hit or miss once per TriggerNetwork(), TrainNetwork() or batch call on Network. A miss if Network is
+    //paged out, or was paged in since the last counted call, e.g. by SendInputs()
+    void countPageUse(NeuralNetwork Network);
+
+    //Copy every texture of Network to host and free it, false if a texture has a format paging doesn't know
+    bool pageOut(NeuralNetwork Network);
+
+    //Make textures of paged out Network again from host copies
+    void pageIn(NeuralNetwork Network);
+
+    //Page out least recently used networks, except Network and Keep, until tracked ones fit in memoryBudget
+    void enforceBudget(NeuralNetwork Network, NeuralNetwork Keep);
+
+    //Latest snapshot of Lyr's neurons, or its weights. Collects a finished readback and starts a new one
+    //if layer changed since, no more than snapshotRate times a second. Never waits for GPU
+    const LayerSnapshot& snapshotLayer(Layer Lyr, bool Weights);
+
+    //Delete pixel buffers and fences of Lyr's snapshots, call before Lyr is freed
+    void dropLayerSnapshots(Layer Lyr);
+
+    //Fence work queued so far for Job and put it in flight
+    void startAsync(const std::shared_ptr<AsyncState>& Job);
+
+    //Copy Job's read back outputs unless it failed, free its fence and buffer and run its continuation
+    void finishAsync(const std::shared_ptr<AsyncState>& Job);
+
+    //Finish async jobs whose fences have signalled, in order of issue. Waits for GPU only until Until is done, never without it
+    void pollAsync(AsyncState* Until);
+
+    //Append raw bytes to API call log
+    void recordBytes(const void* Data, size_t Size);
+
+    //Id of Network in API call log. A network the log hasn't seen yet is saved into it first,
+    //so networks made before recording or by builders that aren't recorded can still be replayed
+    int recordNetwork(NeuralNetwork Network);
+
+    //Add an event to trace without locking, dropped once trace buffer is full
+    void traceEvent(const char* Name, const char* Category, char Ph, long long Ts, long long Dur, int Tid, Layer Lyr, const unsigned int* Grid);
     
     
 
@@ -155,8 +651,6 @@ namespace HermesNetwork
 
     const char* WeightInitShader_code =
         "#version 420                                                                    \n"
-        "precision highp float;                                                          \n"   
-        "precision highp image2D;                                                        \n"     
         "#extension GL_ARB_compute_shader : require                                      \n"
         "#extension GL_ARB_shader_image_load_store : require                             \n"
         "#extension GL_ARB_gpu_shader5 : require                                         \n"
@@ -165,6 +659,8 @@ namespace HermesNetwork
         "#pragma optionNV(fastmath off) \n"
         "#pragma optionNV(fastprecision off)  \n"
         "#pragma optionNV(strict on)    \n "
+        "precision highp float;                                                          \n"   
+        "precision highp image2D;                                                        \n"     
 
         "layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;                \n"
         "layout(rgba32f, binding = 0) uniform image2D img_output;                        \n"
@@ -185,8 +681,6 @@ namespace HermesNetwork
 
     const char* ActivationShader_code = 
         "#version 420                                                                    \n"
-        "precision highp float;                                                          \n"
-        "precision highp image2D;                                                        \n"
         "#extension GL_ARB_compute_shader : require                                      \n"
         "#extension GL_ARB_shader_image_load_store : require                             \n"
         "#extension GL_ARB_gpu_shader5 : require                                         \n"
@@ -195,6 +689,8 @@ namespace HermesNetwork
         "#pragma optionNV(fastmath off) \n"
         "#pragma optionNV(fastprecision off)  \n"
         "#pragma optionNV(strict on)    \n "
+        "precision highp float;                                                          \n"
+        "precision highp image2D;                                                        \n"
 
         "layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;                \n"
         "layout(rgba32f, binding = 0) uniform image2D img_output;                        \n"
@@ -235,10 +731,10 @@ namespace HermesNetwork
 
     const char* ErrorGen_code =     
         "#version 420                                                                 \n"
-        "precision highp float;                                                       \n"
         "#extension GL_ARB_compute_shader : require                                   \n"
         "#extension GL_ARB_shader_image_load_store : require                          \n"
         "#extension GL_ARB_gpu_shader5 : require                                      \n"
+        "precision highp float;                                                       \n"
         "layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;             \n"
         "layout(rgba32f, binding = 0) uniform image2D NeuronsOutput;                  \n"  
         "layout(rgba32f, binding = 1) uniform image2D ActualOutput;                   \n"        
@@ -256,10 +752,10 @@ namespace HermesNetwork
     
     const char* WeightUpdateShader_code = 
         "#version 420                                                                           \n"
-        "precision highp float;                                                                 \n"
         "#extension GL_ARB_compute_shader : require                                             \n"
         "#extension GL_ARB_shader_image_load_store : require                                    \n"
         "#extension GL_ARB_gpu_shader5 : require                                                \n"
+        "precision highp float;                                                                 \n"
         "layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;                       \n"
         "layout(rgba32f, binding = 0) uniform image2D Weights;                                  \n"  
         "layout(rgba32f, binding = 1) uniform image2D NeuronsOutput;                            \n"          
@@ -282,7 +778,7 @@ namespace HermesNetwork
             //figure out which input neuron this weight belongs to
         "   NeuronSelect = mod(gl_GlobalInvocationID.x, PreviousLayer_size + 1);                \n"
             //get that input neuron value
-        "   inputVal = imageLoad(PreviousLayer, ivec2(NeuronSelect / PreviousLayer_size, 0));   \n"
+        "   inputVal = imageLoad(PreviousLayer, ivec2(NeuronSelect, 0));                        \n"
             //set bias to 1 (can also use == instead of >=)
         "   if(NeuronSelect >= PreviousLayer_size)                                              \n"
         "       inputVal.r = 1.0;                                                               \n"        
@@ -295,10 +791,10 @@ namespace HermesNetwork
     
     const char* ErrorBackPropogate_code = 
         "#version 420                                                                                                   \n"
-        "precision highp float;                                                                                         \n"
         "#extension GL_ARB_compute_shader : require                                                                     \n"
         "#extension GL_ARB_shader_image_load_store : require                                                            \n"
         "#extension GL_ARB_gpu_shader5 : require                                                                        \n"
+        "precision highp float;                                                                                         \n"
         "layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;                                               \n"
         "layout(rgba32f, binding = 0) uniform image2D NeuronsOutput;                                                    \n"  
         "layout(rgba32f, binding = 1) uniform image2D NextLayerOutput;                                                  \n"          
@@ -335,11 +831,11 @@ namespace HermesNetwork
 
     const char* ActiveDeriveLibs_code = 
         "#version 420                                                                    \n"
-        "precision highp float;                                                          \n"
         "#extension GL_ARB_compute_shader : require                                      \n"
         "#extension GL_ARB_shader_image_load_store : require                             \n"
         "#extension GL_ARB_gpu_shader5 : require                                         \n"
         "#extension GL_ARB_explicit_uniform_location : enable                            \n"
+        "precision highp float;                                                          \n"
         
         "layout(location = 0) uniform int selection = 0;                                 \n"
         
@@ -365,7 +861,7 @@ namespace HermesNetwork
         "}                                                                               \n"
         "float reLu_derivative(float x)                                                  \n"
         "{                                                                               \n"
-        "       return step(x,0);                                                        \n"
+        "       return x > 0.0 ? 1.0 : 0.0;                                              \n"
         "}                                                                               \n"
         "float Activate(float x)                                                         \n"
         "{                                                                               \n"
@@ -375,6 +871,8 @@ namespace HermesNetwork
         "       return tanH(x);                                                          \n"
         "   else if(selection == 2)                                                      \n"
         "       return reLu(x);                                                          \n"
+        "   else if(selection == 4 || selection == 5)                                    \n"
+        "       return x;                                                                \n"
         "}                                                                               \n"            
         "float Derivate(float x)                                                         \n"
         "{                                                                               \n"
@@ -384,793 +882,6915 @@ namespace HermesNetwork
         "       return tanH_derivative(x);                                               \n"
         "   else if(selection == 2)                                                      \n"
         "       return reLu_derivative(x);                                               \n"
+        "   else if(selection == 4 || selection == 5)                                    \n"
+        "       return 1.0;                                                              \n"
         "}                                                                               \0"
         ;
-};
 
+    const char* QuantizeWeightsShader_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_gpu_shader5 : require                                         \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;                \n"
+        "layout(rgba32f, binding = 0) readonly uniform image2D Weights;                  \n"
+        "layout(r32i, binding = 1) writeonly uniform iimage2D QWeights;                  \n"
+        "layout(rgba32f, binding = 2) writeonly uniform image2D QScale;                  \n"
+        "uniform int PreviousLayer_size;                                                 \n"
+        "uniform int PackedRow_size;                                                     \n"
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+            //one invocation quantizes one row (all weights going into one neuron)
+        "   int row = int(gl_GlobalInvocationID.x);                                      \n"
+        "   int weight_start = row * (PreviousLayer_size + 1);                           \n"
+        "   float absMax = 0;                                                            \n"
+        "   for(int i=0; i<PreviousLayer_size; i++)                                      \n"
+        "       absMax = max(absMax, abs(imageLoad(Weights, ivec2(weight_start+i,0)).r));\n"
+        "   float scale = absMax > 0 ? absMax / 127.0 : 1.0;                             \n"
+        "   for(int k=0; k<PackedRow_size; k++)                                          \n"
+        "   {                                                                            \n"
+        "       int pack4 = 0;                                                          \n"
+        "       for(int j=0; j<4; j++)                                                   \n"
+        "       {                                                                        \n"
+        "           int i = k*4 + j;                                                     \n"
+        "           int q = 0;                                                           \n"
+        "           if(i < PreviousLayer_size)                                           \n"
+        "               q = int(clamp(round(imageLoad(Weights, ivec2(weight_start+i,0)).r / scale), -127.0, 127.0));\n"
+        "           pack4 = bitfieldInsert(pack4, q, j*8, 8);                          \n"
+        "       }                                                                        \n"
+        "       imageStore(QWeights, ivec2(row*PackedRow_size + k,0), ivec4(pack4));    \n"
+        "   }                                                                            \n"
+            //bias stays in fp32 next to the row scale
+        "   float bias = imageLoad(Weights, ivec2(weight_start+PreviousLayer_size,0)).r; \n"
+        "   imageStore(QScale, ivec2(row,0), vec4(scale, bias, 0, 1));                   \n"
+        "}                                                                               \0"
+        ;
 
-/*
- *********************************************************
-   Below are all API vars and function for HermesNetwork
- *********************************************************
-*/
+    const char* QuantizeNeuronsShader_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_gpu_shader5 : require                                         \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;                \n"
+        "layout(rgba32f, binding = 0) readonly uniform image2D Neurons;                  \n"
+        "layout(r32i, binding = 1) writeonly uniform iimage2D QNeurons;                  \n"
+        "uniform int Layer_size;                                                         \n"
+        "uniform float Act_scale;                                                        \n"
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+            //one invocation packs 4 neighbouring neurons into one texel
+        "   int pack4 = 0;                                                              \n"
+        "   for(int j=0; j<4; j++)                                                       \n"
+        "   {                                                                            \n"
+        "       int i = int(gl_GlobalInvocationID.x)*4 + j;                              \n"
+        "       int q = 0;                                                               \n"
+        "       if(i < Layer_size)                                                       \n"
+        "           q = int(clamp(round(imageLoad(Neurons, ivec2(i,0)).r / Act_scale), -127.0, 127.0));\n"
+        "       pack4 = bitfieldInsert(pack4, q, j*8, 8);                              \n"
+        "   }                                                                            \n"
+        "   imageStore(QNeurons, ivec2(gl_GlobalInvocationID.xy), ivec4(pack4));        \n"
+        "}                                                                               \0"
+        ;
 
-//Bypass the namespace to make structure type public
-typedef HermesNetwork::NeuralNetwork NeuralNetwork;
+    const char* QActivationShader_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_gpu_shader5 : require                                         \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;                \n"
+        "layout(rgba32f, binding = 0) uniform image2D img_output;                        \n"
+        "layout(r32i, binding = 1) readonly uniform iimage2D PreviousLayer;              \n"
+        "layout(r32i, binding = 2) readonly uniform iimage2D QWeights;                   \n"
+        "layout(rgba32f, binding = 3) readonly uniform image2D QScale;                   \n"
+        "uniform int PackedRow_size;                                                     \n"
+        "uniform float Input_scale;                                                      \n"
 
-//This enum stores IDs of all different Activation Functions. To be used as an argument in SetActivation()
-enum ActivationType 
-{   Sigmoid = 0, 
-    TanH = 1, 
-    ReLu = 2,
-    LeakyReLu = 3
-};
+        "float Activate(float x);                                                        \n"
 
-//Setup gl context, compile shaders, create drawing polygon
-bool InitNeuralLink(bool GL_Context_Shared);
+            //dot product of two 4 x int8 packed integers
+        "int dot4x8(int a, int b)                                                        \n"
+        "{                                                                               \n"
+        "   return bitfieldExtract(a, 0, 8)  * bitfieldExtract(b, 0, 8)                  \n"
+        "        + bitfieldExtract(a, 8, 8)  * bitfieldExtract(b, 8, 8)                  \n"
+        "        + bitfieldExtract(a, 16, 8) * bitfieldExtract(b, 16, 8)                 \n"
+        "        + bitfieldExtract(a, 24, 8) * bitfieldExtract(b, 24, 8);                \n"
+        "}                                                                               \n"
 
-//Builds network with given input size, hiddenlayer size as array and output size.
-template <typename T = int>
-NeuralNetwork NetworkBuilder(int InputSize, std::vector<T> HiddenLayers, int OutputSize);
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   vec4 neuronData = imageLoad(img_output, ivec2(gl_GlobalInvocationID.xy));    \n"
+        "   int weight_start = int(gl_GlobalInvocationID.x) * PackedRow_size;            \n"
+        "   int acc = 0;                                                                 \n"
+        "   for(int k=0; k<PackedRow_size; k++)                                          \n"
+        "       acc += dot4x8(imageLoad(PreviousLayer, ivec2(k,0)).r, imageLoad(QWeights, ivec2(weight_start+k,0)).r);\n"
+        "   vec4 scale = imageLoad(QScale, ivec2(gl_GlobalInvocationID.x,0));            \n"
+        "   neuronData.r = Activate(float(acc) * scale.r * Input_scale + scale.g);       \n"
+        "   neuronData.a = 1.0;                                                          \n"
+        "   imageStore(img_output, ivec2(gl_GlobalInvocationID.xy), neuronData);         \n"
+        "}                                                                               \0"
+        ;
 
-//Activates every neurons of a layer at specified depth
-void TriggerLayer(NeuralNetwork* Network, int LayerDepth);
+    /*
+     * Convolution and pooling kernels share explicit uniform locations 1-4
+     * (location 0 is activation selection), so one set of locations is used for all of them.
+     * Maximum supported window: kernel <= 11 and 7 * stride + kernel <= 32.
+     */
+    const char* ConvActivationShader_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;                \n"
+        "layout(rgba32f, binding = 0) uniform image2D img_output;                        \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D PreviousLayer;            \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D LayerWeight;              \n"
+        "layout(location = 1) uniform ivec3 In_shape;    // width, height, channels      \n"
+        "layout(location = 2) uniform ivec3 Out_shape;   // width, height, channels      \n"
+        "layout(location = 3) uniform ivec3 Window;      // kernel, stride, padding      \n"
+        "shared float InputTile[32*32];                                                  \n"
+        "shared float FilterTile[11*11];                                                 \n"
 
-//Triggers every layers in network sequentially from input layer to output layer
-void TriggerNetwork(NeuralNetwork* Network);
+        "float Activate(float x);                                                        \n"
 
-//Set every neurons of input layer with specified values in array
-void SendInputs(NeuralNetwork Network, float Inputs[]);
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+            //every 8x8 work group computes an 8x8 patch of one output channel
+        "   ivec2 outPos = ivec2(gl_GlobalInvocationID.xy);                              \n"
+        "   int oc = int(gl_GlobalInvocationID.z);                                       \n"
+        "   int K = Window.x, S = Window.y;                                              \n"
+        "   int tileSize = 7*S + K;                                                      \n"
+        "   ivec2 origin = ivec2(gl_WorkGroupID.xy) * 8 * S - Window.z;                  \n"
+        "   ivec2 base = ivec2(gl_LocalInvocationID.xy) * S;                             \n"
+        "   int filter_start = oc * (In_shape.z*K*K + 1);                                \n"
+        "   int t0 = int(gl_LocalInvocationIndex);                                       \n"
+        "   float sum = 0;                                                               \n"
+        "   for(int ic=0; ic<In_shape.z; ic++)                                           \n"
+        "   {                                                                            \n"
+                //load input patch and filter of this channel once for the whole group
+        "       for(int t=t0; t<tileSize*tileSize; t+=64)                                \n"
+        "       {                                                                        \n"
+        "           ivec2 p = origin + ivec2(t % tileSize, t / tileSize);                \n"
+        "           bool inside = p.x >= 0 && p.y >= 0 && p.x < In_shape.x && p.y < In_shape.y;\n"
+        "           InputTile[t] = inside ? imageLoad(PreviousLayer, ivec2((ic*In_shape.y + p.y)*In_shape.x + p.x, 0)).r : 0.0;\n"
+        "       }                                                                        \n"
+        "       for(int t=t0; t<K*K; t+=64)                                              \n"
+        "           FilterTile[t] = imageLoad(LayerWeight, ivec2(filter_start + ic*K*K + t, 0)).r;\n"
+        "       barrier();                                                               \n"
+        "       for(int ky=0; ky<K; ky++)                                                \n"
+        "           for(int kx=0; kx<K; kx++)                                            \n"
+        "               sum += InputTile[(base.y+ky)*tileSize + base.x+kx] * FilterTile[ky*K+kx];\n"
+        "       barrier();                                                               \n"
+        "   }                                                                            \n"
+        "   if(outPos.x >= Out_shape.x || outPos.y >= Out_shape.y)                       \n"
+        "       return;                                                                  \n"
+        "   ivec2 idx = ivec2((oc*Out_shape.y + outPos.y)*Out_shape.x + outPos.x, 0);    \n"
+        "   vec4 neuronData = imageLoad(img_output, idx);                                \n"
+        "   sum += imageLoad(LayerWeight, ivec2(filter_start + In_shape.z*K*K, 0)).r;    \n"
+        "   neuronData.r = Activate(sum); neuronData.a = 1.0;                            \n"
+        "   imageStore(img_output, idx, neuronData);                                     \n"
+        "}                                                                               \0"
+        ;
 
-//Get neurons data in output layer as array
-void FetchOutputLayerData(NeuralNetwork Network);
+    const char* ConvBackPropogate_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;                \n"
+        "layout(rgba32f, binding = 0) uniform image2D NeuronsOutput;                     \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D NextLayerOutput;          \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D WeightsToNextLayer;       \n"
+        "layout(location = 1) uniform ivec3 In_shape;    // shape of this layer          \n"
+        "layout(location = 2) uniform ivec3 Out_shape;   // shape of next (conv) layer   \n"
+        "layout(location = 3) uniform ivec3 Window;                                      \n"
+        "shared float ErrorTile[32*32];                                                  \n"
+        "shared float FilterTile[11*11];                                                 \n"
+
+        "float Derivate(float x);                                                        \n"
 
-//Generate Error in output neurons, backpropogate errors to previous layers and updates every weight and bias
-void TrainNetwork(NeuralNetwork Network, float ActualOutput[], float LearningRate);
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+            //every 8x8 work group gathers errors for an 8x8 patch of one channel of this layer
+        "   ivec2 pos = ivec2(gl_GlobalInvocationID.xy);                                 \n"
+        "   int ic = int(gl_GlobalInvocationID.z);                                       \n"
+        "   int K = Window.x, S = Window.y, P = Window.z;                                \n"
+        "   ivec2 tileOrg = ivec2(gl_WorkGroupID.xy) * 8;                                \n"
+            //range of next layer positions whose window touches this tile
+        "   ivec2 lo = ivec2(ceil(vec2(tileOrg + P - K + 1) / float(S)));                \n"
+        "   ivec2 hi = ivec2(floor(vec2(tileOrg + 7 + P) / float(S)));                   \n"
+        "   ivec2 tileSize = hi - lo + 1;                                                \n"
+        "   int t0 = int(gl_LocalInvocationIndex);                                       \n"
+        "   float ERROR = 0;                                                             \n"
+        "   for(int oc=0; oc<Out_shape.z; oc++)                                          \n"
+        "   {                                                                            \n"
+        "       for(int t=t0; t<tileSize.x*tileSize.y; t+=64)                            \n"
+        "       {                                                                        \n"
+        "           ivec2 o = lo + ivec2(t % tileSize.x, t / tileSize.x);                \n"
+        "           bool inside = o.x >= 0 && o.y >= 0 && o.x < Out_shape.x && o.y < Out_shape.y;\n"
+        "           ErrorTile[t] = inside ? imageLoad(NextLayerOutput, ivec2((oc*Out_shape.y + o.y)*Out_shape.x + o.x, 0)).b : 0.0;\n"
+        "       }                                                                        \n"
+        "       for(int t=t0; t<K*K; t+=64)                                              \n"
+        "           FilterTile[t] = imageLoad(WeightsToNextLayer, ivec2(oc*(In_shape.z*K*K + 1) + ic*K*K + t, 0)).r;\n"
+        "       barrier();                                                               \n"
+        "       for(int ky=0; ky<K; ky++)                                                \n"
+        "           for(int kx=0; kx<K; kx++)                                            \n"
+        "           {                                                                    \n"
+        "               ivec2 o = pos + P - ivec2(kx, ky);                               \n"
+        "               if(o.x < 0 || o.y < 0 || o.x % S != 0 || o.y % S != 0)           \n"
+        "                   continue;                                                    \n"
+        "               o = o / S - lo;                                                  \n"
+        "               ERROR += ErrorTile[o.y*tileSize.x + o.x] * FilterTile[ky*K+kx];  \n"
+        "           }                                                                    \n"
+        "       barrier();                                                               \n"
+        "   }                                                                            \n"
+        "   if(pos.x >= In_shape.x || pos.y >= In_shape.y)                               \n"
+        "       return;                                                                  \n"
+        "   ivec2 idx = ivec2((ic*In_shape.y + pos.y)*In_shape.x + pos.x, 0);            \n"
+        "   vec4 neuron = imageLoad(NeuronsOutput, idx);                                 \n"
+        "   neuron.b = Derivate(neuron.r) * ERROR;                                       \n"
+        "   imageStore(NeuronsOutput, idx, neuron);                                      \n"
+        "}                                                                               \0"
+        ;
 
-//save network structure,weights and bias in a file.
-void SaveNetwork(NeuralNetwork Network, const char filename[]);
+    const char* ConvWeightUpdate_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) uniform image2D Weights;                           \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D NeuronsOutput;            \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D PreviousLayer;            \n"
+        "layout(location = 1) uniform ivec3 In_shape;                                    \n"
+        "layout(location = 2) uniform ivec3 Out_shape;                                   \n"
+        "layout(location = 3) uniform ivec3 Window;                                      \n"
+        "layout(location = 4) uniform float LearningRate;                                \n"
+        "shared float InputTile[32*32];                                                  \n"
+        "shared float ErrorTile[64];                                                     \n"
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+            //every work group owns the K*K filter connecting one input channel to one output channel.
+            //invocation t accumulates gradient of filter taps t and t+64 over 8x8 output tiles
+        "   int oc = int(gl_WorkGroupID.x), ic = int(gl_WorkGroupID.y);                  \n"
+        "   int t0 = int(gl_LocalInvocationIndex);                                       \n"
+        "   int K = Window.x, S = Window.y;                                              \n"
+        "   int tileSize = 7*S + K;                                                      \n"
+        "   float grad0 = 0, grad1 = 0, biasGrad = 0;                                    \n"
+        "   ivec2 tiles = (Out_shape.xy + 7) / 8;                                        \n"
+        "   for(int ty=0; ty<tiles.y; ty++)                                              \n"
+        "   for(int tx=0; tx<tiles.x; tx++)                                              \n"
+        "   {                                                                            \n"
+        "       ivec2 o = ivec2(tx, ty)*8 + ivec2(t0 % 8, t0 / 8);                       \n"
+        "       bool inside = o.x < Out_shape.x && o.y < Out_shape.y;                    \n"
+        "       ErrorTile[t0] = inside ? imageLoad(NeuronsOutput, ivec2((oc*Out_shape.y + o.y)*Out_shape.x + o.x, 0)).b : 0.0;\n"
+        "       ivec2 origin = ivec2(tx, ty)*8*S - Window.z;                             \n"
+        "       for(int t=t0; t<tileSize*tileSize; t+=64)                                \n"
+        "       {                                                                        \n"
+        "           ivec2 p = origin + ivec2(t % tileSize, t / tileSize);                \n"
+        "           inside = p.x >= 0 && p.y >= 0 && p.x < In_shape.x && p.y < In_shape.y;\n"
+        "           InputTile[t] = inside ? imageLoad(PreviousLayer, ivec2((ic*In_shape.y + p.y)*In_shape.x + p.x, 0)).r : 0.0;\n"
+        "       }                                                                        \n"
+        "       barrier();                                                               \n"
+        "       for(int e=0; e<64; e++)                                                  \n"
+        "       {                                                                        \n"
+        "           int row = (e / 8)*S, col = (e % 8)*S;                                \n"
+        "           if(t0 < K*K)                                                         \n"
+        "               grad0 += ErrorTile[e] * InputTile[(row + t0/K)*tileSize + col + t0%K];\n"
+        "           if(t0 + 64 < K*K)                                                    \n"
+        "               grad1 += ErrorTile[e] * InputTile[(row + (t0+64)/K)*tileSize + col + (t0+64)%K];\n"
+        "           biasGrad += ErrorTile[e];                                            \n"
+        "       }                                                                        \n"
+        "       barrier();                                                               \n"
+        "   }                                                                            \n"
+        "   int filter_start = oc * (In_shape.z*K*K + 1);                                \n"
+        "   ivec2 w;                                                                     \n"
+        "   if(t0 < K*K)                                                                 \n"
+        "   {                                                                            \n"
+        "       w = ivec2(filter_start + ic*K*K + t0, 0);                                \n"
+        "       imageStore(Weights, w, imageLoad(Weights, w) + vec4(grad0 * LearningRate, 0, 0, 0));\n"
+        "   }                                                                            \n"
+        "   if(t0 + 64 < K*K)                                                            \n"
+        "   {                                                                            \n"
+        "       w = ivec2(filter_start + ic*K*K + t0 + 64, 0);                           \n"
+        "       imageStore(Weights, w, imageLoad(Weights, w) + vec4(grad1 * LearningRate, 0, 0, 0));\n"
+        "   }                                                                            \n"
+            //bias of output channel is updated once, by first invocation of first input channel
+        "   if(t0 == 0 && ic == 0)                                                       \n"
+        "   {                                                                            \n"
+        "       w = ivec2(filter_start + In_shape.z*K*K, 0);                             \n"
+        "       imageStore(Weights, w, imageLoad(Weights, w) + vec4(biasGrad * LearningRate, 0, 0, 0));\n"
+        "   }                                                                            \n"
+        "}                                                                               \0"
+        ;
 
-//load saved network from disk and generate a live neural network as per saved data such as weights, bias and no of layers.
-NeuralNetwork LoadNetwork(const char filename[]);
+    const char* PoolActivationShader_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;                \n"
+        "layout(rgba32f, binding = 0) uniform image2D img_output;                        \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D PreviousLayer;            \n"
+        "layout(location = 1) uniform ivec3 In_shape;                                    \n"
+        "layout(location = 2) uniform ivec3 Out_shape;                                   \n"
+        "layout(location = 3) uniform ivec3 Window;                                      \n"
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   ivec3 o = ivec3(gl_GlobalInvocationID);                                      \n"
+        "   if(o.x >= Out_shape.x || o.y >= Out_shape.y)                                 \n"
+        "       return;                                                                  \n"
+        "   float maxVal = -3.402823e38;                                                 \n"
+        "   for(int ky=0; ky<Window.x; ky++)                                             \n"
+        "       for(int kx=0; kx<Window.x; kx++)                                         \n"
+        "       {                                                                        \n"
+        "           ivec2 p = o.xy*Window.y - Window.z + ivec2(kx, ky);                  \n"
+        "           if(p.x >= 0 && p.y >= 0 && p.x < In_shape.x && p.y < In_shape.y)     \n"
+        "               maxVal = max(maxVal, imageLoad(PreviousLayer, ivec2((o.z*In_shape.y + p.y)*In_shape.x + p.x, 0)).r);\n"
+        "       }                                                                        \n"
+        "   ivec2 idx = ivec2((o.z*Out_shape.y + o.y)*Out_shape.x + o.x, 0);             \n"
+        "   vec4 neuronData = imageLoad(img_output, idx);                                \n"
+        "   neuronData.r = maxVal; neuronData.a = 1.0;                                   \n"
+        "   imageStore(img_output, idx, neuronData);                                     \n"
+        "}                                                                               \0"
+        ;
 
-//Set Activation Function for all the layers in NeuralNetwork
-void SetActivation(NeuralNetwork Network, ActivationType AllLayersType);
+    const char* PoolBackPropogate_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;                \n"
+        "layout(rgba32f, binding = 0) uniform image2D NeuronsOutput;                     \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D NextLayerOutput;          \n"
+        "layout(location = 1) uniform ivec3 In_shape;    // shape of this layer          \n"
+        "layout(location = 2) uniform ivec3 Out_shape;   // shape of next (pooling) layer\n"
+        "layout(location = 3) uniform ivec3 Window;                                      \n"
 
-//Set different Activation Function for hidden and output layers in NeuralNetwor
+        "float Derivate(float x);                                                        \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   ivec3 pos = ivec3(gl_GlobalInvocationID);                                    \n"
+        "   if(pos.x >= In_shape.x || pos.y >= In_shape.y)                               \n"
+        "       return;                                                                  \n"
+        "   int K = Window.x, S = Window.y, P = Window.z;                                \n"
+        "   ivec2 lo = max(ivec2(ceil(vec2(pos.xy + P - K + 1) / float(S))), ivec2(0));  \n"
+        "   ivec2 hi = min(ivec2(floor(vec2(pos.xy + P) / float(S))), Out_shape.xy - 1); \n"
+        "   float ERROR = 0;                                                             \n"
+            //error flows back only to the neuron which won the max of a pooling window
+        "   for(int oy=lo.y; oy<=hi.y; oy++)                                             \n"
+        "   for(int ox=lo.x; ox<=hi.x; ox++)                                             \n"
+        "   {                                                                            \n"
+        "       float maxVal = -3.402823e38;                                             \n"
+        "       ivec2 winner = ivec2(-1);                                                \n"
+        "       for(int ky=0; ky<K; ky++)                                                \n"
+        "           for(int kx=0; kx<K; kx++)                                            \n"
+        "           {                                                                    \n"
+        "               ivec2 p = ivec2(ox, oy)*S - P + ivec2(kx, ky);                   \n"
+        "               if(p.x < 0 || p.y < 0 || p.x >= In_shape.x || p.y >= In_shape.y) \n"
+        "                   continue;                                                    \n"
+        "               float v = imageLoad(NeuronsOutput, ivec2((pos.z*In_shape.y + p.y)*In_shape.x + p.x, 0)).r;\n"
+        "               if(v > maxVal) { maxVal = v; winner = p; }                       \n"
+        "           }                                                                    \n"
+        "       if(winner == pos.xy)                                                     \n"
+        "           ERROR += imageLoad(NextLayerOutput, ivec2((pos.z*Out_shape.y + oy)*Out_shape.x + ox, 0)).b;\n"
+        "   }                                                                            \n"
+        "   ivec2 idx = ivec2((pos.z*In_shape.y + pos.y)*In_shape.x + pos.x, 0);         \n"
+        "   vec4 neuron = imageLoad(NeuronsOutput, idx);                                 \n"
+        "   neuron.b = Derivate(neuron.r) * ERROR;                                       \n"
+        "   imageStore(NeuronsOutput, idx, neuron);                                      \n"
+        "}                                                                               \0"
+        ;
+    const char* SoftmaxCrossEntropy_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;              \n"
+        "layout(rgba32f, binding = 0) uniform image2D NeuronsOutput;                     \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D ActualOutput;             \n"
+        "uniform int Layer_size;                                                         \n"
+        "uniform int WithTarget;                                                         \n"
+        "shared float Reduce[256];                                                       \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+            //logits are kept in Green so the error pass can normalize them again
+        "   int t0 = int(gl_LocalInvocationIndex);                                       \n"
+        "   float localMax = -3.402823e38;                                               \n"
+        "   for(int i=t0; i<Layer_size; i+=256)                                          \n"
+        "   {                                                                            \n"
+        "       vec4 neuron = imageLoad(NeuronsOutput, ivec2(i,0));                      \n"
+        "       if(WithTarget == 0)                                                      \n"
+        "       {                                                                        \n"
+        "           neuron.g = neuron.r;                                                 \n"
+        "           imageStore(NeuronsOutput, ivec2(i,0), neuron);                       \n"
+        "       }                                                                        \n"
+        "       localMax = max(localMax, neuron.g);                                      \n"
+        "   }                                                                            \n"
+        "   Reduce[t0] = localMax;                                                       \n"
+        "   barrier();                                                                   \n"
+        "   for(int w=128; w>0; w>>=1)                                                   \n"
+        "   {                                                                            \n"
+        "       if(t0 < w)                                                               \n"
+        "           Reduce[t0] = max(Reduce[t0], Reduce[t0+w]);                          \n"
+        "       barrier();                                                               \n"
+        "   }                                                                            \n"
+        "   float maxVal = Reduce[0];                                                    \n"
+        "   barrier();                                                                   \n"
+        "   float localSum = 0;                                                          \n"
+        "   for(int i=t0; i<Layer_size; i+=256)                                          \n"
+        "       localSum += exp(imageLoad(NeuronsOutput, ivec2(i,0)).g - maxVal);        \n"
+        "   Reduce[t0] = localSum;                                                       \n"
+        "   barrier();                                                                   \n"
+        "   for(int w=128; w>0; w>>=1)                                                   \n"
+        "   {                                                                            \n"
+        "       if(t0 < w)                                                               \n"
+        "           Reduce[t0] += Reduce[t0+w];                                          \n"
+        "       barrier();                                                               \n"
+        "   }                                                                            \n"
+        "   float sum = Reduce[0];                                                       \n"
+        "   for(int i=t0; i<Layer_size; i+=256)                                          \n"
+        "   {                                                                            \n"
+        "       vec4 neuron = imageLoad(NeuronsOutput, ivec2(i,0));                      \n"
+        "       neuron.r = exp(neuron.g - maxVal) / sum;                                 \n"
+        "       neuron.a = 1.0;                                                          \n"
+            //gradient of cross-entropy through softmax, same sign as ErrorGen (target - output)
+        "       if(WithTarget != 0)                                                      \n"
+        "           neuron.b = imageLoad(ActualOutput, ivec2(i,0)).r - neuron.r;         \n"
+        "       imageStore(NeuronsOutput, ivec2(i,0), neuron);                           \n"
+        "   }                                                                            \n"
+        "}                                                                               \0"
+        ;
+
+    const char* SparseActivationShader_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) uniform image2D img_output;                        \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D PreviousLayer;            \n"
+        "layout(r32f, binding = 2) readonly uniform image2D Values;                      \n"
+        "layout(r32i, binding = 3) readonly uniform iimage2D RowPtr;                     \n"
+        "layout(r32i, binding = 4) readonly uniform iimage2D ColIndex;                   \n"
+        "layout(location = 1) uniform int Layer_size;                                    \n"
+        "layout(location = 2) uniform int NonZero_size;                                  \n"
+
+        "float Activate(float x);                                                        \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int n = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(n >= Layer_size)                                                          \n"
+        "       return;                                                                  \n"
+            //only stored weights of this neuron's row are visited
+        "   int start = imageLoad(RowPtr, ivec2(n,0)).r;                                 \n"
+        "   int end = imageLoad(RowPtr, ivec2(n+1,0)).r;                                 \n"
+        "   float Rval = 0;                                                              \n"
+        "   for(int k=start; k<end; k++)                                                 \n"
+        "       Rval += imageLoad(Values, ivec2(k,0)).r * imageLoad(PreviousLayer, ivec2(imageLoad(ColIndex, ivec2(k,0)).r, 0)).r;\n"
+        "   Rval += imageLoad(Values, ivec2(NonZero_size + n, 0)).r;                     \n"
+        "   vec4 neuronData = imageLoad(img_output, ivec2(n,0));                         \n"
+        "   neuronData.r = Activate(Rval); neuronData.a = 1.0;                           \n"
+        "   imageStore(img_output, ivec2(n,0), neuronData);                              \n"
+        "}                                                                               \0"
+        ;
+
+    const char* SparseBackPropogate_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) uniform image2D NeuronsOutput;                     \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D NextLayerOutput;          \n"
+        "layout(r32f, binding = 2) readonly uniform image2D Values;                      \n"
+        "layout(r32i, binding = 3) readonly uniform iimage2D ColPtr;                     \n"
+        "layout(rg32i, binding = 4) readonly uniform iimage2D CscEntry;                  \n"
+        "layout(location = 1) uniform int Layer_size;    // size of this layer           \n"
+
+        "float Derivate(float x);                                                        \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int n = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(n >= Layer_size)                                                          \n"
+        "       return;                                                                  \n"
+            //walk this neuron's column of next layer: (row of next layer, position in Values)
+        "   int start = imageLoad(ColPtr, ivec2(n,0)).r;                                 \n"
+        "   int end = imageLoad(ColPtr, ivec2(n+1,0)).r;                                 \n"
+        "   float ERROR = 0;                                                             \n"
+        "   for(int k=start; k<end; k++)                                                 \n"
+        "   {                                                                            \n"
+        "       ivec2 entry = imageLoad(CscEntry, ivec2(k,0)).rg;                        \n"
+        "       ERROR += imageLoad(NextLayerOutput, ivec2(entry.x,0)).b * imageLoad(Values, ivec2(entry.y,0)).r;\n"
+        "   }                                                                            \n"
+        "   vec4 neuron = imageLoad(NeuronsOutput, ivec2(n,0));                          \n"
+        "   neuron.b = Derivate(neuron.r) * ERROR;                                       \n"
+        "   imageStore(NeuronsOutput, ivec2(n,0), neuron);                               \n"
+        "}                                                                               \0"
+        ;
+
+    const char* SparseWeightUpdate_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(r32f, binding = 0) uniform image2D Values;                               \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D NeuronsOutput;            \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D PreviousLayer;            \n"
+        "layout(r32i, binding = 3) readonly uniform iimage2D RowPtr;                     \n"
+        "layout(r32i, binding = 4) readonly uniform iimage2D ColIndex;                   \n"
+        "layout(location = 1) uniform int Layer_size;                                    \n"
+        "layout(location = 2) uniform int NonZero_size;                                  \n"
+        "layout(location = 3) uniform float LearningRate;                                \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int n = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(n >= Layer_size)                                                          \n"
+        "       return;                                                                  \n"
+            //every invocation owns one row, so no two invocations write the same weight
+        "   float delta = LearningRate * imageLoad(NeuronsOutput, ivec2(n,0)).b;         \n"
+        "   int start = imageLoad(RowPtr, ivec2(n,0)).r;                                 \n"
+        "   int end = imageLoad(RowPtr, ivec2(n+1,0)).r;                                 \n"
+        "   for(int k=start; k<end; k++)                                                 \n"
+        "   {                                                                            \n"
+        "       float inputVal = imageLoad(PreviousLayer, ivec2(imageLoad(ColIndex, ivec2(k,0)).r, 0)).r;\n"
+        "       imageStore(Values, ivec2(k,0), imageLoad(Values, ivec2(k,0)) + delta * inputVal);\n"
+        "   }                                                                            \n"
+        "   ivec2 bias = ivec2(NonZero_size + n, 0);                                     \n"
+        "   imageStore(Values, bias, imageLoad(Values, bias) + delta);                   \n"
+        "}                                                                               \0"
+        ;
+
+    const char* SparseInputActivation_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) uniform image2D img_output;                        \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D ActiveInputs;     // value in red, input index in green\n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D LayerWeight;              \n"
+        "layout(location = 1) uniform int Layer_size;                                    \n"
+        "layout(location = 2) uniform int NonZero_size;                                  \n"
+        "layout(location = 4) uniform int PreviousLayer_size;                            \n"
+
+        "float Activate(float x);                                                        \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int n = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(n >= Layer_size)                                                          \n"
+        "       return;                                                                  \n"
+            //only weight columns of non-zero inputs are visited
+        "   int weight_start = n * (PreviousLayer_size + 1);                             \n"
+        "   float Rval = imageLoad(LayerWeight, ivec2(weight_start + PreviousLayer_size, 0)).r;\n"
+        "   for(int k=0; k<NonZero_size; k++)                                            \n"
+        "   {                                                                            \n"
+        "       vec4 nonZero = imageLoad(ActiveInputs, ivec2(k,0));                      \n"
+        "       Rval += nonZero.r * imageLoad(LayerWeight, ivec2(weight_start + int(nonZero.g), 0)).r;\n"
+        "   }                                                                            \n"
+        "   vec4 neuronData = imageLoad(img_output, ivec2(n,0));                         \n"
+        "   neuronData.r = Activate(Rval); neuronData.a = 1.0;                           \n"
+        "   imageStore(img_output, ivec2(n,0), neuronData);                              \n"
+        "}                                                                               \0"
+        ;
+
+    const char* SparseInputWeightUpdate_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) uniform image2D LayerWeight;                       \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D NeuronsOutput;            \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D ActiveInputs;             \n"
+        "layout(location = 1) uniform int Layer_size;                                    \n"
+        "layout(location = 2) uniform int NonZero_size;                                  \n"
+        "layout(location = 3) uniform float LearningRate;                                \n"
+        "layout(location = 4) uniform int PreviousLayer_size;                            \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int n = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(n >= Layer_size)                                                          \n"
+        "       return;                                                                  \n"
+            //weights of zero inputs would not change, every invocation owns one row
+        "   float delta = LearningRate * imageLoad(NeuronsOutput, ivec2(n,0)).b;         \n"
+        "   int weight_start = n * (PreviousLayer_size + 1);                             \n"
+        "   for(int k=0; k<NonZero_size; k++)                                            \n"
+        "   {                                                                            \n"
+        "       vec4 nonZero = imageLoad(ActiveInputs, ivec2(k,0));                      \n"
+        "       ivec2 w = ivec2(weight_start + int(nonZero.g), 0);                       \n"
+        "       imageStore(LayerWeight, w, imageLoad(LayerWeight, w) + vec4(delta * nonZero.r, 0, 0, 0));\n"
+        "   }                                                                            \n"
+        "   ivec2 bias = ivec2(weight_start + PreviousLayer_size, 0);                    \n"
+        "   imageStore(LayerWeight, bias, imageLoad(LayerWeight, bias) + vec4(delta, 0, 0, 0));\n"
+        "}                                                                               \0"
+        ;
+
+    const char* SparseInputScatter_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) writeonly uniform image2D InputLayer;              \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D ActiveInputs;             \n"
+        "layout(location = 1) uniform int Layer_size;                                    \n"
+        "layout(location = 2) uniform int NonZero_size;                                  \n"
+        "layout(location = 5) uniform int Mode;         // 0: clear every input   1: write non-zero inputs\n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int k = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(Mode == 0 && k < Layer_size)                                              \n"
+        "       imageStore(InputLayer, ivec2(k,0), vec4(0, 0, 0, 1));                    \n"
+        "   else if(Mode == 1 && k < NonZero_size)                                       \n"
+        "   {                                                                            \n"
+        "       vec4 nonZero = imageLoad(ActiveInputs, ivec2(k,0));                      \n"
+        "       imageStore(InputLayer, ivec2(int(nonZero.g), 0), vec4(nonZero.r, 0, 0, 1));\n"
+        "   }                                                                            \n"
+        "}                                                                               \0"
+        ;
+
+    const char* NeuronStatsShader_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) readonly uniform image2D NeuronsOutput;            \n"
+        "layout(rgba32f, binding = 1) uniform image2D Stats;                             \n"
+        "uniform int Layer_size;                                                         \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int n = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(n >= Layer_size)                                                          \n"
+        "       return;                                                                  \n"
+            //running sum, sum of squares and largest magnitude of activation
+        "   float a = imageLoad(NeuronsOutput, ivec2(n,0)).r;                            \n"
+        "   vec4 stat = imageLoad(Stats, ivec2(n,0));                                    \n"
+        "   stat.r += a;                                                                 \n"
+        "   stat.g += a*a;                                                               \n"
+        "   stat.b = max(stat.b, abs(a));                                                \n"
+        "   imageStore(Stats, ivec2(n,0), stat);                                         \n"
+        "}                                                                               \0"
+        ;
+
+    const char* OutgoingNormShader_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) readonly uniform image2D NextLayerWeights;         \n"
+        "layout(rgba32f, binding = 1) uniform image2D Stats;                             \n"
+        "uniform int Layer_size;                                                         \n"
+        "uniform int NextLayer_size;                                                     \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int n = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(n >= Layer_size)                                                          \n"
+        "       return;                                                                  \n"
+            //L2 norm of this neuron's column in next layer's weights
+        "   float sum = 0;                                                               \n"
+        "   for(int m=0; m<NextLayer_size; m++)                                          \n"
+        "   {                                                                            \n"
+        "       float w = imageLoad(NextLayerWeights, ivec2(m*(Layer_size + 1) + n, 0)).r;\n"
+        "       sum += w*w;                                                              \n"
+        "   }                                                                            \n"
+        "   vec4 stat = imageLoad(Stats, ivec2(n,0));                                    \n"
+        "   stat.a = sqrt(sum);                                                          \n"
+        "   imageStore(Stats, ivec2(n,0), stat);                                         \n"
+        "}                                                                               \0"
+        ;
+
+    const char* RecurrentActivationShader_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) uniform image2D img_output;                        \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D PreviousLayer;            \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D Weights;        // row per gate & neuron: input | hidden | bias\n"
+        "layout(rgba32f, binding = 3) uniform image2D StateHistory;            // row per step: gates, state texels per neuron\n"
+        "layout(rgba32f, binding = 4) writeonly uniform image2D InputHistory;  // row per step: input of that step\n"
+        "layout(location = 1) uniform ivec4 Shape;      // input size, hidden size, cell, ring length\n"
+        "layout(location = 2) uniform int Step;         // step being processed, counted from last ResetState()\n"
+        "int I, H, prevRow;                                                              \n"
+        "bool hasPrev;                                                                   \n"
+
+        "float sigm(float x)                                                             \n"
+        "{                                                                               \n"
+        "   return 1.0/(1.0 + exp(-x));                                                  \n"
+        "}                                                                               \n"
+        "float inputDot(int row)                                                         \n"
+        "{                                                                               \n"
+        "   float s = imageLoad(Weights, ivec2(I+H, row)).r;                             \n"
+        "   for(int i=0; i<I; i++)                                                       \n"
+        "       s += imageLoad(Weights, ivec2(i, row)).r * imageLoad(PreviousLayer, ivec2(i,0)).r;\n"
+        "   return s;                                                                    \n"
+        "}                                                                               \n"
+        "float hiddenDot(int row)                                                        \n"
+        "{                                                                               \n"
+        "   float s = 0;                                                                 \n"
+        "   if(hasPrev)                                                                  \n"
+        "       for(int j=0; j<H; j++)                                                   \n"
+        "           s += imageLoad(Weights, ivec2(I+j, row)).r * imageLoad(StateHistory, ivec2(2*j+1, prevRow)).r;\n"
+        "   return s;                                                                    \n"
+        "}                                                                               \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int n = int(gl_GlobalInvocationID.x);                                        \n"
+        "   I = Shape.x; H = Shape.y;                                                    \n"
+        "   if(n >= H)                                                                   \n"
+        "       return;                                                                  \n"
+        "   int row = Step % Shape.w;                                                    \n"
+        "   prevRow = (Step + Shape.w - 1) % Shape.w;                                    \n"
+        "   hasPrev = Step > 0;                                                          \n"
+            //keep this step's input for truncated BPTT
+        "   for(int i=n; i<I; i+=H)                                                      \n"
+        "       imageStore(InputHistory, ivec2(i, row), imageLoad(PreviousLayer, ivec2(i,0)));\n"
+        "   vec2 prevState = hasPrev ? imageLoad(StateHistory, ivec2(2*n+1, prevRow)).rg : vec2(0);\n"
+        "   vec4 gates = vec4(0);                                                        \n"
+        "   vec2 state;                                                                  \n"
+        "   if(Shape.z == 0)                                                             \n"
+        "   {                                                                            \n"
+            //Elman: h = tanh(Wx + Uh + b)
+        "       float h = tanh(inputDot(n) + hiddenDot(n));                              \n"
+        "       gates.x = h;                                                             \n"
+        "       state = vec2(h, 0);                                                      \n"
+        "   }                                                                            \n"
+        "   else if(Shape.z == 1)                                                        \n"
+        "   {                                                                            \n"
+            //GRU: update z, reset r, candidate c = tanh(Wx + r*(Uh) + b)
+        "       float z = sigm(inputDot(n) + hiddenDot(n));                              \n"
+        "       float r = sigm(inputDot(H+n) + hiddenDot(H+n));                          \n"
+        "       float u = hiddenDot(2*H+n);                                              \n"
+        "       float c = tanh(inputDot(2*H+n) + r*u);                                   \n"
+        "       gates = vec4(z, r, c, u);                                                \n"
+        "       state = vec2((1-z)*c + z*prevState.x, 0);                                \n"
+        "   }                                                                            \n"
+        "   else                                                                         \n"
+        "   {                                                                            \n"
+            //LSTM: input i, forget f, cell g, output o
+        "       gates = vec4(sigm(inputDot(n) + hiddenDot(n)), sigm(inputDot(H+n) + hiddenDot(H+n)),\n"
+        "                    tanh(inputDot(2*H+n) + hiddenDot(2*H+n)), sigm(inputDot(3*H+n) + hiddenDot(3*H+n)));\n"
+        "       float c = gates.y*prevState.y + gates.x*gates.z;                         \n"
+        "       state = vec2(gates.w*tanh(c), c);                                        \n"
+        "   }                                                                            \n"
+        "   imageStore(StateHistory, ivec2(2*n, row), gates);                            \n"
+        "   imageStore(StateHistory, ivec2(2*n+1, row), vec4(state, 0, 1));              \n"
+        "   vec4 neuronData = imageLoad(img_output, ivec2(n,0));                         \n"
+        "   neuronData.r = state.x; neuronData.a = 1.0;                                  \n"
+        "   imageStore(img_output, ivec2(n,0), neuronData);                              \n"
+        "}                                                                               \0"
+        ;
+
+    const char* RecurrentGateGrad_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) readonly uniform image2D NeuronsOutput;            \n"
+        "layout(rgba32f, binding = 1) uniform image2D Delta;                  // error of h and c carried between steps\n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D StateHistory;             \n"
+        "layout(rgba32f, binding = 3) writeonly uniform image2D GradHistory;   // row per step: pre-activation error of each gate\n"
+        "layout(rgba32f, binding = 4) readonly uniform image2D ErrorHistory;   // row per step: error of h from next recurrent layer\n"
+        "layout(location = 1) uniform ivec4 Shape;      // input size, hidden size, cell, ring length\n"
+        "layout(location = 2) uniform int Step;         // step being processed, counted from last ResetState()\n"
+        "layout(location = 5) uniform int First;        // latest step, nothing carried from a later step\n"
+        "layout(location = 6) uniform int External;     // next layer is recurrent and gave error for every step\n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int n = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(n >= Shape.y)                                                             \n"
+        "       return;                                                                  \n"
+        "   int row = Step % Shape.w;                                                    \n"
+        "   int prevRow = (Step + Shape.w - 1) % Shape.w;                                \n"
+        "   vec4 d = First != 0 ? vec4(0) : imageLoad(Delta, ivec2(n,0));                \n"
+        "   float dh = d.x, dc = d.y;                                                    \n"
+        "   if(External != 0)                                                            \n"
+        "       dh += imageLoad(ErrorHistory, ivec2(n, row)).r;                          \n"
+        "   else if(First != 0)                                                          \n"
+        "       dh += imageLoad(NeuronsOutput, ivec2(n,0)).b;                            \n"
+        "   vec4 gates = imageLoad(StateHistory, ivec2(2*n, row));                       \n"
+        "   vec2 state = imageLoad(StateHistory, ivec2(2*n+1, row)).rg;                  \n"
+        "   vec2 prevState = Step > 0 ? imageLoad(StateHistory, ivec2(2*n+1, prevRow)).rg : vec2(0);\n"
+        "   vec4 grad = vec4(0);                                                         \n"
+        "   float dhDirect = 0, dcPrev = 0;                                              \n"
+        "   if(Shape.z == 0)                                                             \n"
+        "       grad.x = dh * (1 - gates.x*gates.x);                                     \n"
+        "   else if(Shape.z == 1)                                                        \n"
+        "   {                                                                            \n"
+            //candidate error goes to its input weights (z) and, scaled by r, to its hidden weights (w)
+        "       float dcand = dh * (1 - gates.x) * (1 - gates.z*gates.z);                \n"
+        "       grad.x = dh * (prevState.x - gates.z) * gates.x * (1 - gates.x);         \n"
+        "       grad.y = dcand * gates.w * gates.y * (1 - gates.y);                      \n"
+        "       grad.z = dcand;                                                          \n"
+        "       grad.w = dcand * gates.y;                                                \n"
+        "       dhDirect = dh * gates.x;                                                 \n"
+        "   }                                                                            \n"
+        "   else                                                                         \n"
+        "   {                                                                            \n"
+        "       float tc = tanh(state.y);                                                \n"
+        "       dc += dh * gates.w * (1 - tc*tc);                                        \n"
+        "       grad = vec4(dc * gates.z * gates.x * (1 - gates.x), dc * prevState.y * gates.y * (1 - gates.y),\n"
+        "                   dc * gates.x * (1 - gates.z*gates.z), dh * tc * gates.w * (1 - gates.w));\n"
+        "       dcPrev = dc * gates.y;                                                   \n"
+        "   }                                                                            \n"
+        "   imageStore(GradHistory, ivec2(n, row), grad);                                \n"
+        "   imageStore(Delta, ivec2(n,0), vec4(0, 0, dhDirect, dcPrev));                 \n"
+        "}                                                                               \0"
+        ;
+
+    const char* RecurrentHiddenGrad_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) uniform image2D Delta;                             \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D GradHistory;              \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D Weights;                  \n"
+        "layout(location = 1) uniform ivec4 Shape;      // input size, hidden size, cell, ring length\n"
+        "layout(location = 2) uniform int Step;         // step being processed, counted from last ResetState()\n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int j = int(gl_GlobalInvocationID.x);                                        \n"
+        "   int I = Shape.x, H = Shape.y;                                                \n"
+        "   if(j >= H)                                                                   \n"
+        "       return;                                                                  \n"
+            //error of previous step's h: direct path plus every gate through its hidden weights
+        "   int row = Step % Shape.w;                                                    \n"
+        "   int gateCount = Shape.z == 0 ? 1 : (Shape.z == 1 ? 3 : 4);                   \n"
+        "   vec4 d = imageLoad(Delta, ivec2(j,0));                                       \n"
+        "   float dh = d.z;                                                              \n"
+        "   for(int n=0; n<H; n++)                                                       \n"
+        "   {                                                                            \n"
+        "       vec4 grad = imageLoad(GradHistory, ivec2(n, row));                       \n"
+        "       if(Shape.z == 1)                                                         \n"
+        "           grad.z = grad.w;                                                     \n"
+        "       for(int g=0; g<gateCount; g++)                                           \n"
+        "           dh += grad[g] * imageLoad(Weights, ivec2(I+j, g*H+n)).r;             \n"
+        "   }                                                                            \n"
+        "   imageStore(Delta, ivec2(j,0), vec4(dh, d.w, 0, 0));                          \n"
+        "}                                                                               \0"
+        ;
+
+    const char* RecurrentWeightUpdate_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;                \n"
+        "layout(rgba32f, binding = 0) uniform image2D Weights;                           \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D GradHistory;              \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D InputHistory;             \n"
+        "layout(rgba32f, binding = 3) readonly uniform image2D StateHistory;             \n"
+        "layout(location = 1) uniform ivec4 Shape;      // input size, hidden size, cell, ring length\n"
+        "layout(location = 2) uniform int Step;         // step being processed, counted from last ResetState()\n"
+        "layout(location = 3) uniform int Steps;        // no. of unrolled steps ending at Step\n"
+        "layout(location = 4) uniform float LearningRate;                                \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   ivec2 pos = ivec2(gl_GlobalInvocationID.xy);                                 \n"
+        "   int I = Shape.x, H = Shape.y;                                                \n"
+        "   int gateCount = Shape.z == 0 ? 1 : (Shape.z == 1 ? 3 : 4);                   \n"
+        "   if(pos.x > I+H || pos.y >= gateCount*H)                                      \n"
+        "       return;                                                                  \n"
+        "   int g = pos.y / H, n = pos.y % H;                                            \n"
+            //hidden weights of GRU candidate see error scaled by reset gate
+        "   int comp = (Shape.z == 1 && g == 2 && pos.x >= I && pos.x < I+H) ? 3 : g;    \n"
+        "   float sum = 0;                                                               \n"
+        "   for(int s=0; s<Steps; s++)                                                   \n"
+        "   {                                                                            \n"
+        "       int k = Step - s;                                                        \n"
+        "       float inputVal = 1.0;                                                    \n"
+        "       if(pos.x < I)                                                            \n"
+        "           inputVal = imageLoad(InputHistory, ivec2(pos.x, k % Shape.w)).r;     \n"
+        "       else if(pos.x < I+H)                                                     \n"
+        "           inputVal = k > 0 ? imageLoad(StateHistory, ivec2(2*(pos.x-I)+1, (k + Shape.w - 1) % Shape.w)).r : 0.0;\n"
+        "       sum += imageLoad(GradHistory, ivec2(n, k % Shape.w))[comp] * inputVal;   \n"
+        "   }                                                                            \n"
+        "   vec4 weight = imageLoad(Weights, pos);                                       \n"
+        "   weight.r += LearningRate * sum;                                              \n"
+        "   imageStore(Weights, pos, weight);                                            \n"
+        "}                                                                               \0"
+        ;
+
+    const char* RecurrentBackPropogate_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) uniform image2D NeuronsOutput;                     \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D GradHistory;              \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D Weights;                  \n"
+        "layout(rgba32f, binding = 3) writeonly uniform image2D ErrorHistory;            \n"
+        "layout(location = 1) uniform ivec4 Shape;      // input size, hidden size, cell, ring length\n"
+        "layout(location = 2) uniform int Step;         // step being processed, counted from last ResetState()\n"
+        "layout(location = 3) uniform int Steps;        // no. of unrolled steps ending at Step\n"
+        "layout(location = 6) uniform ivec2 History;    // ring length and unrolled steps of previous layer if it is recurrent\n"
+
+        "float Derivate(float x);                                                        \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int i = int(gl_GlobalInvocationID.x);                                        \n"
+        "   int s = int(gl_GlobalInvocationID.y);                                        \n"
+        "   int H = Shape.y;                                                             \n"
+        "   if(i >= Shape.x)                                                             \n"
+        "       return;                                                                  \n"
+            //error of input at every unrolled step; a feed-forward previous layer only keeps the latest one
+        "   int k = Step - s;                                                            \n"
+        "   int gateCount = Shape.z == 0 ? 1 : (Shape.z == 1 ? 3 : 4);                   \n"
+        "   float ERROR = 0;                                                             \n"
+        "   for(int n=0; n<H && s<Steps; n++)                                            \n"
+        "   {                                                                            \n"
+        "       vec4 grad = imageLoad(GradHistory, ivec2(n, k % Shape.w));               \n"
+        "       for(int g=0; g<gateCount; g++)                                           \n"
+        "           ERROR += grad[g] * imageLoad(Weights, ivec2(i, g*H+n)).r;            \n"
+        "   }                                                                            \n"
+        "   if(History.x > 0)                                                            \n"
+        "       imageStore(ErrorHistory, ivec2(i, k % History.x), vec4(ERROR, 0, 0, 1)); \n"
+        "   if(s > 0)                                                                    \n"
+        "       return;                                                                  \n"
+        "   vec4 neuron = imageLoad(NeuronsOutput, ivec2(i,0));                          \n"
+        "   neuron.b = Derivate(neuron.r) * ERROR;                                       \n"
+        "   imageStore(NeuronsOutput, ivec2(i,0), neuron);                               \n"
+        "}                                                                               \0"
+        ;
+
+    const char* AttentionProjection_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) uniform image2D img_output;                        \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D PreviousLayer;            \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D Weights;    // rows: Wq, Wk, Wv, Wo; last column is bias\n"
+        "layout(rgba32f, binding = 3) writeonly uniform image2D QKV;       // row per token: q | k | v\n"
+        "layout(rgba32f, binding = 4) readonly uniform image2D AttnOut;    // row per token: concatenated heads\n"
+        "layout(location = 1) uniform ivec3 Attn_shape; // tokens, model size, heads     \n"
+        "layout(location = 2) uniform int Mode;         // 0: input to q,k,v   1: heads to layer output\n"
+        "shared float Row[64];                                                           \n"
+
+        "float Activate(float x);                                                        \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int j = int(gl_GlobalInvocationID.x);                                        \n"
+        "   int t = int(gl_GlobalInvocationID.y);                                        \n"
+        "   int lid = int(gl_LocalInvocationIndex);                                      \n"
+        "   int D = Attn_shape.y;                                                        \n"
+        "   int rows = Mode == 0 ? 3*D : D;                                              \n"
+        "   int wRow = Mode == 0 ? j : 3*D + j;                                          \n"
+        "   float sum = 0;                                                               \n"
+            //the whole group works on one token, its input row is staged 64 values at a time
+        "   for(int c=0; c<D; c+=64)                                                     \n"
+        "   {                                                                            \n"
+        "       int i = c + lid;                                                         \n"
+        "       Row[lid] = i >= D ? 0.0 : (Mode == 0 ? imageLoad(PreviousLayer, ivec2(t*D + i, 0)).r : imageLoad(AttnOut, ivec2(i, t)).r);\n"
+        "       barrier();                                                               \n"
+        "       if(j < rows)                                                             \n"
+        "           for(int k=0; k<64 && c+k<D; k++)                                     \n"
+        "               sum += imageLoad(Weights, ivec2(c+k, wRow)).r * Row[k];          \n"
+        "       barrier();                                                               \n"
+        "   }                                                                            \n"
+        "   if(j >= rows)                                                                \n"
+        "       return;                                                                  \n"
+        "   sum += imageLoad(Weights, ivec2(D, wRow)).r;                                 \n"
+        "   if(Mode == 0)                                                                \n"
+        "       imageStore(QKV, ivec2(j, t), vec4(sum, 0, 0, 1));                        \n"
+        "   else                                                                         \n"
+        "   {                                                                            \n"
+        "       vec4 neuronData = imageLoad(img_output, ivec2(t*D + j, 0));              \n"
+        "       neuronData.r = Activate(sum); neuronData.a = 1.0;                        \n"
+        "       imageStore(img_output, ivec2(t*D + j, 0), neuronData);                   \n"
+        "   }                                                                            \n"
+        "}                                                                               \0"
+        ;
+
+    const char* AttentionShader_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) readonly uniform image2D QKV;                      \n"
+        "layout(rgba32f, binding = 1) writeonly uniform image2D AttnOut;                 \n"
+        "layout(rgba32f, binding = 2) writeonly uniform image2D AttnStat;  // log of softmax denominator per head & query\n"
+        "layout(location = 1) uniform ivec3 Attn_shape; // tokens, model size, heads     \n"
+        "shared float Ktile[32*64];                                                      \n"
+        "shared float Vtile[32*64];                                                      \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int t = int(gl_GlobalInvocationID.x);                                        \n"
+        "   int h = int(gl_WorkGroupID.y);                                               \n"
+        "   int lid = int(gl_LocalInvocationIndex);                                      \n"
+        "   int L = Attn_shape.x, D = Attn_shape.y;                                      \n"
+        "   int dh = D / Attn_shape.z;                                                   \n"
+        "   float scale = inversesqrt(float(dh));                                        \n"
+        "   float q[64], acc[64];                                                        \n"
+        "   for(int d=0; d<dh; d++)                                                      \n"
+        "   {                                                                            \n"
+        "       q[d] = t < L ? imageLoad(QKV, ivec2(h*dh + d, t)).r * scale : 0.0;       \n"
+        "       acc[d] = 0;                                                              \n"
+        "   }                                                                            \n"
+            //online softmax over 32 key tiles: scores never leave the work group
+        "   float m = -3.402823e38, l = 0;                                               \n"
+        "   for(int ts=0; ts<L; ts+=32)                                                  \n"
+        "   {                                                                            \n"
+        "       for(int idx=lid; idx<32*dh; idx+=32)                                     \n"
+        "       {                                                                        \n"
+        "           int s = ts + idx / dh, d = idx % dh;                                 \n"
+        "           Ktile[idx] = s < L ? imageLoad(QKV, ivec2(D + h*dh + d, s)).r : 0.0; \n"
+        "           Vtile[idx] = s < L ? imageLoad(QKV, ivec2(2*D + h*dh + d, s)).r : 0.0;\n"
+        "       }                                                                        \n"
+        "       barrier();                                                               \n"
+        "       for(int j=0; j<min(32, L-ts) && t<L; j++)                                \n"
+        "       {                                                                        \n"
+        "           float score = 0;                                                     \n"
+        "           for(int d=0; d<dh; d++)                                              \n"
+        "               score += q[d] * Ktile[j*dh + d];                                 \n"
+        "           float mNew = max(m, score);                                          \n"
+        "           float corr = exp(m - mNew), p = exp(score - mNew);                   \n"
+        "           l = l*corr + p;                                                      \n"
+        "           for(int d=0; d<dh; d++)                                              \n"
+        "               acc[d] = acc[d]*corr + p*Vtile[j*dh + d];                        \n"
+        "           m = mNew;                                                            \n"
+        "       }                                                                        \n"
+        "       barrier();                                                               \n"
+        "   }                                                                            \n"
+        "   if(t >= L)                                                                   \n"
+        "       return;                                                                  \n"
+        "   for(int d=0; d<dh; d++)                                                      \n"
+        "       imageStore(AttnOut, ivec2(h*dh + d, t), vec4(acc[d] / l, 0, 0, 1));      \n"
+        "   imageStore(AttnStat, ivec2(h, t), vec4(m + log(l), 0, 0, 1));                \n"
+        "}                                                                               \0"
+        ;
+
+    const char* AttentionBackProject_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) uniform image2D NeuronsOutput;          // 0: this layer   1: previous layer\n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D Weights;                  \n"
+        "layout(rgba32f, binding = 2) writeonly uniform image2D AttnGrad;                \n"
+        "layout(rgba32f, binding = 3) readonly uniform image2D QKVGrad;                  \n"
+        "layout(location = 1) uniform ivec3 Attn_shape; // tokens, model size, heads     \n"
+        "layout(location = 2) uniform int Mode;         // 0: layer error to heads   1: q,k,v error to previous layer\n"
+        "shared float Grad[64];                                                          \n"
+
+        "float Derivate(float x);                                                        \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int i = int(gl_GlobalInvocationID.x);                                        \n"
+        "   int t = int(gl_GlobalInvocationID.y);                                        \n"
+        "   int lid = int(gl_LocalInvocationIndex);                                      \n"
+        "   int D = Attn_shape.y;                                                        \n"
+        "   int rows = Mode == 0 ? D : 3*D;                                              \n"
+        "   int rowOffset = Mode == 0 ? 3*D : 0;                                         \n"
+        "   float sum = 0;                                                               \n"
+        "   for(int c=0; c<rows; c+=64)                                                  \n"
+        "   {                                                                            \n"
+        "       int j = c + lid;                                                         \n"
+        "       Grad[lid] = j >= rows ? 0.0 : (Mode == 0 ? imageLoad(NeuronsOutput, ivec2(t*D + j, 0)).b : imageLoad(QKVGrad, ivec2(j, t)).r);\n"
+        "       barrier();                                                               \n"
+        "       if(i < D)                                                                \n"
+        "           for(int k=0; k<64 && c+k<rows; k++)                                  \n"
+        "               sum += imageLoad(Weights, ivec2(i, rowOffset + c + k)).r * Grad[k];\n"
+        "       barrier();                                                               \n"
+        "   }                                                                            \n"
+        "   if(i >= D)                                                                   \n"
+        "       return;                                                                  \n"
+        "   if(Mode == 0)                                                                \n"
+        "       imageStore(AttnGrad, ivec2(i, t), vec4(sum, 0, 0, 1));                   \n"
+        "   else                                                                         \n"
+        "   {                                                                            \n"
+        "       vec4 neuron = imageLoad(NeuronsOutput, ivec2(t*D + i, 0));               \n"
+        "       neuron.b = Derivate(neuron.r) * sum;                                     \n"
+        "       imageStore(NeuronsOutput, ivec2(t*D + i, 0), neuron);                    \n"
+        "   }                                                                            \n"
+        "}                                                                               \0"
+        ;
+
+    const char* AttentionBackQuery_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) readonly uniform image2D QKV;                      \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D AttnOut;                  \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D AttnGrad;                 \n"
+        "layout(rgba32f, binding = 3) readonly uniform image2D AttnStat;                 \n"
+        "layout(rgba32f, binding = 4) writeonly uniform image2D QKVGrad;                 \n"
+        "layout(location = 1) uniform ivec3 Attn_shape; // tokens, model size, heads     \n"
+        "shared float Ktile[32*64];                                                      \n"
+        "shared float Vtile[32*64];                                                      \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int t = int(gl_GlobalInvocationID.x);                                        \n"
+        "   int h = int(gl_WorkGroupID.y);                                               \n"
+        "   int lid = int(gl_LocalInvocationIndex);                                      \n"
+        "   int L = Attn_shape.x, D = Attn_shape.y;                                      \n"
+        "   int dh = D / Attn_shape.z;                                                   \n"
+        "   float scale = inversesqrt(float(dh));                                        \n"
+        "   float q[64], dO[64], dq[64];                                                 \n"
+        "   float rowDot = 0;                                                            \n"
+        "   for(int d=0; d<dh && t<L; d++)                                               \n"
+        "   {                                                                            \n"
+        "       q[d] = imageLoad(QKV, ivec2(h*dh + d, t)).r * scale;                     \n"
+        "       dO[d] = imageLoad(AttnGrad, ivec2(h*dh + d, t)).r;                       \n"
+        "       rowDot += dO[d] * imageLoad(AttnOut, ivec2(h*dh + d, t)).r;              \n"
+        "       dq[d] = 0;                                                               \n"
+        "   }                                                                            \n"
+        "   float lse = t < L ? imageLoad(AttnStat, ivec2(h, t)).r : 0.0;                \n"
+            //probabilities are rebuilt from saved log denominator instead of being stored
+        "   for(int ts=0; ts<L; ts+=32)                                                  \n"
+        "   {                                                                            \n"
+        "       for(int idx=lid; idx<32*dh; idx+=32)                                     \n"
+        "       {                                                                        \n"
+        "           int s = ts + idx / dh, d = idx % dh;                                 \n"
+        "           Ktile[idx] = s < L ? imageLoad(QKV, ivec2(D + h*dh + d, s)).r : 0.0; \n"
+        "           Vtile[idx] = s < L ? imageLoad(QKV, ivec2(2*D + h*dh + d, s)).r : 0.0;\n"
+        "       }                                                                        \n"
+        "       barrier();                                                               \n"
+        "       for(int j=0; j<min(32, L-ts) && t<L; j++)                                \n"
+        "       {                                                                        \n"
+        "           float score = 0, dp = 0;                                             \n"
+        "           for(int d=0; d<dh; d++)                                              \n"
+        "           {                                                                    \n"
+        "               score += q[d] * Ktile[j*dh + d];                                 \n"
+        "               dp += dO[d] * Vtile[j*dh + d];                                   \n"
+        "           }                                                                    \n"
+        "           float ds = exp(score - lse) * (dp - rowDot);                         \n"
+        "           for(int d=0; d<dh; d++)                                              \n"
+        "               dq[d] += ds * Ktile[j*dh + d];                                   \n"
+        "       }                                                                        \n"
+        "       barrier();                                                               \n"
+        "   }                                                                            \n"
+        "   if(t >= L)                                                                   \n"
+        "       return;                                                                  \n"
+        "   for(int d=0; d<dh; d++)                                                      \n"
+        "       imageStore(QKVGrad, ivec2(h*dh + d, t), vec4(dq[d] * scale, 0, 0, 1));   \n"
+        "}                                                                               \0"
+        ;
+
+    const char* AttentionBackKeyValue_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) readonly uniform image2D QKV;                      \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D AttnOut;                  \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D AttnGrad;                 \n"
+        "layout(rgba32f, binding = 3) readonly uniform image2D AttnStat;                 \n"
+        "layout(rgba32f, binding = 4) writeonly uniform image2D QKVGrad;                 \n"
+        "layout(location = 1) uniform ivec3 Attn_shape; // tokens, model size, heads     \n"
+        "shared float Qtile[32*64];                                                      \n"
+        "shared float dOtile[32*64];                                                     \n"
+        "shared float LseTile[32];                                                       \n"
+        "shared float RowDotTile[32];                                                    \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int s = int(gl_GlobalInvocationID.x);                                        \n"
+        "   int h = int(gl_WorkGroupID.y);                                               \n"
+        "   int lid = int(gl_LocalInvocationIndex);                                      \n"
+        "   int L = Attn_shape.x, D = Attn_shape.y;                                      \n"
+        "   int dh = D / Attn_shape.z;                                                   \n"
+        "   float scale = inversesqrt(float(dh));                                        \n"
+        "   float k[64], v[64], dk[64], dv[64];                                          \n"
+        "   for(int d=0; d<dh && s<L; d++)                                               \n"
+        "   {                                                                            \n"
+        "       k[d] = imageLoad(QKV, ivec2(D + h*dh + d, s)).r;                         \n"
+        "       v[d] = imageLoad(QKV, ivec2(2*D + h*dh + d, s)).r;                       \n"
+        "       dk[d] = 0; dv[d] = 0;                                                    \n"
+        "   }                                                                            \n"
+            //every key walks all query tiles, each thread also prepares softmax terms of one query
+        "   for(int ts=0; ts<L; ts+=32)                                                  \n"
+        "   {                                                                            \n"
+        "       for(int idx=lid; idx<32*dh; idx+=32)                                     \n"
+        "       {                                                                        \n"
+        "           int t = ts + idx / dh, d = idx % dh;                                 \n"
+        "           Qtile[idx] = t < L ? imageLoad(QKV, ivec2(h*dh + d, t)).r * scale : 0.0;\n"
+        "           dOtile[idx] = t < L ? imageLoad(AttnGrad, ivec2(h*dh + d, t)).r : 0.0;\n"
+        "       }                                                                        \n"
+        "       barrier();                                                               \n"
+        "       float rowDot = 0;                                                        \n"
+        "       for(int d=0; d<dh && ts+lid<L; d++)                                      \n"
+        "           rowDot += dOtile[lid*dh + d] * imageLoad(AttnOut, ivec2(h*dh + d, ts + lid)).r;\n"
+        "       RowDotTile[lid] = rowDot;                                                \n"
+        "       LseTile[lid] = ts+lid < L ? imageLoad(AttnStat, ivec2(h, ts + lid)).r : 0.0;\n"
+        "       barrier();                                                               \n"
+        "       for(int j=0; j<min(32, L-ts) && s<L; j++)                                \n"
+        "       {                                                                        \n"
+        "           float score = 0, dp = 0;                                             \n"
+        "           for(int d=0; d<dh; d++)                                              \n"
+        "           {                                                                    \n"
+        "               score += Qtile[j*dh + d] * k[d];                                 \n"
+        "               dp += dOtile[j*dh + d] * v[d];                                   \n"
+        "           }                                                                    \n"
+        "           float p = exp(score - LseTile[j]);                                   \n"
+        "           float ds = p * (dp - RowDotTile[j]);                                 \n"
+        "           for(int d=0; d<dh; d++)                                              \n"
+        "           {                                                                    \n"
+        "               dv[d] += p * dOtile[j*dh + d];                                   \n"
+        "               dk[d] += ds * Qtile[j*dh + d];                                   \n"
+        "           }                                                                    \n"
+        "       }                                                                        \n"
+        "       barrier();                                                               \n"
+        "   }                                                                            \n"
+        "   if(s >= L)                                                                   \n"
+        "       return;                                                                  \n"
+        "   for(int d=0; d<dh; d++)                                                      \n"
+        "   {                                                                            \n"
+        "       imageStore(QKVGrad, ivec2(D + h*dh + d, s), vec4(dk[d], 0, 0, 1));       \n"
+        "       imageStore(QKVGrad, ivec2(2*D + h*dh + d, s), vec4(dv[d], 0, 0, 1));     \n"
+        "   }                                                                            \n"
+        "}                                                                               \0"
+        ;
+
+    const char* AttentionWeightUpdate_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;                \n"
+        "layout(rgba32f, binding = 0) uniform image2D Weights;                           \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D PreviousLayer;            \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D NeuronsOutput;            \n"
+        "layout(rgba32f, binding = 3) readonly uniform image2D AttnOut;                  \n"
+        "layout(rgba32f, binding = 4) readonly uniform image2D QKVGrad;                  \n"
+        "layout(location = 1) uniform ivec3 Attn_shape; // tokens, model size, heads     \n"
+        "layout(location = 3) uniform float LearningRate;                                \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   ivec2 pos = ivec2(gl_GlobalInvocationID.xy);                                 \n"
+        "   int L = Attn_shape.x, D = Attn_shape.y;                                      \n"
+        "   if(pos.x > D || pos.y >= 4*D)                                                \n"
+        "       return;                                                                  \n"
+            //q,k,v rows learn from input, output rows learn from concatenated heads
+        "   float sum = 0;                                                               \n"
+        "   for(int t=0; t<L; t++)                                                       \n"
+        "   {                                                                            \n"
+        "       if(pos.y < 3*D)                                                          \n"
+        "           sum += imageLoad(QKVGrad, ivec2(pos.y, t)).r * (pos.x < D ? imageLoad(PreviousLayer, ivec2(t*D + pos.x, 0)).r : 1.0);\n"
+        "       else                                                                     \n"
+        "           sum += imageLoad(NeuronsOutput, ivec2(t*D + pos.y - 3*D, 0)).b * (pos.x < D ? imageLoad(AttnOut, ivec2(pos.x, t)).r : 1.0);\n"
+        "   }                                                                            \n"
+        "   vec4 weight = imageLoad(Weights, pos);                                       \n"
+        "   weight.r += LearningRate * sum;                                              \n"
+        "   imageStore(Weights, pos, weight);                                            \n"
+        "}                                                                               \0"
+        ;
+
+    //Dense kernels built in several variants for autotuner. WORK_GROUP and COOPERATIVE are
+    //defined by buildKernel(), a COOPERATIVE variant sums each neuron with a whole work group
+    const char* DenseActivation_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = WORK_GROUP, local_size_y = 1, local_size_z = 1) in;       \n"
+        "layout(rgba32f, binding = 0) uniform image2D img_output;                        \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D PreviousLayer;            \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D LayerWeight;              \n"
+            //sizes are constants in kernels specialized for one shape, loops over them unroll
+        "#ifdef PREV_SIZE                                                                \n"
+        "const int PreviousLayer_size = PREV_SIZE;                                       \n"
+        "const int Layer_size = LAYER_SIZE;                                              \n"
+        "#else                                                                           \n"
+        "layout(location = 1) uniform int PreviousLayer_size;                            \n"
+        "layout(location = 2) uniform int Layer_size;                                    \n"
+        "#endif                                                                          \n"
+        "#if COOPERATIVE                                                                 \n"
+        "shared float partial[WORK_GROUP];                                               \n"
+        "#endif                                                                          \n"
+        "#define INPUT(i) imageLoad(PreviousLayer, ivec2(i,0)).r                         \n"
+        "#define WEIGHT(w) imageLoad(LayerWeight, ivec2(w,0)).r                          \n"
+
+        "float Activate(float x);                                                        \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "#if COOPERATIVE                                                                 \n"
+            //whole work group sums one neuron, each invocation takes every WORK_GROUP-th input
+        "   int n = int(gl_WorkGroupID.x);                                               \n"
+        "   int t = int(gl_LocalInvocationID.x);                                         \n"
+        "   int weight_start = n * (PreviousLayer_size + 1);                             \n"
+        "   float sum = 0.0;                                                             \n"
+        "   for(int i = t; i < PreviousLayer_size; i += WORK_GROUP)                      \n"
+        "       sum += INPUT(i) * WEIGHT(weight_start + i);                              \n"
+        "   partial[t] = sum;                                                            \n"
+        "   memoryBarrierShared();                                                       \n"
+        "   barrier();                                                                   \n"
+        "   for(int stride = WORK_GROUP / 2; stride > 0; stride /= 2)                    \n"
+        "   {                                                                            \n"
+        "       if(t < stride)                                                           \n"
+        "           partial[t] += partial[t + stride];                                   \n"
+        "       memoryBarrierShared();                                                   \n"
+        "       barrier();                                                               \n"
+        "   }                                                                            \n"
+        "   if(t != 0)                                                                   \n"
+        "       return;                                                                  \n"
+        "   float Rval = partial[0];                                                     \n"
+        "#else                                                                           \n"
+            //one invocation per neuron, four inputs at a time as vec4 dot products
+        "   int n = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(n >= Layer_size)                                                          \n"
+        "       return;                                                                  \n"
+        "   int weight_start = n * (PreviousLayer_size + 1);                             \n"
+        "   float Rval = 0.0;                                                            \n"
+        "   int i = 0;                                                                   \n"
+        "   for(; i + 4 <= PreviousLayer_size; i += 4)                                   \n"
+        "       Rval += dot(vec4(INPUT(i), INPUT(i + 1), INPUT(i + 2), INPUT(i + 3)),    \n"
+        "                   vec4(WEIGHT(weight_start + i), WEIGHT(weight_start + i + 1), WEIGHT(weight_start + i + 2), WEIGHT(weight_start + i + 3)));\n"
+        "   for(; i < PreviousLayer_size; i++)                                           \n"
+        "       Rval += INPUT(i) * WEIGHT(weight_start + i);                             \n"
+        "#endif                                                                          \n"
+        "   Rval += WEIGHT(weight_start + PreviousLayer_size);                           \n"
+        "   vec4 neuronData = imageLoad(img_output, ivec2(n,0));                         \n"
+        "   neuronData.r = Activate(Rval); neuronData.a = 1.0;                           \n"
+        "   imageStore(img_output, ivec2(n,0), neuronData);                              \n"
+        "}                                                                               \0"
+        ;
+
+    const char* DenseBackPropogate_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = WORK_GROUP, local_size_y = 1, local_size_z = 1) in;       \n"
+        "layout(rgba32f, binding = 0) uniform image2D NeuronsOutput;                     \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D NextLayerOutput;          \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D WeightsToNextLayer;       \n"
+            //specialized for shape of weights to next layer: PREV_SIZE is this layer, LAYER_SIZE next one
+        "#ifdef PREV_SIZE                                                                \n"
+        "const int Layer_size = PREV_SIZE;                                               \n"
+        "const int NextLayer_size = LAYER_SIZE;                                          \n"
+        "#else                                                                           \n"
+        "layout(location = 2) uniform int Layer_size;                                    \n"
+        "layout(location = 4) uniform int NextLayer_size;                                \n"
+        "#endif                                                                          \n"
+        "#if COOPERATIVE                                                                 \n"
+        "shared float partial[WORK_GROUP];                                               \n"
+        "#endif                                                                          \n"
+        "#define NEXT_ERROR(j) imageLoad(NextLayerOutput, ivec2(j,0)).b                  \n"
+        "#define WEIGHT(j) imageLoad(WeightsToNextLayer, ivec2((j) * (Layer_size + 1) + n, 0)).r\n"
+
+        "float Derivate(float x);                                                        \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "#if COOPERATIVE                                                                 \n"
+            //whole work group sums error of one neuron over every WORK_GROUP-th neuron of next layer
+        "   int n = int(gl_WorkGroupID.x);                                               \n"
+        "   int t = int(gl_LocalInvocationID.x);                                         \n"
+        "   float sum = 0.0;                                                             \n"
+        "   for(int j = t; j < NextLayer_size; j += WORK_GROUP)                          \n"
+        "       sum += NEXT_ERROR(j) * WEIGHT(j);                                        \n"
+        "   partial[t] = sum;                                                            \n"
+        "   memoryBarrierShared();                                                       \n"
+        "   barrier();                                                                   \n"
+        "   for(int stride = WORK_GROUP / 2; stride > 0; stride /= 2)                    \n"
+        "   {                                                                            \n"
+        "       if(t < stride)                                                           \n"
+        "           partial[t] += partial[t + stride];                                   \n"
+        "       memoryBarrierShared();                                                   \n"
+        "       barrier();                                                               \n"
+        "   }                                                                            \n"
+        "   if(t != 0)                                                                   \n"
+        "       return;                                                                  \n"
+        "   float ERROR = partial[0];                                                    \n"
+        "#else                                                                           \n"
+        "   int n = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(n >= Layer_size)                                                          \n"
+        "       return;                                                                  \n"
+        "   float ERROR = 0.0;                                                           \n"
+        "   int j = 0;                                                                   \n"
+        "   for(; j + 4 <= NextLayer_size; j += 4)                                       \n"
+        "       ERROR += dot(vec4(NEXT_ERROR(j), NEXT_ERROR(j + 1), NEXT_ERROR(j + 2), NEXT_ERROR(j + 3)),\n"
+        "                    vec4(WEIGHT(j), WEIGHT(j + 1), WEIGHT(j + 2), WEIGHT(j + 3)));\n"
+        "   for(; j < NextLayer_size; j++)                                               \n"
+        "       ERROR += NEXT_ERROR(j) * WEIGHT(j);                                      \n"
+        "#endif                                                                          \n"
+        "   vec4 neuron = imageLoad(NeuronsOutput, ivec2(n,0));                          \n"
+        "   neuron.b = ERROR * Derivate(neuron.r);                                       \n"
+        "   imageStore(NeuronsOutput, ivec2(n,0), neuron);                               \n"
+        "}                                                                               \0"
+        ;
+
+    const char* DenseWeightUpdate_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = WORK_GROUP, local_size_y = 1, local_size_z = 1) in;       \n"
+        "layout(rgba32f, binding = 0) uniform image2D Weights;                           \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D NeuronsOutput;            \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D PreviousLayer;            \n"
+        "#ifdef PREV_SIZE                                                                \n"
+        "const int PreviousLayer_size = PREV_SIZE;                                       \n"
+        "const int Layer_size = LAYER_SIZE;                                              \n"
+        "#else                                                                           \n"
+        "layout(location = 1) uniform int PreviousLayer_size;                            \n"
+        "layout(location = 2) uniform int Layer_size;                                    \n"
+        "#endif                                                                          \n"
+        "layout(location = 3) uniform float LearningRate;                                \n"
+
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+            //one invocation per weight, bias is last weight of each row and has input 1
+        "   int w = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(w >= (PreviousLayer_size + 1) * Layer_size)                               \n"
+        "       return;                                                                  \n"
+        "   int n = w / (PreviousLayer_size + 1);                                        \n"
+        "   int i = w - n * (PreviousLayer_size + 1);                                    \n"
+        "   float inputVal = i < PreviousLayer_size ? imageLoad(PreviousLayer, ivec2(i,0)).r : 1.0;\n"
+        "   vec4 weight = imageLoad(Weights, ivec2(w,0));                                \n"
+        "   weight.r += imageLoad(NeuronsOutput, ivec2(n,0)).b * inputVal * LearningRate;\n"
+        "   imageStore(Weights, ivec2(w,0), weight);                                     \n"
+        "}                                                                               \0"
+        ;
+    const char* BatchActivation_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) writeonly uniform image2D Batch;                   \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D PreviousBatch;            \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D LayerWeight;              \n"
+        "layout(location = 1) uniform int PreviousLayer_size;                            \n"
+        "layout(location = 3) uniform int Rows;                                          \n"
+        "float Activate(float x);                                                        \n"
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+            //invocation per (sample, neuron), x runs over samples so small layers still fill work groups
+        "   int s = int(gl_GlobalInvocationID.x);                                        \n"
+        "   int n = int(gl_GlobalInvocationID.y);                                        \n"
+        "   if(s >= Rows)                                                                \n"
+        "       return;                                                                  \n"
+        "   int weight_start = n * (PreviousLayer_size + 1);                             \n"
+        "   float Rval = imageLoad(LayerWeight, ivec2(weight_start + PreviousLayer_size, 0)).r;\n"
+        "   for(int i = 0; i < PreviousLayer_size; i++)                                  \n"
+        "       Rval += imageLoad(PreviousBatch, ivec2(i, s)).r * imageLoad(LayerWeight, ivec2(weight_start + i, 0)).r;\n"
+        "   imageStore(Batch, ivec2(n, s), vec4(Activate(Rval), 0.0, 0.0, 1.0));         \n"
+        "}                                                                               \0"
+        ;
+
+    const char* BatchError_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) uniform image2D Batch;                             \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D Targets;                  \n"
+        "layout(location = 3) uniform int Rows;                                          \n"
+        "float Derivate(float x);                                                        \n"
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int s = int(gl_GlobalInvocationID.x);                                        \n"
+        "   int n = int(gl_GlobalInvocationID.y);                                        \n"
+        "   if(s >= Rows)                                                                \n"
+        "       return;                                                                  \n"
+            //target in red, weight of sample in green
+        "   vec4 neuronData = imageLoad(Batch, ivec2(n, s));                             \n"
+        "   vec4 target = imageLoad(Targets, ivec2(n, s));                               \n"
+        "   neuronData.b = target.g * (target.r - neuronData.r) * Derivate(neuronData.r);\n"
+        "   imageStore(Batch, ivec2(n, s), neuronData);                                  \n"
+        "}                                                                               \0"
+        ;
+
+    const char* BatchBackPropogate_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) uniform image2D Batch;                             \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D NextBatch;                \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D NextWeight;               \n"
+        "layout(location = 2) uniform int Layer_size;                                    \n"
+        "layout(location = 3) uniform int Rows;                                          \n"
+        "layout(location = 5) uniform int NextLayer_size;                                \n"
+        "float Derivate(float x);                                                        \n"
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int s = int(gl_GlobalInvocationID.x);                                        \n"
+        "   int n = int(gl_GlobalInvocationID.y);                                        \n"
+        "   if(s >= Rows)                                                                \n"
+        "       return;                                                                  \n"
+        "   float sum = 0.0;                                                             \n"
+        "   for(int j = 0; j < NextLayer_size; j++)                                      \n"
+        "       sum += imageLoad(NextBatch, ivec2(j, s)).b * imageLoad(NextWeight, ivec2(j * (Layer_size + 1) + n, 0)).r;\n"
+        "   vec4 neuronData = imageLoad(Batch, ivec2(n, s));                             \n"
+        "   neuronData.b = sum * Derivate(neuronData.r);                                 \n"
+        "   imageStore(Batch, ivec2(n, s), neuronData);                                  \n"
+        "}                                                                               \0"
+        ;
+
+    const char* BatchWeightUpdate_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) uniform image2D LayerWeight;                       \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D Batch;                    \n"
+        "layout(rgba32f, binding = 2) readonly uniform image2D PreviousBatch;            \n"
+        "layout(rgba32f, binding = 3) readonly uniform image2D Targets;                  \n"
+        "layout(location = 1) uniform int PreviousLayer_size;                            \n"
+        "layout(location = 2) uniform int Layer_size;                                    \n"
+        "layout(location = 3) uniform int Rows;                                          \n"
+        "layout(location = 4) uniform float LearnRT;                                     \n"
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+            //invocation per weight, mean of its gradient over samples with non-zero weight
+        "   int w = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(w >= (PreviousLayer_size + 1) * Layer_size)                               \n"
+        "       return;                                                                  \n"
+        "   int n = w / (PreviousLayer_size + 1);                                        \n"
+        "   int i = w - n * (PreviousLayer_size + 1);                                    \n"
+        "   float sum = 0.0;                                                             \n"
+        "   int count = 0;                                                               \n"
+        "   for(int s = 0; s < Rows; s++)                                                \n"
+        "   {                                                                            \n"
+        "       float x = i < PreviousLayer_size ? imageLoad(PreviousBatch, ivec2(i, s)).r : 1.0;\n"
+        "       sum += imageLoad(Batch, ivec2(n, s)).b * x;                              \n"
+        "       count += imageLoad(Targets, ivec2(0, s)).g != 0.0 ? 1 : 0;               \n"
+        "   }                                                                            \n"
+        "   vec4 weight = imageLoad(LayerWeight, ivec2(w, 0));                           \n"
+        "   weight.r += LearnRT * sum / float(max(count, 1));                            \n"
+        "   imageStore(LayerWeight, ivec2(w, 0), weight);                                \n"
+        "}                                                                               \0"
+        ;
+
+    const char* ReplaySample_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) readonly uniform image2D Inputs;                   \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D Targets;                  \n"
+        "layout(r32f, binding = 2) readonly uniform image2D Priorities;                  \n"
+        "layout(rgba32f, binding = 3) writeonly uniform image2D BatchInputs;             \n"
+        "layout(rgba32f, binding = 4) writeonly uniform image2D BatchTargets;            \n"
+        "layout(r32f, binding = 5) writeonly uniform image2D Sampled;                    \n"
+        "layout(location = 1) uniform int Count;                                         \n"
+        "layout(location = 2) uniform int Leaves;                                        \n"
+        "layout(location = 3) uniform int Rows;                                          \n"
+        "layout(location = 4) uniform uint Seed;                                         \n"
+        "layout(location = 5) uniform int Prioritized;                                   \n"
+        "layout(location = 6) uniform int InputSize;                                     \n"
+        "layout(location = 7) uniform int OutputSize;                                    \n"
+        "uint hash(uint x)                                                               \n"
+        "{                                                                               \n"
+        "   x ^= x >> 16; x *= 0x7feb352du;                                              \n"
+        "   x ^= x >> 15; x *= 0x846ca68bu;                                              \n"
+        "   return x ^ (x >> 16);                                                        \n"
+        "}                                                                               \n"
+        "float treeValue(int node)                                                       \n"
+        "{                                                                               \n"
+        "   return node < Leaves ? imageLoad(Priorities, ivec2(node, 0)).r               \n"
+        "                        : imageLoad(Priorities, ivec2(node - Leaves, 1)).r;     \n"
+        "}                                                                               \n"
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int r = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(r >= Rows)                                                                \n"
+        "       return;                                                                  \n"
+        "   float u = float(hash(Seed ^ hash(uint(r))) >> 8) / 16777216.0;               \n"
+        "   int row = int(u * float(Count));                                             \n"
+        "   if(Prioritized != 0)                                                         \n"
+        "   {                                                                            \n"
+        "       float x = u * treeValue(1);                                              \n"
+        "       int node = 1;                                                            \n"
+        "       while(node < Leaves)                                                     \n"
+        "       {                                                                        \n"
+        "           float left = treeValue(2 * node);                                    \n"
+        "           if(x < left)                                                         \n"
+        "               node = 2 * node;                                                 \n"
+        "           else                                                                 \n"
+        "           {                                                                    \n"
+        "               x -= left;                                                       \n"
+        "               node = 2 * node + 1;                                             \n"
+        "           }                                                                    \n"
+        "       }                                                                        \n"
+        "       row = node - Leaves;                                                     \n"
+        "   }                                                                            \n"
+        "   row = min(row, Count - 1);                                                   \n"
+        "   for(int i = 0; i < InputSize; i++)                                           \n"
+        "       imageStore(BatchInputs, ivec2(i, r), vec4(imageLoad(Inputs, ivec2(i, row)).r, 0.0, 0.0, 1.0));\n"
+        "   for(int n = 0; n < OutputSize; n++)                                          \n"
+        "       imageStore(BatchTargets, ivec2(n, r), vec4(imageLoad(Targets, ivec2(n, row)).r, 1.0, 0.0, 1.0));\n"
+        "   imageStore(Sampled, ivec2(r, 0), vec4(float(row)));                          \n"
+        "}                                                                               \0"
+        ;
+
+    const char* ReplayPriority_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) readonly uniform image2D Outputs;                  \n"
+        "layout(rgba32f, binding = 1) readonly uniform image2D BatchTargets;             \n"
+        "layout(r32f, binding = 2) readonly uniform image2D Sampled;                     \n"
+        "layout(r32f, binding = 3) writeonly uniform image2D Priorities;                 \n"
+        "layout(location = 3) uniform int Rows;                                          \n"
+        "layout(location = 7) uniform int OutputSize;                                    \n"
+        "layout(location = 8) uniform float Floor;                                       \n"
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int r = int(gl_GlobalInvocationID.x);                                        \n"
+        "   if(r >= Rows)                                                                \n"
+        "       return;                                                                  \n"
+        "   float error = 0.0;                                                           \n"
+        "   for(int n = 0; n < OutputSize; n++)                                          \n"
+        "       error += abs(imageLoad(BatchTargets, ivec2(n, r)).r - imageLoad(Outputs, ivec2(n, r)).r);\n"
+        "   int row = int(imageLoad(Sampled, ivec2(r, 0)).r);                            \n"
+        "   imageStore(Priorities, ivec2(row, 1), vec4(error / float(OutputSize) + Floor));\n"
+        "}                                                                               \0"
+        ;
+
+    const char* ReplayTreeLevel_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(r32f, binding = 0) uniform image2D Priorities;                           \n"
+        "layout(location = 2) uniform int Leaves;                                        \n"
+        "layout(location = 9) uniform int Begin;                                         \n"
+        "float treeValue(int node)                                                       \n"
+        "{                                                                               \n"
+        "   return node < Leaves ? imageLoad(Priorities, ivec2(node, 0)).r               \n"
+        "                        : imageLoad(Priorities, ivec2(node - Leaves, 1)).r;     \n"
+        "}                                                                               \n"
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int node = Begin + int(gl_GlobalInvocationID.x);                             \n"
+        "   if(node >= 2 * Begin)                                                        \n"
+        "       return;                                                                  \n"
+        "   imageStore(Priorities, ivec2(node, 0), vec4(treeValue(2 * node) + treeValue(2 * node + 1)));\n"
+        "}                                                                               \0"
+        ;
+
+    const char* ReplayStore_code =
+        "#version 420                                                                    \n"
+        "#extension GL_ARB_compute_shader : require                                      \n"
+        "#extension GL_ARB_shader_image_load_store : require                             \n"
+        "#extension GL_ARB_explicit_uniform_location : require                           \n"
+        "precision highp float;                                                          \n"
+        "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+        "layout(rgba32f, binding = 0) readonly uniform image2D Source;                   \n"
+        "layout(rgba32f, binding = 1) writeonly uniform image2D Ring;                    \n"
+        "layout(location = 3) uniform int Rows;                                          \n"
+        "layout(location = 6) uniform int InputSize;                                     \n"
+        "layout(location = 10) uniform int Head;                                         \n"
+        "layout(location = 11) uniform int Capacity;                                     \n"
+        "void main()                                                                     \n"
+        "{                                                                               \n"
+        "   int i = int(gl_GlobalInvocationID.x);                                        \n"
+        "   int r = int(gl_GlobalInvocationID.y);                                        \n"
+        "   if(i >= InputSize || r >= Rows)                                              \n"
+        "       return;                                                                  \n"
+        "   vec4 value = vec4(imageLoad(Source, ivec2(i, r)).r, 0.0, 0.0, 1.0);          \n"
+        "   imageStore(Ring, ivec2(i, (Head + r) % Capacity), value);                    \n"
+        "}                                                                               \0"
+        ;
+
+};
+
+
+/*
+ *********************************************************
+   Below are all API vars and function for HermesNetwork
+ *********************************************************
+*/
+
+//Bypass the namespace to make structure type public
+typedef HermesNetwork::NeuralNetwork NeuralNetwork;
+typedef HermesNetwork::ReplayBuffer ReplayBuffer;
+
+//This enum stores IDs of all different Activation Functions. To be used as an argument in SetActivation()
+enum ActivationType 
+{   Sigmoid = 0, 
+    TanH = 1, 
+    ReLu = 2,
+    LeakyReLu = 3,
+    Linear = 4,
+    Softmax = 5     // output layer only, trained with cross-entropy loss
+};
+
+//Setup gl context, compile shaders, create drawing polygon. With Calibrate, also runs CalibrateDevices()
+bool InitNeuralLink(bool GL_Context_Shared, bool Calibrate);
+
+//Builds network with given input size, hiddenlayer size as array and output size.
+template <typename T = int>
+NeuralNetwork NetworkBuilder(int InputSize, std::vector<T> HiddenLayers, int OutputSize);
+
+//Activates every neurons of a layer at specified depth
+void TriggerLayer(NeuralNetwork* Network, int LayerDepth);
+
+//Triggers every layers in network sequentially from input layer to output layer
+void TriggerNetwork(NeuralNetwork* Network);
+
+//Set every neurons of input layer with specified values in array
+void SendInputs(NeuralNetwork Network, float Inputs[]);
+
+//Send only non-zero inputs: Values[k] goes to input neuron Indices[k], every other input is 0. Indices must not repeat.
+//A dense first hidden layer then runs and trains only on weights of these inputs.
+void SendSparseInputs(NeuralNetwork Network, const int Indices[], const float Values[], int NonZeros);
+
+//Get neurons data in output layer as array
+void FetchOutputLayerData(NeuralNetwork Network);
+
+//Generate Error in output neurons, backpropogate errors to previous layers and updates every weight and bias
+void TrainNetwork(NeuralNetwork Network, float ActualOutput[], float LearningRate);
+
+//Handle to result of TriggerNetworkAsync() or TrainNetworkAsync(), ready once GPU has finished its work. Copies share
+//one result. Use it only from thread owning gl context
+class NetworkFuture
+{
+public:
+    //Whether result is ready, checks finished GPU work without waiting for it
+    bool Ready() const;
+
+    //Wait for result: outputs for TriggerNetworkAsync(), empty for TrainNetworkAsync() or if it failed
+    const std::vector<float>& Get() const;
+
+    //Whether waiting for GPU failed, checked once ready. A failed result is ready and has no outputs
+    bool Failed() const;
+
+    //Run Callback with result once ready, from PollAsync() or a wait, or right now if ready already
+    void Then(std::function<void(const std::vector<float>&)> Callback);
+
+#ifdef __cpp_impl_coroutine
+    //co_await: a coroutine suspends until result is ready and is resumed by PollAsync() on its thread
+    bool await_ready() const;
+    void await_suspend(std::coroutine_handle<> Handle);
+    std::vector<float> await_resume() const;           // a copy, awaited future is often a temporary
+#endif
+
+    std::shared_ptr<HermesNetwork::AsyncState> state;
+};
+
+//Queue forward pass of inputs set by SendInputs() and a readback of outputs, without waiting for GPU.
+//Once ready, outputs are in result and in Network->Out. A network on CPU is ready right away
+NetworkFuture TriggerNetworkAsync(NeuralNetwork Network);
+
+//Queue TrainNetwork() without waiting for GPU, ready once every weight is updated
+NetworkFuture TrainNetworkAsync(NeuralNetwork Network, float ActualOutput[], float LearningRate);
+
+//Finish async calls whose GPU work is done and run their callbacks and coroutines. Never waits, call it from event loop
+//of gl thread. Returns no. of async calls still in flight
+int PollAsync();
+
+//Set inputs of a batch of Rows samples, row after row. Batches run on their own textures and leave the single sample path untouched.
+//Only dense networks without int8 inference or softmax output take batches, returns false for others and if Rows is above
+//GL_MAX_TEXTURE_SIZE
+bool SendInputsBatch(NeuralNetwork Network, const float Inputs[], int Rows);
+
+//Forward pass of every sample of batch set by SendInputsBatch(). Returns false if batch textures hold fewer than Rows samples
+bool TriggerNetworkBatch(NeuralNetwork Network, int Rows);
+
+//Get outputs of every sample of batch, row after row. Returns false if batch textures hold fewer than Rows samples
+bool FetchOutputBatch(NeuralNetwork Network, float Outputs[], int Rows);
+
+//Update weights once with mean gradient of batch after TriggerNetworkBatch(). Targets go row after row.
+//Weights scales error of each sample (nullptr for all 1), samples of weight 0 are left out of the mean.
+//Returns false if batch textures hold fewer than Rows samples
+bool TrainNetworkBatch(NeuralNetwork Network, const float Targets[], int Rows, float LearningRate, const float Weights[] = nullptr);
+
+//Ring of Capacity (input, target, priority) samples kept in GPU textures. Once full, appends overwrite the oldest samples.
+//Returns nullptr if Capacity or a row doesn't fit in GL_MAX_TEXTURE_SIZE
+ReplayBuffer CreateReplayBuffer(int Capacity, int InputSize, int OutputSize);
+
+//Append Rows samples from host, inputs and targets row after row. Priority weighs prioritized sampling of them
+void AppendReplay(ReplayBuffer Buffer, const float Inputs[], const float Targets[], int Rows = 1, float Priority = 1);
+
+//Append current inputs of Network, as set by SendInputs() or SendSparseInputs(), copied on GPU. Only Targets come from host.
+//Does nothing if Network's input size doesn't match Buffer
+void AppendReplayFromInputs(ReplayBuffer Buffer, NeuralNetwork Network, const float Targets[], float Priority = 1);
+
+//Draw Batch samples from Buffer on GPU, uniformly or in proportion to their priorities, and update Network once with their
+//mean gradient. Prioritized also sets priority of drawn samples to their mean absolute output error before the update.
+//Returns false if Buffer is empty or doesn't match Network, if Network can't take batches (see SendInputsBatch()) or if Batch
+//is above GL_MAX_TEXTURE_SIZE
+bool TrainFromReplay(NeuralNetwork Network, ReplayBuffer Buffer, int Batch, float LearningRate, bool Prioritized = false);
+
+//Free textures of Buffer
+void DeleteReplayBuffer(ReplayBuffer Buffer);
+
+//save network structure,weights and bias in a file.
+void SaveNetwork(NeuralNetwork Network, const char filename[]);
+
+//load saved network from disk and generate a live neural network as per saved data such as weights, bias and no of layers.
+NeuralNetwork LoadNetwork(const char filename[]);
+
+//Free a network made by any builder or LoadNetwork(), with its textures, and forget it in engine stats, memory budget and
+//recording. Waits for its async calls still in flight. Nothing happens for nullptr
+void DeleteNetwork(NeuralNetwork Network);
+
+//Describes one convolution or max pooling stage of ConvNetworkBuilder()
+struct ConvStage
+{
+    int Channels;   // output channels of convolution, pooling keeps channels of its input
+    int Kernel;
+    int Stride;
+    int Padding;
+    bool Pooling;
+};
+
+//Convolution stage with given output channels and square kernel
+ConvStage Convolution(int Channels, int Kernel, int Stride = 1, int Padding = 0);
+
+//Max pooling stage with square window
+ConvStage MaxPooling(int Kernel, int Stride);
+
+//Builds network for Width x Height x Channels images: convolution/pooling stages, then fully connected hidden layers and output.
+//Returns nullptr if a stage does not fit the image or its window is too large (kernel <= 11 and 7 * stride + kernel <= 32).
+NeuralNetwork ConvNetworkBuilder(int Width, int Height, int Channels, std::vector<ConvStage> Stages, std::vector<int> HiddenLayers, int OutputSize);
+
+//This enum stores IDs of recurrent cells. To be used as an argument in RecurrentNetworkBuilder()
+enum RecurrentCell
+{   Elman = 0,
+    GRU = 1,
+    LSTM = 2
+};
+
+//Builds network with recurrent layers of given cell after input, then fully connected hidden layers and output.
+//Hidden state of recurrent layers stays on GPU between TriggerNetwork() calls; Window is the no. of past steps trained by TrainNetwork().
+NeuralNetwork RecurrentNetworkBuilder(int InputSize, RecurrentCell Cell, std::vector<int> RecurrentLayers, std::vector<int> HiddenLayers, int OutputSize, int Window = 8);
+
+//Clear hidden state of every recurrent layer, next TriggerNetwork() starts a new sequence
+void ResetState(NeuralNetwork Network);
+
+//Builds network for a sequence of Tokens x ModelSize inputs (laid out token after token): self-attention blocks with given no. of heads, then fully connected hidden layers and output.
+//Returns nullptr if ModelSize is not divisible by Heads or a head is wider than 64.
+NeuralNetwork AttentionNetworkBuilder(int Tokens, int ModelSize, int Heads, int Blocks, std::vector<int> HiddenLayers, int OutputSize);
+
+//Set Activation Function for all the layers in NeuralNetwork
+void SetActivation(NeuralNetwork Network, ActivationType AllLayersType);
+
+//Set different Activation Function for hidden and output layers in NeuralNetwor
 void SetActivation(NeuralNetwork Network, ActivationType HiddenLayersType, ActivationType OutputLayersType);
 
-//This function does nothing except changing network layer texture representation to a smooth, linear gradient.
-void Terrify(NeuralNetwork N);
+//This function does nothing except changing network layer texture representation to a smooth, linear gradient.
+void Terrify(NeuralNetwork N);
+
+//This function does nothing except changing network layer texture representation rigid, fixed bars.
+void DeTerrify(NeuralNetwork N);
+
+//Quantize every layer to int8 after calibrating activation scales with SampleCount input rows from SampleInputs.
+//Returns the largest absolute difference between fp32 and int8 outputs over the samples.
+float QuantizeNetwork(NeuralNetwork Network, float SampleInputs[], int SampleCount);
+
+//Switch a quantized network between int8 and fp32 inference.
+void SetQuantizedInference(NeuralNetwork Network, bool Enable);
+
+//Criteria used by PruneNetwork() to find low importance hidden neurons
+enum PruneCriterion
+{   WeightNorm = 0,         // L2 norm of neuron's outgoing weights
+    ActivationStats = 1     // standard deviation of neuron's activation over sample inputs
+};
+
+//Remove hidden neurons whose importance by given criterion is below Threshold, shrinking their layers. Returns no. of neurons removed
+int PruneNetwork(NeuralNetwork Network, PruneCriterion Criterion, float Threshold, float SampleInputs[] = nullptr, int SampleCount = 0);
+
+//Convert layer at given depth to sparse (CSR) weights, dropping the smallest Sparsity fraction of weights by magnitude. Returns no. of weights kept
+int SparsifyLayer(NeuralNetwork Network, int LayerDepth, float Sparsity);
+
+//Phases of network work timed by profiler
+enum ProfilePhase
+{   ForwardPhase = 0,           // activation of a layer
+    ErrorPhase = 1,             // output layer error, including upload of expected outputs
+    BackPropagationPhase = 2,   // error of a layer from the one after it
+    WeightUpdatePhase = 3,
+    UploadPhase = 4,            // inputs sent to input layer
+    ReadbackPhase = 5           // neurons or weights read back to CPU
+};
+
+//GPU time taken by one phase of one layer since profiling was enabled
+struct LayerProfile
+{
+    int LayerDepth;
+    ProfilePhase Phase;
+    long long Count;
+    double MeanMs, P50Ms, P99Ms;
+};
+
+//Enable or disable GPU timing of every layer's dispatches, uploads and readbacks. Enabling clears old timings
+void SetProfiling(bool Enable);
+
+//Timings of given network's layers by depth and phase. Waits for GPU work issued so far
+std::vector<LayerProfile> GetProfile(NeuralNetwork Network);
+
+//Start recording a timeline of API calls, layer phases, dispatches and barriers, keeping at most MaxEvents.
+//With SetProfiling(true) GPU time of layer phases is recorded on its own track too
+void StartTrace(int MaxEvents = 1 << 20);
+
+//Stop recording, events are kept for ExportTrace() until next StartTrace()
+void StopTrace();
+
+//Write recorded events as Chrome trace-event JSON, viewable in chrome://tracing or Perfetto. Returns false if file can't be written
+bool ExportTrace(const char filename[]);
+
+//Latency of an API call on host, from call to return. GPU work it queued may still be running
+struct LatencyStats
+{
+    long long Count;
+    double MeanMs, P50Ms, P90Ms, P99Ms, P999Ms, MaxMs;
+};
+
+//GPU memory held by textures of one network
+struct NetworkMemory
+{
+    NeuralNetwork Network;
+    long long Bytes;                // 0 while paged out
+    bool Resident;
+};
+
+//Counters of engine since start of program, always collected
+struct EngineStats
+{
+    long long Inferences;           // TriggerNetwork() calls
+    long long TrainingSteps;        // TrainNetwork() calls
+    long long BytesUploaded;        // inputs and expected outputs sent to GPU
+    long long BytesReadBack;        // neurons and weights read back to CPU
+    long long Stalls;               // times host waited for GPU to finish
+    long long Dispatches;           // compute dispatches
+    long long Barriers;             // memory barriers
+    long long GpuBytes;             // sum of NetworkMemory
+    std::vector<NetworkMemory> Networks;
+    LatencyStats Trigger, Train;
+    long long MemoryBudget;         // see SetMemoryBudget()
+    long long PagedBytes;           // host memory holding textures of paged out networks
+    long long PageHits, PageMisses; // TriggerNetwork(), TrainNetwork() and batch calls finding their network on GPU, or paged out since their last one
+    long long PageOuts;
+    LatencyStats PageIn, PageOut;   // host time to page a network in or out
+};
+
+//Snapshot of engine counters and latency histograms. Must be called from thread owning gl context
+EngineStats GetEngineStats();
+
+//Cap GPU memory of all networks' textures at Bytes, 0 for no cap (default). Once over it, least recently used networks
+//are paged out to host memory, and paged back in by the next call using them, so many small models can be served from
+//one GPU. A network larger than Bytes stays resident
+void SetMemoryBudget(long long Bytes);
+
+//Start recording NetworkBuilder(), LoadNetwork(), SetActivation(), SendInputs(), SendSparseInputs(), TriggerNetwork(),
+//TrainNetwork() and FetchOutputLayerData() calls with their inputs and targets into a binary log. Returns false if file can't be written
+bool StartRecording(const char filename[]);
+
+//Stop recording and close log
+void StopRecording();
+
+//Host time spent in one kind of API call during replay
+struct ReplayTiming
+{
+    const char* Call;
+    long long Count;
+    double TotalMs, P50Ms, P99Ms, MaxMs;
+};
+
+//Result of ReplayRecording(). WallMs covers whole replay until GPU has finished
+struct ReplayReport
+{
+    bool Ok;
+    long long Calls;
+    double WallMs;
+    std::vector<ReplayTiming> Timings;
+    std::vector<NeuralNetwork> Networks;   // networks replay left, by order they first appear in log; free with DeleteNetwork()
+};
+
+//Re-run a log written by StartRecording() as fast as possible on new networks and time every call.
+//Ok is false if file can't be read or is not a log
+ReplayReport ReplayRecording(const char filename[]);
+
+//Time variants (work group size, thread or work group per neuron) of forward, backpropagation and weight update kernels
+//for every distinct dense layer shape of Network, and run its layers with the fastest ones. Shapes timed before are reused
+void AutotuneNetwork(NeuralNetwork Network);
+
+//With Enable, NetworkBuilder() and LoadNetwork() autotune every network they build. Timings are kept per renderer in
+//CacheFile (nullptr for none), so later runs start with tuned kernels without timing them again
+void SetAutotune(bool Enable, const char CacheFile[] = "hermes_tuning.cache");
+
+//Names of kernel variants used by dense layer at given depth: forward, backpropagation into previous layer, weight update
+std::vector<std::string> GetTunedKernels(NeuralNetwork Network, int LayerDepth);
+
+//With Enable (default), dense layers run kernels compiled for their own weight shape: sizes are constants so loops unroll,
+//and inputs are summed four at a time. A shape's kernels are compiled the first time it runs and reused by every layer of that shape
+void SetShapeSpecialization(bool Enable);
+
+//No. of shape specialized kernels compiled so far
+int GetShapeKernelCount();
+
+//Device a network runs on. AutoDevice picks whichever is estimated faster from CalibrateDevices() measurements
+enum ComputeDevice { AutoDevice, GPUDevice, CPUDevice };
+
+//Costs measured by CalibrateDevices(), times in microseconds
+struct DeviceCalibration
+{
+    bool Calibrated = false;
+    double DispatchUs = 0;      // one compute dispatch and its barrier
+    double UploadUs = 0;        // SendInputs() of a small input layer
+    double ReadbackUs = 0;      // FetchOutputLayerData() of a small output layer, waiting for GPU included
+    double GpuGflops = 0;       // dense layer math on GPU
+    double CpuGflops = 0;       // same math on host
+};
+
+//Measure dispatch, upload and readback latency and dense GFLOP/s of GPU and host, in a fraction of a second.
+//Afterwards NetworkBuilder() and LoadNetwork() put every network that can run on CPU on the device estimated faster for it
+DeviceCalibration CalibrateDevices();
+
+//Measurements of last CalibrateDevices(), Calibrated is false before it runs
+DeviceCalibration GetDeviceCalibration();
+
+//Estimated microseconds of one SendInputs(), TriggerNetwork(), FetchOutputLayerData() and TrainNetwork() on Device,
+//from calibration. 0 before CalibrateDevices(), or for CPU if Network can't run there
+double EstimateStepTime(NeuralNetwork Network, ComputeDevice Device);
+
+//Move Network's neurons and weights to Device, AutoDevice for the one estimated faster. Only feed forward networks of dense
+//fp32 layers run on CPU, returns false and keeps others on GPU. Calls that need textures (batches, replay, sparse inputs,
+//quantization, pruning, sparsifying) move a CPU network back to GPU first
+bool SetNetworkDevice(NeuralNetwork Network, ComputeDevice Device);
+
+//Device Network runs on now
+ComputeDevice GetNetworkDevice(NeuralNetwork Network);
+
+//Sizes of hidden layers of a StaticNetwork, e.g. Layers<8, 8>
+template <int... Sizes>
+struct Layers {};
+
+//Dense network of fixed shape that runs on CPU, for models of a few dozen neurons where a GPU round trip costs far more
+//than the math. Weights live in std::arrays and every loop has compile time bounds, so the compiler unrolls and
+//vectorizes forward and train steps. Weights are laid out like those of GPU layers and SaveNetwork()/LoadNetwork()
+//use the same files, so a model moves between StaticNetwork and NetworkBuilder() networks.
+//e.g. StaticNetwork<3, Layers<8, 8>, 2, Sigmoid> Net;
+template <int InputSize, typename HiddenLayers, int OutputSize, ActivationType HiddenType = Sigmoid, ActivationType OutputType = HiddenType>
+struct StaticNetwork;
+
+//Set inputs of a StaticNetwork
+template <int I, typename H, int O, ActivationType A, ActivationType B>
+void SendInputs(StaticNetwork<I, H, O, A, B>& Network, const float Inputs[]);
+
+//Forward pass of a StaticNetwork, outputs are in Network.Out right after
+template <int I, typename H, int O, ActivationType A, ActivationType B>
+void TriggerNetwork(StaticNetwork<I, H, O, A, B>& Network);
+
+//Same step as TrainNetwork() of a GPU network: errors of every layer first, then every weight and bias
+template <int I, typename H, int O, ActivationType A, ActivationType B>
+void TrainNetwork(StaticNetwork<I, H, O, A, B>& Network, const float ActualOutput[], float LearningRate = 1.0f);
+
+//Write a StaticNetwork in SaveNetwork() format, LoadNetwork() reads it back as a GPU network. Returns false if file can't be written
+template <int I, typename H, int O, ActivationType A, ActivationType B>
+bool SaveNetwork(const StaticNetwork<I, H, O, A, B>& Network, const char filename[]);
+
+//Read weights of a file written by SaveNetwork() into a StaticNetwork of same shape. Activations aren't in the file.
+//Returns false, leaving Network unchanged, if file can't be read or holds a different shape or non-dense layers
+template <int I, typename H, int O, ActivationType A, ActivationType B>
+bool LoadNetwork(StaticNetwork<I, H, O, A, B>& Network, const char filename[]);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////  DEFINITIONS  ////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//////////////////////////////////////////////////////// HermesNetwork's functions ////////////////////////////////////////////////////////
+HermesNetwork::Layer HermesNetwork::initLayer(int size, layerType typ)
+{        
+    Layer newL = new LayerHandle();
+	newL->type = typ;
+	newL->no_neuron = size;
+    
+    glGenTextures(1, &newL->NeuronsTex);
+    glBindTexture(GL_TEXTURE_2D, newL->NeuronsTex);    
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, newL->no_neuron, 1, 0, GL_RGBA, GL_FLOAT, NULL);	
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return newL;
+}
+
+NeuralNetwork HermesNetwork::createBasicNetwork(int InputSize, int OutputSize)
+{
+    /* build input Layer structure */
+    Layer inp = initLayer(InputSize, inputL);
+
+    /* build output Layer structure */
+    Layer op = initLayer(OutputSize, inputL);
+
+    /* build NeuralNetowkr structure */
+    NeuralNetwork nn = new NeuralNetworkHandle();
+	nn->no_of_input = InputSize;
+	nn->no_of_output = OutputSize;
+	nn->inputLayer = inp;
+	nn->outputLayer = op;      
+    nn->netType = feedForward;
+
+    nn->inputLayer->next = op;
+    nn->outputLayer->prev = nn->inputLayer;      
+
+    networks.push_back(nn);
+    return nn;
+}
+
+void HermesNetwork::appendHiddenLayer(NeuralNetwork Network, int LayerSize)
+{
+    Layer newL = initLayer(LayerSize, hiddenL);
+    Network->outputLayer->prev->next = newL;
+    newL->prev = Network->outputLayer->prev;
+    newL->next = Network->outputLayer;
+    Network->outputLayer->prev = newL;
+
+    Network->no_layers++;
+}
+
+void HermesNetwork::connectLayer(Layer prev, Layer next)
+{
+	/*TODO
+	* check and delete next->WeightsTex and generate new one as per previous added layer no. of neurons
+	* vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
+	*/	
+    if (next->WeightsTex > 0)  //delete old texture RBO if next layer already connected to an old previous layer
+	{
+		glDeleteTextures(1, &next->WeightsTex);
+	}
+    next->weightVersion++;
+	//^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+
+    /* reconnected sparse layer starts over as dense */
+    if(next->kind == sparseK)
+        freeSparseIndex(next);
+
+    /* pooling has nothing to learn */
+    if(next->kind == poolingK)
+    {
+        next->WeightsTex = 0;
+        next->no_weight = 0;
+        return;
+    }
+
+    if(next->kind == recurrentK)
+    {
+        /* small symmetric weights keep state from saturating, history rings start empty */
+        int gates = next->cell == elmanC ? 1 : (next->cell == gruC ? 3 : 4);
+        int rowSize = prev->no_neuron + next->no_neuron + 1;
+        float range = 1.0f / std::sqrt((float)next->no_neuron);
+        std::vector<float> weights(gates * next->no_neuron * rowSize);
+        for(float& w: weights)
+            w = range * (2.0f * rand() / RAND_MAX - 1.0f);
+        next->no_weight = weights.size();
+        next->WeightsTex = createDataTexture(rowSize, gates * next->no_neuron, GL_RGBA32F, GL_RED, GL_FLOAT, weights.data());
+
+        unsigned int history[5] = { next->StateHistTex, next->InputHistTex, next->GradHistTex, next->DeltaTex, next->ErrHistTex };
+        glDeleteTextures(5, history);
+        next->StateHistTex = createDataTexture(2 * next->no_neuron, next->window + 1, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+        next->InputHistTex = createDataTexture(prev->no_neuron, next->window + 1, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+        next->GradHistTex = createDataTexture(next->no_neuron, next->window + 1, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+        next->DeltaTex = createDataTexture(next->no_neuron, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+        next->ErrHistTex = createDataTexture(next->no_neuron, next->window + 1, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+        next->step = 0;
+        next->unrolled = 0;
+        return;
+    }
+
+    if(next->kind == attentionK)
+    {
+        /* rows of Wq, Wk, Wv and Wo with bias in last column, biases start at 0 */
+        int D = next->no_neuron / next->tokens;
+        float range = 1.0f / std::sqrt((float)D);
+        std::vector<float> weights(4 * D * (D + 1), 0.0f);
+        for(int r = 0; r < 4 * D; r++)
+            for(int c = 0; c < D; c++)
+                weights[r * (D + 1) + c] = range * (2.0f * rand() / RAND_MAX - 1.0f);
+        next->no_weight = weights.size();
+        next->WeightsTex = createDataTexture(D + 1, 4 * D, GL_RGBA32F, GL_RED, GL_FLOAT, weights.data());
+
+        unsigned int buffers[5] = { next->QKVTex, next->AttnTex, next->AttnStatTex, next->AttnGradTex, next->QKVGradTex };
+        glDeleteTextures(5, buffers);
+        next->QKVTex = createDataTexture(3 * D, next->tokens, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+        next->AttnTex = createDataTexture(D, next->tokens, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+        next->AttnStatTex = createDataTexture(next->heads, next->tokens, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+        next->AttnGradTex = createDataTexture(D, next->tokens, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+        next->QKVGradTex = createDataTexture(3 * D, next->tokens, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+        return;
+    }
+
+    /* init next's weight texture */
+    if(next->kind == convolutionK)
+        next->no_weight = (prev->channels * next->kernel * next->kernel + 1) * next->channels;
+    else
+	    next->no_weight = (prev->no_neuron + 1) * next->no_neuron;
+	glGenTextures(1, &next->WeightsTex);
+	glBindTexture(GL_TEXTURE_2D, next->WeightsTex);	
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);	
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, next->no_weight, 1, 0, GL_RGBA, GL_FLOAT, NULL);	
+
+    glBindImageTexture(0, next->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
+    
+    glUseProgram(WeightInit);
+
+    glUniform1i(WINT_unifm_seed, rand());    
+    dispatchCompute(next->no_weight,1,1);
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    
+    glBindTexture(GL_TEXTURE_2D, 0);
+    next->weightVersion++;
+}
+
+void HermesNetwork::triggerLayer(Layer Lyr)
+{	
+    if(Lyr->onHost)
+    {
+        hostTriggerLayer(Lyr);
+        return;
+    }
+    ProfileScope scope(Lyr, forwardP);
+    Lyr->neuronVersion++;
+    if(Lyr->prev->activeInputs > 0 && (Lyr->int8 || Lyr->kind != denseK))
+        scatterActiveInputs(Lyr->prev);
+
+    if(Lyr->prev->activeInputs > 0)
+    {
+        /* dense layer reads only weight columns of non-zero inputs */
+        glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->prev->ActiveInputTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+        glUseProgram(SparseInputActivation);
+
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        glUniform1i(SPRS_unifm_Layer_size, Lyr->no_neuron);
+        glUniform1i(SPRS_unifm_nnz, Lyr->prev->activeInputs);
+        glUniform1i(SPRS_unifm_prev_size, Lyr->prev->no_neuron);
+        dispatchCompute((Lyr->no_neuron + 63) / 64,1,1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        if(Lyr->AFun == Softmax)
+            softmaxLayer(Lyr, nullptr);
+        return;
+    }
+
+    if(Lyr->int8)
+    {
+        /* pack previous layer's activations, then run integer dot products against int8 weights */
+        quantizeLayerNeurons(Lyr->prev);
+
+        glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(QACTV_unifm_prev_L_TEX, Lyr->prev->QNeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32I);
+        glBindImageTexture(QACTV_unifm_qweight_TEX, Lyr->QWeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32I);
+        glBindImageTexture(QACTV_unifm_scale_TEX, Lyr->QScaleTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+        glUseProgram(QActivation);
+
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        glUniform1i(QACTV_unifm_packed_size, (Lyr->prev->no_neuron + 3) / 4);
+        glUniform1f(QACTV_unifm_input_scale, Lyr->prev->ActScale);
+        dispatchCompute(Lyr->no_neuron,1,1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        if(Lyr->AFun == Softmax)
+            softmaxLayer(Lyr, nullptr);
+        return;
+    }
+
+    if(Lyr->kind == recurrentK)
+    {
+        /* all gates of a neuron in one invocation, state of previous step is read from history ring */
+        glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->prev->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(3, Lyr->StateHistTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(4, Lyr->InputHistTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+        glUseProgram(RecurrentActivation);
+
+        setRecurrentUniforms(Lyr, Lyr->step);
+        dispatchCompute((Lyr->no_neuron + 63) / 64,1,1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        Lyr->step++;
+        return;
+    }
+
+    if(Lyr->kind == attentionK)
+    {
+        /* fused q,k,v projection, then tiled attention per 32 queries of a head, then output projection */
+        int D = Lyr->no_neuron / Lyr->tokens;
+        glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->prev->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(3, Lyr->QKVTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        glBindImageTexture(4, Lyr->AttnTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+        glUseProgram(AttentionProjection);
+
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        glUniform3i(ATTN_unifm_shape, Lyr->tokens, D, Lyr->heads);
+        glUniform1i(ATTN_unifm_mode, 0);
+        dispatchCompute((3 * D + 63) / 64, Lyr->tokens, 1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        glBindImageTexture(0, Lyr->QKVTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->AttnTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->AttnStatTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+        glUseProgram(AttentionScores);
+
+        glUniform3i(ATTN_unifm_shape, Lyr->tokens, D, Lyr->heads);
+        dispatchCompute((Lyr->tokens + 31) / 32, Lyr->heads, 1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(4, Lyr->AttnTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+        glUseProgram(AttentionProjection);
+
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        glUniform3i(ATTN_unifm_shape, Lyr->tokens, D, Lyr->heads);
+        glUniform1i(ATTN_unifm_mode, 1);
+        dispatchCompute((D + 63) / 64, Lyr->tokens, 1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        return;
+    }
+
+    if(Lyr->kind == sparseK)
+    {
+        /* one invocation per neuron walking its CSR row */
+        glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->prev->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(3, Lyr->RowPtrTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32I);
+        glBindImageTexture(4, Lyr->ColIndexTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32I);
+
+        glUseProgram(SparseActivation);
+
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        glUniform1i(SPRS_unifm_Layer_size, Lyr->no_neuron);
+        glUniform1i(SPRS_unifm_nnz, Lyr->nnz);
+        dispatchCompute((Lyr->no_neuron + 63) / 64,1,1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        if(Lyr->AFun == Softmax)
+            softmaxLayer(Lyr, nullptr);
+        return;
+    }
+
+    if(Lyr->kind != denseK)
+    {
+        /* convolution/pooling: one 8x8 work group per 8x8 patch of each output channel */
+        glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->prev->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        if(Lyr->kind == convolutionK)
+        {
+            glBindImageTexture(2, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+            glUseProgram(ConvActivation);
+            glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        }
+        else
+            glUseProgram(PoolActivation);
+
+        setImageUniforms(Lyr);
+        dispatchCompute((Lyr->width + 7) / 8, (Lyr->height + 7) / 8, Lyr->channels);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        return;
+    }
+
+    glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
+    glBindImageTexture(ACTV_unifm_prev_L_TEX, Lyr->prev->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
+    glBindImageTexture(ACTV_unifm_Layer_weight, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
+    
+    const KernelVariant* shapedVariant = nullptr;
+    unsigned int shaped = shapedKernel(forwardT, Lyr->tuned[forwardT], Lyr->prev->no_neuron, Lyr->no_neuron, shapedVariant);
+    if(shaped)
+    {
+        glUseProgram(shaped);
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        dispatchCompute(shapedVariant->groups(Lyr->no_neuron),1,1);
+    }
+    else if(Lyr->tuned[forwardT] > 0)
+    {
+        const KernelVariant& v = denseVariants[forwardT][Lyr->tuned[forwardT]];
+        glUseProgram(v.program);
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        glUniform1i(DENSE_unifm_prev_size, Lyr->prev->no_neuron);
+        glUniform1i(DENSE_unifm_Layer_size, Lyr->no_neuron);
+        dispatchCompute(v.groups(Lyr->no_neuron),1,1);
+    }
+    else
+    {
+        glUseProgram(Activation);
+
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        glUniform1i(ACTV_unifm_prev_size, Lyr->prev->no_neuron);
+        glUniform1i(ACTV_unifm_weight_size, Lyr->no_weight);
+        dispatchCompute(Lyr->no_neuron,1,1);
+    }
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);    
+
+    if(Lyr->AFun == Softmax)
+        softmaxLayer(Lyr, nullptr);
+}
+
+void fetchLayerNeuronsData_ERR(HermesNetwork::Layer Lyr)
+{
+    using namespace HermesNetwork;
+    if(!Lyr->data)
+        Lyr->data = new float[Lyr->no_neuron];
+    if(Lyr->onHost)
+    {
+        std::copy(Lyr->hostErrors.begin(), Lyr->hostErrors.end(), Lyr->data);
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, Lyr->NeuronsTex);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_BLUE, GL_FLOAT, Lyr->data);
+    glBindTexture(GL_TEXTURE_2D, 0);    
+    countReadback(sizeof(float) * Lyr->no_neuron);
+}
+
+void HermesNetwork::fetchLayerNeuronsData(Layer Lyr)
+{
+    if(!Lyr->data)
+        Lyr->data = new float[Lyr->no_neuron];
+    if(Lyr->onHost)
+    {
+        std::copy(Lyr->hostNeurons.begin(), Lyr->hostNeurons.end(), Lyr->data);
+        return;
+    }
+    ProfileScope scope(Lyr, readbackP);
+    glBindTexture(GL_TEXTURE_2D, Lyr->NeuronsTex);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, Lyr->data);
+    glBindTexture(GL_TEXTURE_2D, 0);    
+    countReadback(sizeof(float) * Lyr->no_neuron);
+}
+
+void HermesNetwork::fetchLayerWeights_Bias(Layer Lyr)
+{
+    if(!Lyr->weights)
+        Lyr->weights = new float[Lyr->no_weight];
+    if(Lyr->onHost)
+    {
+        std::copy(Lyr->hostWeights.begin(), Lyr->hostWeights.end(), Lyr->weights);
+        return;
+    }
+    ProfileScope scope(Lyr, readbackP);
+    glBindTexture(GL_TEXTURE_2D, Lyr->WeightsTex);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, Lyr->weights);
+    glBindTexture(GL_TEXTURE_2D, 0);    
+    countReadback(sizeof(float) * Lyr->no_weight);
+}
+
+void HermesNetwork::freeLayerNeuronData(Layer Lyr)
+{
+    if(Lyr->type == hiddenL)
+    {
+        delete[] Lyr->data;        
+        Lyr->data = nullptr;
+    }
+}
+    
+void HermesNetwork::freeLayerWeights_Bias(Layer Lyr)
+{
+    if(Lyr->type != inputL)
+    {
+        delete[] Lyr->weights;
+        Lyr->weights = nullptr;
+    }
+}
+
+void HermesNetwork::calcError(Layer Lyr, float* ActualOutput)
+{
+    ProfileScope scope(Lyr, errorP);
+    Lyr->neuronVersion++;
+    /* softmax output computes its normalization and cross-entropy error in one dispatch */
+    if(Lyr->AFun == Softmax)
+    {
+        softmaxLayer(Lyr, ActualOutput);
+        return;
+    }
+
+    /* convert output array to texture */
+	glBindTexture(GL_TEXTURE_2D, TempTex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, Lyr->no_neuron, 1, 0, GL_RED, GL_FLOAT, ActualOutput);
+    countUpload(sizeof(float) * Lyr->no_neuron);
+    
+    glBindImageTexture(ERROR_unifm_neuronOut_TEX, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
+    glBindImageTexture(ERROR_unifm_actualOut_TEX, TempTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
+
+    glUseProgram(ErrorGen);
+
+    glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+    dispatchCompute(Lyr->no_neuron,1,1);
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);  
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void HermesNetwork::trainLayer(Layer Lyr, float* LearningRate)
+{
+    ProfileScope scope(Lyr, updateP);
+    if(Lyr->kind == poolingK)
+        return;
+    Lyr->weightVersion++;
+
+    if(Lyr->kind == recurrentK)
+    {
+        /* one invocation per weight summing its error over all unrolled steps */
+        if(Lyr->unrolled == 0)
+            return;
+        int gates = Lyr->cell == elmanC ? 1 : (Lyr->cell == gruC ? 3 : 4);
+        glBindImageTexture(0, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->GradHistTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->InputHistTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(3, Lyr->StateHistTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+        glUseProgram(RecurrentWeightUpdate);
+
+        setRecurrentUniforms(Lyr, Lyr->step - 1);
+        glUniform1i(RNN_unifm_steps, Lyr->unrolled);
+        glUniform1f(RNN_unifm_LearnRT, *LearningRate);
+        dispatchCompute((Lyr->prev->no_neuron + Lyr->no_neuron + 8) / 8, (gates * Lyr->no_neuron + 7) / 8, 1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        Lyr->unrolled = 0;
+        return;
+    }
+
+    if(Lyr->kind == attentionK)
+    {
+        /* one invocation per weight summing its error over all tokens */
+        int D = Lyr->no_neuron / Lyr->tokens;
+        glBindImageTexture(0, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->prev->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(3, Lyr->AttnTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(4, Lyr->QKVGradTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+        glUseProgram(AttentionWeightUpdate);
+
+        glUniform3i(ATTN_unifm_shape, Lyr->tokens, D, Lyr->heads);
+        glUniform1f(ATTN_unifm_LearnRT, *LearningRate);
+        dispatchCompute((D + 8) / 8, (4 * D + 7) / 8, 1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        return;
+    }
+
+    if(Lyr->kind == denseK && Lyr->prev->activeInputs > 0)
+    {
+        glBindImageTexture(0, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->prev->ActiveInputTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+        glUseProgram(SparseInputWeightUpdate);
+
+        glUniform1i(SPRS_unifm_Layer_size, Lyr->no_neuron);
+        glUniform1i(SPRS_unifm_nnz, Lyr->prev->activeInputs);
+        glUniform1f(SPRS_unifm_LearnRT, *LearningRate);
+        glUniform1i(SPRS_unifm_prev_size, Lyr->prev->no_neuron);
+        dispatchCompute((Lyr->no_neuron + 63) / 64,1,1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        return;
+    }
+
+    if(Lyr->kind == sparseK)
+    {
+        glBindImageTexture(0, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
+        glBindImageTexture(1, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->prev->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(3, Lyr->RowPtrTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32I);
+        glBindImageTexture(4, Lyr->ColIndexTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32I);
+
+        glUseProgram(SparseWeightUpdate);
+
+        glUniform1i(SPRS_unifm_Layer_size, Lyr->no_neuron);
+        glUniform1i(SPRS_unifm_nnz, Lyr->nnz);
+        glUniform1f(SPRS_unifm_LearnRT, *LearningRate);
+        dispatchCompute((Lyr->no_neuron + 63) / 64,1,1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        return;
+    }
+
+    if(Lyr->kind == convolutionK)
+    {
+        /* one work group per filter slice (output channel, input channel) */
+        glBindImageTexture(0, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->prev->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+        glUseProgram(ConvWeightUpdate);
+
+        setImageUniforms(Lyr);
+        glUniform1f(IMG_unifm_LearnRT, *LearningRate);
+        dispatchCompute(Lyr->channels, Lyr->prev->channels, 1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        return;
+    }
+
+    glBindImageTexture(WGHTUP_unifm_weight_TEX, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
+    glBindImageTexture(WGHTUP_unifm_neuronOut_TEX, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
+    glBindImageTexture(WGHTUP_unifm_prev_L_TEX, Lyr->prev->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
+    
+    const KernelVariant* shapedVariant = nullptr;
+    unsigned int shaped = shapedKernel(updateT, Lyr->tuned[updateT], Lyr->prev->no_neuron, Lyr->no_neuron, shapedVariant);
+    if(shaped)
+    {
+        glUseProgram(shaped);
+        glUniform1f(DENSE_unifm_LearnRT, *LearningRate);
+        dispatchCompute(shapedVariant->groups(Lyr->no_weight),1,1);
+    }
+    else if(Lyr->tuned[updateT] > 0)
+    {
+        const KernelVariant& v = denseVariants[updateT][Lyr->tuned[updateT]];
+        glUseProgram(v.program);
+        glUniform1i(DENSE_unifm_prev_size, Lyr->prev->no_neuron);
+        glUniform1i(DENSE_unifm_Layer_size, Lyr->no_neuron);
+        glUniform1f(DENSE_unifm_LearnRT, *LearningRate);
+        dispatchCompute(v.groups(Lyr->no_weight),1,1);
+    }
+    else
+    {
+        glUseProgram(WeightUpdate);
+    
+        glUniform1i(WGHTUP_unifm_prev_size, Lyr->prev->no_neuron);
+        glUniform1i(WGHTUP_unifm_next_size, Lyr->no_neuron);
+        glUniform1f(WGHTUP_unifm_LearnRT, *LearningRate);
+        dispatchCompute(Lyr->no_weight,1,1);    
+    }
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);    
+}
+
+void HermesNetwork::backPropogateError(Layer Lyr)
+{
+    ProfileScope scope(Lyr, backPropP);
+    Lyr->neuronVersion++;
+    if(Lyr->next->kind == recurrentK)
+    {
+        /* input weights carry gate errors of every unrolled step, next layer must be unrolled first.
+           A recurrent layer here takes error of each of its own unrolled steps, others only the latest */
+        int steps = 1;
+        glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->next->GradHistTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->next->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        if(Lyr->kind == recurrentK)
+        {
+            steps = std::max(std::min(Lyr->step, Lyr->window), 1);
+            glBindImageTexture(3, Lyr->ErrHistTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        }
+
+        glUseProgram(RecurrentBackPropogate);
+
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        setRecurrentUniforms(Lyr->next, Lyr->next->step - 1);
+        glUniform1i(RNN_unifm_steps, Lyr->next->unrolled);
+        glUniform2i(RNN_unifm_history, Lyr->kind == recurrentK ? Lyr->window + 1 : 0, steps);
+        dispatchCompute((Lyr->no_neuron + 63) / 64, steps, 1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        return;
+    }
+
+    if(Lyr->next->kind == attentionK)
+    {
+        /* q,k,v errors of every token through their projection, next layer must run attentionBackward() first */
+        Layer next = Lyr->next;
+        glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, next->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(3, next->QKVGradTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+        glUseProgram(AttentionBackProject);
+
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        glUniform3i(ATTN_unifm_shape, next->tokens, next->no_neuron / next->tokens, next->heads);
+        glUniform1i(ATTN_unifm_mode, 1);
+        dispatchCompute((next->no_neuron / next->tokens + 63) / 64, next->tokens, 1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        return;
+    }
+
+    if(Lyr->next->kind == sparseK)
+    {
+        /* gather errors along this layer's columns of next layer's weights */
+        glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->next->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->next->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(3, Lyr->next->ColPtrTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32I);
+        glBindImageTexture(4, Lyr->next->CscEntryTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RG32I);
+
+        glUseProgram(SparseBackPropogate);
+
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        glUniform1i(SPRS_unifm_Layer_size, Lyr->no_neuron);
+        dispatchCompute((Lyr->no_neuron + 63) / 64,1,1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        return;
+    }
+
+    if(Lyr->next->kind != denseK)
+    {
+        /* gather errors through convolution filters or pooling winners of next layer */
+        glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->next->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        if(Lyr->next->kind == convolutionK)
+        {
+            glBindImageTexture(2, Lyr->next->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+            glUseProgram(ConvBackPropogate);
+        }
+        else
+            glUseProgram(PoolBackPropogate);
+
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        setImageUniforms(Lyr->next);
+        dispatchCompute((Lyr->width + 7) / 8, (Lyr->height + 7) / 8, Lyr->channels);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        return;
+    }
+
+    glBindImageTexture(ERROR_BP_unifm_neuronOut_TEX, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
+    glBindImageTexture(ERROR_BP_unifm_next_L_TEX, Lyr->next->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
+    glBindImageTexture(ERROR_BP_unifm_weight_TEX, Lyr->next->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
+    
+    const KernelVariant* shapedVariant = nullptr;
+    unsigned int shaped = shapedKernel(backPropT, Lyr->next->tuned[backPropT], Lyr->no_neuron, Lyr->next->no_neuron, shapedVariant);
+    if(shaped)
+    {
+        glUseProgram(shaped);
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        dispatchCompute(shapedVariant->groups(Lyr->no_neuron),1,1);
+    }
+    else if(Lyr->next->tuned[backPropT] > 0)
+    {
+        const KernelVariant& v = denseVariants[backPropT][Lyr->next->tuned[backPropT]];
+        glUseProgram(v.program);
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        glUniform1i(DENSE_unifm_Layer_size, Lyr->no_neuron);
+        glUniform1i(DENSE_unifm_next_size, Lyr->next->no_neuron);
+        dispatchCompute(v.groups(Lyr->no_neuron),1,1);
+    }
+    else
+    {
+        glUseProgram(ErrorBackPropogate);
+
+        glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+        glUniform1i(ERROR_BP_unifm_Layer_size, Lyr->no_neuron);
+        glUniform1i(ERROR_BP_unifm_next_L_size, Lyr->next->no_neuron);
+        dispatchCompute(Lyr->no_neuron,1,1);
+    }
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);    
+}
+
+unsigned int HermesNetwork::createDataTexture(int width, int height, GLenum internalFormat, GLenum format, GLenum type, const void* data)
+{
+    unsigned int tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, data);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return tex;
+}
+
+unsigned int HermesNetwork::buildKernel(const char* code, bool withActivationLibs, const std::string& defines)
+{
+    int success;
+    char infoLog[512];
+    unsigned int program = glCreateProgram();
+
+    int kernel = glCreateShader(GL_COMPUTE_SHADER);
+    const char* versionEnd = std::strchr(code, '\n') + 1;
+    const char* parts[3] = { code, defines.c_str(), versionEnd };
+    int lengths[3] = { (int)(versionEnd - code), (int)defines.size(), -1 };
+    glShaderSource(kernel, 3, parts, lengths);
+    glCompileShader(kernel);
+    glGetShaderiv(kernel, GL_COMPILE_STATUS, &success);
+    if(!success)
+    {
+        glGetShaderInfoLog(kernel, 512, NULL, infoLog);
+        std::cout << infoLog;
+        glDeleteShader(kernel);
+        glDeleteProgram(program);
+        return 0;
+    }
+    glAttachShader(program, kernel);
+
+    int libs = 0;
+    if(withActivationLibs)
+    {
+        libs = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(libs, 1, &ActiveDeriveLibs_code, NULL);
+        glCompileShader(libs);
+        glAttachShader(program, libs);
+    }
+
+    glLinkProgram(program);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+    /* remove compiled shader from RAM */
+    glDeleteShader(kernel);
+    if(libs)
+        glDeleteShader(libs);
+
+    if(!success)
+    {
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cout << infoLog;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+int HermesNetwork::KernelVariant::groups(int Items) const
+{
+    return cooperative ? Items : (Items + workGroup - 1) / workGroup;
+}
+
+bool HermesNetwork::buildDenseVariants()
+{
+    /* work group size of an invocation per item, or of a work group per neuron */
+    struct Candidate { const char* name; int workGroup; bool cooperative; };
+    const std::vector<Candidate> neuronKernels = {
+        { "thread x32", 32, false }, { "thread x64", 64, false }, { "thread x128", 128, false },
+        { "group x32", 32, true }, { "group x64", 64, true }, { "group x128", 128, true }, { "group x256", 256, true } };
+    const std::vector<Candidate> weightKernels = { { "thread x32", 32, false }, { "thread x64", 64, false }, { "thread x256", 256, false } };
+
+    denseVariants[forwardT] = { { "original", 1, false, Activation } };
+    denseVariants[backPropT] = { { "original", 1, false, ErrorBackPropogate } };
+    denseVariants[updateT] = { { "original", 1, false, WeightUpdate } };
+
+    const char* codes[tunedKernels] = { DenseActivation_code, DenseBackPropogate_code, DenseWeightUpdate_code };
+    for(int k = forwardT; k < tunedKernels; k++)
+        for(const Candidate& c: k == updateT ? weightKernels : neuronKernels)
+        {
+            std::string defines = "#define WORK_GROUP " + std::to_string(c.workGroup) + "\n#define COOPERATIVE " + (c.cooperative ? "1" : "0") + "\n";
+            unsigned int program = buildKernel(codes[k], k != updateT, defines);
+            if(!program)
+                return false;
+            denseVariants[k].push_back({ c.name, c.workGroup, c.cooperative, program });
+        }
+    return true;
+}
+
+unsigned int HermesNetwork::shapedKernel(tunedKernel Kernel, int Variant, int PrevSize, int Size, const KernelVariant*& Used)
+{
+    if(!specializeShapes)
+        return 0;
+    if(Variant == 0)
+        Variant = 2;
+    Used = &denseVariants[Kernel][Variant];
+
+    std::array<int, 4> key = { Kernel, Variant, PrevSize, Size };
+    auto it = shapedKernels.find(key);
+    if(it != shapedKernels.end())
+        return it->second;
+
+    std::string defines = "#define WORK_GROUP " + std::to_string(Used->workGroup) + "\n#define COOPERATIVE " + (Used->cooperative ? "1" : "0") +
+                          "\n#define PREV_SIZE " + std::to_string(PrevSize) + "\n#define LAYER_SIZE " + std::to_string(Size) + "\n";
+    const char* codes[tunedKernels] = { DenseActivation_code, DenseBackPropogate_code, DenseWeightUpdate_code };
+    unsigned int program = buildKernel(codes[Kernel], Kernel != updateT, defines);
+    shapedKernels[key] = program;
+    return program;
+}
+
+HermesNetwork::TunedShape HermesNetwork::tuneShape(int PrevSize, int Size)
+{
+    /* throwaway pair of layers with random neurons, errors and small weights */
+    std::vector<float> prevData(4 * PrevSize), layerData(4 * Size), weights((PrevSize + 1) * Size);
+    for(float& v: prevData)
+        v = (float)rand() / RAND_MAX;
+    for(float& v: layerData)
+        v = (float)rand() / RAND_MAX;
+    for(float& w: weights)
+        w = 0.1f * (2.0f * rand() / RAND_MAX - 1.0f);
+
+    LayerHandle prev, next;
+    prev.type = hiddenL;
+    prev.no_neuron = PrevSize;
+    prev.NeuronsTex = createDataTexture(PrevSize, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT, prevData.data());
+    prev.next = &next;
+    next.type = outputL;
+    next.no_neuron = Size;
+    next.no_weight = weights.size();
+    next.NeuronsTex = createDataTexture(Size, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT, layerData.data());
+    next.WeightsTex = createDataTexture(next.no_weight, 1, GL_RGBA32F, GL_RED, GL_FLOAT, weights.data());
+    next.prev = &prev;
+
+    /* enough repeats to time small shapes, tiny learning rate keeps weights from drifting.
+       Timed on host up to glFinish(), as timer queries of some drivers (llvmpipe) don't measure compute work */
+    int repeats = std::max(3, std::min(50, (int)(2000000 / next.no_weight)));
+    float learningRate = 1e-6f;
+
+    TunedShape best;
+    for(int k = forwardT; k < tunedKernels; k++)
+    {
+        double fastest = -1;
+        best.variant[k] = 0;
+        for(int v = 0; v < (int)denseVariants[k].size(); v++)
+        {
+            next.tuned[k] = v;
+            auto run = [&]()
+            {
+                if(k == forwardT)
+                    triggerLayer(&next);
+                else if(k == backPropT)
+                    backPropogateError(&prev);
+                else
+                    trainLayer(&next, &learningRate);
+            };
+            run();
+            glFinish();
+
+            /* best of 3 rounds, so a preempted round doesn't decide */
+            for(int round = 0; round < 3; round++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                for(int r = 0; r < repeats; r++)
+                    run();
+                glFinish();
+                double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                if(fastest < 0 || ns < fastest)
+                {
+                    fastest = ns;
+                    best.variant[k] = v;
+                }
+            }
+        }
+        next.tuned[k] = 0;
+    }
+
+    unsigned int textures[3] = { prev.NeuronsTex, next.NeuronsTex, next.WeightsTex };
+    glDeleteTextures(3, textures);
+    return best;
+}
+
+void HermesNetwork::autotuneNetwork(NeuralNetwork Network)
+{
+    bool measured = false;
+    for(Layer L = Network->inputLayer->next; L != nullptr; L = L->next)
+    {
+        if(L->kind != denseK)
+            continue;
+        std::pair<int, int> shape(L->prev->no_neuron, L->no_neuron);
+        auto it = tunedShapes.find(shape);
+        if(it == tunedShapes.end())
+        {
+            it = tunedShapes.insert(std::make_pair(shape, tuneShape(shape.first, shape.second))).first;
+            measured = true;
+        }
+        for(int k = forwardT; k < tunedKernels; k++)
+            L->tuned[k] = it->second.variant[k];
+    }
+    if(measured && !tuningCachePath.empty())
+        saveTuningCache();
+}
+
+void HermesNetwork::loadTuningCache()
+{
+    /*
+     *  FILE STRUCTURE (text)
+     *
+     *  TuningCacheHeader
+     *  renderer <tab> previous layer size, layer size, forward, backpropagation, update variant
+     *  :
+     */
+    std::ifstream file(tuningCachePath);
+    std::string line, renderer = (const char*)glGetString(GL_RENDERER);
+    if(!std::getline(file, line) || line != TuningCacheHeader)
+        return;
+    while(std::getline(file, line))
+    {
+        size_t tab = line.find('\t');
+        if(tab == std::string::npos || line.compare(0, tab, renderer) != 0 || tab != renderer.size())
+            continue;
+        int prev, size;
+        TunedShape t;
+        if(std::sscanf(line.c_str() + tab + 1, "%d %d %d %d %d", &prev, &size, &t.variant[forwardT], &t.variant[backPropT], &t.variant[updateT]) != 5)
+            continue;
+        bool valid = true;
+        for(int k = forwardT; k < tunedKernels; k++)
+            valid &= t.variant[k] >= 0 && t.variant[k] < (int)denseVariants[k].size();
+        if(valid)
+            tunedShapes[std::make_pair(prev, size)] = t;
+    }
+}
+
+bool HermesNetwork::saveTuningCache()
+{
+    std::string line, renderer = (const char*)glGetString(GL_RENDERER);
+    std::vector<std::string> others;
+    {
+        std::ifstream file(tuningCachePath);
+        if(std::getline(file, line) && line == TuningCacheHeader)
+            while(std::getline(file, line))
+                if(line.compare(0, renderer.size() + 1, renderer + '\t') != 0)
+                    others.push_back(line);
+    }
+
+    std::ofstream file(tuningCachePath, std::ios::out | std::ios::trunc);
+    if(!file.is_open())
+        return false;
+    file << TuningCacheHeader << "\n";
+    for(const std::string& other: others)
+        file << other << "\n";
+    for(const auto& shape: tunedShapes)
+        file << renderer << "\t" << shape.first.first << " " << shape.first.second << " " << shape.second.variant[forwardT]
+             << " " << shape.second.variant[backPropT] << " " << shape.second.variant[updateT] << "\n";
+    return file.good();
+}
+
+void HermesNetwork::quantizeLayer(Layer Lyr)
+{
+    int packedRow = (Lyr->prev->no_neuron + 3) / 4;
+
+    /* int8 textures are created once and reused on re-quantization */
+    if(!Lyr->QWeightsTex)
+    {
+        Lyr->QWeightsTex = createDataTexture(Lyr->no_neuron * packedRow, 1, GL_R32I, GL_RED_INTEGER, GL_INT, NULL);
+        Lyr->QScaleTex = createDataTexture(Lyr->no_neuron, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+    }
+    if(!Lyr->prev->QNeuronsTex)
+        Lyr->prev->QNeuronsTex = createDataTexture(packedRow, 1, GL_R32I, GL_RED_INTEGER, GL_INT, NULL);
+
+    glBindImageTexture(QWGHT_unifm_weight_TEX, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(QWGHT_unifm_qweight_TEX, Lyr->QWeightsTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32I);
+    glBindImageTexture(QWGHT_unifm_scale_TEX, Lyr->QScaleTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+    glUseProgram(QuantizeWeights);
+
+    glUniform1i(QWGHT_unifm_prev_size, Lyr->prev->no_neuron);
+    glUniform1i(QWGHT_unifm_packed_size, packedRow);
+    dispatchCompute(Lyr->no_neuron,1,1);
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+    Lyr->int8 = true;
+}
+
+void HermesNetwork::quantizeLayerNeurons(Layer Lyr)
+{
+    glBindImageTexture(QNRN_unifm_neuron_TEX, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(QNRN_unifm_qneuron_TEX, Lyr->QNeuronsTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32I);
+
+    glUseProgram(QuantizeNeurons);
+
+    glUniform1i(QNRN_unifm_Layer_size, Lyr->no_neuron);
+    glUniform1f(QNRN_unifm_act_scale, Lyr->ActScale);
+    dispatchCompute((Lyr->no_neuron + 3) / 4,1,1);
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+void HermesNetwork::appendConvolutionLayer(NeuralNetwork Network, int Channels, int KernelSize, int Stride, int Padding)
+{
+    Layer prev = Network->outputLayer->prev;
+    int width = (prev->width + 2 * Padding - KernelSize) / Stride + 1;
+    int height = (prev->height + 2 * Padding - KernelSize) / Stride + 1;
+
+    appendHiddenLayer(Network, width * height * Channels);
+    Layer conv = Network->outputLayer->prev;
+    conv->kind = convolutionK;
+    conv->width = width;
+    conv->height = height;
+    conv->channels = Channels;
+    conv->kernel = KernelSize;
+    conv->stride = Stride;
+    conv->padding = Padding;
+}
+
+void HermesNetwork::appendPoolingLayer(NeuralNetwork Network, int KernelSize, int Stride)
+{
+    Layer prev = Network->outputLayer->prev;
+    int width = (prev->width - KernelSize) / Stride + 1;
+    int height = (prev->height - KernelSize) / Stride + 1;
+
+    appendHiddenLayer(Network, width * height * prev->channels);
+    Layer pool = Network->outputLayer->prev;
+    pool->kind = poolingK;
+    pool->width = width;
+    pool->height = height;
+    pool->channels = prev->channels;
+    pool->kernel = KernelSize;
+    pool->stride = Stride;
+    pool->AFun = Linear;    // pooling passes values and errors through unchanged
+}
+
+void HermesNetwork::setImageUniforms(Layer Lyr)
+{
+    glUniform3i(IMG_unifm_in_shape, Lyr->prev->width, Lyr->prev->height, Lyr->prev->channels);
+    glUniform3i(IMG_unifm_out_shape, Lyr->width, Lyr->height, Lyr->channels);
+    glUniform3i(IMG_unifm_window, Lyr->kernel, Lyr->stride, Lyr->padding);
+}
+
+void HermesNetwork::softmaxLayer(Layer Lyr, float* ActualOutput)
+{
+    if(ActualOutput)
+    {
+        glBindTexture(GL_TEXTURE_2D, TempTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, Lyr->no_neuron, 1, 0, GL_RED, GL_FLOAT, ActualOutput);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        countUpload(sizeof(float) * Lyr->no_neuron);
+        glBindImageTexture(SMAX_unifm_actualOut_TEX, TempTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    }
+    glBindImageTexture(SMAX_unifm_neuronOut_TEX, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+
+    glUseProgram(Softmax_CE);
+
+    glUniform1i(SMAX_unifm_Layer_size, Lyr->no_neuron);
+    glUniform1i(SMAX_unifm_with_target, ActualOutput != nullptr);
+    /* single work group, max and sum are reduced in shared memory */
+    dispatchCompute(1,1,1);
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+void HermesNetwork::uploadSparseLayer(Layer Lyr, int nnz, const int* rowPtr, const int* colIndex, const float* values)
+{
+    Lyr->weightVersion++;
+    /* transpose CSR into CSC so backpropagation can gather instead of scatter */
+    int prevSize = Lyr->prev->no_neuron;
+    std::vector<int> colPtr(prevSize + 1, 0);
+    std::vector<int> cscEntry(std::max(nnz, 1) * 2);
+    for(int k = 0; k < nnz; k++)
+        colPtr[colIndex[k] + 1]++;
+    for(int j = 0; j < prevSize; j++)
+        colPtr[j + 1] += colPtr[j];
+    std::vector<int> fill(colPtr.begin(), colPtr.end() - 1);
+    for(int n = 0; n < Lyr->no_neuron; n++)
+        for(int k = rowPtr[n]; k < rowPtr[n + 1]; k++)
+        {
+            int slot = fill[colIndex[k]]++;
+            cscEntry[slot * 2] = n;
+            cscEntry[slot * 2 + 1] = k;
+        }
+
+    if(Lyr->WeightsTex > 0)
+        glDeleteTextures(1, &Lyr->WeightsTex);
+    freeSparseIndex(Lyr);
+
+    /* a layer without any stored weight still needs valid (1 texel) index textures */
+    Lyr->WeightsTex = createDataTexture(nnz + Lyr->no_neuron, 1, GL_R32F, GL_RED, GL_FLOAT, values);
+    Lyr->RowPtrTex = createDataTexture(Lyr->no_neuron + 1, 1, GL_R32I, GL_RED_INTEGER, GL_INT, rowPtr);
+    Lyr->ColIndexTex = createDataTexture(std::max(nnz, 1), 1, GL_R32I, GL_RED_INTEGER, GL_INT, nnz ? colIndex : cscEntry.data());
+    Lyr->ColPtrTex = createDataTexture(prevSize + 1, 1, GL_R32I, GL_RED_INTEGER, GL_INT, colPtr.data());
+    Lyr->CscEntryTex = createDataTexture(std::max(nnz, 1), 1, GL_RG32I, GL_RG_INTEGER, GL_INT, cscEntry.data());
+    Lyr->kind = sparseK;
+    Lyr->nnz = nnz;
+    Lyr->no_weight = nnz + Lyr->no_neuron;
+}
+
+int HermesNetwork::sparsifyLayer(Layer Lyr, float Threshold)
+{
+    if(Lyr->kind != denseK)
+        return Lyr->kind == sparseK ? Lyr->nnz : 0;
+
+    fetchLayerWeights_Bias(Lyr);
+    int rowSize = Lyr->prev->no_neuron + 1;
+    std::vector<int> rowPtr(Lyr->no_neuron + 1, 0), colIndex;
+    std::vector<float> values, bias(Lyr->no_neuron);
+    for(int n = 0; n < Lyr->no_neuron; n++)
+    {
+        for(int j = 0; j < rowSize - 1; j++)
+        {
+            float w = Lyr->weights[n * rowSize + j];
+            if(std::abs(w) > Threshold)
+            {
+                colIndex.push_back(j);
+                values.push_back(w);
+            }
+        }
+        bias[n] = Lyr->weights[n * rowSize + rowSize - 1];
+        rowPtr[n + 1] = colIndex.size();
+    }
+    delete[] Lyr->weights;
+    Lyr->weights = nullptr;
+    values.insert(values.end(), bias.begin(), bias.end());
+
+    /* int8 copy of dense weights is no longer valid */
+    unsigned int qTex[2] = { Lyr->QWeightsTex, Lyr->QScaleTex };
+    glDeleteTextures(2, qTex);
+    Lyr->QWeightsTex = Lyr->QScaleTex = 0;
+    Lyr->int8 = false;
+
+    uploadSparseLayer(Lyr, colIndex.size(), rowPtr.data(), colIndex.data(), values.data());
+    return Lyr->nnz;
+}
+
+bool HermesNetwork::batchSupported(NeuralNetwork Network)
+{
+    for(Layer L = Network->inputLayer->next; L != nullptr; L = L->next)
+        if(L->kind != denseK || L->int8)
+            return false;
+    return Network->outputLayer->AFun != Softmax;
+}
+
+bool HermesNetwork::reserveBatch(NeuralNetwork Network, int Rows)
+{
+    GLint maxRows = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxRows);
+    if(Rows < 1 || Rows > maxRows)
+        return false;
+    if(Rows <= Network->batchRows)
+        return true;
+    for(Layer L = Network->inputLayer; L != nullptr; L = L->next)
+    {
+        glDeleteTextures(1, &L->BatchTex);
+        L->BatchTex = createDataTexture(L->no_neuron, Rows, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+    }
+    glDeleteTextures(1, &Network->BatchTargetTex);
+    Network->BatchTargetTex = createDataTexture(Network->outputLayer->no_neuron, Rows, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+    Network->batchRows = Rows;
+    return true;
+}
+
+void HermesNetwork::triggerBatch(NeuralNetwork Network, int Rows)
+{
+    glUseProgram(BatchActivation);
+    glUniform1i(BATCH_unifm_rows, Rows);
+    for(Layer L = Network->inputLayer->next; L != nullptr; L = L->next)
+    {
+        ProfileScope scope(L, forwardP);
+        glBindImageTexture(0, L->BatchTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        glBindImageTexture(1, L->prev->BatchTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, L->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glUniform1i(ACTVLibs_unifm_SEL, L->AFun);
+        glUniform1i(BATCH_unifm_prev_size, L->prev->no_neuron);
+        dispatchCompute((Rows + 63) / 64, L->no_neuron, 1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+}
+
+void HermesNetwork::trainBatch(NeuralNetwork Network, int Rows, float LearningRate)
+{
+    Layer out = Network->outputLayer;
+    {
+        ProfileScope scope(out, errorP);
+        glUseProgram(BatchError);
+        glBindImageTexture(0, out->BatchTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Network->BatchTargetTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glUniform1i(ACTVLibs_unifm_SEL, out->AFun);
+        glUniform1i(BATCH_unifm_rows, Rows);
+        dispatchCompute((Rows + 63) / 64, out->no_neuron, 1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    glUseProgram(BatchBackPropogate);
+    glUniform1i(BATCH_unifm_rows, Rows);
+    for(Layer L = out->prev; L != Network->inputLayer; L = L->prev)
+    {
+        ProfileScope scope(L, backPropP);
+        glBindImageTexture(0, L->BatchTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, L->next->BatchTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, L->next->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glUniform1i(ACTVLibs_unifm_SEL, L->AFun);
+        glUniform1i(BATCH_unifm_Layer_size, L->no_neuron);
+        glUniform1i(BATCH_unifm_next_size, L->next->no_neuron);
+        dispatchCompute((Rows + 63) / 64, L->no_neuron, 1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    /* errors of every layer are ready before any weight they went through changes */
+    glUseProgram(BatchWeightUpdate);
+    glUniform1i(BATCH_unifm_rows, Rows);
+    glUniform1f(BATCH_unifm_LearnRT, LearningRate);
+    glBindImageTexture(3, Network->BatchTargetTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    for(Layer L = Network->inputLayer->next; L != nullptr; L = L->next)
+    {
+        ProfileScope scope(L, updateP);
+        glBindImageTexture(0, L->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, L->BatchTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, L->prev->BatchTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glUniform1i(BATCH_unifm_prev_size, L->prev->no_neuron);
+        glUniform1i(BATCH_unifm_Layer_size, L->no_neuron);
+        dispatchCompute((L->no_weight + 63) / 64, 1, 1);
+        L->weightVersion++;
+    }
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+void HermesNetwork::storeReplayRows(ReplayBuffer Buffer, unsigned int Source, unsigned int Ring, int Width, int Rows)
+{
+    glUseProgram(ReplayStore);
+    glBindImageTexture(0, Source, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(1, Ring, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glUniform1i(RPLY_unifm_rows, Rows);
+    glUniform1i(RPLY_unifm_input_size, Width);
+    glUniform1i(RPLY_unifm_head, Buffer->head);
+    glUniform1i(RPLY_unifm_capacity, Buffer->capacity);
+    dispatchCompute((Width + 63) / 64, Rows, 1);
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+}
+
+void HermesNetwork::writeReplayPriorities(ReplayBuffer Buffer, int Rows, float Priority)
+{
+    glBindTexture(GL_TEXTURE_2D, Buffer->PriorityTex);
+    for(int done = 0; done < Rows; )
+    {
+        int row = (Buffer->head + done) % Buffer->capacity;
+        int n = std::min(Rows - done, Buffer->capacity - row);
+        std::vector<float> leaves(n, Priority);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, row, 1, n, 1, GL_RED, GL_FLOAT, leaves.data());
+        countUpload(sizeof(float) * n);
+        done += n;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    Buffer->treeDirty = true;
+}
+
+void HermesNetwork::buildReplayTree(ReplayBuffer Buffer)
+{
+    glUseProgram(ReplayTreeLevel);
+    glBindImageTexture(0, Buffer->PriorityTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
+    glUniform1i(RPLY_unifm_leaves, Buffer->leaves);
+    /* level by level from just above leaves, each reads sums of the one below */
+    for(int begin = Buffer->leaves / 2; begin >= 1; begin /= 2)
+    {
+        glUniform1i(RPLY_unifm_begin, begin);
+        dispatchCompute((begin + 63) / 64, 1, 1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+    Buffer->treeDirty = false;
+}
+
+bool HermesNetwork::hostSupported(NeuralNetwork Network)
+{
+    if(Network->netType != feedForward || Network->quantized || Network->batchSize > 0)
+        return false;
+    for(Layer L = Network->inputLayer->next; L != nullptr; L = L->next)
+        if(L->kind != denseK || L->int8)
+            return false;
+    return true;
+}
+
+void HermesNetwork::placeNetwork(NeuralNetwork Network, bool OnHost)
+{
+    if(Network->inputLayer->onHost == OnHost)
+        return;
+    useNetwork(Network);
+    if(OnHost && Network->inputLayer->activeInputs > 0)
+        scatterActiveInputs(Network->inputLayer);
+    memoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+    for(Layer L = Network->inputLayer; L != nullptr; L = L->next)
+    {
+        /* activation is red and error blue of neurons, weight red of weights, other channels are kept as they are */
+        std::vector<float> rgba(4 * std::max(L->no_neuron, L->no_weight));
+        glBindTexture(GL_TEXTURE_2D, L->NeuronsTex);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, rgba.data());
+        countReadback(sizeof(float) * 4 * L->no_neuron);
+        if(OnHost)
+        {
+            L->hostNeurons.resize(L->no_neuron);
+            L->hostErrors.resize(L->no_neuron);
+            for(int n = 0; n < L->no_neuron; n++)
+            {
+                L->hostNeurons[n] = rgba[4 * n];
+                L->hostErrors[n] = rgba[4 * n + 2];
+            }
+        }
+        else
+        {
+            for(int n = 0; n < L->no_neuron; n++)
+            {
+                rgba[4 * n] = L->hostNeurons[n];
+                rgba[4 * n + 2] = L->hostErrors[n];
+            }
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, L->no_neuron, 1, GL_RGBA, GL_FLOAT, rgba.data());
+            countUpload(sizeof(float) * 4 * L->no_neuron);
+        }
+
+        if(L->WeightsTex)
+        {
+            glBindTexture(GL_TEXTURE_2D, L->WeightsTex);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, rgba.data());
+            countReadback(sizeof(float) * 4 * L->no_weight);
+            if(OnHost)
+            {
+                L->hostWeights.resize(L->no_weight);
+                for(int w = 0; w < L->no_weight; w++)
+                    L->hostWeights[w] = rgba[4 * w];
+            }
+            else
+            {
+                for(int w = 0; w < L->no_weight; w++)
+                    rgba[4 * w] = L->hostWeights[w];
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, L->no_weight, 1, GL_RGBA, GL_FLOAT, rgba.data());
+                countUpload(sizeof(float) * 4 * L->no_weight);
+            }
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        if(!OnHost)
+        {
+            std::vector<float>().swap(L->hostNeurons);
+            std::vector<float>().swap(L->hostErrors);
+            std::vector<float>().swap(L->hostWeights);
+        }
+        L->onHost = OnHost;
+        L->neuronVersion++;
+        L->weightVersion++;
+    }
+}
+
+void HermesNetwork::requireDevice(NeuralNetwork Network)
+{
+    useNetwork(Network);
+    if(Network->inputLayer->onHost)
+        placeNetwork(Network, false);
+}
+
+double HermesNetwork::estimateStep(NeuralNetwork Network, bool OnHost)
+{
+    /* every weight is used by forward pass, backpropagation and update, 2 flops each time */
+    double weights = 0;
+    int layers = 0;
+    for(Layer L = Network->inputLayer->next; L != nullptr; L = L->next)
+    {
+        weights += L->no_weight;
+        layers++;
+    }
+    if(OnHost)
+        return 6 * weights / cpuFlopRate;
+
+    /* forward, backpropagation and update dispatch of every layer and output error, inputs and targets uploaded, outputs read back */
+    return (3 * layers + 1) * dispatchCost + 2 * uploadCost + readbackCost + 6 * weights / gpuFlopRate;
+}
+
+void HermesNetwork::deleteNetwork(NeuralNetwork Network)
+{
+    /* async calls on Network finish first, they copy outputs into it. Waiting for its last one finishes every one before */
+    while(true)
+    {
+        auto job = std::find_if(asyncJobs.rbegin(), asyncJobs.rend(), [Network](const std::shared_ptr<AsyncState>& J) { return J->network == Network; });
+        if(job == asyncJobs.rend())
+            break;
+        std::shared_ptr<AsyncState> last = *job;
+        pollAsync(last.get());
+    }
+
+    for(unsigned int* tex: networkTextures(Network))
+        glDeleteTextures(1, tex);
+    if(Network->paged)
+        for(const PagedTexture& t: Network->pagedTextures)
+            pagedBytes -= t.pixels.size();
+    else if(Network->residentBytes > 0)
+        residentBytes -= Network->residentBytes;
+
+    Layer L = Network->inputLayer;
+    while(L != nullptr)
+    {
+        dropLayerSnapshots(L);
+        for(auto it = profileStats.begin(); it != profileStats.end();)
+            it = it->first.first == L ? profileStats.erase(it) : std::next(it);
+        delete[] L->data;
+        delete[] L->weights;
+        Layer next = L->next;
+        delete L;
+        L = next;
+    }
+    recordIds.erase(Network);
+    networks.erase(std::remove(networks.begin(), networks.end(), Network), networks.end());
+    delete Network;
+}
+
+void HermesNetwork::scatterActiveInputs(Layer Lyr)
+{
+    glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glBindImageTexture(1, Lyr->ActiveInputTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+    glUseProgram(SparseInputScatter);
+
+    glUniform1i(SPRS_unifm_Layer_size, Lyr->no_neuron);
+    glUniform1i(SPRS_unifm_nnz, Lyr->activeInputs);
+    glUniform1i(SPRS_unifm_mode, 0);
+    dispatchCompute((Lyr->no_neuron + 63) / 64,1,1);
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    glUniform1i(SPRS_unifm_mode, 1);
+    dispatchCompute((Lyr->activeInputs + 63) / 64,1,1);
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    Lyr->activeInputs = 0;
+}
+
+void HermesNetwork::appendRecurrentLayer(NeuralNetwork Network, int LayerSize, int Cell, int Window)
+{
+    appendHiddenLayer(Network, LayerSize);
+    Layer rnn = Network->outputLayer->prev;
+    rnn->kind = recurrentK;
+    rnn->cell = Cell;
+    rnn->window = std::max(Window, 1);
+    rnn->AFun = Linear;     // gates have fixed activations, error from next layer is taken as is
+}
+
+void HermesNetwork::setRecurrentUniforms(Layer Lyr, int Step)
+{
+    glUniform4i(RNN_unifm_shape, Lyr->prev->no_neuron, Lyr->no_neuron, Lyr->cell, Lyr->window + 1);
+    glUniform1i(RNN_unifm_step, Step);
+}
+
+void HermesNetwork::unrollRecurrentError(Layer Lyr)
+{
+    ProfileScope scope(Lyr, backPropP);
+    /* walk back from latest step: gate errors of a step, then error of h (and c) of the step before it */
+    Lyr->unrolled = std::min(Lyr->step, Lyr->window);
+    for(int s = 0; s < Lyr->unrolled; s++)
+    {
+        int k = Lyr->step - 1 - s;
+        glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->DeltaTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->StateHistTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(3, Lyr->GradHistTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        glBindImageTexture(4, Lyr->ErrHistTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+        glUseProgram(RecurrentGateGrad);
+
+        setRecurrentUniforms(Lyr, k);
+        glUniform1i(RNN_unifm_first, s == 0);
+        glUniform1i(RNN_unifm_external, Lyr->next->kind == recurrentK);
+        dispatchCompute((Lyr->no_neuron + 63) / 64,1,1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        if(s == Lyr->unrolled - 1)
+            break;
+
+        glBindImageTexture(0, Lyr->DeltaTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+        glBindImageTexture(1, Lyr->GradHistTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+
+        glUseProgram(RecurrentHiddenGrad);
+
+        setRecurrentUniforms(Lyr, k);
+        dispatchCompute((Lyr->no_neuron + 63) / 64,1,1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+}
+
+void HermesNetwork::appendAttentionLayer(NeuralNetwork Network, int Tokens, int Heads)
+{
+    appendHiddenLayer(Network, Network->outputLayer->prev->no_neuron);
+    Layer attn = Network->outputLayer->prev;
+    attn->kind = attentionK;
+    attn->tokens = Tokens;
+    attn->heads = Heads;
+    attn->AFun = Linear;
+}
+
+void HermesNetwork::attentionBackward(Layer Lyr)
+{
+    ProfileScope scope(Lyr, backPropP);
+    int D = Lyr->no_neuron / Lyr->tokens;
+
+    /* layer error back through Wo gives error of each head's output */
+    glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+    glBindImageTexture(1, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(2, Lyr->AttnGradTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+    glUseProgram(AttentionBackProject);
+
+    glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
+    glUniform3i(ATTN_unifm_shape, Lyr->tokens, D, Lyr->heads);
+    glUniform1i(ATTN_unifm_mode, 0);
+    dispatchCompute((D + 63) / 64, Lyr->tokens, 1);
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    /* query errors walk key tiles, key & value errors walk query tiles */
+    glBindImageTexture(0, Lyr->QKVTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(1, Lyr->AttnTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(2, Lyr->AttnGradTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(3, Lyr->AttnStatTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(4, Lyr->QKVGradTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+    glUseProgram(AttentionBackQuery);
+
+    glUniform3i(ATTN_unifm_shape, Lyr->tokens, D, Lyr->heads);
+    dispatchCompute((Lyr->tokens + 31) / 32, Lyr->heads, 1);
+
+    glUseProgram(AttentionBackKeyValue);
+
+    glUniform3i(ATTN_unifm_shape, Lyr->tokens, D, Lyr->heads);
+    dispatchCompute((Lyr->tokens + 31) / 32, Lyr->heads, 1);
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+void HermesNetwork::accumulateNeuronStats(Layer Lyr, unsigned int StatsTex)
+{
+    glBindImageTexture(STAT_unifm_neuronOut_TEX, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(STAT_unifm_stats_TEX, StatsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+
+    glUseProgram(NeuronStats);
+
+    glUniform1i(STAT_unifm_Layer_size, Lyr->no_neuron);
+    dispatchCompute((Lyr->no_neuron + 63) / 64,1,1);
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+void HermesNetwork::outgoingWeightNorm(Layer Lyr, unsigned int StatsTex)
+{
+    glBindImageTexture(NORM_unifm_next_weight_TEX, Lyr->next->WeightsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(NORM_unifm_stats_TEX, StatsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+
+    glUseProgram(OutgoingNorm);
+
+    glUniform1i(NORM_unifm_Layer_size, Lyr->no_neuron);
+    glUniform1i(NORM_unifm_next_size, Lyr->next->no_neuron);
+    dispatchCompute((Lyr->no_neuron + 63) / 64,1,1);
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+}
+
+void HermesNetwork::compactLayer(Layer Lyr, const std::vector<int>& keep, const std::vector<float>& foldValue)
+{
+    Layer next = Lyr->next;
+    int rowSize = Lyr->prev->no_neuron + 1;
+    int oldSize = Lyr->no_neuron, newSize = keep.size();
+
+    /* drop rows of removed neurons */
+    fetchLayerWeights_Bias(Lyr);
+    std::vector<float> weights(newSize * rowSize);
+    for(int i = 0; i < newSize; i++)
+        std::copy(Lyr->weights + keep[i] * rowSize, Lyr->weights + (keep[i] + 1) * rowSize, &weights[i * rowSize]);
+    delete[] Lyr->weights;
+    Lyr->weights = nullptr;
+
+    /* drop columns of removed neurons from next layer, folding their constant output into bias */
+    fetchLayerWeights_Bias(next);
+    std::vector<float> nextWeights(next->no_neuron * (newSize + 1));
+    for(int m = 0; m < next->no_neuron; m++)
+    {
+        float *row = next->weights + m * (oldSize + 1);
+        float bias = row[oldSize];
+        for(int n = 0, i = 0; n < oldSize; n++)
+        {
+            if(i < newSize && keep[i] == n)
+                nextWeights[m * (newSize + 1) + i++] = row[n];
+            else if(!foldValue.empty())
+                bias += foldValue[n] * row[n];
+        }
+        nextWeights[m * (newSize + 1) + newSize] = bias;
+    }
+    delete[] next->weights;
+    next->weights = nullptr;
+
+    /* int8 data was built for old sizes */
+    unsigned int qTex[5] = { Lyr->QWeightsTex, Lyr->QScaleTex, Lyr->QNeuronsTex, next->QWeightsTex, next->QScaleTex };
+    glDeleteTextures(5, qTex);
+    Lyr->QWeightsTex = Lyr->QScaleTex = Lyr->QNeuronsTex = next->QWeightsTex = next->QScaleTex = 0;
+    Lyr->int8 = next->int8 = false;
+
+    delete[] Lyr->data;
+    Lyr->data = nullptr;
+    Lyr->no_neuron = newSize;
+    Lyr->no_weight = weights.size();
+    next->no_weight = nextWeights.size();
+
+    glBindTexture(GL_TEXTURE_2D, Lyr->NeuronsTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, Lyr->no_neuron, 1, 0, GL_RGBA, GL_FLOAT, NULL);
+    glBindTexture(GL_TEXTURE_2D, Lyr->WeightsTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, Lyr->no_weight, 1, 0, GL_RED, GL_FLOAT, weights.data());
+    glBindTexture(GL_TEXTURE_2D, next->WeightsTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, next->no_weight, 1, 0, GL_RED, GL_FLOAT, nextWeights.data());
+
+    /* batch texture keeps its rows at new width */
+    if(Lyr->BatchTex)
+    {
+        GLint rows = 0;
+        glBindTexture(GL_TEXTURE_2D, Lyr->BatchTex);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &rows);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, Lyr->no_neuron, rows, 0, GL_RGBA, GL_FLOAT, NULL);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    Lyr->neuronVersion++;
+    Lyr->weightVersion++;
+    next->weightVersion++;
+}
+
+HermesNetwork::ProfileScope::ProfileScope(Layer Lyr, profilePhase Phase)
+{
+    if(profileDepth++ > 0)
+        return;
+    outermost = true;
+    phase = Phase;
+    profileLayer = Lyr;
+    if(tracing.load(std::memory_order_relaxed))
+        start = traceClock();
+    if(!profiling)
+        return;
+    collectProfileQueries(false);
+    if(profilePending == ProfileRingSize)
+        collectProfileQueries(true);
+    ProfileQuery& q = profileRing[(profileHead + profilePending) % ProfileRingSize];
+    q.Lyr = Lyr;
+    q.phase = Phase;
+    glQueryCounter(q.begin, GL_TIMESTAMP);
+    timed = true;
+}
+
+HermesNetwork::ProfileScope::~ProfileScope()
+{
+    profileDepth--;
+    if(!outermost)
+        return;
+    if(tracing.load(std::memory_order_relaxed))
+    {
+        static const char* names[] = { "forward", "error", "backpropagation", "weight update", "upload", "readback" };
+        long long now = traceClock();
+        traceEvent(names[phase], "layer", 'X', start, now - start, -1, profileLayer, nullptr);
+    }
+    profileLayer = nullptr;
+    if(timed && profiling)
+    {
+        glQueryCounter(profileRing[(profileHead + profilePending) % ProfileRingSize].end, GL_TIMESTAMP);
+        profilePending++;
+    }
+}
+
+HermesNetwork::TraceScope::TraceScope(const char* Name) : name(Name)
+{
+    if(tracing.load(std::memory_order_relaxed))
+        start = traceClock();
+}
+
+HermesNetwork::TraceScope::~TraceScope()
+{
+    if(start >= 0 && tracing.load(std::memory_order_relaxed))
+        traceEvent(name, "api", 'X', start, traceClock() - start, -1, nullptr, nullptr);
+}
+
+void HermesNetwork::dispatchCompute(unsigned int X, unsigned int Y, unsigned int Z)
+{
+    glDispatchCompute(X, Y, Z);
+    statDispatches.fetch_add(1, std::memory_order_relaxed);
+    if(tracing.load(std::memory_order_relaxed))
+    {
+        unsigned int grid[3] = { X, Y, Z };
+        traceEvent("dispatch", "gpu command", 'i', traceClock(), 0, -1, profileLayer, grid);
+    }
+}
+
+void HermesNetwork::memoryBarrier(GLbitfield Barriers)
+{
+    glMemoryBarrier(Barriers);
+    statBarriers.fetch_add(1, std::memory_order_relaxed);
+    if(tracing.load(std::memory_order_relaxed))
+        traceEvent("barrier", "gpu command", 'i', traceClock(), 0, -1, profileLayer, nullptr);
+}
+
+long long HermesNetwork::traceClock()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceOrigin).count();
+}
+
+void HermesNetwork::traceEvent(const char* Name, const char* Category, char Ph, long long Ts, long long Dur, int Tid, Layer Lyr, const unsigned int* Grid)
+{
+    long long slot = traceNext.fetch_add(1, std::memory_order_relaxed);
+    if(slot >= (long long)traceEvents.size())
+        return;
+    if(Tid < 0)
+    {
+        /* host threads get small ids in order of their first event */
+        thread_local int threadId = traceThreads.fetch_add(1, std::memory_order_relaxed) + 1;
+        Tid = threadId;
+    }
+    TraceEvent& e = traceEvents[slot];
+    e.name = Name;
+    e.category = Category;
+    e.ph = Ph;
+    e.tid = Tid;
+    e.ts = Ts;
+    e.dur = Dur;
+    e.layer = -1;
+    for(Layer L = Lyr; L != nullptr; L = L->prev)
+        e.layer++;
+    for(int k = 0; k < 3; k++)
+        e.grid[k] = Grid ? Grid[k] : 0;
+}
+
+void HermesNetwork::LatencyHistogram::record(long long Ns)
+{
+    unsigned long long v = Ns > 0 ? Ns : 0;
+    int shift = 0;
+    while((v >> shift) >= 32)
+        shift++;
+    int index = std::min((int)(shift * 16 + (v >> shift)), Buckets - 1);
+    bucket[index].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(v, std::memory_order_relaxed);
+    long long top = max.load(std::memory_order_relaxed);
+    while((long long)v > top && !max.compare_exchange_weak(top, v, std::memory_order_relaxed));
+}
+
+double HermesNetwork::LatencyHistogram::percentile(double P) const
+{
+    long long n = count.load(std::memory_order_relaxed);
+    if(n == 0)
+        return 0;
+    long long rank = (long long)(P * (n - 1)), seen = 0;
+    for(int i = 0; i < Buckets; i++)
+    {
+        seen += bucket[i].load(std::memory_order_relaxed);
+        if(seen > rank)
+        {
+            /* middle of bucket, buckets below 32 hold a single value */
+            if(i < 32)
+                return i;
+            int shift = i / 16 - 1;
+            return ((i % 16 + 16) + 0.5) * (1LL << shift);
+        }
+    }
+    return max.load(std::memory_order_relaxed);
+}
+
+HermesNetwork::LatencyScope::LatencyScope(LatencyHistogram& Histogram) : histogram(Histogram), start(std::chrono::steady_clock::now())
+{
+}
+
+HermesNetwork::LatencyScope::~LatencyScope()
+{
+    histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+const HermesNetwork::LayerSnapshot& HermesNetwork::snapshotLayer(Layer Lyr, bool Weights)
+{
+    LayerSnapshot& snap = snapshots[{ Lyr, Weights }];
+    if(Lyr->onHost)
+    {
+        /* host copies are current, no readback needed */
+        unsigned int version = Weights ? Lyr->weightVersion : Lyr->neuronVersion;
+        if(!snap.ready || snap.version != version)
+            snap.values = Weights ? Lyr->hostWeights : Lyr->hostNeurons;
+        snap.version = version;
+        snap.ready = true;
+        return snap;
+    }
+    if((Weights ? Lyr->WeightsTex : Lyr->NeuronsTex) == 0)
+        return snap;            // network is paged out, last values stand until it's used again
+    if(snap.pbo == 0)
+        glGenBuffers(1, &snap.pbo);
+
+    if(snap.fence)
+    {
+        GLint status = GL_UNSIGNALED;
+        glGetSynciv(snap.fence, GL_SYNC_STATUS, sizeof(GLint), nullptr, &status);
+        if(status == GL_SIGNALED)
+        {
+            glDeleteSync(snap.fence);
+            snap.fence = nullptr;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, snap.pbo);
+            const float* mapped = (const float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(float) * snap.pendingSize, GL_MAP_READ_BIT);
+            if(mapped)
+            {
+                snap.values.assign(mapped, mapped + snap.pendingSize);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                snap.version = snap.pendingVersion;
+                snap.ready = true;
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+    }
+
+    unsigned int tex = Weights ? Lyr->WeightsTex : Lyr->NeuronsTex;
+    unsigned int version = Weights ? Lyr->weightVersion : Lyr->neuronVersion;
+    auto now = std::chrono::steady_clock::now();
+    bool due = snapshotRate <= 0 || now - snap.requested >= std::chrono::duration<double>(1.0 / snapshotRate);
+    if(snap.fence || tex == 0 || (snap.ready && snap.version == version) || !due)
+        return snap;
+
+    /* whole texture is read, weights of some layer kinds are 2D */
+    GLint width = 0, height = 0;
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    int size = width * height;
+
+    memoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, snap.pbo);
+    if(size > snap.capacity)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(float) * size, nullptr, GL_STREAM_READ);
+        snap.capacity = size;
+    }
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    /* flushed so fence signals without another GL call forcing it */
+    snap.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    snap.pendingVersion = version;
+    snap.pendingSize = size;
+    snap.requested = now;
+    statBytesReadBack.fetch_add(sizeof(float) * size, std::memory_order_relaxed);
+    return snap;
+}
+
+void HermesNetwork::dropLayerSnapshots(Layer Lyr)
+{
+    for(bool weights: { false, true })
+    {
+        auto it = snapshots.find({ Lyr, weights });
+        if(it == snapshots.end())
+            continue;
+        if(it->second.fence)
+            glDeleteSync(it->second.fence);
+        glDeleteBuffers(1, &it->second.pbo);
+        snapshots.erase(it);
+    }
+}
+
+void HermesNetwork::startAsync(const std::shared_ptr<AsyncState>& Job)
+{
+    /* flushed so fence signals without another GL call forcing it */
+    Job->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    asyncJobs.push_back(Job);
+}
+
+void HermesNetwork::finishAsync(const std::shared_ptr<AsyncState>& Job)
+{
+    glDeleteSync(Job->fence);
+    Job->fence = nullptr;
+    if(Job->pbo)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, Job->pbo);
+        const float* mapped = Job->failed ? nullptr : (const float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(float) * Job->size, GL_MAP_READ_BIT);
+        if(mapped)
+        {
+            Job->outputs.assign(mapped, mapped + std::min<int>(Job->size, Job->network->no_of_output));
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            std::copy(Job->outputs.begin(), Job->outputs.end(), Job->network->Out);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        asyncBuffers.push_back(Job->pbo);
+        Job->pbo = 0;
+    }
+    Job->done = true;
+
+    /* continuation may start new async calls, so it's moved out before running */
+    std::function<void()> continuation = std::move(Job->continuation);
+    Job->continuation = nullptr;
+    if(continuation)
+        continuation();
+}
+
+void HermesNetwork::pollAsync(AsyncState* Until)
+{
+    /* fences signal in order of issue, so polling stops at first one still running */
+    while(!asyncJobs.empty())
+    {
+        std::shared_ptr<AsyncState> job = asyncJobs.front();
+        bool wait = Until && !Until->done;
+        GLenum status = glClientWaitSync(job->fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000ull : 0);
+        if(status == GL_TIMEOUT_EXPIRED)
+        {
+            if(wait)
+                continue;
+            return;
+        }
+        job->failed = status == GL_WAIT_FAILED;
+        asyncJobs.erase(asyncJobs.begin());
+        finishAsync(job);
+    }
+}
+
+void HermesNetwork::countUpload(long long Bytes)
+{
+    statBytesUploaded.fetch_add(Bytes, std::memory_order_relaxed);
+}
+
+void HermesNetwork::countReadback(long long Bytes)
+{
+    statBytesReadBack.fetch_add(Bytes, std::memory_order_relaxed);
+    statStalls.fetch_add(1, std::memory_order_relaxed);
+}
+
+long long HermesNetwork::textureBytes(unsigned int Tex)
+{
+    if(Tex == 0)
+        return 0;
+    GLint width = 0, height = 0, format = 0;
+    glBindTexture(GL_TEXTURE_2D, Tex);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    int texel = format == GL_RGBA32F ? 16 : (format == GL_RG32I || format == GL_RG32F ? 8 : 4);
+    return (long long)width * height * texel;
+}
+
+long long HermesNetwork::networkBytes(NeuralNetwork Network)
+{
+    long long bytes = 0;
+    for(unsigned int* tex: networkTextures(Network))
+        bytes += textureBytes(*tex);
+    return bytes;
+}
+
+std::vector<unsigned int*> HermesNetwork::networkTextures(NeuralNetwork Network)
+{
+    std::vector<unsigned int*> textures;
+    for(Layer L = Network->inputLayer; L != nullptr; L = L->next)
+        textures.insert(textures.end(), { &L->NeuronsTex, &L->WeightsTex, &L->QNeuronsTex, &L->QWeightsTex, &L->QScaleTex,
+                                          &L->RowPtrTex, &L->ColIndexTex, &L->ColPtrTex, &L->CscEntryTex, &L->ActiveInputTex,
+                                          &L->StateHistTex, &L->InputHistTex, &L->GradHistTex, &L->DeltaTex, &L->ErrHistTex,
+                                          &L->QKVTex, &L->AttnTex, &L->AttnStatTex, &L->AttnGradTex, &L->QKVGradTex, &L->BatchTex });
+    textures.push_back(&Network->BatchTargetTex);
+    return textures;
+}
+
+void HermesNetwork::useNetwork(NeuralNetwork Network, NeuralNetwork Keep)
+{
+    if(!Network->paged && memoryBudget == 0)
+        return;
+    Network->lastUse = ++useClock;
+    if(Network->paged)
+        pageIn(Network);
+    else
+        measureNetwork(Network);
+    enforceBudget(Network, Keep);
+}
+
+void HermesNetwork::countPageUse(NeuralNetwork Network)
+{
+    if(memoryBudget == 0 && !Network->paged && !Network->pagedIn)
+        return;
+    if(Network->paged || Network->pagedIn)
+        pageMisses++;
+    else
+        pageHits++;
+    Network->pagedIn = false;
+}
+
+void HermesNetwork::measureNetwork(NeuralNetwork Network)
+{
+    /* GL is asked for sizes only once batch textures grew or textures were made or freed */
+    long long signature = Network->batchRows;
+    for(unsigned int* tex: networkTextures(Network))
+        signature = signature * 2 + (*tex != 0);
+    if(Network->residentBytes >= 0 && signature == Network->memorySignature)
+        return;
+    residentBytes -= std::max(Network->residentBytes, 0LL);
+    Network->residentBytes = networkBytes(Network);
+    Network->memorySignature = signature;
+    residentBytes += Network->residentBytes;
+}
+
+bool HermesNetwork::pageOut(NeuralNetwork Network)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<PagedTexture> paged;
+    for(unsigned int* tex: networkTextures(Network))
+    {
+        if(*tex == 0)
+            continue;
+        PagedTexture t = { tex, 0, 0, 0, { 0, 0, 0, 0 }, {} };
+        glBindTexture(GL_TEXTURE_2D, *tex);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &t.internalFormat);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &t.width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &t.height);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &t.parameters[0]);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &t.parameters[1]);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &t.parameters[2]);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &t.parameters[3]);
+        paged.push_back(t);
+    }
+    for(const PagedTexture& t: paged)
+        if(t.internalFormat != GL_RGBA32F && t.internalFormat != GL_R32F && t.internalFormat != GL_R32I && t.internalFormat != GL_RG32I)
+        {
+            glBindTexture(GL_TEXTURE_2D, 0);
+            return false;
+        }
+
+    memoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    long long bytes = 0;
+    for(PagedTexture& t: paged)
+    {
+        GLenum format = t.internalFormat == GL_RGBA32F ? GL_RGBA : t.internalFormat == GL_R32F ? GL_RED :
+                        t.internalFormat == GL_R32I ? GL_RED_INTEGER : GL_RG_INTEGER;
+        GLenum type = t.internalFormat == GL_RGBA32F || t.internalFormat == GL_R32F ? GL_FLOAT : GL_INT;
+        t.pixels.resize(textureBytes(*t.handle));
+        glBindTexture(GL_TEXTURE_2D, *t.handle);
+        glGetTexImage(GL_TEXTURE_2D, 0, format, type, t.pixels.data());
+        glDeleteTextures(1, t.handle);
+        *t.handle = 0;
+        bytes += t.pixels.size();
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    countReadback(bytes);
+
+    for(Layer L = Network->inputLayer; L != nullptr; L = L->next)
+        dropLayerSnapshots(L);
+    Network->pagedTextures = std::move(paged);
+    Network->paged = true;
+    residentBytes -= Network->residentBytes;
+    pagedBytes += bytes;
+    pageOuts++;
+    pageOutLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    return true;
+}
+
+void HermesNetwork::pageIn(NeuralNetwork Network)
+{
+    auto start = std::chrono::steady_clock::now();
+    long long bytes = 0;
+    for(const PagedTexture& t: Network->pagedTextures)
+    {
+        GLenum format = t.internalFormat == GL_RGBA32F ? GL_RGBA : t.internalFormat == GL_R32F ? GL_RED :
+                        t.internalFormat == GL_R32I ? GL_RED_INTEGER : GL_RG_INTEGER;
+        GLenum type = t.internalFormat == GL_RGBA32F || t.internalFormat == GL_R32F ? GL_FLOAT : GL_INT;
+        *t.handle = createDataTexture(t.width, t.height, t.internalFormat, format, type, t.pixels.data());
+        glBindTexture(GL_TEXTURE_2D, *t.handle);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, t.parameters[0]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, t.parameters[1]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, t.parameters[2]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, t.parameters[3]);
+        bytes += t.pixels.size();
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    countUpload(bytes);
+
+    /* snapshots were dropped, so versions only need to move on */
+    for(Layer L = Network->inputLayer; L != nullptr; L = L->next)
+    {
+        L->neuronVersion++;
+        L->weightVersion++;
+    }
+    Network->pagedTextures.clear();
+    Network->pagedTextures.shrink_to_fit();
+    Network->paged = false;
+    Network->pagedIn = true;
+    residentBytes += Network->residentBytes;
+    pagedBytes -= bytes;
+    pageInLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+void HermesNetwork::enforceBudget(NeuralNetwork Network, NeuralNetwork Keep)
+{
+    if(memoryBudget == 0)
+        return;
+    std::vector<NeuralNetwork> unpageable;
+    while(residentBytes > memoryBudget)
+    {
+        NeuralNetwork oldest = nullptr;
+        for(NeuralNetwork N: networks)
+            if(N != Network && N != Keep && !N->paged && N->residentBytes > 0
+               && std::find(unpageable.begin(), unpageable.end(), N) == unpageable.end() && (!oldest || N->lastUse < oldest->lastUse))
+                oldest = N;
+        if(!oldest)
+            return;
+        if(!pageOut(oldest))
+            unpageable.push_back(oldest);
+    }
+}
+
+HermesNetwork::RecordScope::RecordScope() : active(recording && recordDepth == 0)
+{
+    recordDepth++;
+}
+
+HermesNetwork::RecordScope::~RecordScope()
+{
+    recordDepth--;
+}
+
+void HermesNetwork::recordBytes(const void* Data, size_t Size)
+{
+    recordFile.write((const char*)Data, Size);
+}
+
+int HermesNetwork::recordNetwork(NeuralNetwork Network)
+{
+    auto it = recordIds.find(Network);
+    if(it != recordIds.end())
+        return it->second;
+
+    int id = recordIds.size();
+    recordIds[Network] = id;
+
+    /* saved with SaveNetwork() next to the log, then copied into it */
+    std::string path = recordPath + ".snapshot";
+    SaveNetwork(Network, path.c_str());
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::remove(path.c_str());
+
+    /* saved file has no activations, they follow it one byte per layer after input */
+    unsigned char op = snapshotR;
+    int size = bytes.size();
+    recordBytes(&op, 1);
+    recordBytes(&id, sizeof(int));
+    recordBytes(&size, sizeof(int));
+    recordBytes(bytes.data(), size);
+    for(Layer L = Network->inputLayer->next; L != nullptr; L = L->next)
+    {
+        unsigned char type = L->AFun;
+        recordBytes(&type, 1);
+    }
+    return id;
+}
+
+void HermesNetwork::collectProfileQueries(bool Wait)
+{
+    while(profilePending > 0)
+    {
+        ProfileQuery& q = profileRing[profileHead];
+        GLint available = 0;
+        glGetQueryObjectiv(q.end, GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available && !Wait)
+            return;
+        if(!available)
+            statStalls.fetch_add(1, std::memory_order_relaxed);
+        GLuint64 begin, end;
+        glGetQueryObjectui64v(q.begin, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(q.end, GL_QUERY_RESULT, &end);
+
+        ProfileStat& stat = profileStats[std::make_pair(q.Lyr, q.phase)];
+        float ms = (end - begin) / 1.0e6;
+        if((int)stat.samples.size() < ProfileSampleLimit)
+            stat.samples.push_back(ms);
+        else
+            stat.samples[stat.count % ProfileSampleLimit] = ms;
+        stat.count++;
+        stat.total += ms;
+        if(tracing.load(std::memory_order_relaxed))
+        {
+            static const char* names[] = { "forward", "error", "backpropagation", "weight update", "upload", "readback" };
+            traceEvent(names[q.phase], "gpu", 'X', (long long)begin - traceGpuOffset, end - begin, 0, q.Lyr, nullptr);
+        }
+
+        profileHead = (profileHead + 1) % ProfileRingSize;
+        profilePending--;
+        Wait = false;
+    }
+}
+
+void HermesNetwork::freeSparseIndex(Layer Lyr)
+{
+    unsigned int index[4] = { Lyr->RowPtrTex, Lyr->ColIndexTex, Lyr->ColPtrTex, Lyr->CscEntryTex };
+    glDeleteTextures(4, index);
+    Lyr->RowPtrTex = Lyr->ColIndexTex = Lyr->ColPtrTex = Lyr->CscEntryTex = 0;
+    Lyr->nnz = 0;
+    Lyr->kind = denseK;
+}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+//////////////////////////////////////////////////////// public functions  /////////////////////////////////////////////////////////////////
+bool InitNeuralLink(bool GL_Context_Shared = false, bool Calibrate = false)
+{
+    using namespace HermesNetwork;    
+    if(!GL_Context_Shared)
+    {
+        //Create window context
+        #ifdef _WIN32
+                HWND offscreen_context = ::CreateWindowA("STATIC", "OpenGL Context Space", 0 , 0, 0, 0, 0, NULL, NULL, NULL, NULL);
+                PIXELFORMATDESCRIPTOR pfd =
+                        {
+                                sizeof(PIXELFORMATDESCRIPTOR),1,
+                                PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL | PFD_DOUBLEBUFFER, PFD_TYPE_RGBA,
+                                32,0,0,0,0,0,0,
+                                0,0,0,0,0,0,
+                                0,24,8,0,
+                                PFD_MAIN_PLANE,0,0, 0, 0
+                        };
+                HDC DC = GetDC(offscreen_context);
+                int  letWindowsChooseThisPixelFormat;
+                letWindowsChooseThisPixelFormat = ChoosePixelFormat(DC, &pfd);
+                SetPixelFormat(DC,letWindowsChooseThisPixelFormat, &pfd);
+                GlRenderingContext = wglCreateContext(DC);
+                wglMakeCurrent (DC, GlRenderingContext);
+                //wglDeleteContext(GLRenderingContext);
+        #endif
+        #ifdef __linux__
+                Xdisplay = XOpenDisplay(NULL);
+                int s = DefaultScreen(Xdisplay);
+                Xoffscreen_window = XCreateSimpleWindow(Xdisplay, RootWindow(Xdisplay, s), 0, 0, 800, 500, 1, BlackPixel(Xdisplay, s), WhitePixel(Xdisplay, s));      
+                //XMapWindow(Xdisplay, Xoffscreen_window);
+
+                GLint att[] = { GLX_RGBA, GLX_DEPTH_SIZE, 24, GLX_DOUBLEBUFFER, None };
+                XVisualInfo *vi = glXChooseVisual(Xdisplay, 0, att);                
+                GlRenderingContext = glXCreateContext(Xdisplay, vi, NULL, GL_TRUE);
+                glXMakeCurrent(Xdisplay, Xoffscreen_window, GlRenderingContext);  
+                delete vi; 
+        #endif
+        #ifdef __APPLE__
+                //call macOS api to create invisible window
+                            //attatch gl viewport
+                            //make gl context
+        #endif
+        #ifdef __ANDROID__
+                //call macOS api to create invisible window
+                            //attatch gl viewport
+                            //make gl context
+        #endif
+    }
+
+
+    //Init openGl context
+    #ifdef __glew_h__
+        glewInit();
+    #endif
+    #ifdef __glut_h__
+        glutInit(NULL,NULL);
+    #endif
+    #ifdef  __FREEGLUT_H__
+        glutInit(NULL,NULL);
+    #endif
+
+    /* Create And Compile Shaders */
+    int WeightInitComputetShader = glCreateShader(GL_COMPUTE_SHADER);
+    int ActivationComputeShader = glCreateShader(GL_COMPUTE_SHADER);
+    int ErrorGenComputeShader = glCreateShader(GL_COMPUTE_SHADER);
+    int WeightUpdateComputeShader = glCreateShader(GL_COMPUTE_SHADER);   
+    int ErrorBPComputeShader = glCreateShader(GL_COMPUTE_SHADER);
+    int Active_DeriveLibsComputeShader = glCreateShader(GL_COMPUTE_SHADER);
+           
+
+    glShaderSource(WeightInitComputetShader, 1, &WeightInitShader_code, NULL);
+    glShaderSource(ActivationComputeShader, 1, &ActivationShader_code, NULL);
+    glShaderSource(ErrorGenComputeShader, 1, &ErrorGen_code, NULL);
+    glShaderSource(WeightUpdateComputeShader, 1, &WeightUpdateShader_code, NULL);
+    glShaderSource(ErrorBPComputeShader, 1, &ErrorBackPropogate_code, NULL);
+    glShaderSource(Active_DeriveLibsComputeShader, 1, &ActiveDeriveLibs_code, NULL);
+
+
+
+    glCompileShader(WeightInitComputetShader);
+    glCompileShader(ActivationComputeShader);
+    glCompileShader(ErrorGenComputeShader);
+    glCompileShader(WeightUpdateComputeShader);
+    glCompileShader(ErrorBPComputeShader);
+    glCompileShader(Active_DeriveLibsComputeShader);
+   
+
+    
+
+    /* handle compile error	*/
+    std::cout << "Compute Shader Builds: [";
+    int success;
+    bool fail = false;
+    glGetShaderiv(WeightInitComputetShader, GL_COMPILE_STATUS, &success); fail |= !success;
+    std::cout << success<< ",";
+    glGetShaderiv(ActivationComputeShader, GL_COMPILE_STATUS, &success); fail |= !success;
+    std::cout << success<< ",";
+    glGetShaderiv(ErrorGenComputeShader, GL_COMPILE_STATUS, &success); fail |= !success;
+    std::cout << success<< ",";
+    glGetShaderiv(WeightUpdateComputeShader, GL_COMPILE_STATUS, &success); fail |= !success;
+    std::cout << success<< ",";
+    glGetShaderiv(ErrorBPComputeShader, GL_COMPILE_STATUS, &success); fail |= !success;
+    std::cout << success<< ",";
+    glGetShaderiv(Active_DeriveLibsComputeShader, GL_COMPILE_STATUS, &success); fail |= !success;
+    std::cout << success<< ",";
+    std::cout <<"] " << fail << std::endl;
+
+
+    char infoLog[512];
+    glGetShaderInfoLog(Active_DeriveLibsComputeShader, 512, NULL, infoLog);
+    std::cout<<infoLog;
+    if(fail)
+        return !fail;
+
+
+
+    /* remove shader source codes from memory	*/
+
+
+    /* bind shader programs */
+    WeightInit = glCreateProgram();
+    glAttachShader(WeightInit, WeightInitComputetShader);
+    glLinkProgram(WeightInit);
+
+    Activation = glCreateProgram();
+    glAttachShader(Activation, Active_DeriveLibsComputeShader);
+    glAttachShader(Activation, ActivationComputeShader);
+	glLinkProgram(Activation);
+
+    ErrorGen = glCreateProgram();
+    glAttachShader(ErrorGen, Active_DeriveLibsComputeShader);
+    glAttachShader(ErrorGen, ErrorGenComputeShader);
+	glLinkProgram(ErrorGen);
+
+    WeightUpdate = glCreateProgram();
+    glAttachShader(WeightUpdate, WeightUpdateComputeShader);
+	glLinkProgram(WeightUpdate);
+
+    ErrorBackPropogate = glCreateProgram();
+    glAttachShader(ErrorBackPropogate, Active_DeriveLibsComputeShader);
+    glAttachShader(ErrorBackPropogate, ErrorBPComputeShader);
+	glLinkProgram(ErrorBackPropogate);
+
+    /* remove compiled shader from RAM */
+    glDeleteShader(WeightInitComputetShader);
+    glDeleteShader(ActivationComputeShader);
+    glDeleteShader(ErrorGenComputeShader);
+    glDeleteShader(WeightUpdateComputeShader);   
+    glDeleteShader(ErrorBPComputeShader);    
+    glDeleteShader(Active_DeriveLibsComputeShader);    
+   
+
+    /* Initialize Temporary Texture for misc operations */
+    glGenTextures(1, &TempTex);
+    glBindTexture(GL_TEXTURE_2D, TempTex);
+    /*glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, newL->no_neuron, 1, 0, GL_RGB, GL_FLOAT, NULL);*/
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+
+    /* Get all uniform locations */
+
+    //explicit function selector location as defined in ActiveDeriveLibs shader
+    //explicit location used to maintain common location across all sharing compute shader program
+    //take care that no other uniforms in ohter shader is explicitly in same location
+    ACTVLibs_unifm_SEL = 0;
+
+
+    glUseProgram(WeightInit);
+    WINT_unifm_seed = glGetUniformLocation(WeightInit, "seed");
+
+    glUseProgram(Activation);
+	ACTV_unifm_prev_size = glGetUniformLocation(Activation, "PreviousLayer_size");
+	ACTV_unifm_weight_size = glGetUniformLocation(Activation, "Weight_size");
+	ACTV_unifm_prev_L_TEX = 1;    // from shader uniform layout binding
+	ACTV_unifm_Layer_weight = 2;  // from shader uniform layout binding  
+    ACTVLibs_unifm_SEL = glGetUniformLocation(Activation, "selection");
+
+    std::cout<<"LOC: "<< glGetUniformLocation(Activation, "selection") << " "<<  ACTV_unifm_prev_size << std::endl;
+
+    glUseProgram(ErrorGen);
+    ERROR_unifm_neuronOut_TEX = 0; // from shader uniform layout binding
+    ERROR_unifm_actualOut_TEX = 1; // from shader uniform layout binding
+    std::cout<<"LOC: "<< glGetUniformLocation(Activation, "selection") << " "<<  glGetUniformLocation(ErrorGen, "NeuronsOutput") << std::endl;
+
+    glUseProgram(WeightUpdate);
+    WGHTUP_unifm_next_size = glGetUniformLocation(WeightUpdate, "NextLayer_size");
+    WGHTUP_unifm_prev_size = glGetUniformLocation(WeightUpdate, "PreviousLayer_size");
+    WGHTUP_unifm_LearnRT = glGetUniformLocation(WeightUpdate, "LearningRate");
+    WGHTUP_unifm_weight_TEX = 0;    // from shader uniform layout binding
+    WGHTUP_unifm_neuronOut_TEX = 1; // from shader uniform layout binding
+    WGHTUP_unifm_prev_L_TEX = 2;    // from shader uniform layout binding    
+
+    glUseProgram(ErrorBackPropogate);
+    ERROR_BP_unifm_neuronOut_TEX = 0; // from shader uniform layout binding
+	ERROR_BP_unifm_next_L_TEX = 1;    // from shader uniform layout binding
+	ERROR_BP_unifm_weight_TEX = 2;    // from shader uniform layout binding
+	ERROR_BP_unifm_Layer_size = glGetUniformLocation(ErrorBackPropogate, "OutputLayer_size");
+	ERROR_BP_unifm_next_L_size = glGetUniformLocation(ErrorBackPropogate, "NextLayer_size"); 
+    std::cout<<"LOC: "<<  ERROR_BP_unifm_Layer_size << glGetUniformLocation(ErrorBackPropogate, "selection") << std::endl;
+       
+
+    /* Build int8 inference kernels */
+    QuantizeWeights = buildKernel(QuantizeWeightsShader_code, false);
+    QuantizeNeurons = buildKernel(QuantizeNeuronsShader_code, false);
+    QActivation = buildKernel(QActivationShader_code, true);
+    if(!QuantizeWeights || !QuantizeNeurons || !QActivation)
+        return false;
+
+    QWGHT_unifm_prev_size = glGetUniformLocation(QuantizeWeights, "PreviousLayer_size");
+    QWGHT_unifm_packed_size = glGetUniformLocation(QuantizeWeights, "PackedRow_size");
+    QWGHT_unifm_weight_TEX = 0;     // from shader uniform layout binding
+    QWGHT_unifm_qweight_TEX = 1;    // from shader uniform layout binding
+    QWGHT_unifm_scale_TEX = 2;      // from shader uniform layout binding
+
+    QNRN_unifm_Layer_size = glGetUniformLocation(QuantizeNeurons, "Layer_size");
+    QNRN_unifm_act_scale = glGetUniformLocation(QuantizeNeurons, "Act_scale");
+    QNRN_unifm_neuron_TEX = 0;      // from shader uniform layout binding
+    QNRN_unifm_qneuron_TEX = 1;     // from shader uniform layout binding
+
+    QACTV_unifm_packed_size = glGetUniformLocation(QActivation, "PackedRow_size");
+    QACTV_unifm_input_scale = glGetUniformLocation(QActivation, "Input_scale");
+    QACTV_unifm_prev_L_TEX = 1;     // from shader uniform layout binding
+    QACTV_unifm_qweight_TEX = 2;    // from shader uniform layout binding
+    QACTV_unifm_scale_TEX = 3;      // from shader uniform layout binding
+
+    /* Build convolution and pooling kernels */
+    ConvActivation = buildKernel(ConvActivationShader_code, true);
+    ConvBackPropogate = buildKernel(ConvBackPropogate_code, true);
+    ConvWeightUpdate = buildKernel(ConvWeightUpdate_code, false);
+    PoolActivation = buildKernel(PoolActivationShader_code, false);
+    PoolBackPropogate = buildKernel(PoolBackPropogate_code, true);
+    if(!ConvActivation || !ConvBackPropogate || !ConvWeightUpdate || !PoolActivation || !PoolBackPropogate)
+        return false;
+
+    //explicit locations shared by all convolution/pooling kernels
+    IMG_unifm_in_shape = 1;
+    IMG_unifm_out_shape = 2;
+    IMG_unifm_window = 3;
+    IMG_unifm_LearnRT = 4;
+
+    /* Build softmax + cross-entropy kernel */
+    Softmax_CE = buildKernel(SoftmaxCrossEntropy_code, false);
+    if(!Softmax_CE)
+        return false;
+
+    SMAX_unifm_Layer_size = glGetUniformLocation(Softmax_CE, "Layer_size");
+    SMAX_unifm_with_target = glGetUniformLocation(Softmax_CE, "WithTarget");
+    SMAX_unifm_neuronOut_TEX = 0;   // from shader uniform layout binding
+    SMAX_unifm_actualOut_TEX = 1;   // from shader uniform layout binding
+
+    /* Build sparse (CSR) layer kernels */
+    SparseActivation = buildKernel(SparseActivationShader_code, true);
+    SparseBackPropogate = buildKernel(SparseBackPropogate_code, true);
+    SparseWeightUpdate = buildKernel(SparseWeightUpdate_code, false);
+    if(!SparseActivation || !SparseBackPropogate || !SparseWeightUpdate)
+        return false;
+
+    //explicit locations shared by all sparse kernels
+    SPRS_unifm_Layer_size = 1;
+    SPRS_unifm_nnz = 2;
+    SPRS_unifm_LearnRT = 3;
+    SPRS_unifm_prev_size = 4;
+    SPRS_unifm_mode = 5;
+
+    /* Build sparse input kernels, they share explicit locations of sparse layer kernels */
+    SparseInputActivation = buildKernel(SparseInputActivation_code, true);
+    SparseInputWeightUpdate = buildKernel(SparseInputWeightUpdate_code, false);
+    SparseInputScatter = buildKernel(SparseInputScatter_code, false);
+    if(!SparseInputActivation || !SparseInputWeightUpdate || !SparseInputScatter)
+        return false;
+
+    /* Build pruning statistics kernels */
+    NeuronStats = buildKernel(NeuronStatsShader_code, false);
+    OutgoingNorm = buildKernel(OutgoingNormShader_code, false);
+    if(!NeuronStats || !OutgoingNorm)
+        return false;
+
+    STAT_unifm_Layer_size = glGetUniformLocation(NeuronStats, "Layer_size");
+    STAT_unifm_neuronOut_TEX = 0;   // from shader uniform layout binding
+    STAT_unifm_stats_TEX = 1;       // from shader uniform layout binding
+    NORM_unifm_Layer_size = glGetUniformLocation(OutgoingNorm, "Layer_size");
+    NORM_unifm_next_size = glGetUniformLocation(OutgoingNorm, "NextLayer_size");
+    NORM_unifm_next_weight_TEX = 0; // from shader uniform layout binding
+    NORM_unifm_stats_TEX = 1;       // from shader uniform layout binding
+
+    /* Build recurrent layer kernels */
+    RecurrentActivation = buildKernel(RecurrentActivationShader_code, false);
+    RecurrentGateGrad = buildKernel(RecurrentGateGrad_code, false);
+    RecurrentHiddenGrad = buildKernel(RecurrentHiddenGrad_code, false);
+    RecurrentWeightUpdate = buildKernel(RecurrentWeightUpdate_code, false);
+    RecurrentBackPropogate = buildKernel(RecurrentBackPropogate_code, true);
+    if(!RecurrentActivation || !RecurrentGateGrad || !RecurrentHiddenGrad || !RecurrentWeightUpdate || !RecurrentBackPropogate)
+        return false;
+
+    //explicit locations shared by all recurrent kernels
+    RNN_unifm_shape = 1;
+    RNN_unifm_step = 2;
+    RNN_unifm_steps = 3;
+    RNN_unifm_LearnRT = 4;
+    RNN_unifm_first = 5;
+    RNN_unifm_external = 6;
+    RNN_unifm_history = 6;
+
+    /* Build self-attention kernels */
+    AttentionProjection = buildKernel(AttentionProjection_code, true);
+    AttentionScores = buildKernel(AttentionShader_code, false);
+    AttentionBackProject = buildKernel(AttentionBackProject_code, true);
+    AttentionBackQuery = buildKernel(AttentionBackQuery_code, false);
+    AttentionBackKeyValue = buildKernel(AttentionBackKeyValue_code, false);
+    AttentionWeightUpdate = buildKernel(AttentionWeightUpdate_code, false);
+    if(!AttentionProjection || !AttentionScores || !AttentionBackProject || !AttentionBackQuery || !AttentionBackKeyValue || !AttentionWeightUpdate)
+        return false;
+
+    //explicit locations shared by all attention kernels
+    ATTN_unifm_shape = 1;
+    ATTN_unifm_mode = 2;
+    ATTN_unifm_LearnRT = 3;
+
+    /* Build variants of dense kernels for autotuner */
+    if(!buildDenseVariants())
+        return false;
+
+    //explicit locations shared by all dense kernel variants
+    DENSE_unifm_prev_size = 1;
+    DENSE_unifm_Layer_size = 2;
+    DENSE_unifm_LearnRT = 3;
+    DENSE_unifm_next_size = 4;
+
+    /* Build batch kernels */
+    BatchActivation = buildKernel(BatchActivation_code, true);
+    BatchError = buildKernel(BatchError_code, true);
+    BatchBackPropogate = buildKernel(BatchBackPropogate_code, true);
+    BatchWeightUpdate = buildKernel(BatchWeightUpdate_code, false);
+    if(!BatchActivation || !BatchError || !BatchBackPropogate || !BatchWeightUpdate)
+        return false;
+
+    //explicit locations shared by all batch kernels
+    BATCH_unifm_prev_size = 1;
+    BATCH_unifm_Layer_size = 2;
+    BATCH_unifm_rows = 3;
+    BATCH_unifm_LearnRT = 4;
+    BATCH_unifm_next_size = 5;
+
+    /* Build replay buffer kernels */
+    ReplaySample = buildKernel(ReplaySample_code, false);
+    ReplayPriority = buildKernel(ReplayPriority_code, false);
+    ReplayTreeLevel = buildKernel(ReplayTreeLevel_code, false);
+    ReplayStore = buildKernel(ReplayStore_code, false);
+    if(!ReplaySample || !ReplayPriority || !ReplayTreeLevel || !ReplayStore)
+        return false;
+
+    //explicit locations shared by all replay kernels
+    RPLY_unifm_count = 1;
+    RPLY_unifm_leaves = 2;
+    RPLY_unifm_rows = 3;
+    RPLY_unifm_seed = 4;
+    RPLY_unifm_prioritized = 5;
+    RPLY_unifm_input_size = 6;
+    RPLY_unifm_output_size = 7;
+    RPLY_unifm_floor = 8;
+    RPLY_unifm_begin = 9;
+    RPLY_unifm_head = 10;
+    RPLY_unifm_capacity = 11;
+
+    if(Calibrate)
+        CalibrateDevices();
+
+    srand(time(0));
+    return true;
+}
+
+template <typename T>
+NeuralNetwork NetworkBuilder(int InputSize, std::vector<T> HiddenLayers, int OutputSize)
+{    
+    using namespace HermesNetwork;
+    RecordScope record;
+    unsigned int seed = 0;
+    if(record.active)
+    {
+        /* weights come from rand(), reseeding it makes replay build same weights */
+        seed = rand();
+        srand(seed);
+    }
 
-//This function does nothing except changing network layer texture representation rigid, fixed bars.
-void DeTerrify(NeuralNetwork N);
+    NeuralNetwork nn = createBasicNetwork(InputSize, OutputSize);
+    for(int s: HiddenLayers)
+        appendHiddenLayer(nn,s);
+        
+    Layer l = nn->inputLayer;
+    while(l->next != nullptr)
+    {
+        connectLayer(l, l->next);
+        l = l->next;        
+    }
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    //permanently bind output layer with Out array
+    fetchLayerNeuronsData(nn->outputLayer);
+    nn->Out = nn->outputLayer->data;
+    if(autotune)
+        autotuneNetwork(nn);
+    if(devicesCalibrated)
+        SetNetworkDevice(nn, AutoDevice);
+    useNetwork(nn);
+
+    if(record.active)
+    {
+        unsigned char op = buildR;
+        int id = recordIds.size(), hidden = HiddenLayers.size();
+        recordIds[nn] = id;
+        recordBytes(&op, 1);
+        recordBytes(&id, sizeof(int));
+        recordBytes(&seed, sizeof(int));
+        recordBytes(&InputSize, sizeof(int));
+        recordBytes(&hidden, sizeof(int));
+        for(int s: HiddenLayers)
+            recordBytes(&s, sizeof(int));
+        recordBytes(&OutputSize, sizeof(int));
+    }
+    return nn;    
+}
+
+ConvStage Convolution(int Channels, int Kernel, int Stride, int Padding)
+{
+    return { Channels, Kernel, Stride, Padding, false };
+}
+
+ConvStage MaxPooling(int Kernel, int Stride)
+{
+    return { 0, Kernel, Stride, 0, true };
+}
+
+NeuralNetwork ConvNetworkBuilder(int Width, int Height, int Channels, std::vector<ConvStage> Stages, std::vector<int> HiddenLayers, int OutputSize)
+{
+    using namespace HermesNetwork;
+
+    /* check every stage fits the image coming into it and the tile size of conv kernels */
+    int w = Width, h = Height;
+    for(ConvStage& stage: Stages)
+    {
+        int pad = stage.Pooling ? 0 : stage.Padding;
+        w = (w + 2 * pad - stage.Kernel) / stage.Stride + 1;
+        h = (h + 2 * pad - stage.Kernel) / stage.Stride + 1;
+        if(w < 1 || h < 1 || stage.Kernel > 11 || 7 * stage.Stride + stage.Kernel > 32)
+        {
+            std::cout << "ConvNetworkBuilder: unsupported stage (kernel " << stage.Kernel << ", stride " << stage.Stride << ")" << std::endl;
+            return nullptr;
+        }
+    }
+
+    NeuralNetwork nn = createBasicNetwork(Width * Height * Channels, OutputSize);
+    nn->netType = convolutional;
+    nn->inputLayer->width = Width;
+    nn->inputLayer->height = Height;
+    nn->inputLayer->channels = Channels;
+
+    for(ConvStage& stage: Stages)
+    {
+        if(stage.Pooling)
+            appendPoolingLayer(nn, stage.Kernel, stage.Stride);
+        else
+            appendConvolutionLayer(nn, stage.Channels, stage.Kernel, stage.Stride, stage.Padding);
+    }
+    for(int s: HiddenLayers)
+        appendHiddenLayer(nn,s);
+
+    Layer l = nn->inputLayer;
+    while(l->next != nullptr)
+    {
+        connectLayer(l, l->next);
+        l = l->next;
+    }
+
+    //permanently bind output layer with Out array
+    fetchLayerNeuronsData(nn->outputLayer);
+    nn->Out = nn->outputLayer->data;
+    useNetwork(nn);
+    return nn;
+}
+
+NeuralNetwork RecurrentNetworkBuilder(int InputSize, RecurrentCell Cell, std::vector<int> RecurrentLayers, std::vector<int> HiddenLayers, int OutputSize, int Window)
+{
+    using namespace HermesNetwork;
+    NeuralNetwork nn = createBasicNetwork(InputSize, OutputSize);
+    nn->netType = recurrent;
+    for(int s: RecurrentLayers)
+        appendRecurrentLayer(nn, s, Cell, Window);
+    for(int s: HiddenLayers)
+        appendHiddenLayer(nn,s);
+
+    Layer l = nn->inputLayer;
+    while(l->next != nullptr)
+    {
+        connectLayer(l, l->next);
+        l = l->next;
+    }
+
+    //permanently bind output layer with Out array
+    fetchLayerNeuronsData(nn->outputLayer);
+    nn->Out = nn->outputLayer->data;
+    useNetwork(nn);
+    return nn;
+}
+
+NeuralNetwork AttentionNetworkBuilder(int Tokens, int ModelSize, int Heads, int Blocks, std::vector<int> HiddenLayers, int OutputSize)
+{
+    using namespace HermesNetwork;
+    if(Tokens < 1 || Heads < 1 || ModelSize % Heads != 0 || ModelSize / Heads > 64)
+        return nullptr;
+    NeuralNetwork nn = createBasicNetwork(Tokens * ModelSize, OutputSize);
+    nn->netType = attention;
+    for(int b = 0; b < Blocks; b++)
+        appendAttentionLayer(nn, Tokens, Heads);
+    for(int s: HiddenLayers)
+        appendHiddenLayer(nn,s);
+
+    Layer l = nn->inputLayer;
+    while(l->next != nullptr)
+    {
+        connectLayer(l, l->next);
+        l = l->next;
+    }
+
+    //permanently bind output layer with Out array
+    fetchLayerNeuronsData(nn->outputLayer);
+    nn->Out = nn->outputLayer->data;
+    useNetwork(nn);
+    return nn;
+}
+
+void ResetState(NeuralNetwork Network)
+{
+    /* step 0 reads no previous state, so rings need no clearing */
+    for(HermesNetwork::Layer L = Network->inputLayer; L != nullptr; L = L->next)
+    {
+        L->step = 0;
+        L->unrolled = 0;
+    }
+}
+
+void TriggerLayer(NeuralNetwork Network, int LayerDepth)
+{
+	using namespace HermesNetwork;
+    useNetwork(Network);
+
+    /* Don't allow input layer activation */
+    if(LayerDepth == 0)
+        return;
+
+	/* Select Layer at given depth */
+	Layer Lyr = Network->inputLayer;
+	for (int i = 0; i < LayerDepth; i++)
+		Lyr = Lyr->next;
+
+	/* Trigger selected layer */
+	triggerLayer(Lyr);
+}
+
+void TriggerNetwork(NeuralNetwork Network)
+{
+    HermesNetwork::TraceScope trace("TriggerNetwork");
+	using namespace HermesNetwork;
+    LatencyScope latency(triggerLatency);
+    countPageUse(Network);
+    useNetwork(Network);
+    statInferences.fetch_add(1, std::memory_order_relaxed);
+    RecordScope record;
+    if(record.active)
+    {
+        int id = recordNetwork(Network);
+        unsigned char op = triggerR;
+        recordBytes(&op, 1);
+        recordBytes(&id, sizeof(int));
+    }
+
+	Layer Lyr = Network->inputLayer;    
+	for (int i = 1; i < Network->no_layers; i++)
+	{
+		Lyr = Lyr->next;
+		triggerLayer(Lyr);
+	}
+}
+
+void SendInputs(NeuralNetwork Network, float Inputs[])
+{
+    HermesNetwork::TraceScope trace("SendInputs");
+    HermesNetwork::useNetwork(Network);
+    HermesNetwork::RecordScope record;
+    if(record.active)
+    {
+        int id = HermesNetwork::recordNetwork(Network);
+        unsigned char op = HermesNetwork::inputsR;
+        HermesNetwork::recordBytes(&op, 1);
+        HermesNetwork::recordBytes(&id, sizeof(int));
+        HermesNetwork::recordBytes(Inputs, sizeof(float) * Network->inputLayer->no_neuron);
+    }
+    if(Network->inputLayer->onHost)
+    {
+        std::copy(Inputs, Inputs + Network->inputLayer->no_neuron, Network->inputLayer->hostNeurons.begin());
+        Network->inputLayer->neuronVersion++;
+        return;
+    }
+    HermesNetwork::ProfileScope scope(Network->inputLayer, HermesNetwork::uploadP);
+	glBindTexture(GL_TEXTURE_2D, Network->inputLayer->NeuronsTex);		
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, Network->inputLayer->no_neuron, 1, 0, GL_RED, GL_FLOAT, Inputs);
+	glBindTexture(GL_TEXTURE_2D, 0);
+    HermesNetwork::countUpload(sizeof(float) * Network->inputLayer->no_neuron);
+    Network->inputLayer->activeInputs = 0;
+    Network->inputLayer->neuronVersion++;
+}
+
+void SendSparseInputs(NeuralNetwork Network, const int Indices[], const float Values[], int NonZeros)
+{
+    using namespace HermesNetwork;
+    Layer in = Network->inputLayer;
+    TraceScope trace("SendSparseInputs");
+    requireDevice(Network);
+    RecordScope record;
+    if(record.active)
+    {
+        int id = recordNetwork(Network);
+        unsigned char op = sparseInputsR;
+        recordBytes(&op, 1);
+        recordBytes(&id, sizeof(int));
+        recordBytes(&NonZeros, sizeof(int));
+        recordBytes(Indices, sizeof(int) * NonZeros);
+        recordBytes(Values, sizeof(float) * NonZeros);
+    }
+    ProfileScope scope(in, uploadP);
+
+    /* (value, index) pairs, index is exact in float for any texture width */
+    std::vector<float> active(2 * std::max(NonZeros, 1), 0.0f);
+    for(int k = 0; k < NonZeros; k++)
+    {
+        active[2 * k] = Values[k];
+        active[2 * k + 1] = (float)Indices[k];
+    }
+    if(in->ActiveInputTex == 0)
+        in->ActiveInputTex = createDataTexture(active.size() / 2, 1, GL_RGBA32F, GL_RG, GL_FLOAT, active.data());
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, in->ActiveInputTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, active.size() / 2, 1, 0, GL_RG, GL_FLOAT, active.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    in->activeInputs = NonZeros;
+    in->neuronVersion++;
+    countUpload(sizeof(float) * active.size());
+
+    /* all zero input still has to reach the network */
+    if(NonZeros == 0)
+        scatterActiveInputs(in);
+}
+
+void FetchOutputLayerData(NeuralNetwork Network)
+{
+    HermesNetwork::TraceScope trace("FetchOutputLayerData");
+    HermesNetwork::useNetwork(Network);
+    HermesNetwork::RecordScope record;
+    if(record.active)
+    {
+        int id = HermesNetwork::recordNetwork(Network);
+        unsigned char op = HermesNetwork::fetchR;
+        HermesNetwork::recordBytes(&op, 1);
+        HermesNetwork::recordBytes(&id, sizeof(int));
+    }
+    HermesNetwork::fetchLayerNeuronsData(Network->outputLayer);
+}
+
+void TrainNetwork(NeuralNetwork Network, float ActualOutput[], float LearningRate = 1.0)
+{    
+    HermesNetwork::TraceScope trace("TrainNetwork");
+    using namespace HermesNetwork;
+    LatencyScope latency(trainLatency);
+    countPageUse(Network);
+    useNetwork(Network);
+    statTrainingSteps.fetch_add(1, std::memory_order_relaxed);
+    RecordScope record;
+    if(record.active)
+    {
+        int id = recordNetwork(Network);
+        unsigned char op = trainR;
+        recordBytes(&op, 1);
+        recordBytes(&id, sizeof(int));
+        recordBytes(&LearningRate, sizeof(float));
+        recordBytes(ActualOutput, sizeof(float) * Network->outputLayer->no_neuron);
+    }
+    if(Network->inputLayer->onHost)
+    {
+        hostTrainNetwork(Network, ActualOutput, LearningRate);
+        return;
+    }
+    {
+        /*
+        *      STEPS FOR BACKPORPAGATION (old)
+        *
+        *    1.  calculate error for output layer                    --  for each neuron: error = sigmoid_derivative(neuron_output * (ActualOutput-neuron_output))
+        *    2.  adjust weights for output layer according to error  --  for each weights coming from neuron m, going to a neuron n: weights += n.error*m.value
+        *    3.  calculate error for hidden layer                    --  same as that of output layer error calculation
+        *    4.  adjust weights for hidden layer according to error  --  same as that of output layer weight adjustment
+        */
+
+        // /*1*/ calcError(Network->outputLayer, ActualOutput);
+        // /*2*/ trainLayer(Network->outputLayer, &LearningRate);
+        
+        // Layer Lyr = Network->outputLayer->prev;
+        // for(int i = Network->no_layers; i > 2; i--)
+        // {
+        //     /*3*/ backPropogateError(Lyr);
+        //     /*4*/ trainLayer(Lyr, &LearningRate);
+        //     Lyr = Lyr->prev;
+        // }
+    }
+    /*
+     *      STEPS FOR BACKPORPAGATION (new)
+     *
+     *    1.  calculate error for output layer                    --  for each neuron: error = sigmoid_derivative(neuron_output * (ActualOutput-neuron_output))
+     *    3.  calculate error for hidden layer                    --  same as that of output layer error calculation
+     *    2.  adjust weights for output layer according to error  --  for each weights coming from neuron m, going to a neuron n: weights += n.error*m.value    
+     *    4.  adjust weights for hidden layer according to error  --  same as that of output layer weight adjustment
+     */
+    
+    /*1*/ calcError(Network->outputLayer, ActualOutput);
+    // /*2*/ trainLayer(Network->outputLayer, &LearningRate);
+    
+    Layer Lyr = Network->outputLayer->prev;
+	for(int i = Network->no_layers; i > 2; i--)
+    {
+        /*3*/ backPropogateError(Lyr);
+        // /*4*/ trainLayer(Lyr, &LearningRate);
+        if(Lyr->kind == recurrentK)
+            unrollRecurrentError(Lyr);
+        else if(Lyr->kind == attentionK)
+            attentionBackward(Lyr);
+        Lyr = Lyr->prev;
+    }
+
+ /*2*/ trainLayer(Network->outputLayer, &LearningRate);
+    Lyr = Network->outputLayer->prev;
+	for(int i = Network->no_layers; i > 2; i--)
+    {
+        // /*3*/ backPropogateError(Lyr);
+        /*4*/ trainLayer(Lyr, &LearningRate);
+        Lyr = Lyr->prev;
+    }
+
+    /*
+     * If training is in batch, set shader to accumulate errors 
+     * until batch is filed.         
+     */    
+    if(Network->batchSize > 0)
+    {
+        Network->trainingCountByBatch ++;
+        if(Network->trainingCountByBatch == Network->batchSize)
+        {
+            Network->trainingCountByBatch = 0;
+            Network->errorAccumulation  = false;
+        }
+        else
+            Network->errorAccumulation  = true;
+    }
+
+    /*
+     * int8 weights are a snapshot of fp32 weights, so after training
+     * fall back to fp32 inference until network is quantized again.
+     */
+    if(Network->quantized)
+    {
+        SetQuantizedInference(Network, false);
+        Network->quantized = false;
+    }
+    
+    
+}
+
+bool NetworkFuture::Ready() const
+{
+    if(!state->done)
+        HermesNetwork::pollAsync(nullptr);
+    return state->done;
+}
 
+const std::vector<float>& NetworkFuture::Get() const
+{
+    if(!state->done)
+        HermesNetwork::pollAsync(state.get());
+    return state->outputs;
+}
 
+bool NetworkFuture::Failed() const
+{
+    return state->failed;
+}
 
+void NetworkFuture::Then(std::function<void(const std::vector<float>&)> Callback)
+{
+    if(state->done)
+    {
+        Callback(state->outputs);
+        return;
+    }
+    /* state owns continuation, so it outlives every copy of this handle */
+    HermesNetwork::AsyncState* result = state.get();
+    std::function<void()> before = std::move(state->continuation);
+    state->continuation = [before, Callback, result]() {
+        if(before)
+            before();
+        Callback(result->outputs);
+    };
+}
 
+#ifdef __cpp_impl_coroutine
+bool NetworkFuture::await_ready() const
+{
+    return Ready();
+}
 
+void NetworkFuture::await_suspend(std::coroutine_handle<> Handle)
+{
+    Then([Handle](const std::vector<float>&) { Handle.resume(); });
+}
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////////////////////////////////////////////////////////  DEFINITIONS  ////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+std::vector<float> NetworkFuture::await_resume() const
+{
+    return state->outputs;
+}
+#endif
 
+NetworkFuture TriggerNetworkAsync(NeuralNetwork Network)
+{
+    using namespace HermesNetwork;
+    TraceScope trace("TriggerNetworkAsync");
+    TriggerNetwork(Network);
+
+    NetworkFuture future;
+    future.state = std::make_shared<AsyncState>();
+    AsyncState& job = *future.state;
+    job.network = Network;
+    Layer out = Network->outputLayer;
+    if(out->onHost)
+    {
+        job.outputs = out->hostNeurons;
+        std::copy(job.outputs.begin(), job.outputs.end(), Network->Out);
+        job.done = true;
+        return future;
+    }
 
-//////////////////////////////////////////////////////// HermesNetwork's functions ////////////////////////////////////////////////////////
-HermesNetwork::Layer HermesNetwork::initLayer(int size, layerType typ)
-{        
-    Layer newL = new LayerHandle();
-	newL->type = typ;
-	newL->no_neuron = size;
-    
-    glGenTextures(1, &newL->NeuronsTex);
-    glBindTexture(GL_TEXTURE_2D, newL->NeuronsTex);    
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, newL->no_neuron, 1, 0, GL_RGBA, GL_FLOAT, NULL);	
+    /* output layer goes into a pixel buffer, mapped once fence has signalled */
+    GLint width = 0, height = 0;
+    glBindTexture(GL_TEXTURE_2D, out->NeuronsTex);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    job.size = width * height;
+    if(asyncBuffers.empty())
+        glGenBuffers(1, &job.pbo);
+    else
+    {
+        job.pbo = asyncBuffers.back();
+        asyncBuffers.pop_back();
+    }
+    memoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, job.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(float) * job.size, nullptr, GL_STREAM_READ);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, nullptr);
     glBindTexture(GL_TEXTURE_2D, 0);
-
-    return newL;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    statBytesReadBack.fetch_add(sizeof(float) * job.size, std::memory_order_relaxed);
+    startAsync(future.state);
+    return future;
 }
 
-NeuralNetwork HermesNetwork::createBasicNetwork(int InputSize, int OutputSize)
+NetworkFuture TrainNetworkAsync(NeuralNetwork Network, float ActualOutput[], float LearningRate = 1.0)
 {
-    /* build input Layer structure */
-    Layer inp = initLayer(InputSize, inputL);
-
-    /* build output Layer structure */
-    Layer op = initLayer(OutputSize, inputL);
-
-    /* build NeuralNetowkr structure */
-    NeuralNetwork nn = new NeuralNetworkHandle();
-	nn->no_of_input = InputSize;
-	nn->no_of_output = OutputSize;
-	nn->inputLayer = inp;
-	nn->outputLayer = op;      
+    using namespace HermesNetwork;
+    TraceScope trace("TrainNetworkAsync");
+    TrainNetwork(Network, ActualOutput, LearningRate);
+
+    NetworkFuture future;
+    future.state = std::make_shared<AsyncState>();
+    future.state->network = Network;
+    if(Network->inputLayer->onHost)
+        future.state->done = true;
+    else
+        startAsync(future.state);
+    return future;
+}
 
-    nn->inputLayer->next = op;
-    nn->outputLayer->prev = nn->inputLayer;      
+int PollAsync()
+{
+    HermesNetwork::pollAsync(nullptr);
+    return HermesNetwork::asyncJobs.size();
+}
 
-    return nn;
+bool SendInputsBatch(NeuralNetwork Network, const float Inputs[], int Rows)
+{
+    using namespace HermesNetwork;
+    TraceScope trace("SendInputsBatch");
+    requireDevice(Network);
+    if(!batchSupported(Network) || !reserveBatch(Network, Rows))
+        return false;
+    Layer in = Network->inputLayer;
+    glBindTexture(GL_TEXTURE_2D, in->BatchTex);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, in->no_neuron, Rows, GL_RED, GL_FLOAT, Inputs);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    countUpload(sizeof(float) * in->no_neuron * Rows);
+    return true;
 }
 
-void HermesNetwork::appendHiddenLayer(NeuralNetwork Network, int LayerSize)
+bool TriggerNetworkBatch(NeuralNetwork Network, int Rows)
 {
-    Layer newL = initLayer(LayerSize, hiddenL);
-    Network->outputLayer->prev->next = newL;
-    newL->prev = Network->outputLayer->prev;
-    newL->next = Network->outputLayer;
-    Network->outputLayer->prev = newL;
+    using namespace HermesNetwork;
+    TraceScope trace("TriggerNetworkBatch");
+    countPageUse(Network);
+    requireDevice(Network);
+    if(Rows < 1 || Rows > Network->batchRows)
+        return false;
+    statInferences.fetch_add(Rows, std::memory_order_relaxed);
+    triggerBatch(Network, Rows);
+    return true;
+}
 
-    Network->no_layers++;
+bool FetchOutputBatch(NeuralNetwork Network, float Outputs[], int Rows)
+{
+    using namespace HermesNetwork;
+    TraceScope trace("FetchOutputBatch");
+    requireDevice(Network);
+    if(Rows < 1 || Rows > Network->batchRows)
+        return false;
+    Layer out = Network->outputLayer;
+    std::vector<float> rows(out->no_neuron * Network->batchRows);
+    glBindTexture(GL_TEXTURE_2D, out->BatchTex);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, rows.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    countReadback(sizeof(float) * rows.size());
+    std::copy(rows.begin(), rows.begin() + out->no_neuron * Rows, Outputs);
+    return true;
 }
 
-void HermesNetwork::connectLayer(Layer prev, Layer next)
+bool TrainNetworkBatch(NeuralNetwork Network, const float Targets[], int Rows, float LearningRate, const float Weights[])
 {
-	/*TODO
-	* check and delete next->WeightsTex and generate new one as per previous added layer no. of neurons
-	* vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
-	*/	
-    if (next->WeightsTex > 0)  //delete old texture RBO if next layer already connected to an old previous layer
-	{
-		glDeleteTextures(1, &next->WeightsTex);
-	}
-	//^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
+    using namespace HermesNetwork;
+    TraceScope trace("TrainNetworkBatch");
+    countPageUse(Network);
+    requireDevice(Network);
+    if(Rows < 1 || Rows > Network->batchRows)
+        return false;
+    statTrainingSteps.fetch_add(1, std::memory_order_relaxed);
+    int outputs = Network->outputLayer->no_neuron;
+    std::vector<float> targets(2 * outputs * Rows);
+    for(int s = 0; s < Rows; s++)
+        for(int n = 0; n < outputs; n++)
+        {
+            targets[2 * (s * outputs + n)] = Targets[s * outputs + n];
+            targets[2 * (s * outputs + n) + 1] = Weights ? Weights[s] : 1.0f;
+        }
+    glBindTexture(GL_TEXTURE_2D, Network->BatchTargetTex);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, outputs, Rows, GL_RG, GL_FLOAT, targets.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    countUpload(sizeof(float) * targets.size());
+    trainBatch(Network, Rows, LearningRate);
+    return true;
+}
 
-    /* init next's weight texture */
-	next->no_weight = (prev->no_neuron + 1) * next->no_neuron;
-	glGenTextures(1, &next->WeightsTex);
-	glBindTexture(GL_TEXTURE_2D, next->WeightsTex);	
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);	
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, next->no_weight, 1, 0, GL_RGBA, GL_FLOAT, NULL);	
+ReplayBuffer CreateReplayBuffer(int Capacity, int InputSize, int OutputSize)
+{
+    using namespace HermesNetwork;
+    TraceScope trace("CreateReplayBuffer");
+    GLint maxWidth = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxWidth);
+    int leaves = 1;
+    while(leaves < Capacity)
+        leaves *= 2;
+    if(Capacity < 1 || leaves > maxWidth || InputSize > maxWidth || OutputSize > maxWidth)
+        return nullptr;
 
-    glBindImageTexture(0, next->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
-    
-    glUseProgram(WeightInit);
+    ReplayBuffer Buffer = new ReplayBufferHandle;
+    Buffer->capacity = Capacity;
+    Buffer->no_of_input = InputSize;
+    Buffer->no_of_output = OutputSize;
+    Buffer->leaves = leaves;
+    Buffer->InputsTex = createDataTexture(InputSize, Capacity, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+    Buffer->TargetsTex = createDataTexture(OutputSize, Capacity, GL_RGBA32F, GL_RGBA, GL_FLOAT, NULL);
+    std::vector<float> tree(2 * leaves, 0.0f);
+    Buffer->PriorityTex = createDataTexture(leaves, 2, GL_R32F, GL_RED, GL_FLOAT, tree.data());
+    Buffer->seed = rand();
+    return Buffer;
+}
 
-    glUniform1i(WINT_unifm_seed, rand());    
-    glDispatchCompute(next->no_weight,1,1);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-    
+void AppendReplay(ReplayBuffer Buffer, const float Inputs[], const float Targets[], int Rows, float Priority)
+{
+    using namespace HermesNetwork;
+    TraceScope trace("AppendReplay");
+    writeReplayPriorities(Buffer, Rows, Priority);
+    for(int done = 0; done < Rows; )
+    {
+        int n = std::min(Rows - done, Buffer->capacity - Buffer->head);
+        glBindTexture(GL_TEXTURE_2D, Buffer->InputsTex);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, Buffer->head, Buffer->no_of_input, n, GL_RED, GL_FLOAT, Inputs + done * Buffer->no_of_input);
+        glBindTexture(GL_TEXTURE_2D, Buffer->TargetsTex);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, Buffer->head, Buffer->no_of_output, n, GL_RED, GL_FLOAT, Targets + done * Buffer->no_of_output);
+        countUpload(sizeof(float) * n * (Buffer->no_of_input + Buffer->no_of_output));
+        Buffer->head = (Buffer->head + n) % Buffer->capacity;
+        Buffer->count = std::min(Buffer->count + n, Buffer->capacity);
+        done += n;
+    }
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void HermesNetwork::triggerLayer(Layer Lyr)
-{	
-    glBindImageTexture(0, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
-    glBindImageTexture(ACTV_unifm_prev_L_TEX, Lyr->prev->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
-    glBindImageTexture(ACTV_unifm_Layer_weight, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
-    
-    glUseProgram(Activation);
-
-    glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
-    glUniform1i(ACTV_unifm_prev_size, Lyr->prev->no_neuron);
-    glUniform1i(ACTV_unifm_weight_size, Lyr->no_weight);
-    glDispatchCompute(Lyr->no_neuron,1,1);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);    
+void AppendReplayFromInputs(ReplayBuffer Buffer, NeuralNetwork Network, const float Targets[], float Priority)
+{
+    using namespace HermesNetwork;
+    TraceScope trace("AppendReplayFromInputs");
+    requireDevice(Network);
+    if((int)Network->no_of_input != Buffer->no_of_input)
+        return;
+    /* inputs sent by SendSparseInputs() are only in ActiveInputTex until scattered */
+    if(Network->inputLayer->activeInputs > 0)
+        scatterActiveInputs(Network->inputLayer);
+    writeReplayPriorities(Buffer, 1, Priority);
+    storeReplayRows(Buffer, Network->inputLayer->NeuronsTex, Buffer->InputsTex, Buffer->no_of_input, 1);
+    glBindTexture(GL_TEXTURE_2D, Buffer->TargetsTex);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, Buffer->head, Buffer->no_of_output, 1, GL_RED, GL_FLOAT, Targets);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    countUpload(sizeof(float) * Buffer->no_of_output);
+    Buffer->head = (Buffer->head + 1) % Buffer->capacity;
+    Buffer->count = std::min(Buffer->count + 1, Buffer->capacity);
 }
 
-void fetchLayerNeuronsData_ERR(HermesNetwork::Layer Lyr)
+bool TrainFromReplay(NeuralNetwork Network, ReplayBuffer Buffer, int Batch, float LearningRate, bool Prioritized)
 {
     using namespace HermesNetwork;
-    if(!Lyr->data)
-        Lyr->data = new float[Lyr->no_neuron];
-    glBindTexture(GL_TEXTURE_2D, Lyr->NeuronsTex);
-    glGetTexImage(GL_TEXTURE_2D, 0, GL_BLUE, GL_FLOAT, Lyr->data);
-    glBindTexture(GL_TEXTURE_2D, 0);    
+    TraceScope trace("TrainFromReplay");
+    countPageUse(Network);
+    requireDevice(Network);
+    if(!Buffer->count || Batch < 1 || (int)Network->no_of_input != Buffer->no_of_input || (int)Network->no_of_output != Buffer->no_of_output
+       || !batchSupported(Network) || !reserveBatch(Network, Batch))
+        return false;
+    statTrainingSteps.fetch_add(1, std::memory_order_relaxed);
+    if(Batch > Buffer->sampledRows)
+    {
+        glDeleteTextures(1, &Buffer->SampledTex);
+        Buffer->SampledTex = createDataTexture(Batch, 1, GL_R32F, GL_RED, GL_FLOAT, NULL);
+        Buffer->sampledRows = Batch;
+    }
+    if(Prioritized && Buffer->treeDirty)
+        buildReplayTree(Buffer);
+
+    /* minibatch is gathered straight into batch textures of Network */
+    glUseProgram(ReplaySample);
+    glBindImageTexture(0, Buffer->InputsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(1, Buffer->TargetsTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+    glBindImageTexture(2, Buffer->PriorityTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+    glBindImageTexture(3, Network->inputLayer->BatchTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glBindImageTexture(4, Network->BatchTargetTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glBindImageTexture(5, Buffer->SampledTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glUniform1i(RPLY_unifm_count, Buffer->count);
+    glUniform1i(RPLY_unifm_leaves, Buffer->leaves);
+    glUniform1i(RPLY_unifm_rows, Batch);
+    glUniform1ui(RPLY_unifm_seed, Buffer->seed + (unsigned int)Buffer->draws * 0x9E3779B9u);
+    glUniform1i(RPLY_unifm_prioritized, Prioritized);
+    glUniform1i(RPLY_unifm_input_size, Buffer->no_of_input);
+    glUniform1i(RPLY_unifm_output_size, Buffer->no_of_output);
+    dispatchCompute((Batch + 63) / 64, 1, 1);
+    memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    Buffer->draws++;
+
+    triggerBatch(Network, Batch);
+    if(Prioritized)
+    {
+        /* floor keeps every sample drawable once the network fits it */
+        glUseProgram(ReplayPriority);
+        glBindImageTexture(0, Network->outputLayer->BatchTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(1, Network->BatchTargetTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(2, Buffer->SampledTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(3, Buffer->PriorityTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glUniform1i(RPLY_unifm_rows, Batch);
+        glUniform1i(RPLY_unifm_output_size, Buffer->no_of_output);
+        glUniform1f(RPLY_unifm_floor, 1e-3f);
+        dispatchCompute((Batch + 63) / 64, 1, 1);
+        memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+        Buffer->treeDirty = true;
+    }
+    trainBatch(Network, Batch, LearningRate);
+    return true;
 }
 
-void HermesNetwork::fetchLayerNeuronsData(Layer Lyr)
+void DeleteReplayBuffer(ReplayBuffer Buffer)
 {
-    if(!Lyr->data)
-        Lyr->data = new float[Lyr->no_neuron];
-    glBindTexture(GL_TEXTURE_2D, Lyr->NeuronsTex);
-    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, Lyr->data);
-    glBindTexture(GL_TEXTURE_2D, 0);    
+    unsigned int textures[] = { Buffer->InputsTex, Buffer->TargetsTex, Buffer->PriorityTex, Buffer->SampledTex };
+    glDeleteTextures(4, textures);
+    delete Buffer;
+}
+
+void SaveNetwork(NeuralNetwork Network, const char filename[])
+{
+    HermesNetwork::TraceScope trace("SaveNetwork");
+    HermesNetwork::useNetwork(Network);
+    /*
+     *      FILE STRUCTURE
+     *
+     * -------------------------------------------
+     *  No of Layers | Input Size | Output Size             -int,int,int
+     * -------------------------------------------
+     *  1st Hidden Layer Size | [Array of weights]          -int,[float]
+     * -------------------------------------------
+     *  2nd Hidden Layer Size | [Array of weights]          -int,[float]
+     * -------------------------------------------
+     *      :
+     *      :
+     *  nth Hidden Layer Size | [Array of weights]          -int,[float]
+     * -------------------------------------------
+     *  (convolution/pooling layer in place of hidden layer)
+     *  -layerKind | Input Width,Height,Channels |
+     *  Channels,Kernel,Stride,Padding | [Array of weights] -int,int[3],int[4],[float]
+     * -------------------------------------------
+     *  (recurrent layer in place of hidden layer)
+     *  -recurrentK | Layer Size,Cell,Window |
+     *  [Array of weights]                                  -int,int[3],[float]
+     * -------------------------------------------
+     *  (self-attention layer in place of hidden layer)
+     *  -attentionK | Layer Size,Tokens,Heads |
+     *  [Array of weights]                                  -int,int[3],[float]
+     * -------------------------------------------
+     *  (sparse layer in place of hidden or output layer)
+     *  -sparseK | Layer Size | No of stored weights |
+     *  [Row offsets] | [Columns] | [Weights] | [Biases]    -int,int,int,[int],[int],[float],[float]
+     * -------------------------------------------
+     *  [Array of weights of Output Layer]                  -[float]
+     * -------------------------------------------
+     *  (optional, only for quantized network)
+     *  Int8SectionTag | [Activation scale of each Layer]   -int,[float]
+     *  [Packed int8 weights | Row scale & bias] per Layer  -[int],[float,float]
+     * -------------------------------------------
+     */
+    
+    std::fstream file;
+    file.open(filename,std::ios::out|std::ios::binary);
+    file.write((char*)&Network->no_layers, sizeof(int));
+    file.write((char*)&Network->no_of_input, sizeof(int));
+    file.write((char*)&Network->no_of_output, sizeof(int));
+
+    auto writeSparse = [&file](HermesNetwork::Layer L)
+    {
+        int marker = -HermesNetwork::sparseK;
+        std::vector<int> rowPtr(L->no_neuron + 1), colIndex(std::max(L->nnz, 1));
+        std::vector<float> values(L->no_weight);
+        glBindTexture(GL_TEXTURE_2D, L->RowPtrTex);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_INT, rowPtr.data());
+        glBindTexture(GL_TEXTURE_2D, L->ColIndexTex);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_INT, colIndex.data());
+        glBindTexture(GL_TEXTURE_2D, L->WeightsTex);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, values.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        HermesNetwork::countReadback(sizeof(int) * (rowPtr.size() + colIndex.size()) + sizeof(float) * values.size());
+        file.write((char*)&marker, sizeof(int));
+        file.write((char*)&L->no_neuron, sizeof(int));
+        file.write((char*)&L->nnz, sizeof(int));
+        file.write((char*)rowPtr.data(), sizeof(int) * rowPtr.size());
+        file.write((char*)colIndex.data(), sizeof(int) * L->nnz);
+        file.write((char*)values.data(), sizeof(float) * values.size());
+    };
+
+    HermesNetwork::Layer L = Network->inputLayer->next;
+    for(int i=1; i < Network->no_layers-1 ; i++,L = L->next)
+    {
+        if(L->kind == HermesNetwork::sparseK)
+        {
+            writeSparse(L);
+            continue;
+        }
+        if(L->kind == HermesNetwork::recurrentK)
+        {
+            int marker = -L->kind;
+            int shape[3] = { L->no_neuron, L->cell, L->window };
+            file.write((char*)&marker, sizeof(int));
+            file.write((char*)shape, sizeof(shape));
+        }
+        else if(L->kind == HermesNetwork::attentionK)
+        {
+            int marker = -L->kind;
+            int shape[3] = { L->no_neuron, L->tokens, L->heads };
+            file.write((char*)&marker, sizeof(int));
+            file.write((char*)shape, sizeof(shape));
+        }
+        else if(L->kind != HermesNetwork::denseK)
+        {
+            /* negative size marks an image layer, followed by its shape */
+            int marker = -L->kind;
+            int shape[7] = { L->prev->width, L->prev->height, L->prev->channels, L->channels, L->kernel, L->stride, L->padding };
+            file.write((char*)&marker, sizeof(int));
+            file.write((char*)shape, sizeof(shape));
+            if(L->no_weight == 0)
+                continue;
+        }
+        else
+            file.write((char*)&L->no_neuron, sizeof(int));
+        fetchLayerWeights_Bias(L);
+        file.write((char*)L->weights, sizeof(float) * L->no_weight);
+        freeLayerWeights_Bias(L);
+    }
+
+    if(Network->outputLayer->kind == HermesNetwork::sparseK)
+        writeSparse(Network->outputLayer);
+    else
+    {
+        fetchLayerWeights_Bias(Network->outputLayer);    
+        file.write((char*)Network->outputLayer->weights, sizeof(float) * Network->outputLayer->no_weight);    
+        freeLayerWeights_Bias(Network->outputLayer);
+    }
+
+    /* int8 section goes after fp32 data so that loaders without int8 support simply ignore it */
+    if(Network->quantized)
+    {
+        file.write((char*)&HermesNetwork::Int8SectionTag, sizeof(int));
+        for(L = Network->inputLayer; L != nullptr; L = L->next)
+            file.write((char*)&L->ActScale, sizeof(float));
+
+        for(L = Network->inputLayer->next; L != nullptr; L = L->next)
+        {
+            if(L->kind != HermesNetwork::denseK)
+                continue;
+            int packedRow = (L->prev->no_neuron + 3) / 4;
+            int *qWeights = new int[L->no_neuron * packedRow];
+            float *qScale = new float[L->no_neuron * 2];
+            glBindTexture(GL_TEXTURE_2D, L->QWeightsTex);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RED_INTEGER, GL_INT, qWeights);
+            glBindTexture(GL_TEXTURE_2D, L->QScaleTex);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_FLOAT, qScale);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            HermesNetwork::countReadback(sizeof(int) * L->no_neuron * packedRow + sizeof(float) * L->no_neuron * 2);
+            file.write((char*)qWeights, sizeof(int) * L->no_neuron * packedRow);
+            file.write((char*)qScale, sizeof(float) * L->no_neuron * 2);
+            delete[] qWeights;
+            delete[] qScale;
+        }
+    }
+    file.close();
 }
 
-void HermesNetwork::fetchLayerWeights_Bias(Layer Lyr)
-{
-    if(!Lyr->weights)
-        Lyr->weights = new float[Lyr->no_weight];
-    glBindTexture(GL_TEXTURE_2D, Lyr->WeightsTex);
-    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, Lyr->weights);
-    glBindTexture(GL_TEXTURE_2D, 0);    
-}
+NeuralNetwork LoadNetwork(const char filename[])
+{
+    HermesNetwork::TraceScope trace("LoadNetwork");
+    HermesNetwork::RecordScope record;
+    /*
+     *      FILE STRUCTURE
+     *
+     * -------------------------------------------
+     *  No of Layers | Input Size | Output Size             -int,int,int
+     * -------------------------------------------
+     *  1st Hidden Layer Size | [Array of weights]          -int,[float]
+     * -------------------------------------------
+     *  2nd Hidden Layer Size | [Array of weights]          -int,[float]
+     * -------------------------------------------
+     *      :
+     *      :
+     *  nth Hidden Layer Size | [Array of weights]          -int,[float]
+     * -------------------------------------------
+     *  (convolution/pooling layer in place of hidden layer)
+     *  -layerKind | Input Width,Height,Channels |
+     *  Channels,Kernel,Stride,Padding | [Array of weights] -int,int[3],int[4],[float]
+     * -------------------------------------------
+     *  (recurrent layer in place of hidden layer)
+     *  -recurrentK | Layer Size,Cell,Window |
+     *  [Array of weights]                                  -int,int[3],[float]
+     * -------------------------------------------
+     *  (self-attention layer in place of hidden layer)
+     *  -attentionK | Layer Size,Tokens,Heads |
+     *  [Array of weights]                                  -int,int[3],[float]
+     * -------------------------------------------
+     *  (sparse layer in place of hidden or output layer)
+     *  -sparseK | Layer Size | No of stored weights |
+     *  [Row offsets] | [Columns] | [Weights] | [Biases]    -int,int,int,[int],[int],[float],[float]
+     * -------------------------------------------
+     *  [Array of weights of Output Layer]                  -[float]
+     * -------------------------------------------
+     *  (optional, only for quantized network)
+     *  Int8SectionTag | [Activation scale of each Layer]   -int,[float]
+     *  [Packed int8 weights | Row scale & bias] per Layer  -[int],[float,float]
+     * -------------------------------------------
+     */
+
+    std::fstream file;
+    file.open(filename, std::ios::in| std::ios::binary);
+    if(!file.is_open())
+        return nullptr;
+    int layerSize, inputSize, outputSize;
+    file.read((char*)&layerSize,sizeof(int));
+    file.read((char*)&inputSize,sizeof(int));
+    file.read((char*)&outputSize,sizeof(int));
+    
+
+    NeuralNetwork Network = HermesNetwork::createBasicNetwork(inputSize, outputSize);    
+    HermesNetwork::Layer L = Network->inputLayer;
+    int hlSize = 0;    
+
+    /* reads the rest of a sparse record, after its layer size */
+    auto readSparse = [&file](HermesNetwork::Layer L)
+    {
+        int nnz;
+        file.read((char*)&nnz, sizeof(int));
+        std::vector<int> rowPtr(L->no_neuron + 1), colIndex(nnz);
+        std::vector<float> values(nnz + L->no_neuron);
+        file.read((char*)rowPtr.data(), sizeof(int) * rowPtr.size());
+        file.read((char*)colIndex.data(), sizeof(int) * nnz);
+        file.read((char*)values.data(), sizeof(float) * values.size());
+        HermesNetwork::uploadSparseLayer(L, nnz, rowPtr.data(), colIndex.data(), values.data());
+    };
+
+    for(int i = 1; i < layerSize-1; i++)
+    {
+        file.read((char*)&hlSize,sizeof(int));
+        std::cout<<"\nhlS: "<<hlSize;        
+        if(hlSize == -HermesNetwork::sparseK)
+        {
+            file.read((char*)&hlSize,sizeof(int));
+            HermesNetwork::appendHiddenLayer(Network,hlSize);
+            L = L->next;
+            readSparse(L);
+            continue;
+        }
+        if(hlSize == -HermesNetwork::recurrentK)
+        {
+            int shape[3];
+            file.read((char*)shape, sizeof(shape));
+            HermesNetwork::appendRecurrentLayer(Network, shape[0], shape[1], shape[2]);
+            HermesNetwork::connectLayer(L,L->next);
+            L = L->next;
+            std::vector<float> rnnWeights(L->no_weight);
+            file.read((char*)rnnWeights.data(), sizeof(float) * L->no_weight);
+            int rowSize = L->prev->no_neuron + L->no_neuron + 1;
+            glBindTexture(GL_TEXTURE_2D, L->WeightsTex);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, rowSize, L->no_weight / rowSize, 0, GL_RED, GL_FLOAT, rnnWeights.data());
+            glBindTexture(GL_TEXTURE_2D, 0);
+            Network->netType = HermesNetwork::recurrent;
+            continue;
+        }
+        if(hlSize == -HermesNetwork::attentionK)
+        {
+            int shape[3];
+            file.read((char*)shape, sizeof(shape));
+            HermesNetwork::appendAttentionLayer(Network, shape[1], shape[2]);
+            HermesNetwork::connectLayer(L,L->next);
+            L = L->next;
+            std::vector<float> attnWeights(L->no_weight);
+            file.read((char*)attnWeights.data(), sizeof(float) * L->no_weight);
+            int D = L->no_neuron / L->tokens;
+            glBindTexture(GL_TEXTURE_2D, L->WeightsTex);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, D + 1, 4 * D, 0, GL_RED, GL_FLOAT, attnWeights.data());
+            glBindTexture(GL_TEXTURE_2D, 0);
+            Network->netType = HermesNetwork::attention;
+            continue;
+        }
+        if(hlSize < 0)
+        {
+            int shape[7];
+            file.read((char*)shape, sizeof(shape));
+            L->width = shape[0];
+            L->height = shape[1];
+            L->channels = shape[2];
+            if(-hlSize == HermesNetwork::convolutionK)
+                HermesNetwork::appendConvolutionLayer(Network, shape[3], shape[4], shape[5], shape[6]);
+            else
+                HermesNetwork::appendPoolingLayer(Network, shape[4], shape[5]);
+            Network->netType = HermesNetwork::convolutional;
+        }
+        else
+            HermesNetwork::appendHiddenLayer(Network,hlSize);
+        HermesNetwork::connectLayer(L,L->next);     
+
+        L = L->next;        
+        if(L->no_weight == 0)
+            continue;
+        float *hlWeights = new float[L->no_weight];
+        file.read((char*)hlWeights, sizeof(float) * L->no_weight);        
+        glBindTexture(GL_TEXTURE_2D, L->WeightsTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, L->no_weight, 1, 0, GL_RED, GL_FLOAT, hlWeights);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        delete[] hlWeights;        
+    }
 
-void HermesNetwork::freeLayerNeuronData(Layer Lyr)
-{
-    if(Lyr->type == hiddenL)
+    /* sparse marker is a NaN bit pattern, so it can't be mistaken for the first dense output weight */
+    int outMarker = 0;
+    file.read((char*)&outMarker, sizeof(int));
+    L = Network->outputLayer;
+    if(outMarker == -HermesNetwork::sparseK)
     {
-        delete[] Lyr->data;        
-        Lyr->data = nullptr;
+        file.read((char*)&hlSize,sizeof(int));
+        readSparse(L);
     }
-}
-    
-void HermesNetwork::freeLayerWeights_Bias(Layer Lyr)
-{
-    if(Lyr->type != inputL)
+    else
     {
-        delete[] Lyr->weights;
-        Lyr->weights = nullptr;
+        HermesNetwork::connectLayer(L->prev,L);     
+
+        float *outputWeights = new float[L->no_weight];
+        std::memcpy(outputWeights, &outMarker, sizeof(float));
+        file.read((char*)(outputWeights + 1), sizeof(float) * (L->no_weight - 1));    
+        glBindTexture(GL_TEXTURE_2D, L->WeightsTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, L->no_weight, 1, 0, GL_RED, GL_FLOAT,outputWeights);    
+        glBindTexture(GL_TEXTURE_2D, 0);
+        delete[] outputWeights;
     }
-}
 
-void HermesNetwork::calcError(Layer Lyr, float* ActualOutput)
-{
-    /* convert output array to texture */
-	glBindTexture(GL_TEXTURE_2D, TempTex);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, Lyr->no_neuron, 1, 0, GL_RED, GL_FLOAT, ActualOutput);
-    
-    glBindImageTexture(ERROR_unifm_neuronOut_TEX, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
-    glBindImageTexture(ERROR_unifm_actualOut_TEX, TempTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
+    /* optional int8 section */
+    int tag = 0;
+    if(file.read((char*)&tag, sizeof(int)) && tag == HermesNetwork::Int8SectionTag)
+    {
+        for(L = Network->inputLayer; L != nullptr; L = L->next)
+            file.read((char*)&L->ActScale, sizeof(float));
 
-    glUseProgram(ErrorGen);
+        for(L = Network->inputLayer->next; L != nullptr; L = L->next)
+        {
+            if(L->kind != HermesNetwork::denseK)
+                continue;
+            int packedRow = (L->prev->no_neuron + 3) / 4;
+            int *qWeights = new int[L->no_neuron * packedRow];
+            float *qScale = new float[L->no_neuron * 2];
+            file.read((char*)qWeights, sizeof(int) * L->no_neuron * packedRow);
+            file.read((char*)qScale, sizeof(float) * L->no_neuron * 2);
+            L->QWeightsTex = HermesNetwork::createDataTexture(L->no_neuron * packedRow, 1, GL_R32I, GL_RED_INTEGER, GL_INT, qWeights);
+            L->QScaleTex = HermesNetwork::createDataTexture(L->no_neuron, 1, GL_RGBA32F, GL_RG, GL_FLOAT, qScale);
+            L->prev->QNeuronsTex = HermesNetwork::createDataTexture(packedRow, 1, GL_R32I, GL_RED_INTEGER, GL_INT, NULL);
+            L->int8 = true;
+            delete[] qWeights;
+            delete[] qScale;
+        }
+        Network->quantized = true;
+    }
 
-    glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
-    glDispatchCompute(Lyr->no_neuron,1,1);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);  
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+    //permanently bind output layer with Out array
+    fetchLayerNeuronsData(Network->outputLayer);
+    Network->Out = Network->outputLayer->data;    
+    if(HermesNetwork::autotune)
+        HermesNetwork::autotuneNetwork(Network);
+    if(HermesNetwork::devicesCalibrated)
+        SetNetworkDevice(Network, AutoDevice);
+    HermesNetwork::useNetwork(Network);
+
+    if(record.active)
+    {
+        /* whole file goes into log, replay doesn't need it */
+        file.clear();
+        file.seekg(0, std::ios::end);
+        int size = file.tellg();
+        std::vector<char> bytes(size);
+        file.seekg(0);
+        file.read(bytes.data(), size);
+
+        unsigned char op = HermesNetwork::loadR;
+        int id = HermesNetwork::recordIds.size();
+        HermesNetwork::recordIds[Network] = id;
+        HermesNetwork::recordBytes(&op, 1);
+        HermesNetwork::recordBytes(&id, sizeof(int));
+        HermesNetwork::recordBytes(&size, sizeof(int));
+        HermesNetwork::recordBytes(bytes.data(), size);
+    }
+
+    file.close();
+    return Network;
 }
 
-void HermesNetwork::trainLayer(Layer Lyr, float* LearningRate)
+void DeleteNetwork(NeuralNetwork Network)
 {
-    glBindImageTexture(WGHTUP_unifm_weight_TEX, Lyr->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
-    glBindImageTexture(WGHTUP_unifm_neuronOut_TEX, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
-    glBindImageTexture(WGHTUP_unifm_prev_L_TEX, Lyr->prev->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
-    
-    glUseProgram(WeightUpdate);
-    
-    glUniform1i(WGHTUP_unifm_prev_size, Lyr->prev->no_neuron);
-    glUniform1i(WGHTUP_unifm_next_size, Lyr->no_neuron);
-    glUniform1i(WGHTUP_unifm_LearnRT, *LearningRate);
-    glDispatchCompute(Lyr->no_weight,1,1);    
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);    
+    if(Network)
+        HermesNetwork::deleteNetwork(Network);
 }
 
-void HermesNetwork::backPropogateError(Layer Lyr)
+void SetActivation(NeuralNetwork Network, ActivationType AllLayersType)
 {
-    glBindImageTexture(ERROR_BP_unifm_neuronOut_TEX, Lyr->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
-    glBindImageTexture(ERROR_BP_unifm_next_L_TEX, Lyr->next->NeuronsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
-    glBindImageTexture(ERROR_BP_unifm_weight_TEX, Lyr->next->WeightsTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);    
-    
-    glUseProgram(ErrorBackPropogate);
+    using namespace HermesNetwork;
+    RecordScope record;
+    if(record.active)
+    {
+        /* same as setting hidden and output layers to one type */
+        int id = recordNetwork(Network);
+        unsigned char op = activationR, type[2] = { (unsigned char)AllLayersType, (unsigned char)AllLayersType };
+        recordBytes(&op, 1);
+        recordBytes(&id, sizeof(int));
+        recordBytes(type, 2);
+    }
 
-    glUniform1i(ACTVLibs_unifm_SEL, Lyr->AFun);
-    glUniform1i(ERROR_BP_unifm_Layer_size, Lyr->no_neuron);
-    glUniform1i(ERROR_BP_unifm_next_L_size, Lyr->next->no_neuron);
-    glDispatchCompute(Lyr->no_neuron,1,1);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);    
+	Layer Lyr = Network->inputLayer;    
+	for (int i = 1; i < Network->no_layers; i++)
+	{
+		Lyr = Lyr->next;
+        if(Lyr->kind == poolingK || Lyr->kind == recurrentK || (AllLayersType == Softmax && Lyr != Network->outputLayer))
+            continue;
+		Lyr->AFun = AllLayersType;
+	}
+    
 }
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-
 
-//////////////////////////////////////////////////////// public functions  /////////////////////////////////////////////////////////////////
-bool InitNeuralLink(bool GL_Context_Shared = false)
+void SetActivation(NeuralNetwork Network, ActivationType HiddenLayersType, ActivationType OutputLayersType)
 {
-    using namespace HermesNetwork;    
-    if(!GL_Context_Shared)
+    using namespace HermesNetwork;
+    RecordScope record;
+    if(record.active)
     {
-        //Create window context
-        #ifdef _WIN32
-                HWND offscreen_context = ::CreateWindowA("STATIC", "OpenGL Context Space", 0 , 0, 0, 0, 0, NULL, NULL, NULL, NULL);
-                PIXELFORMATDESCRIPTOR pfd =
-                        {
-                                sizeof(PIXELFORMATDESCRIPTOR),1,
-                                PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL | PFD_DOUBLEBUFFER, PFD_TYPE_RGBA,
-                                32,0,0,0,0,0,0,
-                                0,0,0,0,0,0,
-                                0,24,8,0,
-                                PFD_MAIN_PLANE,0,0, 0, 0
-                        };
-                HDC DC = GetDC(offscreen_context);
-                int  letWindowsChooseThisPixelFormat;
-                letWindowsChooseThisPixelFormat = ChoosePixelFormat(DC, &pfd);
-                SetPixelFormat(DC,letWindowsChooseThisPixelFormat, &pfd);
-                GlRenderingContext = wglCreateContext(DC);
-                wglMakeCurrent (DC, GlRenderingContext);
-                //wglDeleteContext(GLRenderingContext);
-        #endif
-        #ifdef __linux__
-                Xdisplay = XOpenDisplay(NULL);
-                int s = DefaultScreen(Xdisplay);
-                Xoffscreen_window = XCreateSimpleWindow(Xdisplay, RootWindow(Xdisplay, s), 0, 0, 800, 500, 1, BlackPixel(Xdisplay, s), WhitePixel(Xdisplay, s));      
-                //XMapWindow(Xdisplay, Xoffscreen_window);
-
-                GLint att[] = { GLX_RGBA, GLX_DEPTH_SIZE, 24, GLX_DOUBLEBUFFER, None };
-                XVisualInfo *vi = glXChooseVisual(Xdisplay, 0, att);                
-                GlRenderingContext = glXCreateContext(Xdisplay, vi, NULL, GL_TRUE);
-                glXMakeCurrent(Xdisplay, Xoffscreen_window, GlRenderingContext);  
-                delete vi; 
-        #endif
-        #ifdef __APPLE__
-                //call macOS api to create invisible window
-                            //attatch gl viewport
-                            //make gl context
-        #endif
-        #ifdef __ANDROID__
-                //call macOS api to create invisible window
-                            //attatch gl viewport
-                            //make gl context
-        #endif
+        int id = recordNetwork(Network);
+        unsigned char op = activationR, type[2] = { (unsigned char)HiddenLayersType, (unsigned char)OutputLayersType };
+        recordBytes(&op, 1);
+        recordBytes(&id, sizeof(int));
+        recordBytes(type, 2);
     }
+    SetActivation(Network,HiddenLayersType);
+    Network->outputLayer->AFun = OutputLayersType;
+}
 
+void Terrify(NeuralNetwork N)
+{    
+    HermesNetwork::useNetwork(N);
+    HermesNetwork::Layer l = N->inputLayer;   
+    while(l != nullptr)
+        {
+            glBindTexture(GL_TEXTURE_2D, l->WeightsTex);    
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindTexture(GL_TEXTURE_2D, 0);
 
-    //Init openGl context
-    #ifdef __glew_h__
-        glewInit();
-    #endif
-    #ifdef __glut_h__
-        glutInit(NULL,NULL);
-    #endif
-    #ifdef  __FREEGLUT_H__
-        glutInit(NULL,NULL);
-    #endif
-
-    /* Create And Compile Shaders */
-    int WeightInitComputetShader = glCreateShader(GL_COMPUTE_SHADER);
-    int ActivationComputeShader = glCreateShader(GL_COMPUTE_SHADER);
-    int ErrorGenComputeShader = glCreateShader(GL_COMPUTE_SHADER);
-    int WeightUpdateComputeShader = glCreateShader(GL_COMPUTE_SHADER);   
-    int ErrorBPComputeShader = glCreateShader(GL_COMPUTE_SHADER);
-    int Active_DeriveLibsComputeShader = glCreateShader(GL_COMPUTE_SHADER);
-           
-
-    glShaderSource(WeightInitComputetShader, 1, &WeightInitShader_code, NULL);
-    glShaderSource(ActivationComputeShader, 1, &ActivationShader_code, NULL);
-    glShaderSource(ErrorGenComputeShader, 1, &ErrorGen_code, NULL);
-    glShaderSource(WeightUpdateComputeShader, 1, &WeightUpdateShader_code, NULL);
-    glShaderSource(ErrorBPComputeShader, 1, &ErrorBackPropogate_code, NULL);
-    glShaderSource(Active_DeriveLibsComputeShader, 1, &ActiveDeriveLibs_code, NULL);
+            glBindTexture(GL_TEXTURE_2D, l->NeuronsTex);    
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            l = l->next;            
+        }                    
+}
 
+void DeTerrify(NeuralNetwork N)
+{    
+    HermesNetwork::useNetwork(N);
+    HermesNetwork::Layer l = N->inputLayer;   
+    while(l != nullptr)
+    {
+        glBindTexture(GL_TEXTURE_2D, l->WeightsTex);    
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
 
+        glBindTexture(GL_TEXTURE_2D, l->NeuronsTex);    
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        l = l->next;            
+    }                    
+}
 
-    glCompileShader(WeightInitComputetShader);
-    glCompileShader(ActivationComputeShader);
-    glCompileShader(ErrorGenComputeShader);
-    glCompileShader(WeightUpdateComputeShader);
-    glCompileShader(ErrorBPComputeShader);
-    glCompileShader(Active_DeriveLibsComputeShader);
-   
 
-    
+float QuantizeNetwork(NeuralNetwork Network, float SampleInputs[], int SampleCount)
+{
+    using namespace HermesNetwork;
 
-    /* handle compile error	*/
-    std::cout << "Compute Shader Builds: [";
-    int success;
-    bool fail;
-    glGetShaderiv(WeightInitComputetShader, GL_COMPILE_STATUS, &success); fail |= !success;
-    std::cout << success<< ",";
-    glGetShaderiv(ActivationComputeShader, GL_COMPILE_STATUS, &success); fail |= !success;
-    std::cout << success<< ",";
-    glGetShaderiv(ErrorGenComputeShader, GL_COMPILE_STATUS, &success); fail |= !success;
-    std::cout << success<< ",";
-    glGetShaderiv(WeightUpdateComputeShader, GL_COMPILE_STATUS, &success); fail |= !success;
-    std::cout << success<< ",";
-    glGetShaderiv(ErrorBPComputeShader, GL_COMPILE_STATUS, &success); fail |= !success;
-    std::cout << success<< ",";
-    glGetShaderiv(Active_DeriveLibsComputeShader, GL_COMPILE_STATUS, &success); fail |= !success;
-    std::cout << success<< ",";
-    std::cout <<"] " << fail << std::endl;
+    requireDevice(Network);
 
+    /* calibration: run samples through fp32 path and track largest activation of every layer */
+    SetQuantizedInference(Network, false);
+    std::vector<float> fp32Out(SampleCount * Network->no_of_output);
+    std::vector<float> absMax(Network->no_layers, 0);
+    for(int s = 0; s < SampleCount; s++)
+    {
+        float *sample = SampleInputs + s * Network->no_of_input;
+        for(int i = 0; i < (int)Network->no_of_input; i++)
+            absMax[0] = std::max(absMax[0], std::abs(sample[i]));
 
-    char infoLog[512];
-    glGetShaderInfoLog(Active_DeriveLibsComputeShader, 512, NULL, infoLog);
-    std::cout<<infoLog;
-    if(fail)
-        return !fail;
+        SendInputs(Network, sample);
+        TriggerNetwork(Network);
 
+        Layer L = Network->inputLayer->next;
+        for(int d = 1; L != nullptr; d++, L = L->next)
+        {
+            fetchLayerNeuronsData(L);
+            for(int i = 0; i < L->no_neuron; i++)
+                absMax[d] = std::max(absMax[d], std::abs(L->data[i]));
+            freeLayerNeuronData(L);
+        }
+        std::copy(Network->Out, Network->Out + Network->no_of_output, &fp32Out[s * Network->no_of_output]);
+    }
 
+    /* quantize weights with scales picked by calibration */
+    Layer L = Network->inputLayer;
+    for(int d = 0; L != nullptr; d++, L = L->next)
+    {
+        L->ActScale = absMax[d] > 0 ? absMax[d] / 127.0f : 1.0f;
+        if(L != Network->inputLayer && L->kind == denseK)
+            quantizeLayer(L);
+    }
+    Network->quantized = true;
 
-    /* remove shader source codes from memory	*/
+    /* measure how far int8 outputs drift from fp32 outputs */
+    float maxError = 0;
+    for(int s = 0; s < SampleCount; s++)
+    {
+        SendInputs(Network, SampleInputs + s * Network->no_of_input);
+        TriggerNetwork(Network);
+        FetchOutputLayerData(Network);
+        for(int i = 0; i < (int)Network->no_of_output; i++)
+            maxError = std::max(maxError, std::abs(Network->Out[i] - fp32Out[s * Network->no_of_output + i]));
+    }
+    return maxError;
+}
 
+void SetQuantizedInference(NeuralNetwork Network, bool Enable)
+{
+    if(!Network->quantized)
+        return;
+    HermesNetwork::useNetwork(Network);
 
-    /* bind shader programs */
-    WeightInit = glCreateProgram();
-    glAttachShader(WeightInit, WeightInitComputetShader);
-    glLinkProgram(WeightInit);
+    /* only layers that were quantized have int8 weights */
+    HermesNetwork::Layer L = Network->inputLayer->next;
+    for(; L != nullptr; L = L->next)
+        L->int8 = Enable && L->QWeightsTex != 0;
+}
 
-    Activation = glCreateProgram();
-    glAttachShader(Activation, Active_DeriveLibsComputeShader);
-    glAttachShader(Activation, ActivationComputeShader);
-	glLinkProgram(Activation);
+int PruneNetwork(NeuralNetwork Network, PruneCriterion Criterion, float Threshold, float SampleInputs[], int SampleCount)
+{
+    using namespace HermesNetwork;
+    if(Criterion == ActivationStats && (!SampleInputs || SampleCount <= 0))
+        return 0;
+    requireDevice(Network);
+
+    /* pruned sizes no longer match int8 data, same as after training */
+    SetQuantizedInference(Network, false);
+    Network->quantized = false;
+
+    /* only dense hidden layers feeding a dense layer can be shrunk */
+    std::vector<Layer> layers;
+    std::vector<unsigned int> stats;
+    for(Layer L = Network->inputLayer->next; L != Network->outputLayer; L = L->next)
+        if(L->kind == denseK && L->next->kind == denseK)
+        {
+            layers.push_back(L);
+            stats.push_back(createDataTexture(L->no_neuron, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT, std::vector<float>(L->no_neuron * 4, 0).data()));
+        }
 
-    ErrorGen = glCreateProgram();
-    glAttachShader(ErrorGen, Active_DeriveLibsComputeShader);
-    glAttachShader(ErrorGen, ErrorGenComputeShader);
-	glLinkProgram(ErrorGen);
+    /* gather statistics on GPU before any layer changes size */
+    for(int s = 0; s < SampleCount; s++)
+    {
+        SendInputs(Network, SampleInputs + s * Network->no_of_input);
+        TriggerNetwork(Network);
+        for(size_t i = 0; i < layers.size(); i++)
+            accumulateNeuronStats(layers[i], stats[i]);
+    }
+    for(size_t i = 0; i < layers.size(); i++)
+        outgoingWeightNorm(layers[i], stats[i]);
 
-    WeightUpdate = glCreateProgram();
-    glAttachShader(WeightUpdate, WeightUpdateComputeShader);
-	glLinkProgram(WeightUpdate);
+    int removed = 0;
+    for(size_t i = 0; i < layers.size(); i++)
+    {
+        Layer L = layers[i];
+        std::vector<float> stat(L->no_neuron * 4), importance(L->no_neuron), mean;
+        glBindTexture(GL_TEXTURE_2D, stats[i]);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, stat.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        countReadback(sizeof(float) * stat.size());
+        glDeleteTextures(1, &stats[i]);
 
-    ErrorBackPropogate = glCreateProgram();
-    glAttachShader(ErrorBackPropogate, Active_DeriveLibsComputeShader);
-    glAttachShader(ErrorBackPropogate, ErrorBPComputeShader);
-	glLinkProgram(ErrorBackPropogate);
+        for(int n = 0; n < L->no_neuron; n++)
+        {
+            if(Criterion == WeightNorm)
+                importance[n] = stat[n * 4 + 3];
+            else
+            {
+                /* a neuron that barely changes is replaced by its mean in next layer's bias */
+                float m = stat[n * 4] / SampleCount;
+                importance[n] = std::sqrt(std::max(stat[n * 4 + 1] / SampleCount - m * m, 0.0f));
+                mean.push_back(m);
+            }
+        }
 
-    /* remove compiled shader from RAM */
-    glDeleteShader(WeightInitComputetShader);
-    glDeleteShader(ActivationComputeShader);
-    glDeleteShader(ErrorGenComputeShader);
-    glDeleteShader(WeightUpdateComputeShader);   
-    glDeleteShader(ErrorBPComputeShader);    
-    glDeleteShader(Active_DeriveLibsComputeShader);    
-   
+        std::vector<int> keep;
+        for(int n = 0; n < L->no_neuron; n++)
+            if(importance[n] >= Threshold)
+                keep.push_back(n);
+        if(keep.empty())
+            keep.push_back(std::max_element(importance.begin(), importance.end()) - importance.begin());
+        if((int)keep.size() == L->no_neuron)
+            continue;
+
+        removed += L->no_neuron - keep.size();
+        compactLayer(L, keep, mean);
+    }
 
-    /* Initialize Temporary Texture for misc operations */
-    glGenTextures(1, &TempTex);
-    glBindTexture(GL_TEXTURE_2D, TempTex);
-    /*glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, newL->no_neuron, 1, 0, GL_RGB, GL_FLOAT, NULL);*/
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    /* texture sizes changed but not which exist, so network is measured again as if new */
+    if(removed > 0 && Network->residentBytes >= 0)
+    {
+        residentBytes -= Network->residentBytes;
+        Network->residentBytes = -1;
+    }
+    return removed;
+}
 
+int SparsifyLayer(NeuralNetwork Network, int LayerDepth, float Sparsity)
+{
+    using namespace HermesNetwork;
 
-    /* Get all uniform locations */
+    /* Don't allow input layer */
+    if(LayerDepth <= 0 || LayerDepth >= (int)Network->no_layers)
+        return 0;
+    requireDevice(Network);
 
-    //explicit function selector location as defined in ActiveDeriveLibs shader
-    //explicit location used to maintain common location across all sharing compute shader program
-    //take care that no other uniforms in ohter shader is explicitly in same location
-    ACTVLibs_unifm_SEL = 0;
+	/* Select Layer at given depth */
+    Layer Lyr = Network->inputLayer;
+	for (int i = 0; i < LayerDepth; i++)
+		Lyr = Lyr->next;
+    if(Lyr->kind != denseK)
+        return Lyr->nnz;
+
+    /* magnitude below which weights are dropped, biases are always kept */
+    fetchLayerWeights_Bias(Lyr);
+    int rowSize = Lyr->prev->no_neuron + 1;
+    std::vector<float> magnitude;
+    for(int k = 0; k < Lyr->no_weight; k++)
+        if(k % rowSize != rowSize - 1)
+            magnitude.push_back(std::abs(Lyr->weights[k]));
+    freeLayerWeights_Bias(Lyr);
+
+    int drop = std::min((int)(Sparsity * magnitude.size()), (int)magnitude.size());
+    float threshold = -1;
+    if(drop > 0)
+    {
+        std::nth_element(magnitude.begin(), magnitude.begin() + drop - 1, magnitude.end());
+        threshold = magnitude[drop - 1];
+    }
+    return sparsifyLayer(Lyr, threshold);
+}
 
+void SetProfiling(bool Enable)
+{
+    using namespace HermesNetwork;
+    if(Enable == profiling)
+        return;
+    if(Enable)
+    {
+        /* query objects are made once, at first use */
+        if(profileRing.empty())
+        {
+            profileRing.resize(ProfileRingSize);
+            for(ProfileQuery& q: profileRing)
+            {
+                glGenQueries(1, &q.begin);
+                glGenQueries(1, &q.end);
+            }
+        }
+        profileStats.clear();
+    }
+    while(profilePending > 0)
+        collectProfileQueries(true);
+    profiling = Enable;
+}
 
-    glUseProgram(WeightInit);
-    WINT_unifm_seed = glGetUniformLocation(WeightInit, "seed");
+void StartTrace(int MaxEvents)
+{
+    using namespace HermesNetwork;
+    tracing = false;
+    traceEvents.assign(std::max(MaxEvents, 1), TraceEvent());
+    traceNext = 0;
+    traceOrigin = std::chrono::steady_clock::now();
+
+    /* GPU timestamps are placed on host timeline by their offset at start */
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    traceGpuOffset = gpuNow - traceClock();
+    tracing = true;
+}
 
-    glUseProgram(Activation);
-	ACTV_unifm_prev_size = glGetUniformLocation(Activation, "PreviousLayer_size");
-	ACTV_unifm_weight_size = glGetUniformLocation(Activation, "Weight_size");
-	ACTV_unifm_prev_L_TEX = 1;    // from shader uniform layout binding
-	ACTV_unifm_Layer_weight = 2;  // from shader uniform layout binding  
-    ACTVLibs_unifm_SEL = glGetUniformLocation(Activation, "selection");
+void StopTrace()
+{
+    using namespace HermesNetwork;
+    while(profilePending > 0)
+        collectProfileQueries(true);
+    tracing = false;
+}
 
-    std::cout<<"LOC: "<< glGetUniformLocation(Activation, "selection") << " "<<  ACTV_unifm_prev_size << std::endl;
+bool ExportTrace(const char filename[])
+{
+    using namespace HermesNetwork;
+    std::ofstream file(filename);
+    if(!file.is_open())
+        return false;
+    file << std::fixed;
+    file.precision(3);
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+    for(int t = 1; t <= traceThreads; t++)
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t << ",\"args\":{\"name\":\"Host " << t << "\"}}";
+
+    long long count = std::min(traceNext.load(), (long long)traceEvents.size());
+    for(long long k = 0; k < count; k++)
+    {
+        const TraceEvent& e = traceEvents[k];
+        file << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category << "\",\"ph\":\"" << e.ph
+             << "\",\"pid\":1,\"tid\":" << e.tid << ",\"ts\":" << e.ts / 1000.0;
+        if(e.ph == 'X')
+            file << ",\"dur\":" << e.dur / 1000.0;
+        else
+            file << ",\"s\":\"t\"";
+        file << ",\"args\":{";
+        if(e.layer >= 0)
+            file << "\"layer\":" << e.layer;
+        if(e.grid[0] > 0)
+            file << (e.layer >= 0 ? "," : "") << "\"grid\":[" << e.grid[0] << "," << e.grid[1] << "," << e.grid[2] << "]";
+        file << "}}";
+    }
+    file << "\n]}\n";
+    return file.good();
+}
 
-    glUseProgram(ErrorGen);
-    ERROR_unifm_neuronOut_TEX = 0; // from shader uniform layout binding
-    ERROR_unifm_actualOut_TEX = 1; // from shader uniform layout binding
-    std::cout<<"LOC: "<< glGetUniformLocation(Activation, "selection") << " "<<  glGetUniformLocation(ErrorGen, "NeuronsOutput") << std::endl;
+std::vector<LayerProfile> GetProfile(NeuralNetwork Network)
+{
+    using namespace HermesNetwork;
+    while(profilePending > 0)
+        collectProfileQueries(true);
 
-    glUseProgram(WeightUpdate);
-    WGHTUP_unifm_next_size = glGetUniformLocation(WeightUpdate, "NextLayer_size");
-    WGHTUP_unifm_prev_size = glGetUniformLocation(WeightUpdate, "PreviousLayer_size");
-    WGHTUP_unifm_LearnRT = glGetUniformLocation(WeightUpdate, "LearningRate");
-    WGHTUP_unifm_weight_TEX = 0;    // from shader uniform layout binding
-    WGHTUP_unifm_neuronOut_TEX = 1; // from shader uniform layout binding
-    WGHTUP_unifm_prev_L_TEX = 2;    // from shader uniform layout binding    
+    std::vector<LayerProfile> profile;
+    int depth = 0;
+    for(Layer L = Network->inputLayer; L != nullptr; L = L->next, depth++)
+        for(int phase = forwardP; phase <= readbackP; phase++)
+        {
+            auto it = profileStats.find(std::make_pair(L, phase));
+            if(it == profileStats.end())
+                continue;
+            std::vector<float> sorted = it->second.samples;
+            std::sort(sorted.begin(), sorted.end());
+            LayerProfile p;
+            p.LayerDepth = depth;
+            p.Phase = (ProfilePhase)phase;
+            p.Count = it->second.count;
+            p.MeanMs = it->second.total / it->second.count;
+            p.P50Ms = sorted[(sorted.size() - 1) / 2];
+            p.P99Ms = sorted[(sorted.size() - 1) * 99 / 100];
+            profile.push_back(p);
+        }
+    return profile;
+}
 
-    glUseProgram(ErrorBackPropogate);
-    ERROR_BP_unifm_neuronOut_TEX = 0; // from shader uniform layout binding
-	ERROR_BP_unifm_next_L_TEX = 1;    // from shader uniform layout binding
-	ERROR_BP_unifm_weight_TEX = 2;    // from shader uniform layout binding
-	ERROR_BP_unifm_Layer_size = glGetUniformLocation(ErrorBackPropogate, "OutputLayer_size");
-	ERROR_BP_unifm_next_L_size = glGetUniformLocation(ErrorBackPropogate, "NextLayer_size"); 
-    std::cout<<"LOC: "<<  ERROR_BP_unifm_Layer_size << glGetUniformLocation(ErrorBackPropogate, "selection") << std::endl;
-       
+void AutotuneNetwork(NeuralNetwork Network)
+{
+    HermesNetwork::TraceScope trace("AutotuneNetwork");
+    HermesNetwork::useNetwork(Network);
+    HermesNetwork::autotuneNetwork(Network);
+}
 
-    srand(time(0));
-    return true;
+void SetAutotune(bool Enable, const char CacheFile[])
+{
+    using namespace HermesNetwork;
+    autotune = Enable;
+    tuningCachePath = CacheFile ? CacheFile : "";
+    if(Enable && !tuningCachePath.empty())
+        loadTuningCache();
 }
 
-template <typename T = int>
-NeuralNetwork NetworkBuilder(int InputSize, std::vector<T> HiddenLayers, int OutputSize)
-{    
+std::vector<std::string> GetTunedKernels(NeuralNetwork Network, int LayerDepth)
+{
     using namespace HermesNetwork;
-    NeuralNetwork nn = createBasicNetwork(InputSize, OutputSize);
-    for(int s: HiddenLayers)
-        appendHiddenLayer(nn,s);
-        
-    Layer l = nn->inputLayer;
-    while(l->next != nullptr)
+    Layer L = Network->inputLayer;
+    for(int i = 0; i < LayerDepth && L != nullptr; i++)
+        L = L->next;
+    if(L == nullptr || L == Network->inputLayer || L->kind != denseK)
+        return {};
+    std::vector<std::string> names;
+    for(int k = forwardT; k < tunedKernels; k++)
     {
-        connectLayer(l, l->next);
-        l = l->next;        
+        /* variant that runs, specialized kernels stand in for original ones */
+        int variant = specializeShapes && L->tuned[k] == 0 ? 2 : L->tuned[k];
+        names.push_back(std::string(denseVariants[k][variant].name) + (specializeShapes ? " shaped" : ""));
     }
+    return names;
+}
 
-    //permanently bind output layer with Out array
-    fetchLayerNeuronsData(nn->outputLayer);
-    nn->Out = nn->outputLayer->data;
-    return nn;    
+void SetShapeSpecialization(bool Enable)
+{
+    HermesNetwork::specializeShapes = Enable;
 }
 
-void TriggerLayer(NeuralNetwork Network, int LayerDepth)
+int GetShapeKernelCount()
 {
-	using namespace HermesNetwork;
+    int count = 0;
+    for(const auto& k: HermesNetwork::shapedKernels)
+        count += k.second != 0;
+    return count;
+}
 
-    /* Don't allow input layer activation */
-    if(LayerDepth == 0)
-        return;
+DeviceCalibration CalibrateDevices()
+{
+    using namespace HermesNetwork;
+    TraceScope trace("CalibrateDevices");
+    /* networks used to measure aren't recorded, tuned or placed */
+    RecordScope record;
+    bool tune = autotune;
+    autotune = false;
+    devicesCalibrated = false;
+
+    /* host microseconds per call, repeated until it adds up to a few milliseconds */
+    auto timeCall = [](const std::function<void()>& Call)
+    {
+        Call();
+        glFinish();
+        for(int reps = 4; ; reps *= 2)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for(int r = 0; r < reps; r++)
+                Call();
+            glFinish();
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            if(us > 20000 || reps >= 4096)
+                return us / reps;
+        }
+    };
+    auto forward = [](NeuralNetwork N)
+    {
+        for(Layer L = N->inputLayer->next; L != nullptr; L = L->next)
+            triggerLayer(L);
+    };
 
-	/* Select Layer at given depth */
-	Layer Lyr = Network->inputLayer;
-	for (int i = 0; i < LayerDepth; i++)
-		Lyr = Lyr->next;
+    /* latencies on a network too small for its math to count */
+    NeuralNetwork small = NetworkBuilder(16, std::vector<int>(6, 16), 16);
+    std::vector<float> inputs(16, 0.5f);
+    dispatchCost = timeCall([&] { forward(small); }) / 7;
+    uploadCost = timeCall([&] { SendInputs(small, inputs.data()); });
+    /* a readback waits for work queued before it, so it is timed after a forward pass */
+    readbackCost = timeCall([&] { forward(small); fetchLayerNeuronsData(small->outputLayer); }) - 7 * dispatchCost;
+    readbackCost = std::max(readbackCost, timeCall([&] { fetchLayerNeuronsData(small->outputLayer); }));
+
+    /* throughput on widest layers whose weights fit in a texture row, up to 256 */
+    GLint maxWidth = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxWidth);
+    int width = std::min(256, (int)((std::sqrt(1.0 + 4.0 * maxWidth) - 1) / 2));
+    NeuralNetwork wide = NetworkBuilder(width, std::vector<int>(3, width), width);
+    double flops = 4 * 2.0 * width * (width + 1);
+    double gpuTime = timeCall([&] { forward(wide); });
+    gpuFlopRate = flops / std::max(gpuTime - 4 * dispatchCost, 0.1 * gpuTime);
+    placeNetwork(wide, true);
+    cpuFlopRate = flops / timeCall([&] { forward(wide); });
+
+    deleteNetwork(small);
+    deleteNetwork(wide);
+    autotune = tune;
+    devicesCalibrated = true;
+    return GetDeviceCalibration();
+}
 
-	/* Trigger selected layer */
-	triggerLayer(Lyr);
+DeviceCalibration GetDeviceCalibration()
+{
+    using namespace HermesNetwork;
+    DeviceCalibration calibration;
+    if(!devicesCalibrated)
+        return calibration;
+    calibration.Calibrated = true;
+    calibration.DispatchUs = dispatchCost;
+    calibration.UploadUs = uploadCost;
+    calibration.ReadbackUs = readbackCost;
+    calibration.GpuGflops = gpuFlopRate * 1e-3;
+    calibration.CpuGflops = cpuFlopRate * 1e-3;
+    return calibration;
 }
 
-void TriggerNetwork(NeuralNetwork Network)
+double EstimateStepTime(NeuralNetwork Network, ComputeDevice Device)
 {
-	using namespace HermesNetwork;
+    using namespace HermesNetwork;
+    bool host = hostSupported(Network);
+    if(!devicesCalibrated || (Device == CPUDevice && !host))
+        return 0;
+    if(Device == AutoDevice)
+        return host ? std::min(estimateStep(Network, true), estimateStep(Network, false)) : estimateStep(Network, false);
+    return estimateStep(Network, Device == CPUDevice);
+}
 
-	Layer Lyr = Network->inputLayer;    
-	for (int i = 1; i < Network->no_layers; i++)
-	{
-		Lyr = Lyr->next;
-		triggerLayer(Lyr);
-	}
+bool SetNetworkDevice(NeuralNetwork Network, ComputeDevice Device)
+{
+    using namespace HermesNetwork;
+    bool host = hostSupported(Network);
+    if(Device == AutoDevice)
+        Device = host && devicesCalibrated && estimateStep(Network, true) < estimateStep(Network, false) ? CPUDevice : GPUDevice;
+    if(Device == CPUDevice && !host)
+        return false;
+    placeNetwork(Network, Device == CPUDevice);
+    return true;
 }
 
-void SendInputs(NeuralNetwork Network, float Inputs[])
+ComputeDevice GetNetworkDevice(NeuralNetwork Network)
 {
-	glBindTexture(GL_TEXTURE_2D, Network->inputLayer->NeuronsTex);		
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, Network->inputLayer->no_neuron, 1, 0, GL_RED, GL_FLOAT, Inputs);
-	glBindTexture(GL_TEXTURE_2D, 0);
+    return Network->inputLayer->onHost ? CPUDevice : GPUDevice;
 }
 
-void FetchOutputLayerData(NeuralNetwork Network)
+bool StartRecording(const char filename[])
 {
-    HermesNetwork::fetchLayerNeuronsData(Network->outputLayer);
+    using namespace HermesNetwork;
+    StopRecording();
+    recordFile.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!recordFile.is_open())
+        return false;
+    recordPath = filename;
+    recordIds.clear();
+    recordBytes(&RecordTag, sizeof(int));
+    recordBytes(&RecordVersion, sizeof(int));
+    recording = true;
+    return true;
 }
 
-void TrainNetwork(NeuralNetwork Network, float ActualOutput[], float LearningRate = 1.0)
-{    
+void StopRecording()
+{
+    using namespace HermesNetwork;
+    if(!recording)
+        return;
+    recording = false;
+    recordFile.close();
+    recordIds.clear();
+}
+
+ReplayReport ReplayRecording(const char filename[])
+{
     using namespace HermesNetwork;
+    ReplayReport report = { false, 0, 0, {}, {} };
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    int tag = 0, version = 0;
+    file.read((char*)&tag, sizeof(int));
+    file.read((char*)&version, sizeof(int));
+    if(!file || tag != RecordTag || version != RecordVersion)
+        return report;
+
+    const char* names[recordOps] = { "snapshot", "LoadNetwork", "NetworkBuilder", "SetActivation", "SendInputs",
+                                     "SendSparseInputs", "TriggerNetwork", "TrainNetwork", "FetchOutputLayerData" };
+    std::vector<std::vector<float>> samples(recordOps);
+    std::vector<NeuralNetwork> networks;
+    std::vector<float> values;
+    std::vector<int> indices;
+    std::vector<char> bytes;
+    std::string path = std::string(filename) + ".network";
+
+    auto readInt = [&file]() { int v = 0; file.read((char*)&v, sizeof(int)); return v; };
+
+    auto begin = std::chrono::steady_clock::now();
+    unsigned char op;
+    bool ok = true;
+    while(ok && file.read((char*)&op, 1))
     {
-        /*
-        *      STEPS FOR BACKPORPAGATION (old)
-        *
-        *    1.  calculate error for output layer                    --  for each neuron: error = sigmoid_derivative(neuron_output * (ActualOutput-neuron_output))
-        *    2.  adjust weights for output layer according to error  --  for each weights coming from neuron m, going to a neuron n: weights += n.error*m.value
-        *    3.  calculate error for hidden layer                    --  same as that of output layer error calculation
-        *    4.  adjust weights for hidden layer according to error  --  same as that of output layer weight adjustment
-        */
+        int id = readInt();
+        if(op >= recordOps || id < 0 || (op >= activationR && (id >= (int)networks.size() || networks[id] == nullptr)))
+        {
+            ok = false;
+            break;
+        }
+        NeuralNetwork N = op >= activationR ? networks[id] : nullptr;
+
+        /* payload is read before timer starts, so only the call is timed */
+        unsigned char type[2];
+        float learningRate = 0;
+        int inputSize = 0, outputSize = 0, nonZeros = 0;
+        unsigned int seed = 0;
+        std::vector<int> hidden;
+        if(op == snapshotR || op == loadR)
+        {
+            /* saved network is loaded back through a file, as LoadNetwork() only reads files */
+            bytes.resize(std::max(readInt(), 0));
+            file.read(bytes.data(), bytes.size());
+            std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), bytes.size());
+            out.close();
+            if((int)networks.size() <= id)
+                networks.resize(id + 1, nullptr);
+        }
+        else if(op == activationR)
+            file.read((char*)type, 2);
+        else if(op == inputsR)
+        {
+            values.resize(N->inputLayer->no_neuron);
+            file.read((char*)values.data(), sizeof(float) * values.size());
+        }
+        else if(op == sparseInputsR)
+        {
+            nonZeros = readInt();
+            indices.resize(std::max(nonZeros, 0));
+            values.resize(std::max(nonZeros, 0));
+            file.read((char*)indices.data(), sizeof(int) * indices.size());
+            file.read((char*)values.data(), sizeof(float) * values.size());
+        }
+        else if(op == trainR)
+        {
+            file.read((char*)&learningRate, sizeof(float));
+            values.resize(N->outputLayer->no_neuron);
+            file.read((char*)values.data(), sizeof(float) * values.size());
+        }
+        else if(op == buildR)
+        {
+            seed = readInt();
+            inputSize = readInt();
+            hidden.resize(std::max(readInt(), 0));
+            for(int& h: hidden)
+                h = readInt();
+            outputSize = readInt();
+        }
+        if(!file)
+        {
+            ok = false;
+            break;
+        }
 
-        // /*1*/ calcError(Network->outputLayer, ActualOutput);
-        // /*2*/ trainLayer(Network->outputLayer, &LearningRate);
-        
-        // Layer Lyr = Network->outputLayer->prev;
-        // for(int i = Network->no_layers; i > 2; i--)
-        // {
-        //     /*3*/ backPropogateError(Lyr);
-        //     /*4*/ trainLayer(Lyr, &LearningRate);
-        //     Lyr = Lyr->prev;
-        // }
+        auto t0 = std::chrono::steady_clock::now();
+        switch(op)
+        {
+            case snapshotR:
+            case loadR:
+                networks[id] = LoadNetwork(path.c_str());
+                break;
+            case buildR:
+                srand(seed);
+                if((int)networks.size() <= id)
+                    networks.resize(id + 1, nullptr);
+                networks[id] = NetworkBuilder(inputSize, hidden, outputSize);
+                break;
+            case activationR:           SetActivation(N, (ActivationType)type[0], (ActivationType)type[1]); break;
+            case inputsR:               SendInputs(N, values.data()); break;
+            case sparseInputsR:         SendSparseInputs(N, indices.data(), values.data(), nonZeros); break;
+            case triggerR:              TriggerNetwork(N); break;
+            case trainR:                TrainNetwork(N, values.data(), learningRate); break;
+            case fetchR:                FetchOutputLayerData(N); break;
+        }
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        if(op == snapshotR || op == loadR)
+        {
+            std::remove(path.c_str());
+            ok = networks[id] != nullptr;
+        }
+        if(op == snapshotR)
+        {
+            /* networks saved whole into log are only set up, not timed */
+            for(Layer L = ok ? networks[id]->inputLayer->next : nullptr; L != nullptr; L = L->next)
+                if(file.read((char*)type, 1))
+                    L->AFun = type[0];
+            continue;
+        }
+        samples[op].push_back(ms);
+        report.Calls++;
+    }
+    glFinish();
+    report.WallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    report.Ok = ok;
+    report.Networks = networks;
+
+    for(int op = loadR; op < recordOps; op++)
+    {
+        std::vector<float>& t = samples[op];
+        if(t.empty())
+            continue;
+        ReplayTiming timing = { names[op], (long long)t.size(), 0, 0, 0, 0 };
+        for(float ms: t)
+            timing.TotalMs += ms;
+        std::sort(t.begin(), t.end());
+        timing.P50Ms = t[(t.size() - 1) / 2];
+        timing.P99Ms = t[(t.size() - 1) * 99 / 100];
+        timing.MaxMs = t.back();
+        report.Timings.push_back(timing);
+    }
+    return report;
+}
+
+EngineStats GetEngineStats()
+{
+    using namespace HermesNetwork;
+    auto latency = [](const LatencyHistogram& H)
+    {
+        LatencyStats l;
+        l.Count = H.count.load(std::memory_order_relaxed);
+        l.MeanMs = l.Count ? H.total.load(std::memory_order_relaxed) / 1.0e6 / l.Count : 0;
+        l.P50Ms = H.percentile(0.5) / 1.0e6;
+        l.P90Ms = H.percentile(0.9) / 1.0e6;
+        l.P99Ms = H.percentile(0.99) / 1.0e6;
+        l.P999Ms = H.percentile(0.999) / 1.0e6;
+        l.MaxMs = H.max.load(std::memory_order_relaxed) / 1.0e6;
+        return l;
+    };
+
+    EngineStats stats;
+    stats.Inferences = statInferences.load(std::memory_order_relaxed);
+    stats.TrainingSteps = statTrainingSteps.load(std::memory_order_relaxed);
+    stats.BytesUploaded = statBytesUploaded.load(std::memory_order_relaxed);
+    stats.BytesReadBack = statBytesReadBack.load(std::memory_order_relaxed);
+    stats.Stalls = statStalls.load(std::memory_order_relaxed);
+    stats.Dispatches = statDispatches.load(std::memory_order_relaxed);
+    stats.Barriers = statBarriers.load(std::memory_order_relaxed);
+    stats.GpuBytes = 0;
+    for(NeuralNetwork N: networks)
+    {
+        stats.Networks.push_back({ N, networkBytes(N), !N->paged });
+        stats.GpuBytes += stats.Networks.back().Bytes;
+    }
+    stats.Trigger = latency(triggerLatency);
+    stats.Train = latency(trainLatency);
+    stats.MemoryBudget = memoryBudget;
+    stats.PagedBytes = pagedBytes;
+    stats.PageHits = pageHits;
+    stats.PageMisses = pageMisses;
+    stats.PageOuts = pageOuts;
+    stats.PageIn = latency(pageInLatency);
+    stats.PageOut = latency(pageOutLatency);
+    return stats;
+}
+
+void SetMemoryBudget(long long Bytes)
+{
+    using namespace HermesNetwork;
+    memoryBudget = std::max(Bytes, 0LL);
+    for(NeuralNetwork N: networks)
+        if(!N->paged)
+            measureNetwork(N);
+    enforceBudget(nullptr, nullptr);
+}
+
+namespace HermesNetwork
+{
+    //Activation of StaticNetwork layers, same functions as ActiveDeriveLibs. Leaky ReLU leaks 0.01
+    template <ActivationType Fun>
+    inline float staticActivate(float X)
+    {
+        return Fun == Sigmoid ? 1.0f / (1.0f + std::exp(-X)) :
+               Fun == TanH ? std::tanh(X) :
+               Fun == ReLu ? std::max(X, 0.0f) :
+               Fun == LeakyReLu ? (X > 0.0f ? X : 0.01f * X) : X;
     }
-    /*
-     *      STEPS FOR BACKPORPAGATION (new)
-     *
-     *    1.  calculate error for output layer                    --  for each neuron: error = sigmoid_derivative(neuron_output * (ActualOutput-neuron_output))
-     *    3.  calculate error for hidden layer                    --  same as that of output layer error calculation
-     *    2.  adjust weights for output layer according to error  --  for each weights coming from neuron m, going to a neuron n: weights += n.error*m.value    
-     *    4.  adjust weights for hidden layer according to error  --  same as that of output layer weight adjustment
-     */
-    
-    /*1*/ calcError(Network->outputLayer, ActualOutput);
-    // /*2*/ trainLayer(Network->outputLayer, &LearningRate);
-    
-    Layer Lyr = Network->outputLayer->prev;
-	for(int i = Network->no_layers; i > 2; i--)
+
+    //Derivative in terms of activated value, as kernels compute it
+    template <ActivationType Fun>
+    inline float staticDerivate(float Y)
     {
-        /*3*/ backPropogateError(Lyr);
-        // /*4*/ trainLayer(Lyr, &LearningRate);
-        Lyr = Lyr->prev;
+        return Fun == Sigmoid ? Y * (1.0f - Y) :
+               Fun == TanH ? 1.0f - Y * Y :
+               Fun == ReLu ? (Y > 0.0f ? 1.0f : 0.0f) :
+               Fun == LeakyReLu ? (Y > 0.0f ? 1.0f : 0.01f) : 1.0f;
     }
 
- /*2*/ trainLayer(Network->outputLayer, &LearningRate);
-    Lyr = Network->outputLayer->prev;
-	for(int i = Network->no_layers; i > 2; i--)
+    float hostActivate(int Fun, float X)
     {
-        // /*3*/ backPropogateError(Lyr);
-        /*4*/ trainLayer(Lyr, &LearningRate);
-        Lyr = Lyr->prev;
+        switch(Fun)
+        {
+            case Sigmoid:   return staticActivate<Sigmoid>(X);
+            case TanH:      return staticActivate<TanH>(X);
+            case ReLu:      return staticActivate<ReLu>(X);
+            case LeakyReLu: return staticActivate<LeakyReLu>(X);
+            default:        return X;
+        }
     }
 
-    /*
-     * If training is in batch, set shader to accumulate errors 
-     * until batch is filed.         
-     */    
-    if(Network->batchSize > 0)
+    float hostDerivate(int Fun, float Y)
     {
-        Network->trainingCountByBatch ++;
-        if(Network->trainingCountByBatch == Network->batchSize)
+        switch(Fun)
         {
-            Network->trainingCountByBatch = 0;
-            Network->errorAccumulation  = false;
+            case Sigmoid:   return staticDerivate<Sigmoid>(Y);
+            case TanH:      return staticDerivate<TanH>(Y);
+            case ReLu:      return staticDerivate<ReLu>(Y);
+            case LeakyReLu: return staticDerivate<LeakyReLu>(Y);
+            default:        return 1.0f;
         }
-        else
-            Network->errorAccumulation  = true;
     }
-    
-    
-}
 
-void SaveNetwork(NeuralNetwork Network, const char filename[])
-{
-    /*
-     *      FILE STRUCTURE
-     *
-     * -------------------------------------------
-     *  No of Layers | Input Size | Output Size             -int,int,int
-     * -------------------------------------------
-     *  1st Hidden Layer Size | [Array of weights]          -int,[float]
-     * -------------------------------------------
-     *  2nd Hidden Layer Size | [Array of weights]          -int,[float]
-     * -------------------------------------------
-     *      :
-     *      :
-     *  nth Hidden Layer Size | [Array of weights]          -int,[float]
-     * -------------------------------------------
-     *  [Array of weights of Output Layer]                  -[float]
-     * -------------------------------------------
-     */
-    
-    std::fstream file;
-    file.open(filename,std::ios::out|std::ios::binary);
-    file.write((char*)&Network->no_layers, sizeof(int));
-    file.write((char*)&Network->no_of_input, sizeof(int));
-    file.write((char*)&Network->no_of_output, sizeof(int));
+    void hostTriggerLayer(Layer Lyr)
+    {
+        Lyr->neuronVersion++;
+        int prev = Lyr->prev->no_neuron;
+        const float* x = Lyr->prev->hostNeurons.data();
+        float* out = Lyr->hostNeurons.data();
+        for(int n = 0; n < Lyr->no_neuron; n++)
+        {
+            /* four running sums, so adds don't wait on each other */
+            const float* w = &Lyr->hostWeights[n * (prev + 1)];
+            float sums[4] = { 0, 0, 0, 0 };
+            int i = 0;
+            for(; i + 4 <= prev; i += 4)
+                for(int k = 0; k < 4; k++)
+                    sums[k] += w[i + k] * x[i + k];
+            for(; i < prev; i++)
+                sums[0] += w[i] * x[i];
+            float sum = (sums[0] + sums[1]) + (sums[2] + sums[3]) + w[prev];
+            out[n] = Lyr->AFun == Softmax ? sum : hostActivate(Lyr->AFun, sum);
+        }
+        if(Lyr->AFun == Softmax)
+        {
+            float top = *std::max_element(out, out + Lyr->no_neuron), total = 0;
+            for(int n = 0; n < Lyr->no_neuron; n++)
+                total += (out[n] = std::exp(out[n] - top));
+            for(int n = 0; n < Lyr->no_neuron; n++)
+                out[n] /= total;
+        }
+    }
 
-    HermesNetwork::Layer L = Network->inputLayer->next;
-    for(int i=1; i < Network->no_layers-1 ; i++,L = L->next)
+    void hostTrainNetwork(NeuralNetwork Network, const float* ActualOutput, float LearningRate)
     {
-        file.write((char*)&L->no_neuron, sizeof(int));
-        fetchLayerWeights_Bias(L);
-        file.write((char*)L->weights, sizeof(float) * L->no_weight);
-        freeLayerWeights_Bias(L);
+        /* softmax is trained with cross-entropy, its error is target - probability */
+        Layer out = Network->outputLayer;
+        for(int n = 0; n < out->no_neuron; n++)
+            out->hostErrors[n] = (ActualOutput[n] - out->hostNeurons[n]) * hostDerivate(out->AFun, out->hostNeurons[n]);
+        out->neuronVersion++;
+
+        /* errors of every hidden layer first, from weights before update, as on GPU */
+        for(Layer L = out->prev; L != Network->inputLayer; L = L->prev)
+        {
+            Layer next = L->next;
+            std::fill(L->hostErrors.begin(), L->hostErrors.end(), 0.0f);
+            for(int j = 0; j < next->no_neuron; j++)
+            {
+                const float* w = &next->hostWeights[j * (L->no_neuron + 1)];
+                float e = next->hostErrors[j];
+                for(int i = 0; i < L->no_neuron; i++)
+                    L->hostErrors[i] += e * w[i];
+            }
+            for(int i = 0; i < L->no_neuron; i++)
+                L->hostErrors[i] *= hostDerivate(L->AFun, L->hostNeurons[i]);
+            L->neuronVersion++;
+        }
+
+        for(Layer L = Network->inputLayer->next; L != nullptr; L = L->next)
+        {
+            int prev = L->prev->no_neuron;
+            const float* x = L->prev->hostNeurons.data();
+            for(int n = 0; n < L->no_neuron; n++)
+            {
+                float* w = &L->hostWeights[n * (prev + 1)];
+                float step = LearningRate * L->hostErrors[n];
+                for(int i = 0; i < prev; i++)
+                    w[i] += step * x[i];
+                w[prev] += step;
+            }
+            L->weightVersion++;
+        }
     }
 
-    fetchLayerWeights_Bias(Network->outputLayer);    
-    file.write((char*)Network->outputLayer->weights, sizeof(float) * Network->outputLayer->no_weight);    
-    freeLayerWeights_Bias(Network->outputLayer);
-    file.close();
-}
+    //Weights, outputs and errors of one dense layer of a StaticNetwork
+    template <ActivationType Fun, int Prev, int Size>
+    struct StaticDense
+    {
+        std::array<float, (Prev + 1) * Size> weights;   // Prev weights then bias for every neuron, like WeightsTex
+        std::array<float, Size> out, err;
 
-NeuralNetwork LoadNetwork(const char filename[])
-{
-    /*
-     *      FILE STRUCTURE
-     *
-     * -------------------------------------------
-     *  No of Layers | Input Size | Output Size             -int,int,int
-     * -------------------------------------------
-     *  1st Hidden Layer Size | [Array of weights]          -int,[float]
-     * -------------------------------------------
-     *  2nd Hidden Layer Size | [Array of weights]          -int,[float]
-     * -------------------------------------------
-     *      :
-     *      :
-     *  nth Hidden Layer Size | [Array of weights]          -int,[float]
-     * -------------------------------------------
-     *  [Array of weights of Output Layer]                  -[float]
-     * -------------------------------------------
-     */
+        //Same range as WeightInit shader
+        void init()
+        {
+            for(float& w: weights)
+                w = (rand() + 1.0f) / (RAND_MAX + 1.0f);
+        }
 
-    std::fstream file;
-    file.open(filename, std::ios::in| std::ios::binary);
-    if(!file.is_open())
-        return nullptr;
-    int layerSize, inputSize, outputSize;
-    file.read((char*)&layerSize,sizeof(int));
-    file.read((char*)&inputSize,sizeof(int));
-    file.read((char*)&outputSize,sizeof(int));
-    
+        void forward(const float* X)
+        {
+            for(int n = 0; n < Size; n++)
+            {
+                const float* w = &weights[n * (Prev + 1)];
+                float sum = w[Prev];
+                for(int i = 0; i < Prev; i++)
+                    sum += w[i] * X[i];
+                out[n] = Fun == Softmax ? sum : staticActivate<Fun>(sum);
+            }
+            if(Fun == Softmax)
+            {
+                float top = *std::max_element(out.begin(), out.end()), total = 0;
+                for(float& z: out)
+                    total += (z = std::exp(z - top));
+                for(float& z: out)
+                    z /= total;
+            }
+        }
 
-    NeuralNetwork Network = HermesNetwork::createBasicNetwork(inputSize, outputSize);    
-    HermesNetwork::Layer L = Network->inputLayer;
-    int hlSize = 0;    
+        //Error of this layer from error of Next through its weights
+        template <typename NextLayer>
+        void backPropogate(const NextLayer& Next)
+        {
+            err.fill(0.0f);
+            for(int j = 0; j < (int)Next.err.size(); j++)
+            {
+                const float* w = &Next.weights[j * (Size + 1)];
+                for(int i = 0; i < Size; i++)
+                    err[i] += Next.err[j] * w[i];
+            }
+            for(int i = 0; i < Size; i++)
+                err[i] *= staticDerivate<Fun>(out[i]);
+        }
 
-    for(int i = 1; i < layerSize-1; i++)
+        void update(const float* X, float LearningRate)
+        {
+            for(int n = 0; n < Size; n++)
+            {
+                float* w = &weights[n * (Prev + 1)];
+                float step = LearningRate * err[n];
+                for(int i = 0; i < Prev; i++)
+                    w[i] += step * X[i];
+                w[Prev] += step;
+            }
+        }
+    };
+
+    //Layer of Size neurons after Prev and every layer after it, this one is the output layer
+    template <ActivationType HiddenType, ActivationType OutputType, int Prev, int Size, int... Rest>
+    struct StaticLayer : StaticDense<OutputType, Prev, Size>
     {
-        file.read((char*)&hlSize,sizeof(int));
-        std::cout<<"\nhlS: "<<hlSize;        
-        HermesNetwork::appendHiddenLayer(Network,hlSize);
-        HermesNetwork::connectLayer(L,L->next);     
+        void init()
+        {
+            StaticDense<OutputType, Prev, Size>::init();
+        }
 
-        L = L->next;        
-        float *hlWeights = new float[L->no_weight];
-        file.read((char*)hlWeights, sizeof(float) * L->no_weight);        
-        glBindTexture(GL_TEXTURE_2D, L->WeightsTex);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, L->no_weight, 1, 0, GL_RED, GL_FLOAT, hlWeights);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        delete[] hlWeights;        
-    }
+        void trigger(const float* X)
+        {
+            this->forward(X);
+        }
 
-    HermesNetwork::connectLayer(L,L->next);     
+        const float* output() const
+        {
+            return this->out.data();
+        }
 
-    L = Network->outputLayer;
-    float *outputWeights = new float[L->no_weight];
-    file.read((char*)outputWeights, sizeof(float) * L->no_weight);    
-    glBindTexture(GL_TEXTURE_2D, L->WeightsTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, L->no_weight, 1, 0, GL_RED, GL_FLOAT,outputWeights);    
-    glBindTexture(GL_TEXTURE_2D, 0);
-    delete[] outputWeights;
+        /* softmax is trained with cross-entropy, its error is target - probability */
+        void error(const float* Targets)
+        {
+            for(int n = 0; n < Size; n++)
+                this->err[n] = (Targets[n] - this->out[n]) * staticDerivate<OutputType>(this->out[n]);
+        }
 
+        void train(const float* X, float LearningRate)
+        {
+            this->update(X, LearningRate);
+        }
 
-    //permanently bind output layer with Out array
-    fetchLayerNeuronsData(Network->outputLayer);
-    Network->Out = Network->outputLayer->data;    
+        void save(std::ostream& File) const
+        {
+            File.write((const char*)this->weights.data(), sizeof(float) * this->weights.size());
+        }
 
-    file.close();
-    return Network;
+        /* a sparse output layer is saved as its marker and CSR arrays instead, marker is a NaN bit pattern no weight has */
+        bool load(std::istream& File, std::vector<float>& Weights)
+        {
+            int marker = 0;
+            if(!File.read((char*)&marker, sizeof(int)) || marker == -sparseK)
+                return false;
+            size_t at = Weights.size();
+            Weights.resize(at + this->weights.size());
+            std::memcpy(&Weights[at], &marker, sizeof(float));
+            return (bool)File.read((char*)&Weights[at + 1], sizeof(float) * (this->weights.size() - 1));
+        }
+
+        const float* assign(const float* Weights)
+        {
+            std::copy(Weights, Weights + this->weights.size(), this->weights.begin());
+            return Weights + this->weights.size();
+        }
+    };
+
+    //Hidden layer of Size neurons, followed by Next and the rest
+    template <ActivationType HiddenType, ActivationType OutputType, int Prev, int Size, int Next, int... Rest>
+    struct StaticLayer<HiddenType, OutputType, Prev, Size, Next, Rest...> : StaticDense<HiddenType, Prev, Size>
+    {
+        StaticLayer<HiddenType, OutputType, Size, Next, Rest...> next;
+
+        void init()
+        {
+            StaticDense<HiddenType, Prev, Size>::init();
+            next.init();
+        }
+
+        void trigger(const float* X)
+        {
+            this->forward(X);
+            next.trigger(this->out.data());
+        }
+
+        const float* output() const
+        {
+            return next.output();
+        }
+
+        void error(const float* Targets)
+        {
+            next.error(Targets);
+            this->backPropogate(next);
+        }
+
+        void train(const float* X, float LearningRate)
+        {
+            this->update(X, LearningRate);
+            next.train(this->out.data(), LearningRate);
+        }
+
+        void save(std::ostream& File) const
+        {
+            int size = Size;
+            File.write((const char*)&size, sizeof(int));
+            File.write((const char*)this->weights.data(), sizeof(float) * this->weights.size());
+            next.save(File);
+        }
+
+        /* read every layer before assigning any, so a bad file leaves network as it was */
+        bool load(std::istream& File, std::vector<float>& Weights)
+        {
+            int size = 0;
+            if(!File.read((char*)&size, sizeof(int)) || size != Size)
+                return false;
+            size_t at = Weights.size();
+            Weights.resize(at + this->weights.size());
+            return File.read((char*)&Weights[at], sizeof(float) * this->weights.size()) && next.load(File, Weights);
+        }
+
+        const float* assign(const float* Weights)
+        {
+            std::copy(Weights, Weights + this->weights.size(), this->weights.begin());
+            return next.assign(Weights + this->weights.size());
+        }
+    };
 }
 
-void SetActivation(NeuralNetwork Network, ActivationType AllLayersType)
+template <int InputSize, int... Hidden, int OutputSize, ActivationType HiddenType, ActivationType OutputType>
+struct StaticNetwork<InputSize, Layers<Hidden...>, OutputSize, HiddenType, OutputType>
 {
-    using namespace HermesNetwork;
+    static_assert(HiddenType != Softmax, "softmax is for output layer only");
+    static const int no_layers = sizeof...(Hidden) + 2;
 
-	Layer Lyr = Network->inputLayer;    
-	for (int i = 1; i < Network->no_layers; i++)
-	{
-		Lyr = Lyr->next;
-		Lyr->AFun = AllLayersType;
-	}
-    
-}
+    std::array<float, InputSize> In;
+    std::array<float, OutputSize> Out;
+    HermesNetwork::StaticLayer<HiddenType, OutputType, InputSize, Hidden..., OutputSize> layers;
 
-void SetActivation(NeuralNetwork Network, ActivationType HiddenLayersType, ActivationType OutputLayersType)
+    //Random weights like NetworkBuilder()
+    StaticNetwork()
+    {
+        In.fill(0.0f);
+        Out.fill(0.0f);
+        layers.init();
+    }
+};
+
+template <int I, typename H, int O, ActivationType A, ActivationType B>
+void SendInputs(StaticNetwork<I, H, O, A, B>& Network, const float Inputs[])
 {
-    SetActivation(Network,HiddenLayersType);
-    Network->outputLayer->AFun = OutputLayersType;
+    std::copy(Inputs, Inputs + I, Network.In.begin());
 }
 
-void Terrify(NeuralNetwork N)
-{    
-    HermesNetwork::Layer l = N->inputLayer;   
-    while(l != nullptr)
-        {
-            glBindTexture(GL_TEXTURE_2D, l->WeightsTex);    
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glBindTexture(GL_TEXTURE_2D, 0);
+template <int I, typename H, int O, ActivationType A, ActivationType B>
+void TriggerNetwork(StaticNetwork<I, H, O, A, B>& Network)
+{
+    Network.layers.trigger(Network.In.data());
+    const float* out = Network.layers.output();
+    std::copy(out, out + O, Network.Out.begin());
+}
 
-            glBindTexture(GL_TEXTURE_2D, l->NeuronsTex);    
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glBindTexture(GL_TEXTURE_2D, 0);
-            l = l->next;            
-        }                    
+template <int I, typename H, int O, ActivationType A, ActivationType B>
+void TrainNetwork(StaticNetwork<I, H, O, A, B>& Network, const float ActualOutput[], float LearningRate)
+{
+    Network.layers.error(ActualOutput);
+    Network.layers.train(Network.In.data(), LearningRate);
 }
 
-void DeTerrify(NeuralNetwork N)
-{    
-    HermesNetwork::Layer l = N->inputLayer;   
-    while(l != nullptr)
-    {
-        glBindTexture(GL_TEXTURE_2D, l->WeightsTex);    
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glBindTexture(GL_TEXTURE_2D, 0);
+template <int I, typename H, int O, ActivationType A, ActivationType B>
+bool SaveNetwork(const StaticNetwork<I, H, O, A, B>& Network, const char filename[])
+{
+    std::ofstream file(filename, std::ios::out | std::ios::binary);
+    if(!file.is_open())
+        return false;
+    int header[3] = { StaticNetwork<I, H, O, A, B>::no_layers, I, O };
+    file.write((char*)header, sizeof(header));
+    Network.layers.save(file);
+    return (bool)file;
+}
 
-        glBindTexture(GL_TEXTURE_2D, l->NeuronsTex);    
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        l = l->next;            
-    }                    
+template <int I, typename H, int O, ActivationType A, ActivationType B>
+bool LoadNetwork(StaticNetwork<I, H, O, A, B>& Network, const char filename[])
+{
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    int header[3];
+    if(!file.read((char*)header, sizeof(header)) || header[0] != StaticNetwork<I, H, O, A, B>::no_layers || header[1] != I || header[2] != O)
+        return false;
+
+    /* an int8 section after fp32 weights is left unread */
+    std::vector<float> weights;
+    if(!Network.layers.load(file, weights))
+        return false;
+    Network.layers.assign(weights.data());
+    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
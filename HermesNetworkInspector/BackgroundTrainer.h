@@ -0,0 +1,199 @@
+#pragma once
+
+#include<CleanImGuiWin.h>
+#include "HermesNetwork.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <chrono>
+
+//Runs training steps on a worker thread with its own GL context shared with the Inspector's,
+//so training speed isn't tied to frame rate. The UI holds gpu for the whole frame, the worker
+//takes it between frames for a short batch of steps. Every HermesNetwork call goes under gpu.
+namespace Trainer {
+	//What the worker publishes for UI to draw, no more than publishRate times a second
+	struct Snapshot {
+		long long steps = 0;
+		double stepsPerSecond = 0;
+		float loss = 0;
+		std::vector<float> outputs;
+	};
+
+	GLFWwindow* context = nullptr;
+	std::thread worker;
+	std::mutex gpu;
+	std::condition_variable wake;
+	std::atomic<bool> uiWaiting(false);
+	bool quit = false;
+
+	//Job and controls, guarded by gpu
+	const void* owner = nullptr;				// window that started the job
+	std::function<void()> step;				// one training step, no readback
+	std::function<void(Snapshot&)> publish;	// read back outputs and loss
+	bool running = false;
+	int pendingSteps = 0;					// single steps asked for while paused
+	float stepsPerSecond = 0;				// 0 for as fast as GPU goes
+	float publishRate = 15;
+	long long steps = 0;
+	Snapshot published;
+
+	//Fences handing network over from one context to the other
+	GLsync workerDone = nullptr, uiDone = nullptr;
+
+	//Fence commands issued so far by this context
+	void release(GLsync& Fence) {
+		if(Fence)
+			glDeleteSync(Fence);
+		Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+	}
+
+	//Make this context's next commands wait on the GPU for other context's fence, host doesn't wait
+	void acquire(GLsync Fence) {
+		if(Fence)
+			glWaitSync(Fence, 0, GL_TIMEOUT_IGNORED);
+	}
+
+	void run() {
+		using clock = std::chrono::steady_clock;
+		glfwMakeContextCurrent(context);
+		clock::time_point nextStep = clock::now(), lastPublish = nextStep;
+		long long lastSteps = 0;
+		bool publishPending = false;
+
+		while(true) {
+			/* let a waiting frame in first, mutex alone would let worker take it back right away */
+			while(uiWaiting)
+				std::this_thread::yield();
+
+			std::unique_lock<std::mutex> lock(gpu);
+			wake.wait(lock, [&] { return quit || (step && (running || pendingSteps > 0)) || (publish && publishPending); });
+			if(quit)
+				break;
+			acquire(uiDone);
+
+			/* short batch keeps frames from waiting long on gpu */
+			clock::time_point begin = clock::now(), now = begin;
+			while(step && (running || pendingSteps > 0) && now - begin < std::chrono::milliseconds(4)) {
+				if(stepsPerSecond > 0 && now < nextStep)
+					break;
+				step();
+				steps++;
+				publishPending = true;
+				if(!running)
+					pendingSteps--;
+				if(stepsPerSecond > 0)
+					nextStep = std::max(nextStep, now - std::chrono::milliseconds(100)) + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / stepsPerSecond));
+				now = clock::now();
+			}
+
+			/* throttled while running, right away once it stops so UI shows where it stopped */
+			bool stopped = !running && pendingSteps == 0;
+			if(publish && publishPending && (stopped || now - lastPublish >= std::chrono::duration<double>(1.0 / publishRate))) {
+				double elapsed = std::chrono::duration<double>(now - lastPublish).count();
+				Snapshot s;
+				publish(s);
+				s.steps = steps;
+				s.stepsPerSecond = running && elapsed > 0 ? (steps - lastSteps) / elapsed : 0;
+				published = s;
+				lastPublish = now;
+				lastSteps = steps;
+				publishPending = false;
+			}
+			release(workerDone);
+			lock.unlock();
+
+			if(running && stepsPerSecond > 0)
+				std::this_thread::sleep_until(std::min(nextStep, clock::now() + std::chrono::milliseconds(50)));
+		}
+
+		glfwMakeContextCurrent(nullptr);
+	}
+
+	//Create hidden context sharing Window's objects and start worker, call after InitNeuralLink()
+	void init(GLFWwindow* Window) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		context = glfwCreateWindow(1, 1, "HermesNetwork Trainer", nullptr, Window);
+		glfwDefaultWindowHints();
+		glfwMakeContextCurrent(Window);
+		if(context)
+			worker = std::thread(run);
+	}
+
+	void shutdown() {
+		{
+			std::lock_guard<std::mutex> lock(gpu);
+			quit = true;
+		}
+		wake.notify_all();
+		if(worker.joinable())
+			worker.join();
+		if(context)
+			glfwDestroyWindow(context);
+		context = nullptr;
+	}
+
+	//Functions below are called from UI frame, holding gpu
+
+	void setJob(const void* Owner, std::function<void()> Step, std::function<void(Snapshot&)> Publish) {
+		if(owner != Owner) {
+			steps = 0;
+			published = Snapshot();
+		}
+		owner = Owner;
+		step = Step;
+		publish = Publish;
+	}
+
+	void start(const void* Owner, std::function<void()> Step, std::function<void(Snapshot&)> Publish) {
+		setJob(Owner, Step, Publish);
+		running = true;
+		wake.notify_all();
+	}
+
+	void pause() {
+		running = false;
+		pendingSteps = 0;
+		wake.notify_all();
+	}
+
+	void stepOnce(const void* Owner, std::function<void()> Step, std::function<void(Snapshot&)> Publish) {
+		setJob(Owner, Step, Publish);
+		running = false;
+		pendingSteps++;
+		wake.notify_all();
+	}
+
+	//Drop job, before networks it uses are deleted
+	void stop() {
+		owner = nullptr;
+		step = nullptr;
+		publish = nullptr;
+		running = false;
+		pendingSteps = 0;
+		steps = 0;
+		published = Snapshot();
+	}
+
+	//Start/pause/step buttons, rate control and status of job owned by Owner
+	void DrawControls(const void* Owner, std::function<void()> Step, std::function<void(Snapshot&)> Publish) {
+		bool mine = owner == Owner;
+		if(ImGui::Button(mine && running ? "Pause" : "Start")) {
+			if(mine && running)
+				pause();
+			else
+				start(Owner, Step, Publish);
+		}
+		ImGui::SameLine();
+		if(ImGui::Button("Step"))
+			stepOnce(Owner, Step, Publish);
+		ImGui::SameLine();
+		ImGui::SetNextItemWidth(100);
+		ImGui::DragFloat("steps/s", &stepsPerSecond, 10.0f, 0.0f, 1e6f, stepsPerSecond > 0 ? "%.0f" : "max");
+		if(mine)
+			ImGui::Text("%lld steps  %.0f steps/s  loss %f", published.steps, running ? published.stepsPerSecond : 0.0, published.loss);
+	}
+}
@@ -0,0 +1,266 @@
+#pragma once
+
+#include "HermesNetwork.h"
+
+#include <random>
+
+//Headless PingPong: thousands of independent games of two networks stepped together on GPU.
+//Game state sits in a texture next to the networks' batch textures, so a step runs observation,
+//inference of both networks, physics and training without any host round trip.
+//Rules and labels are those of the Inspector's PingPong demo.
+namespace PingPongEnv {
+	//State of one game, as sample() reads it back
+	struct Game {
+		float ballX, ballY, ballSpeed, ballAngle;
+		float plr1Pos, plr2Pos;
+		int score[2];
+	};
+
+	struct Environment {
+		int games = 0;
+		NeuralNetwork left = nullptr, right = nullptr;	// must be different networks, each keeps its own batch
+		bool learnLeft = true, learnRight = true;
+		float speed = 1.8f;						// paddle speed
+		float LR = 1.8f, ACK = 0.2f;			// learning rate on a miss and on a hit
+		unsigned int StateTex = 0;				// column per game: ball x, y, speed, angle in row 0, paddles and scores in row 1
+		unsigned int seed = 0;
+		long long steps = 0;
+	};
+
+	unsigned int Observe = 0, Physics = 0;
+
+	const char* Observe_code =
+		"#version 420                                                                    \n"
+		"#extension GL_ARB_compute_shader : require                                      \n"
+		"#extension GL_ARB_shader_image_load_store : require                             \n"
+		"precision highp float;                                                          \n"
+		"layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+		"layout(rgba32f, binding = 0) readonly uniform image2D State;                    \n"
+		"layout(rgba32f, binding = 1) writeonly uniform image2D LeftInput;               \n"
+		"layout(rgba32f, binding = 2) writeonly uniform image2D RightInput;              \n"
+		"uniform int Games;                                                              \n"
+		"void main()                                                                     \n"
+		"{                                                                               \n"
+			//each network sees ball height, its own paddle and ball angle
+		"   int g = int(gl_GlobalInvocationID.x);                                        \n"
+		"   if(g >= Games)                                                               \n"
+		"       return;                                                                  \n"
+		"   vec4 ball = imageLoad(State, ivec2(g, 0));                                   \n"
+		"   vec4 pads = imageLoad(State, ivec2(g, 1));                                   \n"
+		"   imageStore(LeftInput, ivec2(0, g), vec4(ball.y / 550.0));                    \n"
+		"   imageStore(LeftInput, ivec2(1, g), vec4(pads.x / 550.0));                    \n"
+		"   imageStore(LeftInput, ivec2(2, g), vec4(ball.w));                            \n"
+		"   imageStore(RightInput, ivec2(0, g), vec4(ball.y / 550.0));                   \n"
+		"   imageStore(RightInput, ivec2(1, g), vec4(pads.y / 550.0));                   \n"
+		"   imageStore(RightInput, ivec2(2, g), vec4(ball.w));                           \n"
+		"}                                                                               \0"
+		;
+
+	const char* Physics_code =
+		"#version 420                                                                    \n"
+		"#extension GL_ARB_compute_shader : require                                      \n"
+		"#extension GL_ARB_shader_image_load_store : require                             \n"
+		"precision highp float;                                                          \n"
+		"layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;               \n"
+		"layout(rgba32f, binding = 0) uniform image2D State;                             \n"
+		"layout(rgba32f, binding = 1) readonly uniform image2D LeftOutput;               \n"
+		"layout(rgba32f, binding = 2) readonly uniform image2D RightOutput;              \n"
+		"layout(rgba32f, binding = 3) writeonly uniform image2D LeftTargets;             \n"
+		"layout(rgba32f, binding = 4) writeonly uniform image2D RightTargets;            \n"
+		"uniform int Games;                                                              \n"
+		"uniform int Step;                                                               \n"
+		"uniform uint Seed;                                                              \n"
+		"uniform float Speed;                                                            \n"
+		"uniform float HitRate;                                                          \n"
+		"uniform float MissRate;                                                         \n"
+		"uniform vec2 Learn;                                                             \n"
+		"uint hash(uint x)                                                               \n"
+		"{                                                                               \n"
+		"   x ^= x >> 16; x *= 0x7feb352dU; x ^= x >> 15; x *= 0x846ca68bU; x ^= x >> 16;\n"
+		"   return x;                                                                    \n"
+		"}                                                                               \n"
+		"void main()                                                                     \n"
+		"{                                                                               \n"
+		"   int g = int(gl_GlobalInvocationID.x);                                        \n"
+		"   if(g >= Games)                                                               \n"
+		"       return;                                                                  \n"
+		"   vec4 ball = imageLoad(State, ivec2(g, 0));                                   \n"
+		"   vec4 pads = imageLoad(State, ivec2(g, 1));                                   \n"
+
+			//first output up, second down
+		"   float up1 = imageLoad(LeftOutput, ivec2(0, g)).r;                            \n"
+		"   float down1 = imageLoad(LeftOutput, ivec2(1, g)).r;                          \n"
+		"   float up2 = imageLoad(RightOutput, ivec2(0, g)).r;                           \n"
+		"   float down2 = imageLoad(RightOutput, ivec2(1, g)).r;                         \n"
+		"   pads.x = clamp(pads.x + (up1 > down1 ? -6.2 : 6.2) * Speed, 30.0, 380.0);    \n"
+		"   pads.y = clamp(pads.y + (up2 > down2 ? -6.2 : 6.2) * Speed, 30.0, 380.0);    \n"
+		"   ball.x += ball.z;                                                            \n"
+		"   ball.y += ball.w;                                                            \n"
+
+			//label says which half of paddle ball was at, weight 0 leaves game out of training
+		"   float label1 = 0.0, weight1 = 0.0, label2 = 0.0, weight2 = 0.0;              \n"
+		"   if(ball.x < 40.0 && ball.y > pads.x && ball.y < pads.x + 200.0)              \n"
+		"   {                                                                            \n"
+		"       ball.z = -ball.z + 0.8;                                                  \n"
+		"       ball.w += (pads.x + 100.0 - ball.x) / 270.0;                             \n"
+		"       label1 = ball.y < pads.x + 100.0 ? 1.0 : 0.0;                            \n"
+		"       weight1 = HitRate * Learn.x;                                             \n"
+		"   }                                                                            \n"
+		"   if(ball.x > 750.0 && ball.y > pads.y && ball.y < pads.y + 200.0)             \n"
+		"   {                                                                            \n"
+		"       ball.z = -ball.z - 0.8;                                                  \n"
+		"       ball.w += (pads.y + 100.0 - ball.x) / 270.0;                             \n"
+		"       label2 = ball.y < pads.y + 100.0 ? 1.0 : 0.0;                            \n"
+		"       weight2 = HitRate * Learn.y;                                             \n"
+		"   }                                                                            \n"
+		"   if(ball.y > 560.0 || ball.y < 25.0)                                          \n"
+		"       ball.w = -ball.w;                                                        \n"
+		"   if(ball.x > 800.0 || ball.x < 0.0)                                           \n"
+		"   {                                                                            \n"
+		"       if(ball.x < 0.0)                                                         \n"
+		"       {                                                                        \n"
+		"           label1 = ball.y < pads.x + 100.0 ? 1.0 : 0.0;                        \n"
+		"           weight1 = MissRate * Learn.x;                                        \n"
+		"       }                                                                        \n"
+		"       if(ball.x > 800.0)                                                       \n"
+		"       {                                                                        \n"
+		"           label2 = ball.y < pads.y + 100.0 ? 1.0 : 0.0;                        \n"
+		"           weight2 = MissRate * Learn.y;                                        \n"
+		"       }                                                                        \n"
+		"       if(ball.z > 0.0)                                                         \n"
+		"           pads.z += 1.0;                                                       \n"
+		"       else                                                                     \n"
+		"           pads.w += 1.0;                                                       \n"
+		"       ball.xy = vec2(400.0, 300.0);                                            \n"
+		"       ball.w = float(hash(Seed ^ hash(uint(g) ^ hash(uint(Step)))) % 20U);     \n"
+		"   }                                                                            \n"
+		"   ball.z = min(ball.z, 10.0);                                                  \n"
+		"   imageStore(State, ivec2(g, 0), ball);                                        \n"
+		"   imageStore(State, ivec2(g, 1), pads);                                        \n"
+		"   imageStore(LeftTargets, ivec2(0, g), vec4(label1, weight1, 0.0, 1.0));       \n"
+		"   imageStore(LeftTargets, ivec2(1, g), vec4(1.0 - label1, weight1, 0.0, 1.0)); \n"
+		"   imageStore(RightTargets, ivec2(0, g), vec4(label2, weight2, 0.0, 1.0));      \n"
+		"   imageStore(RightTargets, ivec2(1, g), vec4(1.0 - label2, weight2, 0.0, 1.0));\n"
+		"}                                                                               \0"
+		;
+
+	//Build kernels once, after InitNeuralLink()
+	bool init() {
+		if(!Observe)
+			Observe = HermesNetwork::buildKernel(Observe_code, false);
+		if(!Physics)
+			Physics = HermesNetwork::buildKernel(Physics_code, false);
+		return Observe && Physics;
+	}
+
+	//Games start like the demo: ball in the middle at a random angle, paddles at 90. Left and Right
+	//need 3 inputs, 2 outputs and must take batches of Games rows, at most GL_MAX_TEXTURE_SIZE. Returns nullptr otherwise
+	Environment* create(int Games, NeuralNetwork Left, NeuralNetwork Right, unsigned int Seed) {
+		if(!init() || Left == Right || Left->no_of_input != 3 || Right->no_of_input != 3 || Left->no_of_output != 2 || Right->no_of_output != 2
+		   || !HermesNetwork::batchSupported(Left) || !HermesNetwork::batchSupported(Right))
+			return nullptr;
+
+		/* games run batch kernels on the networks' textures */
+		HermesNetwork::requireDevice(Left);
+		HermesNetwork::requireDevice(Right);
+		if(!HermesNetwork::reserveBatch(Left, Games) || !HermesNetwork::reserveBatch(Right, Games))
+			return nullptr;
+
+		Environment* env = new Environment;
+		env->games = Games;
+		env->left = Left;
+		env->right = Right;
+		env->seed = Seed;
+
+		std::mt19937 rng(Seed);
+		std::vector<float> state(8 * Games);
+		for(int g = 0; g < Games; g++) {
+			float* ball = &state[4 * g];
+			float* pads = &state[4 * (Games + g)];
+			ball[0] = 400; ball[1] = 300; ball[2] = 6.0f; ball[3] = (float)(rng() % 20);
+			pads[0] = 90; pads[1] = 90; pads[2] = 0; pads[3] = 0;
+		}
+		env->StateTex = HermesNetwork::createDataTexture(Games, 2, GL_RGBA32F, GL_RGBA, GL_FLOAT, state.data());
+		HermesNetwork::countUpload(sizeof(float) * state.size());
+		return env;
+	}
+
+	//Advance every game Steps times: observe, run both networks, move and train on hits and misses
+	void step(Environment* Env, int Steps = 1) {
+		using namespace HermesNetwork;
+		TraceScope trace("PingPongEnv::step");
+		useNetwork(Env->left, Env->right);
+		useNetwork(Env->right, Env->left);
+		int groups = (Env->games + 63) / 64;
+		for(int k = 0; k < Steps; k++) {
+			glUseProgram(Observe);
+			glUniform1i(glGetUniformLocation(Observe, "Games"), Env->games);
+			glBindImageTexture(0, Env->StateTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+			glBindImageTexture(1, Env->left->inputLayer->BatchTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+			glBindImageTexture(2, Env->right->inputLayer->BatchTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+			dispatchCompute(groups, 1, 1);
+			memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+			triggerBatch(Env->left, Env->games);
+			triggerBatch(Env->right, Env->games);
+
+			glUseProgram(Physics);
+			glUniform1i(glGetUniformLocation(Physics, "Games"), Env->games);
+			glUniform1i(glGetUniformLocation(Physics, "Step"), (int)Env->steps);
+			glUniform1ui(glGetUniformLocation(Physics, "Seed"), Env->seed);
+			glUniform1f(glGetUniformLocation(Physics, "Speed"), Env->speed);
+			glUniform1f(glGetUniformLocation(Physics, "HitRate"), Env->ACK);
+			glUniform1f(glGetUniformLocation(Physics, "MissRate"), Env->LR);
+			glUniform2f(glGetUniformLocation(Physics, "Learn"), Env->learnLeft ? 1.0f : 0.0f, Env->learnRight ? 1.0f : 0.0f);
+			glBindImageTexture(0, Env->StateTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+			glBindImageTexture(1, Env->left->outputLayer->BatchTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+			glBindImageTexture(2, Env->right->outputLayer->BatchTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+			glBindImageTexture(3, Env->left->BatchTargetTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+			glBindImageTexture(4, Env->right->BatchTargetTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+			dispatchCompute(groups, 1, 1);
+			memoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+			/* each network takes one update from the mean of its games' hits and misses this step */
+			if(Env->learnLeft)
+				trainBatch(Env->left, Env->games, 1.0f);
+			if(Env->learnRight)
+				trainBatch(Env->right, Env->games, 1.0f);
+			Env->steps++;
+		}
+	}
+
+	//Whole state texture, ball of game g at 4 * g and its paddles and scores at 4 * (games + g)
+	std::vector<float> readState(Environment* Env) {
+		std::vector<float> state(8 * Env->games);
+		glBindTexture(GL_TEXTURE_2D, Env->StateTex);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, state.data());
+		glBindTexture(GL_TEXTURE_2D, 0);
+		HermesNetwork::countReadback(sizeof(float) * state.size());
+		return state;
+	}
+
+	//Read back one game, for drawing
+	Game sample(Environment* Env, int Index) {
+		std::vector<float> state = readState(Env);
+		const float* ball = &state[4 * Index];
+		const float* pads = &state[4 * (Env->games + Index)];
+		return { ball[0], ball[1], ball[2], ball[3], pads[0], pads[1], { (int)pads[2], (int)pads[3] } };
+	}
+
+	//Points of left and right player summed over every game
+	void totalScore(Environment* Env, long long Score[2]) {
+		std::vector<float> state = readState(Env);
+		Score[0] = Score[1] = 0;
+		for(int g = 0; g < Env->games; g++) {
+			Score[0] += (long long)state[4 * (Env->games + g) + 2];
+			Score[1] += (long long)state[4 * (Env->games + g) + 3];
+		}
+	}
+
+	void destroy(Environment* Env) {
+		if(!Env)
+			return;
+		glDeleteTextures(1, &Env->StateTex);
+		delete Env;
+	}
+}
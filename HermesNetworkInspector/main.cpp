@@ -4,11 +4,17 @@
 
 #include <HermesNetwork.h>
 #include <PingPongDemo.h>
+#include <BackgroundTrainer.h>
 
 void Theme1();
 void DrawLogicGateTrainer();
 void CreateNeuralNetwork();
 void DeleteNeuralNetwork();
+void TrainStep();
+void PublishOutputs(Trainer::Snapshot& S);
+void LogicGateTargets(int Row);
+void LogicGateStep();
+void PublishLogicGates(Trainer::Snapshot& S);
 
 namespace LogicGateTrainer {
 	bool enable = false, end = false;
@@ -57,12 +63,18 @@ int main() {
 	char FILE[50] = "";	
 	
 	InitNeuralLink(true);
+	Trainer::init(window);
 	
 	Theme1();
 	ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 15.0f);
 	ImGui::PushStyleVar(ImGuiStyleVar_FrameRounding, 5.0f);			
 
 	while (!glfwWindowShouldClose(window)) {
+		Trainer::uiWaiting = true;
+		std::unique_lock<std::mutex> gpu(Trainer::gpu);
+		Trainer::uiWaiting = false;
+		Trainer::acquire(Trainer::workerDone);
+
 		ImGui::StartCleanWindow(window);				
 
 		ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, {4,3});
@@ -80,9 +92,15 @@ int main() {
 					PingPong::N2 = NetworkBuilder(3, {}, 2);
 					Terrify(PingPong::N1);
 					Terrify(PingPong::N2);
-					PingPong::scoreboard[0] = PingPong::scoreboard[1] = 0;
 					PingPong::speed = 1.8f;
-					PingPong::ballspeed = 6.0;
+					PingPong::env = PingPongEnv::create(PingPong::games, PingPong::N1, PingPong::N2, rand());
+					if(!PingPong::env) {
+						DeleteNetwork(PingPong::N1);
+						DeleteNetwork(PingPong::N2);
+						PingPong::N1 = NULL;
+						PingPong::N2 = NULL;
+						PingPong::Enable = false;
+					}
 				}
 			}
             ImGui::SameLine();
@@ -203,8 +221,11 @@ int main() {
 					// call hermisNetwork Train
 					TrainNetwork(NN, OUTPUTdata, learningRate);
 				}
+				if (ImGui::CollapsingHeader("Background Training"))
+					Trainer::DrawControls(&controlPanel, TrainStep, PublishOutputs);
 				ImGui::PushItemWidth(180);
 				ImGui::DragFloat("Learning Rate", &learningRate, 0.02f);
+				ImGui::DragFloat("Live Refresh/s", &HermesNetwork::snapshotRate, 1.0f, 0.0f, 240.0f);
 				const uint32_t step = 1;
                 if(ImGui::InputScalar("Batch Size", ImGuiDataType_U32, &NN->batchSize, &step));
                 if(ImGui::Button("Sigmoid")) {
@@ -337,14 +358,15 @@ int main() {
 							glUniform1i(HermesNetwork::WINT_unifm_seed, rand());
 							glDispatchCompute(L->no_weight, 1, 1);
 							glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+							L->weightVersion++;
 						}
-						HermesNetwork::fetchLayerWeights_Bias(L);						
+						const HermesNetwork::LayerSnapshot& snap = HermesNetwork::snapshotLayer(L, true);
 						/*if (NEURONS_DATA == nullptr)
 							NEURONS_DATA = HermesNetwork::getWeights_Bias(NN, i + 1);*/
 						ImGui::BeginChild("HL Weights Data", { 300,40 }, true, ImGuiWindowFlags_HorizontalScrollbar);
-						for (int j = 0; j < L->no_weight; j++)
+						for (int j = 0; j < snap.values.size(); j++)
 						{
-							ImGui::TextColored({ 1,0,0,1 }, "%f ", L->weights[j]);
+							ImGui::TextColored({ 1,0,0,1 }, "%f ", snap.values[j]);
 							ImGui::SameLine();
 						}
 						ImGui::EndChild();
@@ -373,11 +395,11 @@ int main() {
 						}
 						/*if (NEURONS_DATA == nullptr)
 							NEURONS_DATA = HermesNetwork::getLayerNeuronsData(NN, i+1);*/
-						HermesNetwork::fetchLayerNeuronsData(L);
+						const HermesNetwork::LayerSnapshot& snap = HermesNetwork::snapshotLayer(L, false);
 						ImGui::BeginChild("Neurons Data", { 300,40 }, true, ImGuiWindowFlags_HorizontalScrollbar);
-						for (int j = 0; j < hiddenLayers[i]; j++)
+						for (int j = 0; j < snap.values.size(); j++)
 						{
-							ImGui::TextColored({ 1,0,0,1 }, "%f ", L->data[j]);
+							ImGui::TextColored({ 1,0,0,1 }, "%f ", snap.values[j]);
 							ImGui::SameLine();
 						}
 						ImGui::EndChild();
@@ -401,16 +423,17 @@ int main() {
 						glUniform1i(HermesNetwork::WINT_unifm_seed, rand());
 						glDispatchCompute(L->no_weight, 1, 1);
 						glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+						L->weightVersion++;
 					}
 					/*if (NEURONS_DATA == nullptr)
 						NEURONS_DATA = HermesNetwork::getWeights_Bias(NN, NN->no_layers - 1);*/
-					HermesNetwork::fetchLayerWeights_Bias(L);
+					const HermesNetwork::LayerSnapshot& snap = HermesNetwork::snapshotLayer(L, true);
 
 					{
 						ImGui::BeginChild("Neurons Data", { 300,40 }, true, ImGuiWindowFlags_HorizontalScrollbar);
-						for (int i = 0; i < NN->outputLayer->no_weight; i++)
+						for (int i = 0; i < snap.values.size(); i++)
 						{
-							ImGui::TextColored({ 1,0,0,1 }, "%f ", L->weights[i]);							
+							ImGui::TextColored({ 1,0,0,1 }, "%f ", snap.values[i]);							
 							ImGui::SameLine();
 						}
 
@@ -437,13 +460,13 @@ int main() {
 					}
 					/*if (NEURONS_DATA == nullptr)
 						NEURONS_DATA = HermesNetwork::getLayerNeuronsData(NN,NN->no_layers-1);*/
-					HermesNetwork::fetchLayerNeuronsData(L);
+					const HermesNetwork::LayerSnapshot& snap = HermesNetwork::snapshotLayer(L, false);
 					//else
 					{
 						ImGui::BeginChild("Neurons Data", { 300,40 }, true, ImGuiWindowFlags_HorizontalScrollbar);
-						for (int i = 0; i < Input_OutputLayer[1]; i++)
+						for (int i = 0; i < snap.values.size(); i++)
 						{
-							ImGui::TextColored({ 1,0,0,1 }, "%f ", L->data[i]);
+							ImGui::TextColored({ 1,0,0,1 }, "%f ", snap.values[i]);
 							ImGui::SameLine();
 						}
 
@@ -464,9 +487,13 @@ int main() {
 		DrawPingPong();	
 		DrawLogicGateTrainer();
 		ImGui::ShowDemoWindow();
+
+		Trainer::release(Trainer::uiDone);
+		gpu.unlock();
 		
 		ImGui::EndCleanWindow(window);
 	}
+	Trainer::shutdown();
 	ImGui::PopStyleVar(2);
 	ImGui::terminateImGui();
 	ImGui::terminateGLFW(window);
@@ -494,7 +521,8 @@ void DeleteNeuralNetwork() {
 	activationType = ActivationType::Sigmoid;
 	hiddenLayerSize = 0;
 	controlPanel = false;
-	delete NN;
+	Trainer::stop();
+	DeleteNetwork(NN);
 	NN = nullptr;
 }
 
@@ -558,6 +586,70 @@ void Theme1()
 }
 
 
+//Train control panel's network on its input and output, like Train Network button
+void TrainStep() {
+	SendInputs(NN, INPUTdata);
+	TriggerNetwork(NN);
+	TrainNetwork(NN, OUTPUTdata, learningRate);
+}
+
+void PublishOutputs(Trainer::Snapshot& S) {
+	SendInputs(NN, INPUTdata);
+	TriggerNetwork(NN);
+	FetchOutputLayerData(NN);
+	S.outputs.assign(NN->Out, NN->Out + Input_OutputLayer[1]);
+	for(int k = 0; k < Input_OutputLayer[1]; k++)
+		S.loss += (OUTPUTdata[k] - NN->Out[k]) * (OUTPUTdata[k] - NN->Out[k]) / Input_OutputLayer[1];
+}
+
+//Fill OUTPUTdata with selected gates' outputs for a row of truth table
+void LogicGateTargets(int Row) {
+	int outIdx = 0;
+	if(LogicGateTrainer::andTrain) {
+		OUTPUTdata[outIdx] = LogicGateTrainer::AND[Row];
+		outIdx ++;
+	}
+	if(LogicGateTrainer::orTrain) {
+		OUTPUTdata[outIdx] = LogicGateTrainer::OR[Row];
+		outIdx ++;
+	}
+	if(LogicGateTrainer::xorTrain) {
+		OUTPUTdata[outIdx] = LogicGateTrainer::XOR[Row];
+		outIdx ++;						
+	}
+}
+
+//Train on next row of truth table
+void LogicGateStep() {
+	INPUTdata[0] = LogicGateTrainer::TT[LogicGateTrainer::inpIndex][0];
+	INPUTdata[1] = LogicGateTrainer::TT[LogicGateTrainer::inpIndex][1];
+	SendInputs(NN, INPUTdata);
+	TriggerNetwork(NN);
+	LogicGateTargets(LogicGateTrainer::inpIndex);
+	TrainNetwork(NN, OUTPUTdata, learningRate);
+
+	LogicGateTrainer::inpIndex ++;
+	if(LogicGateTrainer::inpIndex > 3)
+		LogicGateTrainer::inpIndex = 0;
+}
+
+//Outputs of every row, row after row, and their mean squared error
+void PublishLogicGates(Trainer::Snapshot& S) {
+	int outputs = Input_OutputLayer[1];
+	for(int i = 0; i < 4; i++) {
+		INPUTdata[0] = LogicGateTrainer::TT[i][0];
+		INPUTdata[1] = LogicGateTrainer::TT[i][1];
+		SendInputs(NN, INPUTdata);
+		TriggerNetwork(NN);
+		FetchOutputLayerData(NN);
+		LogicGateTargets(i);
+		for(int k = 0; k < outputs; k++) {
+			S.outputs.push_back(NN->Out[k]);
+			S.loss += (OUTPUTdata[k] - NN->Out[k]) * (OUTPUTdata[k] - NN->Out[k]) / (4 * outputs);
+		}
+	}
+}
+
 void DrawLogicGateTrainer() {
 	if(LogicGateTrainer::enable) {
 		ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(20,20));
@@ -637,37 +729,11 @@ void DrawLogicGateTrainer() {
 				}
 
 				ImGui::Spacing();
-				ImGui::Button("Learn [click & hold]");
-				if(ImGui::IsItemActive()) {
-					INPUTdata[0] = LogicGateTrainer::TT[LogicGateTrainer::inpIndex][0];
-					INPUTdata[1] = LogicGateTrainer::TT[LogicGateTrainer::inpIndex][1];
-					SendInputs(NN, INPUTdata);
-					TriggerNetwork(NN);
-					FetchOutputLayerData(NN);
-
-					for(int k = 0; k < Input_OutputLayer[1]; k++) {
-						LogicGateTrainer::Result[LogicGateTrainer::inpIndex][k] = NN->Out[k];
-					}
-
-					int outIdx = 0;
-					if(LogicGateTrainer::andTrain) {
-						OUTPUTdata[outIdx] = LogicGateTrainer::AND[LogicGateTrainer::inpIndex];
-						outIdx ++;
-					}
-					if(LogicGateTrainer::orTrain) {
-						OUTPUTdata[outIdx] = LogicGateTrainer::OR[LogicGateTrainer::inpIndex];
-						outIdx ++;
-					}
-					if(LogicGateTrainer::xorTrain) {
-						OUTPUTdata[outIdx] = LogicGateTrainer::XOR[LogicGateTrainer::inpIndex];
-						outIdx ++;						
-					}
-
-					TrainNetwork(NN, OUTPUTdata, learningRate);
-
-					LogicGateTrainer::inpIndex ++;
-					if(LogicGateTrainer::inpIndex > 3)
-						LogicGateTrainer::inpIndex = 0;
+				Trainer::DrawControls(&LogicGateTrainer::enable, LogicGateStep, PublishLogicGates);
+				if(Trainer::owner == &LogicGateTrainer::enable && Trainer::published.outputs.size() == 4 * Input_OutputLayer[1]) {
+					for(int i = 0; i < 4; i++)
+						for(int k = 0; k < Input_OutputLayer[1]; k++)
+							LogicGateTrainer::Result[i][k] = Trainer::published.outputs[i * Input_OutputLayer[1] + k];
 				}
 
 				if(ImGui::Button("Trigger")) {
@@ -697,6 +763,8 @@ void DrawLogicGateTrainer() {
 		}
 
 		if(!LogicGateTrainer::enable) {
+			if(Trainer::owner == &LogicGateTrainer::enable)
+				Trainer::stop();
 			LogicGateTrainer::andTrain = false;
 			LogicGateTrainer::orTrain = false;
 			LogicGateTrainer::xorTrain = false;